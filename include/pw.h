@@ -16,6 +16,9 @@
 #include <pw_datetime.h>
 #include <pw_iterator.h>
 #include <pw_map.h>
+#include <pw_packed_array.h>
+#include <pw_reclaim.h>
+#include <pw_set.h>
 #include <pw_string.h>
 #include <pw_file.h>
 #include <pw_string_io.h>
@@ -14,10 +14,38 @@ extern "C" {
  * Constructors
  */
 
+// growth policies, applied when appended item does not fit
+#define PW_ARRAY_GROWTH_DOUBLE  0  // double the capacity, the default
+#define PW_ARRAY_GROWTH_1_5X    1  // grow by half of the capacity, less memory overhead
+#define PW_ARRAY_GROWTH_LINEAR  2  // grow by fixed increment, for arrays that barely change
+
+typedef struct {
+    /*
+     * Arguments for Array constructor.
+     *
+     * Subtypes of Array that have own constructor arguments
+     * should embed this structure as the first member.
+     * Deep copy of an array passes PwArrayCtorArgs to the constructor.
+     */
+    unsigned capacity;  // number of items the array can hold without growing
+    uint8_t growth;     // PW_ARRAY_GROWTH_*
+    bool acyclic;       // see pw_set_acyclic
+} PwArrayCtorArgs;
+
 [[nodiscard]] static inline bool pw_create_array(PwValuePtr result)
 {
     return pw_create(PwTypeId_Array, result);
 }
+/*
+ * Create array with default growth policy.
+ *
+ * To choose the policy or initial capacity, use:
+ *
+ * PwArrayCtorArgs args = { .capacity = 1000, .growth = PW_ARRAY_GROWTH_1_5X };
+ * if (pw_create2(PwTypeId_Array, &args, &array)) {
+ *     // success!
+ * }
+ */
 
 #define pw_array_va(result, ...)  \
     _pw_array_va((result), __VA_ARGS__ __VA_OPT__(,) PwVaEnd())
@@ -98,6 +126,25 @@ extern "C" {
  * Item are cloned before appending.
  */
 
+[[nodiscard]] bool pw_array_extend(PwValuePtr dest, PwValuePtr src);
+/*
+ * Append clones of all items of `src` array to `dest`.
+ * `src` can be the same array as `dest`.
+ *
+ * Unlike appending items one by one, the array is resized at most once
+ * and items are copied in bulk.
+ */
+
+[[nodiscard]] bool pw_array_extend_move(PwValuePtr dest, PwValuePtr values, unsigned n);
+/*
+ * Move `n` values to the end of `dest`, leaving Nulls in `values`.
+ * On failure `values` are left intact.
+ *
+ * This is the fastest way to build an array from parsed data:
+ * the array is resized at most once, only compound values need
+ * per-item processing and the rest are moved with memcpy.
+ */
+
 #define pw_array_insert(array, index, item) _Generic((item), \
              nullptr_t: _pw_array_insert_null,      \
                   bool: _pw_array_insert_bool,      \
@@ -124,6 +171,7 @@ extern "C" {
  * The basic insert function.
  *
  * `item` is cloned before inserting.
+ * Items are shifted towards the nearest end of array.
  */
 
 [[nodiscard]] static inline bool _pw_array_insert_null    (PwValuePtr array, unsigned index, PwType_Null     item) { _PwValue v = PW_NULL;              return _pw_array_insert(array, index, &v); }
@@ -163,6 +211,10 @@ extern "C" {
 [[nodiscard]] bool pw_array_pull(PwValuePtr array, PwValuePtr result);
 /*
  * Extract first item from the array.
+ *
+ * Items are not moved, the freed slot is reused by subsequent inserts
+ * at front or appends, so arrays can serve as queues and deques:
+ * append/pop and insert at 0/pull take amortized O(1).
  */
 
 [[nodiscard]] bool pw_array_pop(PwValuePtr array, PwValuePtr result);
@@ -200,6 +252,59 @@ extern "C" {
  */
 
 
+/****************************************************************
+ * Cursor
+ *
+ * Borrowing iteration over array items without cloning them.
+ * While the cursor is active the array cannot be modified,
+ * modifying functions fail with PW_ERROR_ITERATION_IN_PROGRESS.
+ */
+
+typedef struct {
+    _PwValue array;   // clone of iterated array, Null when iteration is stopped
+    PwValuePtr item;  // borrowed pointer to the current item, do not destroy or modify
+    unsigned index;   // index of the current item
+    unsigned _next;
+    unsigned _length;
+    PwValuePtr _items;
+} _PwArrayCursor;
+
+// automatically stopped cursor
+#define PwArrayCursor [[ gnu::cleanup(pw_array_cursor_stop) ]] _PwArrayCursor
+
+[[nodiscard]] _PwArrayCursor pw_array_cursor(PwValuePtr array);
+/*
+ * Start borrowing iteration.
+ *
+ * Example:
+ *
+ * PwArrayCursor cursor = pw_array_cursor(array);
+ * while (pw_array_cursor_next(&cursor)) {
+ *     // use cursor.item, clone it if it has to outlive the cursor
+ * }
+ */
+
+[[nodiscard]] static inline bool pw_array_cursor_next(_PwArrayCursor* cursor)
+/*
+ * Advance cursor to the next item.
+ * Return false when there are no more items.
+ */
+{
+    if (cursor->_next >= cursor->_length) {
+        return false;
+    }
+    cursor->index = cursor->_next++;
+    cursor->item = &cursor->_items[cursor->index];
+    return true;
+}
+
+void pw_array_cursor_stop(_PwArrayCursor* cursor);
+/*
+ * Stop iteration and release the array.
+ * Safe to call more than once.
+ */
+
+
 /****************************************************************
  * Iterator
  */
@@ -216,12 +321,67 @@ extern PwTypeId PwTypeId_ArrayIterator;
     return pw_create2(PwTypeId_ArrayIterator, &args, result);
 }
 
+/****************************************************************
+ * Slice views
+ */
+
+extern PwTypeId PwTypeId_ArraySlice;
+
+#define pw_is_array_slice(value)      pw_is_subtype((value), PwTypeId_ArraySlice)
+#define pw_assert_array_slice(value)  pw_assert(pw_is_array_slice(value))
+
+[[nodiscard]] bool pw_array_slice_view(PwValuePtr array, unsigned start_index, unsigned end_index, PwValuePtr result);
+/*
+ * Create a view of items from `start_index` to `end_index` (exclusive)
+ * without copying them. `array` can be an Array or another view.
+ *
+ * The view holds a reference to the array and reflects its current contents.
+ * If the array shrinks, the view is clamped to the array length.
+ *
+ * Writes to the view never affect the array: the first write turns
+ * the view into an owned copy of its items, see pw_array_slice_materialize.
+ *
+ * Views support RandomAccess interface.
+ */
+
+unsigned pw_array_slice_length(PwValuePtr view);
+
+[[nodiscard]] bool pw_array_slice_item(PwValuePtr view, unsigned index, PwValuePtr result);
+
+[[nodiscard]] bool pw_array_slice_set_item(PwValuePtr view, unsigned index, PwValuePtr item);
+/*
+ * Materialize the view and set item.
+ */
+
+[[nodiscard]] bool pw_array_slice_materialize(PwValuePtr view);
+/*
+ * Copy items to the array owned by the view and release the referenced array.
+ * Do nothing if the view is materialized already.
+ */
+
+[[nodiscard]] bool pw_array_slice_to_array(PwValuePtr view, PwValuePtr result);
+/*
+ * Create new Array from items of the view.
+ */
+
+[[nodiscard]] _PwArrayCursor pw_array_slice_cursor(PwValuePtr view);
+/*
+ * Start borrowing iteration over items of the view.
+ * The cursor blocks modifications of the underlying array,
+ * `index` is relative to the start of the view.
+ */
+
 /****************************************************************
  * Miscellaneous array functions
  */
 
 [[nodiscard]] bool pw_array_resize(PwValuePtr array, unsigned desired_capacity);
 
+[[nodiscard]] bool pw_array_shrink(PwValuePtr array);
+/*
+ * Release unused capacity.
+ */
+
 unsigned pw_array_length(PwValuePtr array);
 
 void pw_array_del(PwValuePtr array, unsigned start_index, unsigned end_index);
@@ -238,6 +398,31 @@ void pw_array_clean(PwValuePtr array);
 [[nodiscard]] bool pw_array_slice(PwValuePtr array, unsigned start_index, unsigned end_index, PwValuePtr result);
 /*
  * Make shallow copy of the given range of array.
+ * Use pw_array_slice_view to avoid copying.
+ */
+
+typedef struct {
+    bool stable;  // keep order of equal items
+
+    [[ gnu::warn_unused_result ]] bool (*key)(PwValuePtr item, PwValuePtr result);
+    /*
+     * Optional function that computes the sort key for `item`.
+     * Keys are computed once per item.
+     */
+
+    unsigned num_threads;  // for large arrays of strings, 0 or 1 means single thread
+} PwSortOptions;
+
+[[nodiscard]] bool pw_array_sort(PwValuePtr array, PwSortOptions* options);
+/*
+ * Sort array inplace in ascending order.
+ * Items or keys are compared with pw_compare.
+ * `options` can be nullptr, in this case sort is unstable, without key function.
+ *
+ * Homogeneous Signed, Unsigned, Float, and Timestamp keys are sorted with
+ * radix sort which is always stable.
+ * Keys that cannot be compared make the function return false
+ * with PW_ERROR_INCOMPATIBLE_TYPE, the array is left unchanged.
  */
 
 [[nodiscard]] bool pw_array_dedent(PwValuePtr lines);
@@ -30,6 +30,13 @@ PwType_Hash pw_hash(PwValuePtr value);
  * Calculate hash of value.
  */
 
+[[nodiscard]] bool _pw_hash_utf8(char8_t* str, unsigned size, PwType_Hash* result);
+/*
+ * Calculate hash of String made of UTF-8 buffer without creating it.
+ * Invalid and incomplete UTF-8 sequences are skipped as pw_create_string does.
+ * Always return true.
+ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,11 @@ extern "C" {
  * Get array length
  */
 
+#define PW_CMP(a, b)  (((a) > (b)) - ((a) < (b)))
+/*
+ * Three-way comparison of scalars: -1, 0, or 1
+ */
+
 #define _pw_likely(x)    __builtin_expect(!!(x), 1)
 #define _pw_unlikely(x)  __builtin_expect(!!(x), 0)
 /*
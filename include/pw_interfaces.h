@@ -25,6 +25,7 @@ typedef struct __PwInterface _PwInterface;
 #define PwInterfaceId_Writer        2
 #define PwInterfaceId_LineReader    3  // iterator interface
 #define PwInterfaceId_Append        4
+#define PwInterfaceId_Comparison    5
 
 /****************************************************************
  * RandomAccess interface
@@ -119,6 +120,26 @@ typedef struct {
 } PwInterface_Append;
 
 
+/****************************************************************
+ * Comparison interface
+ *
+ * Implemented by Null, Bool, numbers, DateTime, Timestamp, String, and Array.
+ * Numbers of different types are compared by value.
+ * NaN is greater than any number and equal to itself, so that
+ * floats are totally ordered.
+ */
+
+typedef struct {
+    [[ gnu::warn_unused_result ]] bool (*compare)(PwValuePtr self, PwValuePtr other, int* result);
+    /*
+     * Set `result` to negative value if self < other, zero if they are equal,
+     * and positive value if self > other.
+     * Return false with PW_ERROR_INCOMPATIBLE_TYPE if values cannot be ordered.
+     */
+
+} PwInterface_Comparison;
+
+
 /*
 // TBD, TODO
 #define PwInterfaceId_Logic         0
@@ -127,8 +148,6 @@ typedef struct {
     // TBD
 #define PwInterfaceId_Bitwise       2
     // TBD
-#define PwInterfaceId_Comparison    3
-    // PwMethodCompare  -- compare_sametype, compare;
 #define PwInterfaceId_String        5
     // TBD substring, truncate, trim, append_substring, etc
 #define PwInterfaceId_Array         6
@@ -229,6 +248,13 @@ static inline bool _pw_has_interface(PwTypeId type_id, unsigned interface_id)
     return pw_interface(container->type_id, Append)->append(container, value);
 }
 
+[[nodiscard]] bool pw_compare(PwValuePtr a, PwValuePtr b, int* result);
+/*
+ * Compare values using Comparison interface of `a`.
+ * Return false with PW_ERROR_INCOMPATIBLE_TYPE if `a` does not support
+ * the interface or values cannot be ordered.
+ */
+
 #ifdef __cplusplus
 }
 #endif
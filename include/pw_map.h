@@ -10,10 +10,47 @@ extern "C" {
  * Constructors
  */
 
+// hash table engines
+#define PW_MAP_ENGINE_LINEAR  0  // variable width index slots probed one at a time, the default
+#define PW_MAP_ENGINE_SWISS   1  // 7-bit hash fragments in control bytes probed 16 slots at a time
+
+typedef struct {
+    /*
+     * Arguments for Map constructor.
+     *
+     * Subtypes of Map that have own constructor arguments
+     * should embed this structure as the first member.
+     * Deep copy of a map passes PwMapCtorArgs to the constructor.
+     */
+    uint8_t engine;     // hash table engine
+    unsigned capacity;  // number of items the map can hold without growing
+    bool acyclic;       // see pw_set_acyclic
+} PwMapCtorArgs;
+
 [[nodiscard]] static inline bool pw_create_map(PwValuePtr result)
 {
     return pw_create(PwTypeId_Map, result);
 }
+/*
+ * Create map with default hash table engine.
+ *
+ * To choose the engine or initial capacity, use:
+ *
+ * PwMapCtorArgs args = { .engine = PW_MAP_ENGINE_SWISS, .capacity = 1000 };
+ * if (pw_create2(PwTypeId_Map, &args, &map)) {
+ *     // success!
+ * }
+ */
+
+[[nodiscard]] bool pw_create_map_from_pairs(PwValuePtr kv_pairs, unsigned num_pairs, PwValuePtr result);
+/*
+ * Create map from C array of alternating keys and values.
+ * The map is sized once for `num_pairs` items.
+ *
+ * Keys are deep-copied, same as in pw_map_update, values are moved.
+ * All items of `kv_pairs` are Null on return, even if an error occured.
+ * If a key occurs more than once, the last value wins.
+ */
 
 #define pw_map_va(result, ...)  \
     _pw_map_va((result), __VA_ARGS__  __VA_OPT__(,) PwVaEnd())
@@ -85,13 +122,21 @@ extern "C" {
 
 bool _pw_map_has_key(PwValuePtr map, PwValuePtr key);
 
+[[nodiscard]] bool pw_map_has_key_utf8_buf(PwValuePtr map, char8_t* key, unsigned key_size);
+/*
+ * Check if `map` has string key equal to UTF-8 buffer `key` of `key_size` bytes.
+ * The buffer does not have to be null-terminated.
+ * No temporary string is created. Invalid UTF-8 sequences are skipped
+ * as pw_create_string does, so the key created from the same buffer matches.
+ */
+
 [[nodiscard]] static inline bool _pw_map_has_key_null    (PwValuePtr map, PwType_Null     key) { _PwValue k = PW_NULL;          return _pw_map_has_key(map, &k); }
 [[nodiscard]] static inline bool _pw_map_has_key_bool    (PwValuePtr map, PwType_Bool     key) { _PwValue k = PW_BOOL(key);     return _pw_map_has_key(map, &k); }
 [[nodiscard]] static inline bool _pw_map_has_key_signed  (PwValuePtr map, PwType_Signed   key) { _PwValue k = PW_SIGNED(key);   return _pw_map_has_key(map, &k); }
 [[nodiscard]] static inline bool _pw_map_has_key_unsigned(PwValuePtr map, PwType_Unsigned key) { _PwValue k = PW_UNSIGNED(key); return _pw_map_has_key(map, &k); }
 [[nodiscard]] static inline bool _pw_map_has_key_float   (PwValuePtr map, PwType_Float    key) { _PwValue k = PW_FLOAT(key);    return _pw_map_has_key(map, &k); }
 [[nodiscard]] static inline bool _pw_map_has_key_ascii   (PwValuePtr map, char*           key) { _PwValue k = PwStaticString(key); return _pw_map_has_key(map, &k); }
-[[nodiscard]] static inline bool _pw_map_has_key_utf8    (PwValuePtr map, char8_t*        key) { PwValue k = PW_NULL; if (!pw_create_string(key, &k)) { pw_panic("OOM"); } return _pw_map_has_key(map, &k); }
+[[nodiscard]] static inline bool _pw_map_has_key_utf8    (PwValuePtr map, char8_t*        key) { return pw_map_has_key_utf8_buf(map, key, strlen((char*) key)); }
 [[nodiscard]] static inline bool _pw_map_has_key_utf32   (PwValuePtr map, char32_t*       key) { _PwValue k = PwStaticStringUtf32(key); return _pw_map_has_key(map, &k); }
 
 
@@ -123,16 +168,103 @@ bool _pw_map_has_key(PwValuePtr map, PwValuePtr key);
 
 [[nodiscard]] bool _pw_map_get(PwValuePtr map, PwValuePtr key, PwValuePtr result);
 
+[[nodiscard]] bool pw_map_get_utf8_buf(PwValuePtr map, char8_t* key, unsigned key_size, PwValuePtr result);
+/*
+ * Get value by string key given as UTF-8 buffer, same as pw_map_has_key_utf8_buf.
+ */
+
 [[nodiscard]] static inline bool _pw_map_get_null    (PwValuePtr map, PwType_Null     key, PwValuePtr result) { _PwValue k = PW_NULL;          return _pw_map_get(map, &k, result); }
 [[nodiscard]] static inline bool _pw_map_get_bool    (PwValuePtr map, PwType_Bool     key, PwValuePtr result) { _PwValue k = PW_BOOL(key);     return _pw_map_get(map, &k, result); }
 [[nodiscard]] static inline bool _pw_map_get_signed  (PwValuePtr map, PwType_Signed   key, PwValuePtr result) { _PwValue k = PW_SIGNED(key);   return _pw_map_get(map, &k, result); }
 [[nodiscard]] static inline bool _pw_map_get_unsigned(PwValuePtr map, PwType_Unsigned key, PwValuePtr result) { _PwValue k = PW_UNSIGNED(key); return _pw_map_get(map, &k, result); }
 [[nodiscard]] static inline bool _pw_map_get_float   (PwValuePtr map, PwType_Float    key, PwValuePtr result) { _PwValue k = PW_FLOAT(key);    return _pw_map_get(map, &k, result); }
 [[nodiscard]] static inline bool _pw_map_get_ascii   (PwValuePtr map, char*           key, PwValuePtr result) { _PwValue k = PwStaticString(key); return _pw_map_get(map, &k, result); }
-[[nodiscard]] static inline bool _pw_map_get_utf8    (PwValuePtr map, char8_t*        key, PwValuePtr result) { PwValue k = PW_NULL; if (!pw_create_string(key, &k)) { pw_panic("OOM"); } return _pw_map_get(map, &k, result); }
+[[nodiscard]] static inline bool _pw_map_get_utf8    (PwValuePtr map, char8_t*        key, PwValuePtr result) { return pw_map_get_utf8_buf(map, key, strlen((char*) key), result); }
 [[nodiscard]] static inline bool _pw_map_get_utf32   (PwValuePtr map, char32_t*       key, PwValuePtr result) { _PwValue k = PwStaticStringUtf32(key); return _pw_map_get(map, &k, result); }
 
 
+/****************************************************************
+ * Get-or-insert: find value by `key` with a single lookup and
+ * borrow it. If `key` is not in the `map`, insert a deep copy
+ * of `default_value` first.
+ *
+ * Like the cursor, the slot holds the map: while it is active
+ * the map cannot be modified, modifying functions fail with
+ * PW_ERROR_ITERATION_IN_PROGRESS, so slot.value never goes stale.
+ * Slots for existing keys can be obtained while the map is held,
+ * inserting a new key fails.
+ *
+ * Scalar values can be changed in place, compound values
+ * can be modified (e.g. appended to). Do not assign to slot.value,
+ * replace the value with pw_map_slot_put instead.
+ *
+ * Example:
+ *
+ * PwValue zero = PwUnsigned(0);
+ * PwMapSlot counter = PW_MAP_SLOT_NULL;
+ * if (pw_map_slot(map, "hits", &zero, &counter)) {
+ *     counter.value->unsigned_value++;
+ * }
+ */
+
+typedef struct {
+    _PwValue map;      // clone of the map, Null when the slot is released
+    PwValuePtr value;  // borrowed pointer to the value, do not destroy
+} _PwMapSlot;
+
+// initializer of released slot
+#define PW_MAP_SLOT_NULL {.map = PW_NULL}
+
+// automatically released slot
+#define PwMapSlot [[ gnu::cleanup(pw_map_slot_release) ]] _PwMapSlot
+
+#define pw_map_slot(map, key, default_value, slot) _Generic((key),   \
+             nullptr_t: _pw_map_slot_null,      \
+                  bool: _pw_map_slot_bool,      \
+                  char: _pw_map_slot_signed,    \
+         unsigned char: _pw_map_slot_unsigned,  \
+                 short: _pw_map_slot_signed,    \
+        unsigned short: _pw_map_slot_unsigned,  \
+                   int: _pw_map_slot_signed,    \
+          unsigned int: _pw_map_slot_unsigned,  \
+                  long: _pw_map_slot_signed,    \
+         unsigned long: _pw_map_slot_unsigned,  \
+             long long: _pw_map_slot_signed,    \
+    unsigned long long: _pw_map_slot_unsigned,  \
+                 float: _pw_map_slot_float,     \
+                double: _pw_map_slot_float,     \
+                 char*: _pw_map_slot_ascii,     \
+              char8_t*: _pw_map_slot_utf8,      \
+             char32_t*: _pw_map_slot_utf32,     \
+            PwValuePtr: _pw_map_slot            \
+    )((map), (key), (default_value), (slot))
+
+[[nodiscard]] bool _pw_map_slot(PwValuePtr map, PwValuePtr key, PwValuePtr default_value, _PwMapSlot* slot);
+/*
+ * An active slot is released first, it remains released on error.
+ */
+
+[[nodiscard]] static inline bool _pw_map_slot_null    (PwValuePtr map, PwType_Null     key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PW_NULL;          return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_bool    (PwValuePtr map, PwType_Bool     key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PW_BOOL(key);     return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_signed  (PwValuePtr map, PwType_Signed   key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PW_SIGNED(key);   return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_unsigned(PwValuePtr map, PwType_Unsigned key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PW_UNSIGNED(key); return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_float   (PwValuePtr map, PwType_Float    key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PW_FLOAT(key);    return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_ascii   (PwValuePtr map, char*           key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PwStaticString(key); return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_utf8    (PwValuePtr map, char8_t*        key, PwValuePtr default_value, _PwMapSlot* slot) { PwValue k = PW_NULL; if (!pw_create_string(key, &k)) { return false; } return _pw_map_slot(map, &k, default_value, slot); }
+[[nodiscard]] static inline bool _pw_map_slot_utf32   (PwValuePtr map, char32_t*       key, PwValuePtr default_value, _PwMapSlot* slot) { _PwValue k = PwStaticStringUtf32(key); return _pw_map_slot(map, &k, default_value, slot); }
+
+[[nodiscard]] bool pw_map_slot_put(_PwMapSlot* slot, PwValuePtr value);
+/*
+ * Replace the value in the slot, `value` is moved.
+ * Compound values are attached to the map, same as in pw_map_update.
+ */
+
+void pw_map_slot_release(_PwMapSlot* slot);
+/*
+ * Release the map. Safe to call more than once.
+ */
+
+
 /****************************************************************
  * Delete item from map by `key`.
  *
@@ -162,13 +294,18 @@ bool _pw_map_has_key(PwValuePtr map, PwValuePtr key);
 
 [[nodiscard]] bool _pw_map_del(PwValuePtr map, PwValuePtr key);
 
+[[nodiscard]] bool pw_map_del_utf8_buf(PwValuePtr map, char8_t* key, unsigned key_size);
+/*
+ * Delete item by string key given as UTF-8 buffer, same as pw_map_has_key_utf8_buf.
+ */
+
 [[nodiscard]] static inline bool _pw_map_del_null    (PwValuePtr map, PwType_Null     key) { _PwValue k = PW_NULL;          return _pw_map_del(map, &k); }
 [[nodiscard]] static inline bool _pw_map_del_bool    (PwValuePtr map, PwType_Bool     key) { _PwValue k = PW_BOOL(key);     return _pw_map_del(map, &k); }
 [[nodiscard]] static inline bool _pw_map_del_signed  (PwValuePtr map, PwType_Signed   key) { _PwValue k = PW_SIGNED(key);   return _pw_map_del(map, &k); }
 [[nodiscard]] static inline bool _pw_map_del_unsigned(PwValuePtr map, PwType_Unsigned key) { _PwValue k = PW_UNSIGNED(key); return _pw_map_del(map, &k); }
 [[nodiscard]] static inline bool _pw_map_del_float   (PwValuePtr map, PwType_Float    key) { _PwValue k = PW_FLOAT(key);    return _pw_map_del(map, &k); }
 [[nodiscard]] static inline bool _pw_map_del_ascii   (PwValuePtr map, char*           key) { _PwValue k = PwStaticString(key); return _pw_map_del(map, &k); }
-[[nodiscard]] static inline bool _pw_map_del_utf8    (PwValuePtr map, char8_t*        key) { PwValue k = PW_NULL; if (!pw_create_string(key, &k)) { pw_panic("OOM"); } return _pw_map_del(map, &k); }
+[[nodiscard]] static inline bool _pw_map_del_utf8    (PwValuePtr map, char8_t*        key) { return pw_map_del_utf8_buf(map, key, strlen((char*) key)); }
 [[nodiscard]] static inline bool _pw_map_del_utf32   (PwValuePtr map, char32_t*       key) { _PwValue k = PwStaticStringUtf32(key); return _pw_map_del(map, &k); }
 
 
@@ -176,6 +313,11 @@ bool _pw_map_has_key(PwValuePtr map, PwValuePtr key);
  * Misc. functions.
  */
 
+[[nodiscard]] bool pw_map_reserve(PwValuePtr map, unsigned capacity);
+/*
+ * Make sure `map` can hold `capacity` items without growing.
+ */
+
 unsigned pw_map_length(PwValuePtr map);
 /*
  * Return the number of items in `map`.
@@ -195,6 +337,50 @@ unsigned pw_map_length(PwValuePtr map);
  * }
  */
 
+/****************************************************************
+ * Cursor
+ *
+ * Borrowing iteration over key-value pairs without cloning them.
+ * While the cursor is active the map cannot be modified,
+ * modifying functions fail with PW_ERROR_ITERATION_IN_PROGRESS.
+ */
+
+typedef struct {
+    _PwValue map;      // clone of iterated map, Null when iteration is stopped
+    PwValuePtr key;    // borrowed pointers to the current pair,
+    PwValuePtr value;  // do not destroy or modify
+    unsigned index;    // index of the current pair
+    unsigned _key_index;
+} _PwMapCursor;
+
+// automatically stopped cursor
+#define PwMapCursor [[ gnu::cleanup(pw_map_cursor_stop) ]] _PwMapCursor
+
+[[nodiscard]] _PwMapCursor pw_map_cursor(PwValuePtr map);
+/*
+ * Start borrowing iteration.
+ *
+ * Example:
+ *
+ * PwMapCursor cursor = pw_map_cursor(map);
+ * while (pw_map_cursor_next(&cursor)) {
+ *     // use cursor.key and cursor.value,
+ *     // clone them if they have to outlive the cursor
+ * }
+ */
+
+[[nodiscard]] bool pw_map_cursor_next(_PwMapCursor* cursor);
+/*
+ * Advance cursor to the next pair.
+ * Return false when there are no more pairs.
+ */
+
+void pw_map_cursor_stop(_PwMapCursor* cursor);
+/*
+ * Stop iteration and release the map.
+ * Safe to call more than once.
+ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <pw_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Packed array holds numbers of the same type as raw machine values
+ * without type id, so it takes half of the memory of Array
+ * (1/128 for Bool) and its items can be processed with vector instructions.
+ *
+ * Item types and their representation:
+ *
+ *   Bool       bitmap, 1 bit per item
+ *   Signed     int64_t
+ *   Unsigned   uint64_t
+ *   Float      double
+ *   Timestamp  uint64_t nanoseconds since epoch, this limits timestamps to year 2554
+ *
+ * Packed arrays support RandomAccess interface.
+ */
+
+typedef struct {
+    /*
+     * This structure extends _PwStructData.
+     */
+    _PwStructData struct_data;
+
+    PwTypeId item_type;
+    unsigned length;
+    unsigned capacity;  // in items, multiple of 64
+    union {
+        uint64_t* bits;  // Bool, bit i of the array is bit (i % 64) of bits[i / 64],
+                         // bits beyond length are always zero
+        int64_t*  signed_items;
+        uint64_t* unsigned_items;  // Unsigned and Timestamp
+        double*   float_items;
+    };
+} _PwPackedArray;
+
+#define get_packed_array_data_ptr(value)  ((_PwPackedArray*) ((value)->struct_data))
+
+extern PwTypeId PwTypeId_PackedArray;
+
+#define pw_is_packed_array(value)      pw_is_subtype((value), PwTypeId_PackedArray)
+#define pw_assert_packed_array(value)  pw_assert(pw_is_packed_array(value))
+
+/****************************************************************
+ * Constructors
+ */
+
+typedef struct {
+    PwTypeId item_type;  // mandatory
+    unsigned capacity;   // number of items the array can hold without growing
+} PwPackedArrayCtorArgs;
+
+[[nodiscard]] static inline bool pw_create_packed_array(PwTypeId item_type, PwValuePtr result)
+{
+    PwPackedArrayCtorArgs args = { .item_type = item_type };
+    return pw_create2(PwTypeId_PackedArray, &args, result);
+}
+
+[[nodiscard]] bool pw_packed_array_from_array(PwValuePtr array, PwTypeId item_type, PwValuePtr result);
+/*
+ * Create packed array from Array.
+ * Items are converted to `item_type`, see pw_packed_array_append.
+ */
+
+[[nodiscard]] bool pw_packed_array_to_array(PwValuePtr packed_array, PwValuePtr result);
+/*
+ * Create Array from packed array.
+ */
+
+/****************************************************************
+ * Items
+ */
+
+#define pw_packed_array_append(packed_array, item) _Generic((item), \
+                  bool: _pw_packed_array_append_bool,      \
+                  char: _pw_packed_array_append_signed,    \
+         unsigned char: _pw_packed_array_append_unsigned,  \
+                 short: _pw_packed_array_append_signed,    \
+        unsigned short: _pw_packed_array_append_unsigned,  \
+                   int: _pw_packed_array_append_signed,    \
+          unsigned int: _pw_packed_array_append_unsigned,  \
+                  long: _pw_packed_array_append_signed,    \
+         unsigned long: _pw_packed_array_append_unsigned,  \
+             long long: _pw_packed_array_append_signed,    \
+    unsigned long long: _pw_packed_array_append_unsigned,  \
+                 float: _pw_packed_array_append_float,     \
+                double: _pw_packed_array_append_float,     \
+            PwValuePtr: _pw_packed_array_append            \
+    )((packed_array), (item))
+
+[[nodiscard]] bool _pw_packed_array_append(PwValuePtr packed_array, PwValuePtr item);
+/*
+ * Append item to the array.
+ *
+ * Signed and Unsigned values are accepted by arrays of both integer types
+ * and by Float arrays as long as they fit.
+ * Otherwise the type of `item` must match the type of items.
+ */
+
+[[nodiscard]] static inline bool _pw_packed_array_append_bool    (PwValuePtr packed_array, PwType_Bool     item) { _PwValue v = PW_BOOL(item);     return _pw_packed_array_append(packed_array, &v); }
+[[nodiscard]] static inline bool _pw_packed_array_append_signed  (PwValuePtr packed_array, PwType_Signed   item) { _PwValue v = PW_SIGNED(item);   return _pw_packed_array_append(packed_array, &v); }
+[[nodiscard]] static inline bool _pw_packed_array_append_unsigned(PwValuePtr packed_array, PwType_Unsigned item) { _PwValue v = PW_UNSIGNED(item); return _pw_packed_array_append(packed_array, &v); }
+[[nodiscard]] static inline bool _pw_packed_array_append_float   (PwValuePtr packed_array, PwType_Float    item) { _PwValue v = PW_FLOAT(item);    return _pw_packed_array_append(packed_array, &v); }
+
+[[nodiscard]] bool pw_packed_array_item(PwValuePtr packed_array, unsigned index, PwValuePtr result);
+
+[[nodiscard]] bool pw_packed_array_set_item(PwValuePtr packed_array, unsigned index, PwValuePtr item);
+
+void pw_packed_array_del(PwValuePtr packed_array, unsigned start_index, unsigned end_index);
+/*
+ * Delete items from array.
+ * `end_index` is exclusive.
+ */
+
+unsigned pw_packed_array_length(PwValuePtr packed_array);
+
+static inline void* pw_packed_array_data(PwValuePtr packed_array)
+/*
+ * Return pointer to raw items.
+ * The pointer is valid until the array is modified.
+ */
+{
+    return get_packed_array_data_ptr(packed_array)->bits;
+}
+
+/****************************************************************
+ * Vectorized kernels
+ *
+ * Sums of integers wrap around on overflow.
+ * Sums of floats are calculated in multiple lanes, so the result
+ * may differ from sequential summation in the last digits.
+ */
+
+[[nodiscard]] bool pw_packed_array_sum(PwValuePtr packed_array, PwValuePtr result);
+/*
+ * Sum of items, the number of true items for Bool arrays.
+ * Not defined for Timestamps.
+ */
+
+[[nodiscard]] bool pw_packed_array_mean(PwValuePtr packed_array, PwValuePtr result);
+/*
+ * Arithmetic mean as Float, the share of true items for Bool arrays.
+ * Not defined for Timestamps.
+ */
+
+[[nodiscard]] bool pw_packed_array_min(PwValuePtr packed_array, PwValuePtr result);
+[[nodiscard]] bool pw_packed_array_max(PwValuePtr packed_array, PwValuePtr result);
+/*
+ * Minimal and maximal items.
+ * Return PW_ERROR_EXTRACT_FROM_EMPTY_ARRAY if array is empty.
+ */
+
+// comparison operators
+#define PW_CMP_LT  0
+#define PW_CMP_LE  1
+#define PW_CMP_EQ  2
+#define PW_CMP_NE  3
+#define PW_CMP_GE  4
+#define PW_CMP_GT  5
+
+[[nodiscard]] bool pw_packed_array_compare(PwValuePtr packed_array, uint8_t op, PwValuePtr operand, PwValuePtr result);
+/*
+ * Compare each item with `operand` using PW_CMP_* operator
+ * and write results to packed Bool array.
+ *
+ * Example:
+ *
+ * PwValue mask = PW_NULL;
+ * PwValue limit = PwFloat(0.5);
+ * if (pw_packed_array_compare(&prices, PW_CMP_LT, &limit, &mask)) {
+ *     // success!
+ * }
+ */
+
+[[nodiscard]] bool pw_packed_array_filter(PwValuePtr packed_array, PwValuePtr mask, PwValuePtr result);
+/*
+ * Create packed array of items for which the corresponding bits of `mask` are set.
+ * `mask` is a packed Bool array of the same length.
+ */
+
+[[nodiscard]] bool pw_packed_array_gather(PwValuePtr packed_array, PwValuePtr indices, PwValuePtr result);
+/*
+ * Create packed array of items at `indices`.
+ * `indices` is a packed Unsigned or Signed array, negative indices
+ * are not allowed.
+ */
+
+#ifdef __cplusplus
+}
+#endif
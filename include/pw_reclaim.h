@@ -0,0 +1,60 @@
+#pragma once
+
+#include <pw_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************
+ * Deferred release of large values.
+ *
+ * Destroying the last reference to an array or map with millions
+ * of items runs the whole destructor at once. In deferred mode
+ * such values are put on the reclamation queue instead,
+ * and their items are destroyed in portions by pw_reclaim,
+ * for example, from the idle handler of event loop.
+ *
+ * The mode is disabled by default.
+ *
+ * Values on the queue are not freed unless pw_reclaim is called,
+ * so call pw_reclaim_all before exit.
+ */
+
+void pw_set_deferred_release(unsigned min_items);
+/*
+ * Defer release of arrays and maps having at least `min_items` items
+ * (keys and values are counted separately for maps).
+ * Zero disables deferred release, already queued values stay on the queue.
+ *
+ * Smaller values are destroyed in place, including the ones nested
+ * in queued values, so the threshold should be low enough for a portion
+ * of pw_reclaim work to stay short.
+ */
+
+bool pw_reclaim(unsigned budget);
+/*
+ * Destroy up to `budget` items of queued values
+ * and release values that have no items left.
+ *
+ * Return true if the queue is empty.
+ */
+
+void pw_reclaim_all();
+/*
+ * Release all queued values.
+ */
+
+typedef struct {
+    unsigned queue_length;     // values waiting for release
+    uint64_t num_deferred;     // values put on the queue so far
+    uint64_t num_reclaimed;    // values released from the queue so far
+    uint64_t items_reclaimed;  // items destroyed by pw_reclaim so far
+    double   reclaim_rate;     // items per second spent in pw_reclaim
+} PwReclaimStats;
+
+void pw_reclaim_stats(PwReclaimStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************
+ * Set is a map without values.
+ *
+ * It shares hash table engines with Map and takes the same
+ * constructor arguments, PwMapCtorArgs.
+ * Items are kept in the insertion order.
+ */
+
+[[nodiscard]] static inline bool pw_create_set(PwValuePtr result)
+{
+    return pw_create(PwTypeId_Set, result);
+}
+/*
+ * Create set with default hash table engine.
+ *
+ * To choose the engine or initial capacity, use:
+ *
+ * PwMapCtorArgs args = { .engine = PW_MAP_ENGINE_SWISS, .capacity = 1000 };
+ * if (pw_create2(PwTypeId_Set, &args, &set)) {
+ *     // success!
+ * }
+ */
+
+#define pw_set_va(result, ...)  \
+    _pw_set_va((result), __VA_ARGS__  __VA_OPT__(,) PwVaEnd())
+
+#define pwva_set(...) \
+    __extension__ \
+    ({  \
+        _PwValue result = PW_NULL;  \
+        if (!_pw_set_va(&result, __VA_ARGS__  __VA_OPT__(,) PwVaEnd())) {  \
+            pw_clone2(&current_task->status, &result);  \
+        }  \
+        result;  \
+    })
+
+[[nodiscard]] bool _pw_set_va(PwValuePtr result, ...);
+/*
+ * Variadic constructor arguments are items.
+ * Duplicates are added once.
+ */
+
+/****************************************************************
+ * Add item to set.
+ *
+ * Adding an item that is already in the set is not an error.
+ */
+
+#define pw_set_add(set, item) _Generic((item),   \
+             nullptr_t: _pw_set_add_null,      \
+                  bool: _pw_set_add_bool,      \
+                  char: _pw_set_add_signed,    \
+         unsigned char: _pw_set_add_unsigned,  \
+                 short: _pw_set_add_signed,    \
+        unsigned short: _pw_set_add_unsigned,  \
+                   int: _pw_set_add_signed,    \
+          unsigned int: _pw_set_add_unsigned,  \
+                  long: _pw_set_add_signed,    \
+         unsigned long: _pw_set_add_unsigned,  \
+             long long: _pw_set_add_signed,    \
+    unsigned long long: _pw_set_add_unsigned,  \
+                 float: _pw_set_add_float,     \
+                double: _pw_set_add_float,     \
+                 char*: _pw_set_add_ascii,     \
+              char8_t*: _pw_set_add_utf8,      \
+             char32_t*: _pw_set_add_utf32,     \
+            PwValuePtr: _pw_set_add            \
+    )((set), (item))
+
+[[nodiscard]] bool _pw_set_add(PwValuePtr set, PwValuePtr item);
+/*
+ * `item` is deeply copied before adding.
+ */
+
+[[nodiscard]] static inline bool _pw_set_add_null    (PwValuePtr set, PwType_Null     item) { _PwValue v = PW_NULL;          return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_bool    (PwValuePtr set, PwType_Bool     item) { _PwValue v = PW_BOOL(item);     return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_signed  (PwValuePtr set, PwType_Signed   item) { _PwValue v = PW_SIGNED(item);   return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_unsigned(PwValuePtr set, PwType_Unsigned item) { _PwValue v = PW_UNSIGNED(item); return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_float   (PwValuePtr set, PwType_Float    item) { _PwValue v = PW_FLOAT(item);    return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_ascii   (PwValuePtr set, char*           item) { _PwValue v = PwStaticString(item); return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_utf8    (PwValuePtr set, char8_t*        item) { PwValue v = PW_NULL; if (!pw_create_string(item, &v)) { return false; } return _pw_set_add(set, &v); }
+[[nodiscard]] static inline bool _pw_set_add_utf32   (PwValuePtr set, char32_t*       item) { _PwValue v = PwStaticStringUtf32(item); return _pw_set_add(set, &v); }
+
+[[nodiscard]] bool pw_set_add_ap(PwValuePtr set, va_list ap);
+/*
+ * Add items from variadic arguments, see _pw_map_update_va for details.
+ */
+
+/****************************************************************
+ * Check `item` is in `set`.
+ */
+
+#define pw_set_contains(set, item) _Generic((item),   \
+             nullptr_t: _pw_set_contains_null,      \
+                  bool: _pw_set_contains_bool,      \
+                  char: _pw_set_contains_signed,    \
+         unsigned char: _pw_set_contains_unsigned,  \
+                 short: _pw_set_contains_signed,    \
+        unsigned short: _pw_set_contains_unsigned,  \
+                   int: _pw_set_contains_signed,    \
+          unsigned int: _pw_set_contains_unsigned,  \
+                  long: _pw_set_contains_signed,    \
+         unsigned long: _pw_set_contains_unsigned,  \
+             long long: _pw_set_contains_signed,    \
+    unsigned long long: _pw_set_contains_unsigned,  \
+                 float: _pw_set_contains_float,     \
+                double: _pw_set_contains_float,     \
+                 char*: _pw_set_contains_ascii,     \
+              char8_t*: _pw_set_contains_utf8,      \
+             char32_t*: _pw_set_contains_utf32,     \
+            PwValuePtr: _pw_set_contains            \
+    )((set), (item))
+
+bool _pw_set_contains(PwValuePtr set, PwValuePtr item);
+
+[[nodiscard]] static inline bool _pw_set_contains_null    (PwValuePtr set, PwType_Null     item) { _PwValue v = PW_NULL;          return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_bool    (PwValuePtr set, PwType_Bool     item) { _PwValue v = PW_BOOL(item);     return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_signed  (PwValuePtr set, PwType_Signed   item) { _PwValue v = PW_SIGNED(item);   return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_unsigned(PwValuePtr set, PwType_Unsigned item) { _PwValue v = PW_UNSIGNED(item); return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_float   (PwValuePtr set, PwType_Float    item) { _PwValue v = PW_FLOAT(item);    return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_ascii   (PwValuePtr set, char*           item) { _PwValue v = PwStaticString(item); return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_utf8    (PwValuePtr set, char8_t*        item) { PwValue v = PW_NULL; if (!pw_create_string(item, &v)) { return false; } return _pw_set_contains(set, &v); }
+[[nodiscard]] static inline bool _pw_set_contains_utf32   (PwValuePtr set, char32_t*       item) { _PwValue v = PwStaticStringUtf32(item); return _pw_set_contains(set, &v); }
+
+
+/****************************************************************
+ * Remove item from set.
+ *
+ * Return PW_ERROR_KEY_NOT_FOUND if `item` is not in the `set`.
+ */
+
+#define pw_set_remove(set, item) _Generic((item),   \
+             nullptr_t: _pw_set_remove_null,      \
+                  bool: _pw_set_remove_bool,      \
+                  char: _pw_set_remove_signed,    \
+         unsigned char: _pw_set_remove_unsigned,  \
+                 short: _pw_set_remove_signed,    \
+        unsigned short: _pw_set_remove_unsigned,  \
+                   int: _pw_set_remove_signed,    \
+          unsigned int: _pw_set_remove_unsigned,  \
+                  long: _pw_set_remove_signed,    \
+         unsigned long: _pw_set_remove_unsigned,  \
+             long long: _pw_set_remove_signed,    \
+    unsigned long long: _pw_set_remove_unsigned,  \
+                 float: _pw_set_remove_float,     \
+                double: _pw_set_remove_float,     \
+                 char*: _pw_set_remove_ascii,     \
+              char8_t*: _pw_set_remove_utf8,      \
+             char32_t*: _pw_set_remove_utf32,     \
+            PwValuePtr: _pw_set_remove            \
+    )((set), (item))
+
+[[nodiscard]] bool _pw_set_remove(PwValuePtr set, PwValuePtr item);
+
+[[nodiscard]] static inline bool _pw_set_remove_null    (PwValuePtr set, PwType_Null     item) { _PwValue v = PW_NULL;          return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_bool    (PwValuePtr set, PwType_Bool     item) { _PwValue v = PW_BOOL(item);     return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_signed  (PwValuePtr set, PwType_Signed   item) { _PwValue v = PW_SIGNED(item);   return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_unsigned(PwValuePtr set, PwType_Unsigned item) { _PwValue v = PW_UNSIGNED(item); return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_float   (PwValuePtr set, PwType_Float    item) { _PwValue v = PW_FLOAT(item);    return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_ascii   (PwValuePtr set, char*           item) { _PwValue v = PwStaticString(item); return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_utf8    (PwValuePtr set, char8_t*        item) { PwValue v = PW_NULL; if (!pw_create_string(item, &v)) { return false; } return _pw_set_remove(set, &v); }
+[[nodiscard]] static inline bool _pw_set_remove_utf32   (PwValuePtr set, char32_t*       item) { _PwValue v = PwStaticStringUtf32(item); return _pw_set_remove(set, &v); }
+
+
+/****************************************************************
+ * Bulk insertion and set algebra.
+ *
+ * Algebra functions create new set in `result` and leave operands
+ * intact. They iterate the smaller operand and probe the larger one,
+ * reusing hashes stored in operands.
+ */
+
+[[nodiscard]] bool pw_set_update(PwValuePtr set, PwValuePtr items);
+/*
+ * Add all items from Array or Set.
+ * The set is sized once for all new items.
+ */
+
+[[nodiscard]] bool pw_set_union(PwValuePtr a, PwValuePtr b, PwValuePtr result);
+/*
+ * Items that are in `a` or in `b`.
+ */
+
+[[nodiscard]] bool pw_set_intersection(PwValuePtr a, PwValuePtr b, PwValuePtr result);
+/*
+ * Items that are both in `a` and in `b`.
+ */
+
+[[nodiscard]] bool pw_set_difference(PwValuePtr a, PwValuePtr b, PwValuePtr result);
+/*
+ * Items of `a` that are not in `b`.
+ */
+
+/****************************************************************
+ * Misc. functions.
+ */
+
+[[nodiscard]] bool pw_set_reserve(PwValuePtr set, unsigned capacity);
+/*
+ * Make sure `set` can hold `capacity` items without growing.
+ */
+
+unsigned pw_set_length(PwValuePtr set);
+/*
+ * Return the number of items in `set`.
+ */
+
+/****************************************************************
+ * Cursor
+ *
+ * Borrowing iteration over items in the insertion order.
+ * While the cursor is active the set cannot be modified,
+ * modifying functions fail with PW_ERROR_ITERATION_IN_PROGRESS.
+ */
+
+typedef struct {
+    _PwValue set;     // clone of iterated set, Null when iteration is stopped
+    PwValuePtr item;  // borrowed pointer to the current item, do not destroy or modify
+    unsigned index;   // index of the current item
+    unsigned _key_index;
+} _PwSetCursor;
+
+// automatically stopped cursor
+#define PwSetCursor [[ gnu::cleanup(pw_set_cursor_stop) ]] _PwSetCursor
+
+[[nodiscard]] _PwSetCursor pw_set_cursor(PwValuePtr set);
+/*
+ * Start borrowing iteration.
+ *
+ * Example:
+ *
+ * PwSetCursor cursor = pw_set_cursor(set);
+ * while (pw_set_cursor_next(&cursor)) {
+ *     // use cursor.item
+ * }
+ */
+
+[[nodiscard]] bool pw_set_cursor_next(_PwSetCursor* cursor);
+/*
+ * Advance cursor to the next item.
+ * Return false when there are no more items.
+ */
+
+void pw_set_cursor_stop(_PwSetCursor* cursor);
+/*
+ * Stop iteration and release the set.
+ * Safe to call more than once.
+ */
+
+#ifdef __cplusplus
+}
+#endif
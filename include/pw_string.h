@@ -4,13 +4,9 @@
 
 #include <pw_assert.h>
 #include <pw_types.h>
+#include <pw_unicode.h>
 #include <pw_utf.h>
 
-#ifdef PW_WITH_ICU
-    // ICU library for character classification:
-#   include <unicode/uchar.h>
-#endif
-
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -222,15 +218,9 @@ static inline unsigned pw_strlen(PwValuePtr str)
 
 [[nodiscard]] bool pw_string_lower(PwValuePtr str);
 [[nodiscard]] bool pw_string_upper(PwValuePtr str);
-
-
-#ifdef PW_WITH_ICU
-#   define pw_char_lower(c)  u_tolower(c)
-#   define pw_char_upper(c)  u_toupper(c)
-#else
-#   define pw_char_lower(c)  tolower(c)
-#   define pw_char_upper(c)  toupper(c)
-#endif
+/*
+ * Characters are converted with pw_char_lower and pw_char_upper, see pw_unicode.h
+ */
 
 #define pw_strcat(result, str, ...)  \
     _pw_strcat_va((result), (str) __VA_OPT__(,) __VA_ARGS__, PwVaEnd())
@@ -252,31 +242,8 @@ unsigned pw_string_skip_chars(PwValuePtr str, unsigned position, char32_t* skipc
 
 /****************************************************************
  * Character classification functions
- */
-
-#ifdef PW_WITH_ICU
-#   define pw_isspace(c)  u_isspace(c)
-#   define pw_isblank(c)  u_isblank(c)
-#   define pw_isalpha(c)  u_isalpha(c)
-#   define pw_isdigit(c)  u_isdigit(c)
-#   define pw_isalnum(c)  u_isalnum(c)
-#   define pw_ispunct(c)  u_ispunct(c)
-#   define pw_iscntrl(c)  u_iscntrl(c)
-#   define pw_isgraph(c)  u_isgraph(c)
-#   define pw_isprint(c)  u_isprint(c)
-#else
-#   define pw_isspace(c)  ((c) <= 255 && isspace((unsigned char) (c)))
-#   define pw_isblank(c)  ((c) <= 255 && isblank((unsigned char) (c)))
-#   define pw_isalpha(c)  ((c) <= 255 && isalpha((unsigned char) (c)))
-#   define pw_isdigit(c)  ((c) <= 255 && isdigit((unsigned char) (c)))
-#   define pw_isalnum(c)  ((c) <= 255 && isalnum((unsigned char) (c)))
-#   define pw_ispunct(c)  ((c) <= 255 && ispunct((unsigned char) (c)))
-#   define pw_iscntrl(c)  ((c) <= 255 && iscntrl((unsigned char) (c)))
-#   define pw_isgraph(c)  ((c) <= 255 && isgraph((unsigned char) (c)))
-#   define pw_isprint(c)  ((c) <= 255 && isprint((unsigned char) (c)))
-#endif
-/*
- * Return true if `c` is a whitespace character.
+ *
+ * pw_isspace, pw_isalpha, etc. are defined in pw_unicode.h
  */
 
 #define pw_is_ascii_digit(c)  isdigit(c)
@@ -311,6 +278,8 @@ bool pw_string_is_ascii_digit(PwValuePtr str);
  *     pw_string_append(dest_string, start_ptr, nullptr);
  *
  * C strings are slowest because strlen is called to obtain end_ptr.
+ *
+ * Invalid UTF-8 sequences are skipped.
  */
 
 #define pw_string_append(dest, src, ...) _Generic((src),  \
@@ -511,6 +480,13 @@ bool pw_string_is_ascii_digit(PwValuePtr str);
     return _pw_endswithi_z(str, suffix, 4);
 }
 
+[[nodiscard]] int pw_strcmp(PwValuePtr a, PwValuePtr b);
+/*
+ * Compare strings by code points.
+ * Return negative value if a < b, zero if they are equal,
+ * and positive value if a > b.
+ */
+
 
 /****************************************************************
  * Substring scanning functions.
@@ -540,7 +516,7 @@ bool pw_string_is_ascii_digit(PwValuePtr str);
     return _pw_strstr_z(str, substr, 4, start_pos, pos);
 }
 
-#define pw_strstri(str, substr, pos) _Generic((substr), \
+#define pw_strstri(str, substr, start_pos, pos) _Generic((substr), \
                  char*: _pw_strstri_ascii,  \
               char8_t*: _pw_strstri_utf8,   \
              char32_t*: _pw_strstri_utf32,  \
@@ -552,6 +528,64 @@ bool pw_string_is_ascii_digit(PwValuePtr str);
 [[nodiscard]] bool _pw_strstri_utf8 (PwValuePtr str, char8_t*   substr, unsigned start_pos, unsigned* pos);
 [[nodiscard]] bool _pw_strstri_utf32(PwValuePtr str, char32_t*  substr, unsigned start_pos, unsigned* pos);
 
+/****************************************************************
+ * Precompiled substring search.
+ *
+ * pw_strstr and pw_strstri prepare the substring on every call.
+ * To search the same substring in many strings, prepare it once:
+ *
+ * PwStringFinder finder;
+ * if (!pw_create_string_finder(&substr, false, &finder)) {
+ *     return false;
+ * }
+ * for (...) {
+ *     if (pw_string_find(&finder, &str, 0, &pos)) {
+ *         // found!
+ *     }
+ * }
+ * pw_destroy_string_finder(&finder);
+ *
+ * Single characters are searched with strchr. Short substrings
+ * are searched with a vector filter on their first and last characters.
+ * Long substrings, case-insensitive search, and filters that produce
+ * too many false candidates use the two-way algorithm, which runs
+ * in linear time.
+ */
+
+#define PW_FINDER_INLINE_LENGTH  16
+
+typedef struct {
+    _PwValue substr;            // clone of the substring
+    unsigned length;            // of the substring
+    unsigned critical_pos;      // parameters of two-way algorithm
+    unsigned period;
+    bool     periodic;
+    bool     case_insensitive;
+    uint8_t  max_char_size;     // of code points in the substring
+    uint8_t  shift[256];        // bad character shifts, indexed by low byte of code point
+    union {
+        // code points of the substring, lower case for case-insensitive search
+        char32_t  codepoints[PW_FINDER_INLINE_LENGTH];
+        char32_t* codepoints_ptr;  // if length > PW_FINDER_INLINE_LENGTH
+    };
+} PwStringFinder;
+
+[[nodiscard]] bool pw_create_string_finder(PwValuePtr substr, bool case_insensitive, PwStringFinder* finder);
+/*
+ * Prepare `substr` for search.
+ * The finder must be destroyed with pw_destroy_string_finder.
+ */
+
+void pw_destroy_string_finder(PwStringFinder* finder);
+
+[[nodiscard]] bool pw_string_find(PwStringFinder* finder, PwValuePtr str, unsigned start_pos, unsigned* pos);
+/*
+ * Find the substring in `str` starting from `start_pos`.
+ *
+ * Return true if the substring is found and write its position to `pos`.
+ * `pos` can be nullptr. Empty substring is never found.
+ */
+
 
 /****************************************************************
  * Split functions.
@@ -37,6 +37,7 @@ extern "C" {
 #define PwTypeId_Iterator   13U
 #define PwTypeId_Array      14U
 #define PwTypeId_Map        15U
+#define PwTypeId_Set        16U
 
 // limits
 #define PW_SIGNED_MAX  0x7fff'ffff'ffff'ffffLL
@@ -59,6 +60,7 @@ extern "C" {
 #define pw_is_iterator(value)  pw_is_subtype((value), PwTypeId_Iterator)
 #define pw_is_array(value)     pw_is_subtype((value), PwTypeId_Array)
 #define pw_is_map(value)       pw_is_subtype((value), PwTypeId_Map)
+#define pw_is_set(value)       pw_is_subtype((value), PwTypeId_Set)
 
 #define pw_assert_null(value)      pw_assert(pw_is_null    (value))
 #define pw_assert_bool(value)      pw_assert(pw_is_bool    (value))
@@ -76,6 +78,7 @@ extern "C" {
 #define pw_assert_iterator(value)  pw_assert(pw_is_iterator(value))
 #define pw_assert_array(value)     pw_assert(pw_is_array   (value))
 #define pw_assert_map(value)       pw_assert(pw_is_map     (value))
+#define pw_assert_set(value)       pw_assert(pw_is_set     (value))
 
 // forward declarations
 
@@ -803,12 +806,28 @@ static inline bool pw_is_true(PwValuePtr value)
  * API for compound types
  */
 
+void pw_set_acyclic(PwValuePtr value);
+/*
+ * Switch compound value to acyclic mode: it is never a part of cyclic
+ * references, so it does not track parents and uses plain reference counting.
+ * This makes adding and removing the value to/from containers cheaper,
+ * and destruction skips the search for cyclic references.
+ *
+ * The value must not be added to any container yet.
+ * Arrays and maps can be created in acyclic mode with `acyclic`
+ * constructor argument.
+ *
+ * In debug builds (DEBUG defined) making a cycle that passes through
+ * an acyclic value, directly or via other containers, is an assertion failure.
+ */
+
 [[nodiscard]] bool _pw_adopt(PwValuePtr parent, PwValuePtr child);
 /*
  * Add parent to child's parents or increment
  * parents_refcount if added already.
  *
  * Decrement child refcount.
+ * Acyclic child keeps refcount because it counts the reference from parent.
  *
  * Return false if OOM.
  */
@@ -819,6 +838,7 @@ bool _pw_abandon(PwValuePtr parent, PwValuePtr child);
  * remove parent from child's parents and return true.
  *
  * If child still refers to parent, return false.
+ * Always return true for acyclic child.
  *
  * XXX return value is not used.
  */
@@ -833,11 +853,22 @@ bool _pw_abandon(PwValuePtr parent, PwValuePtr child);
  * Check if all parents have zero refcount and there are cyclic references.
  */
 
+#ifdef DEBUG
+void _pw_embrace_noncompound(PwValuePtr parent, PwValuePtr child);
+/*
+ * Debug builds only: let cycle checks in _pw_adopt know the parent holds
+ * an array slice, which refers to its array without adopting it.
+ */
+#endif
+
 [[nodiscard]] static inline bool _pw_embrace(PwValuePtr parent, PwValuePtr child)
 {
     if (pw_is_compound(child)) {
         return _pw_adopt(parent, child);
     } else {
+#       ifdef DEBUG
+            _pw_embrace_noncompound(parent, child);
+#       endif
         return true;
     }
 }
@@ -912,6 +943,12 @@ bool _pw_abandon(PwValuePtr parent, PwValuePtr child);
 
 [[nodiscard]] bool _pw_equal_z(PwValuePtr a, void* b, uint8_t b_char_size);
 
+[[nodiscard]] bool _pw_equal_utf8_buf(PwValuePtr a, char8_t* b, unsigned b_size);
+/*
+ * Compare `a` with UTF-8 buffer that is not necessarily null-terminated.
+ * Invalid UTF-8 sequences in the buffer are skipped as pw_create_string does.
+ */
+
 [[nodiscard]] static inline bool _pw_equal_ascii(PwValuePtr a, char* b)
 {
     return _pw_equal_z(a, b, 1);
@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * Unicode character properties and simple case mappings.
+ *
+ * Tables are generated by tools/gen_unicode_tables.py
+ * and compiled into the library, see src/pw_unicode_tables.c
+ *
+ * Classification follows ICU functions with the same names,
+ * i.e. pw_isspace(c) is equivalent to u_isspace(c).
+ * Code points beyond U+10FFFF have no properties.
+ */
+
+#include <stdint.h>
+#include <uchar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define _PW_UNICODE_BLOCK_SHIFT  7
+
+#define _PW_CHAR_SPACE  0x01
+#define _PW_CHAR_BLANK  0x02
+#define _PW_CHAR_ALPHA  0x04
+#define _PW_CHAR_DIGIT  0x08
+#define _PW_CHAR_PUNCT  0x10
+#define _PW_CHAR_CNTRL  0x20
+#define _PW_CHAR_GRAPH  0x40
+#define _PW_CHAR_PRINT  0x80
+
+typedef struct {
+    uint8_t flags;
+    int32_t lower_delta;  // add to code point to convert it to lower case
+    int32_t upper_delta;
+} _PwUnicodeRecord;
+
+extern const uint8_t pw_unicode_version[3];
+/*
+ * Version of Unicode the tables were generated from: major, minor, update.
+ */
+
+extern const _PwUnicodeRecord _pw_unicode_records[];
+extern const uint8_t _pw_unicode_index[];   // block numbers, indexed by code point >> _PW_UNICODE_BLOCK_SHIFT
+extern const uint8_t _pw_unicode_blocks[];  // record numbers
+
+static inline const _PwUnicodeRecord* _pw_unicode_record(char32_t c)
+{
+    if (c > 0x10FFFF) {
+        // noncharacter, has no properties
+        c = 0x10FFFF;
+    }
+    unsigned block = _pw_unicode_index[c >> _PW_UNICODE_BLOCK_SHIFT];
+    unsigned offset = c & ((1 << _PW_UNICODE_BLOCK_SHIFT) - 1);
+    return &_pw_unicode_records[_pw_unicode_blocks[(block << _PW_UNICODE_BLOCK_SHIFT) | offset]];
+}
+
+static inline bool pw_isspace(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_SPACE; }
+static inline bool pw_isblank(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_BLANK; }
+static inline bool pw_isalpha(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_ALPHA; }
+static inline bool pw_isdigit(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_DIGIT; }
+static inline bool pw_isalnum(char32_t c) { return _pw_unicode_record(c)->flags & (_PW_CHAR_ALPHA | _PW_CHAR_DIGIT); }
+static inline bool pw_ispunct(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_PUNCT; }
+static inline bool pw_iscntrl(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_CNTRL; }
+static inline bool pw_isgraph(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_GRAPH; }
+static inline bool pw_isprint(char32_t c) { return _pw_unicode_record(c)->flags & _PW_CHAR_PRINT; }
+
+static inline char32_t pw_char_lower(char32_t c) { return c + _pw_unicode_record(c)->lower_delta; }
+static inline char32_t pw_char_upper(char32_t c) { return c + _pw_unicode_record(c)->upper_delta; }
+/*
+ * Simple case mapping, one code point to one code point.
+ */
+
+#ifdef __cplusplus
+}
+#endif
@@ -32,7 +32,9 @@ bool _pw_decode_utf8_buffer(char8_t** ptr, unsigned* bytes_remaining, char32_t*
  *
  * Return false if UTF-8 sequence is incomplete or `bytes_remaining` is zero.
  * Otherwise return true.
- * If character is invalid, write 0xFFFFFFFF to `result`.
+ * If character is invalid, write 0xFFFFFFFF to `result` and skip one byte.
+ * Overlong sequences, surrogates, and code points beyond U+10FFFF are invalid,
+ * same as when string is created from UTF-8.
  */
 
 void pw_string_to_utf8_buf(PwValuePtr str, char* buffer);
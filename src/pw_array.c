@@ -4,6 +4,7 @@
 #include "include/pw_parse.h"
 #include "src/pw_alloc.h"
 #include "src/pw_array_internal.h"
+#include "src/pw_interfaces_internal.h"
 #include "src/pw_struct_internal.h"
 
 static void array_fini(PwValuePtr self)
@@ -13,12 +14,36 @@ static void array_fini(PwValuePtr self)
     _pw_destroy_array(self->type_id, array, self);
 }
 
-[[nodiscard]] static bool array_init(PwValuePtr self, void* ctor_args)
+static void use_inline_storage(_PwArray* array)
+/*
+ * Point items to inline storage.
+ * The array must be a part of _PwArrayData.
+ */
 {
-    // XXX not using ctor_args for now
-    // XXX array constructor arg: initial size
+    array->items = ((_PwArrayData*) array)->inline_items;
+    array->capacity = PWARRAY_INLINE_CAPACITY;
+    array->head = 0;
+    array->inline_storage = true;
+}
 
-    if (_pw_alloc_array(self->type_id, get_array_struct_ptr(self), PWARRAY_INITIAL_CAPACITY)) {
+[[nodiscard]] static bool array_init(PwValuePtr self, void* ctor_args)
+{
+    _PwArray* array = get_array_struct_ptr(self);
+    PwArrayCtorArgs* args = ctor_args;
+    unsigned capacity = PWARRAY_INITIAL_CAPACITY;
+    if (args) {
+        array->growth = args->growth;
+        array->compound_data.acyclic = args->acyclic;
+        if (args->capacity > capacity) {
+            capacity = args->capacity;
+        }
+    }
+    if (capacity <= PWARRAY_INLINE_CAPACITY) {
+        // nothing to allocate
+        use_inline_storage(array);
+        return true;
+    }
+    if (_pw_alloc_array(self->type_id, array, capacity)) {
         return true;
     } else {
         array_fini(self);
@@ -38,18 +63,18 @@ static void array_hash(PwValuePtr self, PwHashContext* ctx)
 
 [[nodiscard]] static bool array_deepcopy(PwValuePtr self, PwValuePtr result)
 {
-    if (!pw_create(self->type_id, result)) {
+    _PwArray* src_array = get_array_struct_ptr(self);
+    PwArrayCtorArgs args = {
+        .capacity = src_array->length,
+        .growth   = src_array->growth,
+        .acyclic  = src_array->compound_data.acyclic
+    };
+    if (!pw_create2(self->type_id, &args, result)) {
         return false;
     }
 
-    _PwArray* src_array = get_array_struct_ptr(self);
     _PwArray* dest_array = get_array_struct_ptr(result);
 
-    if (!_pw_array_resize(self->type_id, dest_array, src_array->length)) {
-        pw_destroy(result);
-        return false;
-    }
-
     PwValuePtr src_item_ptr = src_array->items;
     PwValuePtr dest_item_ptr = dest_array->items;
     for (unsigned i = 0; i < src_array->length; i++) {
@@ -127,12 +152,43 @@ static void array_dump(PwValuePtr self, FILE* fp, int first_indent, int next_ind
     }
 }
 
+[[nodiscard]] static bool array_compare(PwValuePtr self, PwValuePtr other, int* result)
+/*
+ * Compare arrays lexicographically.
+ */
+{
+    if (!pw_is_array(other)) {
+        return _pw_incomparable(self, other);
+    }
+    _PwArray* a = get_array_struct_ptr(self);
+    _PwArray* b = get_array_struct_ptr(other);
+    unsigned n = (a->length < b->length)? a->length : b->length;
+    for (unsigned i = 0; i < n; i++) {
+        if (!pw_compare(&a->items[i], &b->items[i], result)) {
+            return false;
+        }
+        if (*result) {
+            return true;
+        }
+    }
+    *result = PW_CMP(a->length, b->length);
+    return true;
+}
+
+static PwInterface_Comparison comparison_interface = {
+    .compare = array_compare
+};
+
 static PwInterface_RandomAccess random_access_interface;  // forward declaration
 
 static _PwInterface array_interfaces[] = {
     {
         .interface_id      = PwInterfaceId_RandomAccess,
         .interface_methods = (void**) &random_access_interface
+    },
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &comparison_interface
     }
     // PwInterfaceId_Array
 };
@@ -154,7 +210,7 @@ PwType _pw_array_type = {
     .equal_sametype = array_equal_sametype,
     .equal          = array_equal,
 
-    .data_size      = sizeof(_PwArray),
+    .data_size      = sizeof(_PwArrayData),
 
     .init           = array_init,
     .fini           = array_fini,
@@ -164,12 +220,14 @@ PwType _pw_array_type = {
 };
 
 
-static unsigned round_capacity(unsigned capacity)
+unsigned _pw_array_round_capacity(unsigned capacity)
 {
     if (capacity <= PWARRAY_CAPACITY_INCREMENT) {
         return align_unsigned(capacity, PWARRAY_INITIAL_CAPACITY);
-    } else {
+    } else if (capacity < PWARRAY_LARGE_CAPACITY) {
         return align_unsigned(capacity, PWARRAY_CAPACITY_INCREMENT);
+    } else {
+        return align_unsigned_to_page(capacity * sizeof(_PwValue)) / sizeof(_PwValue);
     }
 }
 
@@ -192,13 +250,14 @@ static unsigned round_capacity(unsigned capacity)
 
 [[nodiscard]] bool _pw_alloc_array(PwTypeId type_id, _PwArray* array, unsigned capacity)
 {
-    if (capacity >= UINT_MAX / sizeof(_PwValue)) {
+    if (capacity > PWARRAY_MAX_CAPACITY) {
         pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
         return false;
     }
 
     array->length = 0;
-    array->capacity = round_capacity(capacity);
+    array->head = 0;
+    array->capacity = _pw_array_round_capacity(capacity);
 
     unsigned memsize = array->capacity * sizeof(_PwValue);
     array->items = _pw_alloc(type_id, memsize, true);
@@ -234,23 +293,61 @@ static void destroy_items(_PwArray* array, unsigned start_index, unsigned end_in
 
 void _pw_destroy_array(PwTypeId type_id, _PwArray* array, PwValuePtr parent)
 {
+    if (array->inline_storage) {
+        destroy_items(array, 0, array->length, parent);
+        array->items = nullptr;
+        array->inline_storage = false;
+        return;
+    }
     if (array->items) {
         destroy_items(array, 0, array->length, parent);
-        unsigned memsize = array->capacity * sizeof(_PwValue);
+        unsigned memsize = (array->head + array->capacity) * sizeof(_PwValue);
+        array->items -= array->head;
+        array->head = 0;
         _pw_free(type_id, (void**) &array->items, memsize);
     }
 }
 
+static void reclaim_head(_PwArray* array)
+/*
+ * Move items to the beginning of allocated block.
+ */
+{
+    PwValuePtr block = array->items - array->head;
+    memmove(block, array->items, array->length * sizeof(_PwValue));
+    array->items = block;
+    array->capacity += array->head;
+    array->head = 0;
+}
+
 [[nodiscard]] bool _pw_array_resize(PwTypeId type_id, _PwArray* array, unsigned desired_capacity)
 {
     if (desired_capacity < array->length) {
         desired_capacity = array->length;
-    } else if (desired_capacity >= UINT_MAX / sizeof(_PwValue)) {
+    } else if (desired_capacity > PWARRAY_MAX_CAPACITY) {
         pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
         return false;
     }
-    unsigned new_capacity = round_capacity(desired_capacity);
+    unsigned new_capacity = _pw_array_round_capacity(desired_capacity);
 
+    if (array->head) {
+        reclaim_head(array);
+    }
+    if (array->inline_storage) {
+        if (new_capacity <= PWARRAY_INLINE_CAPACITY) {
+            return true;
+        }
+        // spill items to allocated block
+        PwValuePtr items = _pw_alloc(type_id, new_capacity * sizeof(_PwValue), true);
+        if (!items) {
+            return false;
+        }
+        memcpy(items, array->items, array->length * sizeof(_PwValue));
+        array->items = items;
+        array->capacity = new_capacity;
+        array->inline_storage = false;
+        return true;
+    }
     unsigned old_memsize = array->capacity * sizeof(_PwValue);
     unsigned new_memsize = new_capacity * sizeof(_PwValue);
 
@@ -272,6 +369,34 @@ void _pw_destroy_array(PwTypeId type_id, _PwArray* array, PwValuePtr parent)
     return _pw_array_resize(array_value->type_id, array, desired_capacity);
 }
 
+[[nodiscard]] bool pw_array_shrink(PwValuePtr array_value)
+{
+    pw_assert_array(array_value);
+    _PwArray* array = get_array_struct_ptr(array_value);
+    if (array->itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    if (array->length <= PWARRAY_INLINE_CAPACITY) {
+        if (!array->inline_storage) {
+            // move items back to inline storage
+            PwValuePtr block = array->items - array->head;
+            unsigned memsize = (array->head + array->capacity) * sizeof(_PwValue);
+            memcpy(((_PwArrayData*) array)->inline_items, array->items, array->length * sizeof(_PwValue));
+            _pw_free(array_value->type_id, (void**) &block, memsize);
+            use_inline_storage(array);
+        } else if (array->head) {
+            reclaim_head(array);
+        }
+        return true;
+    }
+    unsigned capacity = array->length;
+    if (array->head == 0 && _pw_array_round_capacity(capacity) == array->capacity) {
+        return true;
+    }
+    return _pw_array_resize(array_value->type_id, array, capacity);
+}
+
 [[nodiscard]] unsigned pw_array_length(PwValuePtr array_value)
 {
     pw_assert_array(array_value);
@@ -312,21 +437,144 @@ void _pw_destroy_array(PwTypeId type_id, _PwArray* array, PwValuePtr parent)
     return _pw_array_append_item(array_value->type_id, array, &cloned_item, array_value);
 }
 
+unsigned _pw_array_grown_capacity(_PwArray* array)
+{
+    unsigned capacity = array->capacity;
+    unsigned increment;
+    if (capacity <= PWARRAY_CAPACITY_INCREMENT) {
+        increment = PWARRAY_INITIAL_CAPACITY;
+    } else {
+        switch (array->growth) {
+            case PW_ARRAY_GROWTH_1_5X:   increment = capacity / 2; break;
+            case PW_ARRAY_GROWTH_LINEAR: increment = PWARRAY_CAPACITY_INCREMENT; break;
+            default:                     increment = capacity; break;
+        }
+    }
+    if (capacity >= PWARRAY_MAX_CAPACITY) {
+        // let _pw_array_resize fail
+        increment = 1;
+    } else if (increment > PWARRAY_MAX_CAPACITY - capacity) {
+        increment = PWARRAY_MAX_CAPACITY - capacity;
+    }
+    return capacity + increment;
+}
+
 [[nodiscard]] static bool grow_array(PwTypeId type_id, _PwArray* array)
 {
     pw_assert(array->length <= array->capacity);
 
-    if (array->length == array->capacity) {
-        unsigned new_capacity;
-        if (array->capacity <= PWARRAY_CAPACITY_INCREMENT) {
-            new_capacity = array->capacity + PWARRAY_INITIAL_CAPACITY;
-        } else {
-            new_capacity = array->capacity + PWARRAY_CAPACITY_INCREMENT;
+    if (array->length < array->capacity) {
+        return true;
+    }
+    if (array->head && array->head >= array->length / 2) {
+        // enough room at front, moving items there is amortized by pulls
+        reclaim_head(array);
+        return true;
+    }
+    return _pw_array_resize(type_id, array, _pw_array_grown_capacity(array));
+}
+
+[[nodiscard]] static bool reserve_tail(PwTypeId type_id, _PwArray* array, unsigned n)
+/*
+ * Make room for `n` more items at the end with at most one reallocation.
+ */
+{
+    if (n > PWARRAY_MAX_CAPACITY - array->length) {
+        pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+        return false;
+    }
+    unsigned required = array->length + n;
+    if (required <= array->capacity) {
+        return true;
+    }
+    if (required <= array->head + array->capacity && array->head >= array->length / 2) {
+        reclaim_head(array);
+        return true;
+    }
+    // grow no less than the policy does, so repeated extends stay amortized
+    unsigned capacity = _pw_array_grown_capacity(array);
+    if (capacity < required) {
+        capacity = required;
+    }
+    return _pw_array_resize(type_id, array, capacity);
+}
+
+static void unadopt_items(PwValuePtr parent, PwValuePtr items, unsigned n)
+/*
+ * Roll back successful _pw_adopt calls for the first n items:
+ * drop links to the parent and restore references consumed by adoption.
+ */
+{
+    for (unsigned i = 0; i < n; i++, items++) {
+        if (pw_is_compound(items)) {
+            _pw_abandon(parent, items);
+            if (!_pw_compound_data_ptr(items)->acyclic) {
+                items->struct_data->refcount++;
+            }
         }
-        if (!_pw_array_resize(type_id, array, new_capacity)) {
+    }
+}
+
+[[nodiscard]] bool pw_array_extend(PwValuePtr dest, PwValuePtr src)
+{
+    pw_assert_array(dest);
+    pw_assert_array(src);
+    _PwArray* array = get_array_struct_ptr(dest);
+    if (array->itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    unsigned n = get_array_struct_ptr(src)->length;
+    if (!reserve_tail(dest->type_id, array, n)) {
+        return false;
+    }
+    // get items after reserving, src may be the same as dest
+    PwValuePtr src_items = get_array_struct_ptr(src)->items;
+    PwValuePtr new_items = &array->items[array->length];
+    memcpy(new_items, src_items, n * sizeof(_PwValue));
+
+    PwValuePtr item_ptr = new_items;
+    for (unsigned i = 0; i < n; i++, item_ptr++) {
+        PwType* t = pw_typeof(item_ptr);
+        if (t->clone) {
+            t->clone(item_ptr);
+        }
+        if (!_pw_embrace(dest, item_ptr)) {
+            // items after i are not cloned yet, leave them alone
+            unadopt_items(dest, new_items, i);
+            for (unsigned j = 0; j <= i; j++) {
+                pw_destroy(&new_items[j]);
+            }
+            return false;
+        }
+    }
+    array->length += n;
+    return true;
+}
+
+[[nodiscard]] bool pw_array_extend_move(PwValuePtr dest, PwValuePtr values, unsigned n)
+{
+    pw_assert_array(dest);
+    _PwArray* array = get_array_struct_ptr(dest);
+    if (array->itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    if (!reserve_tail(dest->type_id, array, n)) {
+        return false;
+    }
+    PwValuePtr value_ptr = values;
+    for (unsigned i = 0; i < n; i++, value_ptr++) {
+        if (!_pw_embrace(dest, value_ptr)) {
+            unadopt_items(dest, values, i);
             return false;
         }
     }
+    memcpy(&array->items[array->length], values, n * sizeof(_PwValue));
+    array->length += n;
+    for (unsigned i = 0; i < n; i++) {
+        values[i].type_id = PwTypeId_Null;
+    }
     return true;
 }
 
@@ -390,6 +638,32 @@ failure:
     return true;
 }
 
+[[nodiscard]] static bool grow_head(PwTypeId type_id, _PwArray* array)
+/*
+ * Make room before the first item, proportional to the length of array,
+ * so that repeated inserts at front take amortized O(1).
+ */
+{
+    unsigned room = array->length / 2;
+    if (room < PWARRAY_INITIAL_CAPACITY) {
+        room = PWARRAY_INITIAL_CAPACITY;
+    }
+    if (array->capacity - array->length < room) {
+        if (room > PWARRAY_MAX_CAPACITY - array->length) {
+            pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+            return false;
+        }
+        if (!_pw_array_resize(type_id, array, array->length + room)) {
+            return false;
+        }
+    }
+    memmove(array->items + room, array->items, array->length * sizeof(_PwValue));
+    array->items += room;
+    array->head += room;
+    array->capacity -= room;
+    return true;
+}
+
 [[nodiscard]] bool _pw_array_insert(PwValuePtr array_value, unsigned index, PwValuePtr item)
 {
     pw_assert_array(array_value);
@@ -402,14 +676,31 @@ failure:
         pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
         return false;
     }
-    if (!grow_array(array_value->type_id, array)) {
-        return false;
-    }
-    if (!_pw_embrace(array_value, item)) {
-        return false;
-    }
-    if (index < array->length) {
-        memmove(&array->items[index + 1], &array->items[index], (array->length - index) * sizeof(_PwValue));
+    if (index < array->length / 2) {
+        // shift preceding items towards front
+        if (array->head == 0) {
+            if (!grow_head(array_value->type_id, array)) {
+                return false;
+            }
+        }
+        if (!_pw_embrace(array_value, item)) {
+            return false;
+        }
+        array->items--;
+        array->head--;
+        array->capacity++;
+        memmove(array->items, array->items + 1, index * sizeof(_PwValue));
+    } else {
+        // shift following items towards back
+        if (!grow_array(array_value->type_id, array)) {
+            return false;
+        }
+        if (!_pw_embrace(array_value, item)) {
+            return false;
+        }
+        if (index < array->length) {
+            memmove(&array->items[index + 1], &array->items[index], (array->length - index) * sizeof(_PwValue));
+        }
     }
     __pw_clone(item, &array->items[index]);  // destination contains garbage, so use __pw_clone here
     array->length++;
@@ -496,6 +787,32 @@ failure:
     }
 }
 
+[[nodiscard]] _PwArrayCursor pw_array_cursor(PwValuePtr array_value)
+{
+    pw_assert_array(array_value);
+    _PwArray* array = get_array_struct_ptr(array_value);
+
+    // the array cannot be modified until cursor is stopped,
+    // so items pointer and length remain valid
+    array->itercount++;
+
+    return (_PwArrayCursor) {
+        .array   = pw_clone(array_value),
+        ._items  = array->items,
+        ._length = array->length
+    };
+}
+
+void pw_array_cursor_stop(_PwArrayCursor* cursor)
+{
+    if (cursor->array.type_id != PwTypeId_Null) {
+        get_array_struct_ptr(&cursor->array)->itercount--;
+        pw_destroy(&cursor->array);
+        cursor->item = nullptr;
+        cursor->_length = 0;
+    }
+}
+
 [[nodiscard]] bool pw_array_pull(PwValuePtr array_value, PwValuePtr result)
 {
     pw_assert_array(array_value);
@@ -514,8 +831,17 @@ failure:
     }
     pw_move(item_ptr, result);
     array->length--;
-    memmove(item_ptr, item_ptr + 1, array->length * sizeof(_PwValue));
-//    memset(&array->items[array->length], 0, sizeof(_PwValue)); // XXX just in case
+    if (array->length == 0) {
+        // start over from the beginning of allocated block
+        array->capacity += array->head;
+        array->items -= array->head;
+        array->head = 0;
+    } else {
+        // leave the slot at front for inserts and appends
+        array->items++;
+        array->head++;
+        array->capacity--;
+    }
     return true;
 }
 
@@ -644,18 +970,16 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
 
     // calculate total length and max char width of string items
     unsigned result_len = 0;
-    for (unsigned i = 0; i < num_items; i++) {{   // nested scope for autocleaning item
-        if (i) {
+    PwArrayCursor cursor = pw_array_cursor(array);
+    while (pw_array_cursor_next(&cursor)) {
+        if (cursor.index) {
             result_len += separator_len;
         }
-        PwValue item = PW_NULL;
-        if (!pw_array_item(array, i, &item)) {
-            return false;
-        }
+        PwValuePtr item = cursor.item;
         uint8_t char_size;
-        if (pw_is_string(&item)) {
-            char_size = item.char_size;
-            result_len += pw_strlen(&item);
+        if (pw_is_string(item)) {
+            char_size = item->char_size;
+            result_len += pw_strlen(item);
         } else {
             // XXX skipping non-string values
             continue;
@@ -663,30 +987,29 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
         if (max_char_size < char_size) {
             max_char_size = char_size;
         }
-    }}
+    }
+    pw_array_cursor_stop(&cursor);
 
     // join array items
     if (!pw_create_empty_string(result_len, max_char_size, result)) {
         return false;
     }
-    for (unsigned i = 0; i < num_items; i++) {{   // nested scope for autocleaning item
-        PwValue item = PW_NULL;
-        if (!pw_array_item(array, i, &item)) {
-            return false;
-        }
-        if (pw_is_string(&item)) {
-            if (i) {
+    cursor = pw_array_cursor(array);
+    while (pw_array_cursor_next(&cursor)) {
+        PwValuePtr item = cursor.item;
+        if (pw_is_string(item)) {
+            if (cursor.index) {
                 if (!_pw_string_append(result, separator)) {
                     pw_destroy(result);
                     return false;
                 }
             }
-            if (!_pw_string_append(result, &item)) {
+            if (!_pw_string_append(result, item)) {
                 pw_destroy(result);
                 return false;
             }
         }
-    }}
+    }
     return true;
 }
 
@@ -778,7 +1101,7 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
  * RandomAccess interface
  */
 
-[[nodiscard]] static bool key_to_index(PwValuePtr key, PwValuePtr result)
+[[nodiscard]] bool _pw_array_key_to_index(PwValuePtr key, PwValuePtr result)
 /*
  * Convert key to integer index, either signed or unsigned.
  */
@@ -831,7 +1154,7 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
 [[nodiscard]] static bool ra_get_item(PwValuePtr self, PwValuePtr key, PwValuePtr result)
 {
     PwValue index = PW_NULL;
-    if (!key_to_index(key, &index)) {
+    if (!_pw_array_key_to_index(key, &index)) {
         return false;
     }
     if (pw_is_unsigned(&index)) {
@@ -844,7 +1167,7 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
 [[nodiscard]] static bool ra_set_item(PwValuePtr self, PwValuePtr key, PwValuePtr value)
 {
     PwValue index = PW_NULL;
-    if (!key_to_index(key, &index)) {
+    if (!_pw_array_key_to_index(key, &index)) {
         return false;
     }
     if (pw_is_unsigned(&index)) {
@@ -857,7 +1180,7 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
 [[nodiscard]] static bool ra_delete_item(PwValuePtr self, PwValuePtr key)
 {
     PwValue index = PW_NULL;
-    if (!key_to_index(key, &index)) {
+    if (!_pw_array_key_to_index(key, &index)) {
         return false;
     }
     unsigned i;
@@ -15,6 +15,16 @@ extern "C" {
 #define PWARRAY_INITIAL_CAPACITY    4
 #define PWARRAY_CAPACITY_INCREMENT  16
 
+// arrays of this capacity and above occupy whole pages,
+// so allocators that map large blocks can remap them on growth instead of copying
+#define PWARRAY_LARGE_CAPACITY  (128 * 1024 / sizeof(_PwValue))
+
+// rounding capacity up to whole pages of up to 64K never overflows memsize
+#define PWARRAY_MAX_CAPACITY  ((UINT_MAX & ~0xFFFFU) / sizeof(_PwValue))
+
+// arrays of up to this number of items keep them inline in struct data
+#define PWARRAY_INLINE_CAPACITY  PWARRAY_INITIAL_CAPACITY
+
 typedef struct {
     /*
      * This structure extends _PwCompoundData.
@@ -23,10 +33,27 @@ typedef struct {
 
     PwValuePtr items;
     unsigned length;
-    unsigned capacity;
+    unsigned capacity;   // number of items allocated starting from `items`
+    unsigned head;       // number of free items allocated before `items`,
+                         // it makes pulling and inserting at front O(1)
     unsigned itercount;  // number of iterations in progress
+    uint8_t growth;      // PW_ARRAY_GROWTH_*
+    bool inline_storage; // items point to _PwArrayData.inline_items
 } _PwArray;
 
+typedef struct {
+    /*
+     * Struct data of Array values.
+     *
+     * Small arrays keep items here and do not allocate a separate block
+     * until they grow beyond PWARRAY_INLINE_CAPACITY.
+     * Arrays embedded in other structures, such as map's kv_pairs,
+     * have no inline storage.
+     */
+    _PwArray array;
+    _PwValue inline_items[PWARRAY_INLINE_CAPACITY];
+} _PwArrayData;
+
 #define get_array_struct_ptr(value)  ((_PwArray*) ((value)->struct_data))
 
 extern PwType _pw_array_type;
@@ -52,6 +79,17 @@ static inline unsigned _pw_array_capacity(_PwArray* array)
  * - set array->capacity = rounded capacity
  */
 
+unsigned _pw_array_round_capacity(unsigned capacity);
+/*
+ * Return capacity the array gets when resized to `capacity`.
+ * `capacity` must not exceed PWARRAY_MAX_CAPACITY.
+ */
+
+unsigned _pw_array_grown_capacity(_PwArray* array);
+/*
+ * Return next capacity according to growth policy.
+ */
+
 [[nodiscard]] bool _pw_array_resize(PwTypeId type_id, _PwArray* array, unsigned desired_capacity);
 /*
  * Reallocate array.
@@ -78,6 +116,17 @@ void _pw_array_del(_PwArray* array, unsigned start_index, unsigned end_index, Pw
  * Delete items from array.
  */
 
+[[nodiscard]] bool _pw_array_key_to_index(PwValuePtr key, PwValuePtr result);
+/*
+ * Convert RandomAccess key to integer index, either signed or unsigned.
+ * String keys are parsed.
+ */
+
+PwValuePtr _pw_array_slice_array(PwValuePtr slice);
+/*
+ * Return borrowed pointer to the array the slice refers to or owns.
+ */
+
 #ifdef __cplusplus
 }
 #endif
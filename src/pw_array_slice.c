@@ -0,0 +1,343 @@
+#include "include/pw.h"
+#include "src/pw_array_internal.h"
+#include "src/pw_struct_internal.h"
+
+typedef struct {
+    /*
+     * This structure extends _PwStructData.
+     */
+    _PwStructData struct_data;
+
+    _PwValue array;  // referenced array or owned copy of items
+    unsigned start;
+    unsigned end;    // exclusive, can be beyond the current length of array
+    bool owned;      // the array is a copy that belongs to the view
+} _PwArraySlice;
+
+#define get_array_slice_ptr(value)  ((_PwArraySlice*) ((value)->struct_data))
+
+PwTypeId PwTypeId_ArraySlice = 0;
+
+static PwType array_slice_type;
+
+static inline unsigned slice_length(_PwArraySlice* slice)
+/*
+ * Return the length of slice clamped to the current length of array.
+ */
+{
+    unsigned array_length = get_array_struct_ptr(&slice->array)->length;
+    unsigned end = slice->end;
+    if (end > array_length) {
+        end = array_length;
+    }
+    if (slice->start >= end) {
+        return 0;
+    }
+    return end - slice->start;
+}
+
+PwValuePtr _pw_array_slice_array(PwValuePtr slice)
+{
+    return &get_array_slice_ptr(slice)->array;
+}
+
+static inline PwValuePtr slice_items(_PwArraySlice* slice)
+{
+    return &get_array_struct_ptr(&slice->array)->items[slice->start];
+}
+
+/****************************************************************
+ * Basic interface methods
+ */
+
+static void array_slice_fini(PwValuePtr self)
+{
+    pw_destroy(&get_array_slice_ptr(self)->array);
+}
+
+static void array_slice_hash(PwValuePtr self, PwHashContext* ctx)
+{
+    _PwArraySlice* slice = get_array_slice_ptr(self);
+    _pw_hash_uint64(ctx, self->type_id);
+    PwValuePtr item_ptr = slice_items(slice);
+    for (unsigned n = slice_length(slice); n; n--, item_ptr++) {
+        _pw_call_hash(item_ptr, ctx);
+    }
+}
+
+[[nodiscard]] static bool array_slice_deepcopy(PwValuePtr self, PwValuePtr result)
+{
+    // make owned view of deep copied items
+    PwValue items = PW_NULL;
+    if (!pw_array_slice_to_array(self, &items)) {
+        return false;
+    }
+    PwValue array = PW_NULL;
+    if (!pw_deepcopy(&items, &array)) {
+        return false;
+    }
+    if (!pw_array_slice_view(&array, 0, UINT_MAX, result)) {
+        return false;
+    }
+    get_array_slice_ptr(result)->owned = true;
+    return true;
+}
+
+static void array_slice_dump(PwValuePtr self, FILE* fp, int first_indent, int next_indent, _PwCompoundChain* tail)
+{
+    _PwArraySlice* slice = get_array_slice_ptr(self);
+
+    _pw_dump_start(fp, self, first_indent);
+    _pw_dump_struct_data(fp, self);
+    _pw_print_indent(fp, next_indent);
+    fprintf(fp, "%s items %u..%u of:", slice->owned? "Owned" : "Referenced", slice->start, slice->end);
+    _pw_call_dump(fp, &slice->array, next_indent, next_indent, tail);
+}
+
+[[nodiscard]] static bool array_slice_to_string(PwValuePtr self, PwValuePtr result)
+{
+    pw_set_status(PwStatus(PW_ERROR_NOT_IMPLEMENTED));
+    return false;
+}
+
+[[nodiscard]] static bool array_slice_is_true(PwValuePtr self)
+{
+    return slice_length(get_array_slice_ptr(self));
+}
+
+[[nodiscard]] static bool array_slice_eq(_PwArraySlice* a, _PwArraySlice* b)
+{
+    unsigned n = slice_length(a);
+    if (slice_length(b) != n) {
+        return false;
+    }
+    PwValuePtr a_ptr = slice_items(a);
+    PwValuePtr b_ptr = slice_items(b);
+    for (; n; n--, a_ptr++, b_ptr++) {
+        if (!_pw_equal(a_ptr, b_ptr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] static bool array_slice_equal_sametype(PwValuePtr self, PwValuePtr other)
+{
+    return array_slice_eq(get_array_slice_ptr(self), get_array_slice_ptr(other));
+}
+
+[[nodiscard]] static bool array_slice_equal(PwValuePtr self, PwValuePtr other)
+{
+    PwTypeId t = other->type_id;
+    for (;;) {
+        if (t == PwTypeId_ArraySlice) {
+            return array_slice_eq(get_array_slice_ptr(self), get_array_slice_ptr(other));
+        }
+        // check base type
+        t = _pw_types[t]->ancestor_id;
+        if (t == PwTypeId_Null) {
+            return false;
+        }
+    }
+}
+
+/****************************************************************
+ * Slice functions
+ */
+
+[[nodiscard]] bool pw_array_slice_view(PwValuePtr array, unsigned start_index, unsigned end_index, PwValuePtr result)
+{
+    _PwValue target;
+    if (pw_is_array_slice(array)) {
+        // refer to the underlying array directly
+        _PwArraySlice* src = get_array_slice_ptr(array);
+        unsigned length = slice_length(src);
+        if (end_index > length) {
+            end_index = length;
+        }
+        if (start_index > end_index) {
+            start_index = end_index;
+        }
+        target = src->array;
+        start_index += src->start;
+        end_index += src->start;
+    } else {
+        pw_assert_array(array);
+        if (start_index > end_index) {
+            start_index = end_index;
+        }
+        target = *array;
+    }
+    if (!pw_create(PwTypeId_ArraySlice, result)) {
+        return false;
+    }
+    _PwArraySlice* slice = get_array_slice_ptr(result);
+    slice->array = pw_clone(&target);
+    slice->start = start_index;
+    slice->end   = end_index;
+    return true;
+}
+
+unsigned pw_array_slice_length(PwValuePtr view)
+{
+    pw_assert_array_slice(view);
+    return slice_length(get_array_slice_ptr(view));
+}
+
+[[nodiscard]] bool pw_array_slice_item(PwValuePtr view, unsigned index, PwValuePtr result)
+{
+    pw_assert_array_slice(view);
+    _PwArraySlice* slice = get_array_slice_ptr(view);
+    if (index >= slice_length(slice)) {
+        pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+        return false;
+    }
+    pw_clone2(&slice_items(slice)[index], result);
+    return true;
+}
+
+[[nodiscard]] bool pw_array_slice_set_item(PwValuePtr view, unsigned index, PwValuePtr item)
+{
+    if (!pw_array_slice_materialize(view)) {
+        return false;
+    }
+    return pw_array_set_item(&get_array_slice_ptr(view)->array, index, item);
+}
+
+[[nodiscard]] bool pw_array_slice_materialize(PwValuePtr view)
+{
+    pw_assert_array_slice(view);
+    _PwArraySlice* slice = get_array_slice_ptr(view);
+    if (slice->owned) {
+        return true;
+    }
+    PwValue copy = PW_NULL;
+    if (!pw_array_slice_to_array(view, &copy)) {
+        return false;
+    }
+    pw_move(&copy, &slice->array);
+    slice->start = 0;
+    slice->end   = UINT_MAX;  // follow the length of owned array
+    slice->owned = true;
+    return true;
+}
+
+[[nodiscard]] bool pw_array_slice_to_array(PwValuePtr view, PwValuePtr result)
+{
+    pw_assert_array_slice(view);
+    _PwArraySlice* slice = get_array_slice_ptr(view);
+    return pw_array_slice(&slice->array, slice->start, slice->start + slice_length(slice), result);
+}
+
+[[nodiscard]] _PwArrayCursor pw_array_slice_cursor(PwValuePtr view)
+{
+    pw_assert_array_slice(view);
+    _PwArraySlice* slice = get_array_slice_ptr(view);
+
+    // same as pw_array_cursor, restricted to the range of the view
+    _PwArrayCursor cursor = pw_array_cursor(&slice->array);
+    cursor._items  = slice_items(slice);
+    cursor._length = slice_length(slice);
+    return cursor;
+}
+
+/****************************************************************
+ * RandomAccess interface
+ */
+
+[[nodiscard]] static bool key_to_index(PwValuePtr self, PwValuePtr key, unsigned* result)
+/*
+ * Convert key to unsigned index, negative keys are counted from the end.
+ * The index is range-checked in 64 bits before narrowing.
+ */
+{
+    PwValue index = PW_NULL;
+    if (!_pw_array_key_to_index(key, &index)) {
+        return false;
+    }
+    unsigned length = slice_length(get_array_slice_ptr(self));
+    if (pw_is_signed(&index)) {
+        PwType_Signed i = index.signed_value;
+        if (i < 0) {
+            i += length;
+        }
+        if (i < 0 || i >= (PwType_Signed) length) {
+            pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+            return false;
+        }
+        *result = (unsigned) i;
+        return true;
+    }
+    if (index.unsigned_value >= length) {
+        pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+        return false;
+    }
+    *result = (unsigned) index.unsigned_value;
+    return true;
+}
+
+[[nodiscard]] static bool ra_get_item(PwValuePtr self, PwValuePtr key, PwValuePtr result)
+{
+    unsigned index;
+    if (!key_to_index(self, key, &index)) {
+        return false;
+    }
+    return pw_array_slice_item(self, index, result);
+}
+
+[[nodiscard]] static bool ra_set_item(PwValuePtr self, PwValuePtr key, PwValuePtr value)
+{
+    unsigned index;
+    if (!key_to_index(self, key, &index)) {
+        return false;
+    }
+    return pw_array_slice_set_item(self, index, value);
+}
+
+[[nodiscard]] static bool ra_delete_item(PwValuePtr self, PwValuePtr key)
+{
+    unsigned index;
+    if (!key_to_index(self, key, &index)) {
+        return false;
+    }
+    if (!pw_array_slice_materialize(self)) {
+        return false;
+    }
+    PwValuePtr array = &get_array_slice_ptr(self)->array;
+    if (index >= pw_array_length(array)) {
+        pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+        return false;
+    }
+    pw_array_del(array, index, index + 1);
+    return true;
+}
+
+static PwInterface_RandomAccess random_access_interface = {
+    .length      = pw_array_slice_length,
+    .get_item    = ra_get_item,
+    .set_item    = ra_set_item,
+    .delete_item = ra_delete_item
+};
+
+/****************************************************************
+ * ArraySlice type
+ */
+
+[[ gnu::constructor ]]
+static void init_array_slice_type()
+{
+    if (PwTypeId_ArraySlice == 0) {
+        PwTypeId_ArraySlice = pw_struct_subtype(
+            &array_slice_type, "ArraySlice", PwTypeId_Struct, _PwArraySlice,
+            PwInterfaceId_RandomAccess, &random_access_interface
+        );
+        array_slice_type.hash           = array_slice_hash;
+        array_slice_type.deepcopy       = array_slice_deepcopy;
+        array_slice_type.dump           = array_slice_dump;
+        array_slice_type.to_string      = array_slice_to_string;
+        array_slice_type.is_true        = array_slice_is_true;
+        array_slice_type.equal_sametype = array_slice_equal_sametype;
+        array_slice_type.equal          = array_slice_equal;
+        array_slice_type.fini           = array_slice_fini;
+    }
+}
@@ -0,0 +1,616 @@
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "include/pw.h"
+#include "src/pw_alloc.h"
+#include "src/pw_array_internal.h"
+
+/*
+ * Sorting sorts a permutation of item indices first and then reorders items.
+ * This way comparators work with precomputed keys and items are moved only once.
+ *
+ * Homogeneous keys are detected and given specialized paths:
+ *
+ *   Signed, Unsigned, Float, Timestamp  LSD radix sort, always stable
+ *   strings with char_size 1            memcmp
+ *
+ * Other keys are compared with pw_compare.
+ */
+
+#define INSERTION_SORT_THRESHOLD  24
+#define MIN_PARALLEL_ITEMS        65536
+#define MAX_SORT_THREADS          64
+
+/****************************************************************
+ * Comparators
+ *
+ * Each comparator is a `less` function of two item indices
+ * and a context that holds precomputed keys.
+ */
+
+typedef struct {
+    uint8_t* ptr;
+    unsigned length;
+} StringKey;
+
+static inline bool string_less(StringKey* keys, unsigned a, unsigned b)
+{
+    StringKey* ka = &keys[a];
+    StringKey* kb = &keys[b];
+    unsigned n = (ka->length < kb->length)? ka->length : kb->length;
+    int result = memcmp(ka->ptr, kb->ptr, n);
+    if (result) {
+        return result < 0;
+    }
+    return ka->length < kb->length;
+}
+
+typedef struct {
+    PwValuePtr keys;
+    bool failed;
+} GenericContext;
+
+static inline bool generic_less(GenericContext* ctx, unsigned a, unsigned b)
+{
+    if (_pw_unlikely(ctx->failed)) {
+        return false;
+    }
+    int result;
+    if (!pw_compare(&ctx->keys[a], &ctx->keys[b], &result)) {
+        ctx->failed = true;
+        return false;
+    }
+    return result < 0;
+}
+
+/****************************************************************
+ * Comparison sorts, specialized for each comparator.
+ *
+ * Merge sort is stable, introsort is not.
+ */
+
+#define SORT_FUNCTIONS(NAME, CONTEXT_TYPE, LESS)  \
+    static void insertion_sort_##NAME(CONTEXT_TYPE ctx, unsigned* perm, unsigned n)  \
+    {  \
+        for (unsigned i = 1; i < n; i++) {  \
+            unsigned x = perm[i];  \
+            unsigned j = i;  \
+            while (j && LESS(ctx, x, perm[j - 1])) {  \
+                perm[j] = perm[j - 1];  \
+                j--;  \
+            }  \
+            perm[j] = x;  \
+        }  \
+    }  \
+    \
+    static void merge_##NAME(CONTEXT_TYPE ctx, unsigned* left, unsigned left_n,  \
+                             unsigned* right, unsigned right_n, unsigned* dest)  \
+    {  \
+        unsigned* left_end = left + left_n;  \
+        unsigned* right_end = right + right_n;  \
+        while (left < left_end && right < right_end) {  \
+            if (LESS(ctx, *right, *left)) {  \
+                *dest++ = *right++;  \
+            } else {  \
+                *dest++ = *left++;  \
+            }  \
+        }  \
+        while (left < left_end) {  \
+            *dest++ = *left++;  \
+        }  \
+        while (right < right_end) {  \
+            *dest++ = *right++;  \
+        }  \
+    }  \
+    \
+    static void merge_sort_##NAME(CONTEXT_TYPE ctx, unsigned* perm, unsigned* temp, unsigned n)  \
+    /*  \
+     * Bottom-up merge sort of sorted runs, `temp` must hold n items.  \
+     */  \
+    {  \
+        for (unsigned i = 0; i < n; i += INSERTION_SORT_THRESHOLD) {  \
+            unsigned run = (n - i < INSERTION_SORT_THRESHOLD)? n - i : INSERTION_SORT_THRESHOLD;  \
+            insertion_sort_##NAME(ctx, perm + i, run);  \
+        }  \
+        unsigned* src = perm;  \
+        unsigned* dest = temp;  \
+        for (unsigned width = INSERTION_SORT_THRESHOLD; width < n; width *= 2) {  \
+            for (unsigned i = 0; i < n; i += 2 * width) {  \
+                unsigned left_n = (n - i < width)? n - i : width;  \
+                unsigned right_n = (n - i - left_n < width)? n - i - left_n : width;  \
+                merge_##NAME(ctx, src + i, left_n, src + i + left_n, right_n, dest + i);  \
+            }  \
+            unsigned* t = src;  \
+            src = dest;  \
+            dest = t;  \
+        }  \
+        if (src != perm) {  \
+            memcpy(perm, src, n * sizeof(unsigned));  \
+        }  \
+    }  \
+    \
+    static void sift_down_##NAME(CONTEXT_TYPE ctx, unsigned* perm, unsigned root, unsigned n)  \
+    {  \
+        for (;;) {  \
+            unsigned child = 2 * root + 1;  \
+            if (child >= n) {  \
+                break;  \
+            }  \
+            if (child + 1 < n && LESS(ctx, perm[child], perm[child + 1])) {  \
+                child++;  \
+            }  \
+            if (!LESS(ctx, perm[root], perm[child])) {  \
+                break;  \
+            }  \
+            unsigned t = perm[root];  \
+            perm[root] = perm[child];  \
+            perm[child] = t;  \
+            root = child;  \
+        }  \
+    }  \
+    \
+    static void heap_sort_##NAME(CONTEXT_TYPE ctx, unsigned* perm, unsigned n)  \
+    {  \
+        for (unsigned i = n / 2; i--;) {  \
+            sift_down_##NAME(ctx, perm, i, n);  \
+        }  \
+        while (n > 1) {  \
+            n--;  \
+            unsigned t = perm[0];  \
+            perm[0] = perm[n];  \
+            perm[n] = t;  \
+            sift_down_##NAME(ctx, perm, 0, n);  \
+        }  \
+    }  \
+    \
+    static void intro_sort_##NAME(CONTEXT_TYPE ctx, unsigned* perm, unsigned n, unsigned depth_limit)  \
+    {  \
+        while (n > INSERTION_SORT_THRESHOLD) {  \
+            if (depth_limit-- == 0) {  \
+                heap_sort_##NAME(ctx, perm, n);  \
+                return;  \
+            }  \
+            /* median of three goes to perm[0] */  \
+            unsigned mid = n / 2;  \
+            unsigned a = perm[1], b = perm[mid], c = perm[n - 1];  \
+            unsigned median;  \
+            if (LESS(ctx, a, b)) {  \
+                median = LESS(ctx, b, c)? mid : (LESS(ctx, a, c)? n - 1 : 1);  \
+            } else {  \
+                median = LESS(ctx, a, c)? 1 : (LESS(ctx, b, c)? n - 1 : mid);  \
+            }  \
+            unsigned pivot = perm[median];  \
+            perm[median] = perm[0];  \
+            perm[0] = pivot;  \
+            /* Hoare partition */  \
+            unsigned i = 0;  \
+            unsigned j = n;  \
+            for (;;) {  \
+                do { i++; } while (i < n && LESS(ctx, perm[i], pivot));  \
+                do { j--; } while (LESS(ctx, pivot, perm[j]));  \
+                if (i >= j) {  \
+                    break;  \
+                }  \
+                unsigned t = perm[i];  \
+                perm[i] = perm[j];  \
+                perm[j] = t;  \
+            }  \
+            perm[0] = perm[j];  \
+            perm[j] = pivot;  \
+            /* recurse into smaller part */  \
+            if (j < n - j - 1) {  \
+                intro_sort_##NAME(ctx, perm, j, depth_limit);  \
+                perm += j + 1;  \
+                n -= j + 1;  \
+            } else {  \
+                intro_sort_##NAME(ctx, perm + j + 1, n - j - 1, depth_limit);  \
+                n = j;  \
+            }  \
+        }  \
+        insertion_sort_##NAME(ctx, perm, n);  \
+    }  \
+    \
+    static void sort_##NAME(CONTEXT_TYPE ctx, unsigned* perm, unsigned* temp, unsigned n, bool stable)  \
+    {  \
+        if (stable) {  \
+            merge_sort_##NAME(ctx, perm, temp, n);  \
+        } else {  \
+            intro_sort_##NAME(ctx, perm, n, 2 * (32 - __builtin_clz(n)));  \
+        }  \
+    }
+
+SORT_FUNCTIONS(string,  StringKey*,      string_less)
+SORT_FUNCTIONS(generic, GenericContext*, generic_less)
+
+/****************************************************************
+ * Parallel sort of strings.
+ *
+ * The permutation is split into chunks that are sorted in separate
+ * threads, then chunks are merged pairwise, each pair in its own thread.
+ *
+ * Only pure comparators run in threads: pw_compare may set status
+ * which is not thread-safe.
+ */
+
+typedef struct {
+    StringKey* keys;
+    unsigned* perm;
+    unsigned* temp;
+    unsigned  n;
+    unsigned  right_n;  // for merge jobs
+    bool      stable;
+} SortJob;
+
+static void* sort_job(void* arg)
+{
+    SortJob* job = arg;
+    sort_string(job->keys, job->perm, job->temp, job->n, job->stable);
+    return nullptr;
+}
+
+static void* merge_job(void* arg)
+{
+    SortJob* job = arg;
+    merge_string(job->keys, job->perm, job->n, job->perm + job->n, job->right_n, job->temp);
+    memcpy(job->perm, job->temp, (job->n + job->right_n) * sizeof(unsigned));
+    return nullptr;
+}
+
+static void run_jobs(void* (*fn)(void*), SortJob* jobs, unsigned num_jobs)
+/*
+ * Run jobs in threads, fall back to the current thread
+ * if a thread cannot be started.
+ */
+{
+    pthread_t threads[MAX_SORT_THREADS];
+    bool started[MAX_SORT_THREADS];
+    for (unsigned i = 1; i < num_jobs; i++) {
+        started[i] = pthread_create(&threads[i], nullptr, fn, &jobs[i]) == 0;
+        if (!started[i]) {
+            fn(&jobs[i]);
+        }
+    }
+    fn(&jobs[0]);
+    for (unsigned i = 1; i < num_jobs; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], nullptr);
+        }
+    }
+}
+
+static void parallel_sort_string(StringKey* keys, unsigned* perm, unsigned* temp, unsigned n,
+                                 bool stable, unsigned num_threads)
+{
+    if (num_threads > MAX_SORT_THREADS) {
+        num_threads = MAX_SORT_THREADS;
+    }
+    unsigned chunk_size = (n + num_threads - 1) / num_threads;
+
+    // chunk boundaries, chunk i spans bounds[i]..bounds[i + 1]
+    unsigned bounds[MAX_SORT_THREADS + 1];
+    unsigned num_chunks = 0;
+    for (unsigned start = 0; start < n; start += chunk_size) {
+        bounds[num_chunks++] = start;
+    }
+    bounds[num_chunks] = n;
+
+    SortJob jobs[MAX_SORT_THREADS];
+    for (unsigned i = 0; i < num_chunks; i++) {
+        jobs[i] = (SortJob) {
+            .keys   = keys,
+            .perm   = perm + bounds[i],
+            .temp   = temp + bounds[i],
+            .n      = bounds[i + 1] - bounds[i],
+            .stable = stable
+        };
+    }
+    run_jobs(sort_job, jobs, num_chunks);
+
+    // merge adjacent chunks until one remains; merging adjacent chunks keeps sort stable
+    while (num_chunks > 1) {
+        unsigned num_jobs = 0;
+        unsigned new_num_chunks = 0;
+        for (unsigned i = 0; i < num_chunks; i += 2) {
+            bounds[new_num_chunks++] = bounds[i];
+            if (i + 1 < num_chunks) {
+                jobs[num_jobs++] = (SortJob) {
+                    .keys    = keys,
+                    .perm    = perm + bounds[i],
+                    .temp    = temp + bounds[i],
+                    .n       = bounds[i + 1] - bounds[i],
+                    .right_n = bounds[i + 2] - bounds[i + 1]
+                };
+            }
+        }
+        bounds[new_num_chunks] = n;
+        run_jobs(merge_job, jobs, num_jobs);
+        num_chunks = new_num_chunks;
+    }
+}
+
+/****************************************************************
+ * Radix sort
+ */
+
+typedef struct {
+    uint64_t key;
+    unsigned index;
+} RadixItem;
+
+static RadixItem* radix_sort(RadixItem* items, RadixItem* temp, unsigned n, unsigned num_digits)
+/*
+ * Sort items by lower `num_digits` bytes of keys.
+ * Return pointer to sorted items, either `items` or `temp`.
+ */
+{
+    unsigned counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (unsigned i = 0; i < n; i++) {
+        uint64_t key = items[i].key;
+        for (unsigned d = 0; d < num_digits; d++) {
+            counts[d][(key >> (d * 8)) & 255]++;
+        }
+    }
+    RadixItem* src = items;
+    RadixItem* dest = temp;
+    for (unsigned d = 0; d < num_digits; d++) {
+        unsigned shift = d * 8;
+        unsigned* count = counts[d];
+        if (count[(src[0].key >> shift) & 255] == n) {
+            // all items have the same digit
+            continue;
+        }
+        unsigned offset = 0;
+        for (unsigned b = 0; b < 256; b++) {
+            unsigned c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (unsigned i = 0; i < n; i++) {
+            dest[count[(src[i].key >> shift) & 255]++] = src[i];
+        }
+        RadixItem* t = src;
+        src = dest;
+        dest = t;
+    }
+    return src;
+}
+
+static inline uint64_t float_radix_key(double f)
+/*
+ * Map float to unsigned integer with the same order.
+ * NaN is greater than any number, zeros are equal.
+ */
+{
+    if (isnan(f)) {
+        f = NAN;
+    } else if (f == 0.0) {
+        f = 0.0;
+    }
+    uint64_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return (bits & (1ULL << 63))? ~bits : bits | (1ULL << 63);
+}
+
+/****************************************************************
+ * Detection of key types
+ */
+
+enum {
+    KEYS_GENERIC,
+    KEYS_SIGNED,
+    KEYS_UNSIGNED,  // also Signed values that are not negative
+    KEYS_FLOAT,
+    KEYS_TIMESTAMP,
+    KEYS_STRING
+};
+
+static unsigned detect_keys(PwValuePtr keys, unsigned n)
+{
+    PwTypeId type_id = keys[0].type_id;
+    bool has_negative = false;
+    bool has_unsigned = false;
+    for (unsigned i = 0; i < n; i++) {
+        PwValuePtr key = &keys[i];
+        if (key->type_id == PwTypeId_Signed) {
+            if (key->signed_value < 0) {
+                has_negative = true;
+            }
+            if (type_id != PwTypeId_Signed && type_id != PwTypeId_Unsigned) {
+                return KEYS_GENERIC;
+            }
+        } else if (key->type_id == PwTypeId_Unsigned) {
+            has_unsigned = true;
+            if (type_id != PwTypeId_Signed && type_id != PwTypeId_Unsigned) {
+                return KEYS_GENERIC;
+            }
+        } else if (key->type_id != type_id) {
+            return KEYS_GENERIC;
+        } else if (type_id == PwTypeId_String && key->char_size != 1) {
+            return KEYS_GENERIC;
+        }
+    }
+    switch (type_id) {
+        case PwTypeId_Signed:
+        case PwTypeId_Unsigned:
+            if (has_negative) {
+                return has_unsigned? KEYS_GENERIC : KEYS_SIGNED;
+            }
+            return KEYS_UNSIGNED;
+        case PwTypeId_Float:     return KEYS_FLOAT;
+        case PwTypeId_Timestamp: return KEYS_TIMESTAMP;
+        case PwTypeId_String:    return KEYS_STRING;
+        default:                 return KEYS_GENERIC;
+    }
+}
+
+/****************************************************************
+ * Sorting
+ */
+
+[[nodiscard]] static bool get_memsize(size_t memsize, unsigned* result)
+/*
+ * Check that buffer size fits the allocator, which takes unsigned sizes.
+ */
+{
+    if (memsize > UINT_MAX) {
+        pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+        return false;
+    }
+    *result = (unsigned) memsize;
+    return true;
+}
+
+[[nodiscard]] static bool sort_permutation(PwValuePtr keys, unsigned* perm, unsigned n, PwSortOptions* options)
+{
+    bool stable = options && options->stable;
+    unsigned num_threads = options? options->num_threads : 0;
+
+    unsigned kind = detect_keys(keys, n);
+
+    if (kind == KEYS_STRING || kind == KEYS_GENERIC) {
+        unsigned* temp = _pw_alloc(PwTypeId_Array, n * sizeof(unsigned), false);
+        if (!temp) {
+            return false;
+        }
+        for (unsigned i = 0; i < n; i++) {
+            perm[i] = i;
+        }
+        bool result = true;
+        if (kind == KEYS_STRING) {
+            StringKey* string_keys = _pw_alloc(PwTypeId_Array, n * sizeof(StringKey), false);
+            if (string_keys) {
+                for (unsigned i = 0; i < n; i++) {
+                    string_keys[i].ptr = _pw_string_start_length(&keys[i], &string_keys[i].length);
+                }
+                if (num_threads > 1 && n >= MIN_PARALLEL_ITEMS) {
+                    parallel_sort_string(string_keys, perm, temp, n, stable, num_threads);
+                } else {
+                    sort_string(string_keys, perm, temp, n, stable);
+                }
+                _pw_free(PwTypeId_Array, (void**) &string_keys, n * sizeof(StringKey));
+            } else {
+                result = false;
+            }
+        } else {
+            GenericContext ctx = { .keys = keys, .failed = false };
+            sort_generic(&ctx, perm, temp, n, stable);
+            result = !ctx.failed;
+        }
+        _pw_free(PwTypeId_Array, (void**) &temp, n * sizeof(unsigned));
+        return result;
+    }
+
+    // radix sort
+    unsigned memsize;
+    if (!get_memsize(2 * (size_t) n * sizeof(RadixItem), &memsize)) {
+        return false;
+    }
+    RadixItem* items = _pw_alloc(PwTypeId_Array, memsize, false);
+    if (!items) {
+        return false;
+    }
+    RadixItem* temp = items + n;
+    RadixItem* sorted;
+    switch (kind) {
+        case KEYS_SIGNED:
+            for (unsigned i = 0; i < n; i++) {
+                items[i] = (RadixItem) { .key = ((uint64_t) keys[i].signed_value) ^ (1ULL << 63), .index = i };
+            }
+            sorted = radix_sort(items, temp, n, 8);
+            break;
+        case KEYS_UNSIGNED:
+            for (unsigned i = 0; i < n; i++) {
+                items[i] = (RadixItem) { .key = keys[i].unsigned_value, .index = i };
+            }
+            sorted = radix_sort(items, temp, n, 8);
+            break;
+        case KEYS_FLOAT:
+            for (unsigned i = 0; i < n; i++) {
+                items[i] = (RadixItem) { .key = float_radix_key(keys[i].float_value), .index = i };
+            }
+            sorted = radix_sort(items, temp, n, 8);
+            break;
+        default:
+            // timestamps: sort by nanoseconds, then by seconds
+            for (unsigned i = 0; i < n; i++) {
+                items[i] = (RadixItem) { .key = keys[i].ts_nanoseconds, .index = i };
+            }
+            sorted = radix_sort(items, temp, n, 4);
+            for (unsigned i = 0; i < n; i++) {
+                sorted[i].key = keys[sorted[i].index].ts_seconds;
+            }
+            sorted = radix_sort(sorted, (sorted == items)? temp : items, n, 8);
+            break;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        perm[i] = sorted[i].index;
+    }
+    _pw_free(PwTypeId_Array, (void**) &items, memsize);
+    return true;
+}
+
+static void destroy_keys(PwValuePtr keys, unsigned n)
+{
+    for (unsigned i = 0; i < n; i++) {
+        pw_destroy(&keys[i]);
+    }
+    _pw_free(PwTypeId_Array, (void**) &keys, n * sizeof(_PwValue));
+}
+
+[[nodiscard]] bool pw_array_sort(PwValuePtr array_value, PwSortOptions* options)
+{
+    pw_assert_array(array_value);
+    _PwArray* array = get_array_struct_ptr(array_value);
+    if (array->itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    unsigned n = array->length;
+    if (n < 2) {
+        return true;
+    }
+
+    PwValuePtr keys = array->items;
+    if (options && options->key) {
+        keys = _pw_alloc(PwTypeId_Array, n * sizeof(_PwValue), true);
+        if (!keys) {
+            return false;
+        }
+        // key function must not modify the array
+        array->itercount++;
+        for (unsigned i = 0; i < n; i++) {
+            if (!options->key(&array->items[i], &keys[i])) {
+                array->itercount--;
+                destroy_keys(keys, n);
+                return false;
+            }
+        }
+        array->itercount--;
+    }
+
+    // buffer for reordered items followed by permutation
+    unsigned memsize;
+    bool result = get_memsize((size_t) n * (sizeof(_PwValue) + sizeof(unsigned)), &memsize);
+    PwValuePtr sorted = nullptr;
+    if (result) {
+        sorted = _pw_alloc(PwTypeId_Array, memsize, false);
+        result = sorted != nullptr;
+    }
+    if (result) {
+        unsigned* perm = (unsigned*) (sorted + n);
+        result = sort_permutation(keys, perm, n, options);
+        if (result) {
+            for (unsigned i = 0; i < n; i++) {
+                sorted[i] = array->items[perm[i]];
+            }
+            memcpy(array->items, sorted, n * sizeof(_PwValue));
+        }
+        _pw_free(PwTypeId_Array, (void**) &sorted, memsize);
+    }
+    if (keys != array->items) {
+        destroy_keys(keys, n);
+    }
+    return result;
+}
@@ -3,6 +3,7 @@
 #include "include/pw.h"
 
 #include "src/pw_compound_internal.h"
+#include "src/pw_map_internal.h"
 #include "src/pw_struct_internal.h"
 
 
@@ -43,17 +44,316 @@ static inline _PwParentsChunk* get_parents_list(_PwCompoundData* cdata)
     return false;
 }
 
+/****************************************************************
+ * Hash set of parents
+ *
+ * Slots of the set are laid out in chunks, slot i is i % PW_PARENTS_CHUNK_SIZE
+ * in chunk i / PW_PARENTS_CHUNK_SIZE. Collisions are resolved by linear probing.
+ */
+
+#define parent_slot(list, i)      ((list)[(i) / PW_PARENTS_CHUNK_SIZE].parents[(i) % PW_PARENTS_CHUNK_SIZE])
+#define parent_refcount(list, i)  ((list)[(i) / PW_PARENTS_CHUNK_SIZE].parents_refcount[(i) % PW_PARENTS_CHUNK_SIZE])
+
+static inline bool using_parents_set(_PwCompoundData* cdata)
+{
+    return cdata->using_parents_list && cdata->num_parents_chunks > PW_PARENTS_LIST_MAX_CHUNKS;
+}
+
+static inline unsigned parent_hash(_PwCompoundData* parent, unsigned mask)
+{
+    return ((uint64_t) (ptrdiff_t) parent * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+}
+
+static void set_insert(_PwParentsChunk* set, unsigned mask, _PwCompoundData* parent, unsigned refcount)
+/*
+ * Insert `parent` that is not in the set yet.
+ * The set must have free slots.
+ */
+{
+    unsigned i = parent_hash(parent, mask);
+    while (parent_slot(set, i)) {
+        i = (i + 1) & mask;
+    }
+    parent_slot(set, i) = parent;
+    parent_refcount(set, i) = refcount;
+}
+
+[[nodiscard]] static bool rebuild_parents_list(_PwCompoundData* cdata, unsigned num_chunks)
+/*
+ * Move parents to a new list of `num_chunks`.
+ * The new list is a hash set if num_chunks > PW_PARENTS_LIST_MAX_CHUNKS,
+ * otherwise parents are placed one after another.
+ */
+{
+    _PwParentsChunk* new_list = default_allocator.allocate(num_chunks * sizeof(_PwParentsChunk), true);
+    if (!new_list) {
+        return false;
+    }
+    _PwParentsChunk* old_list = get_parents_list(cdata);
+    unsigned old_num_slots = cdata->num_parents_chunks * PW_PARENTS_CHUNK_SIZE;
+    unsigned mask = num_chunks * PW_PARENTS_CHUNK_SIZE - 1;
+    unsigned n = 0;
+    for (unsigned i = 0; i < old_num_slots; i++) {
+        _PwCompoundData* parent = parent_slot(old_list, i);
+        if (parent) {
+            if (num_chunks > PW_PARENTS_LIST_MAX_CHUNKS) {
+                set_insert(new_list, mask, parent, parent_refcount(old_list, i));
+            } else {
+                parent_slot(new_list, n) = parent;
+                parent_refcount(new_list, n) = parent_refcount(old_list, i);
+            }
+            n++;
+        }
+    }
+    default_allocator.release((void**) &old_list, cdata->num_parents_chunks * sizeof(_PwParentsChunk));
+    cdata->parents_list = new_list;
+    cdata->using_parents_list = true;
+    cdata->num_parents_chunks = num_chunks;
+    cdata->num_parents = n;
+    return true;
+}
+
+static void use_embedded_parents(_PwCompoundData* cdata)
+/*
+ * Move parents from the allocated list to embedded pointers
+ * and release the list. The list must contain no more than 2 parents.
+ */
+{
+    // embedded pointers overlap list fields, get them first
+    _PwParentsChunk* parents_list = get_parents_list(cdata);
+    unsigned num_slots = cdata->num_parents_chunks * PW_PARENTS_CHUNK_SIZE;
+    unsigned list_size = cdata->num_parents_chunks * sizeof(_PwParentsChunk);
+
+    for (unsigned j = 0; j < 2; j++) {
+        cdata->parents[j] = nullptr;
+        cdata->parents_refcount[j] = 0;
+    }
+    for (unsigned i = 0, j = 0; i < num_slots; i++) {
+        _PwCompoundData* parent = parent_slot(parents_list, i);
+        if (parent) {
+            cdata->parents[j] = parent;
+            cdata->parents_refcount[j] = parent_refcount(parents_list, i);
+            j++;
+        }
+    }
+    default_allocator.release((void**) &parents_list, list_size);
+}
+
+[[nodiscard]] static bool set_adopt(_PwCompoundData* child, _PwCompoundData* parent)
+{
+    _PwParentsChunk* set = get_parents_list(child);
+    unsigned mask = child->num_parents_chunks * PW_PARENTS_CHUNK_SIZE - 1;
+    for (unsigned i = parent_hash(parent, mask);; i = (i + 1) & mask) {
+        _PwCompoundData* p = parent_slot(set, i);
+        if (p == parent) {
+            parent_refcount(set, i)++;
+            return true;
+        }
+        if (p == nullptr) {
+            break;
+        }
+    }
+    // keep load factor below 3/4
+    if ((child->num_parents + 1) * 4 > (mask + 1) * 3) {
+        if (!rebuild_parents_list(child, child->num_parents_chunks * 2)) {
+            return false;
+        }
+        set = get_parents_list(child);
+        mask = mask * 2 + 1;
+    }
+    set_insert(set, mask, parent, 1);
+    child->num_parents++;
+    return true;
+}
+
+[[nodiscard]] static bool set_abandon(_PwCompoundData* child, _PwCompoundData* parent)
+{
+    _PwParentsChunk* set = get_parents_list(child);
+    unsigned mask = child->num_parents_chunks * PW_PARENTS_CHUNK_SIZE - 1;
+    unsigned i = parent_hash(parent, mask);
+    for (;;) {
+        _PwCompoundData* p = parent_slot(set, i);
+        if (p == parent) {
+            break;
+        }
+        if (p == nullptr) {
+            // not found, this means it's already abandoned
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+    if (--parent_refcount(set, i)) {
+        return false;  // not fully abandoned yet
+    }
+
+    // delete parent, shifting back following entries that are not at their home slots
+    unsigned hole = i;
+    for (unsigned j = (i + 1) & mask;; j = (j + 1) & mask) {
+        _PwCompoundData* p = parent_slot(set, j);
+        if (p == nullptr) {
+            break;
+        }
+        unsigned home = parent_hash(p, mask);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            parent_slot(set, hole) = p;
+            parent_refcount(set, hole) = parent_refcount(set, j);
+            hole = j;
+        }
+    }
+    parent_slot(set, hole) = nullptr;
+    parent_refcount(set, hole) = 0;
+    child->num_parents--;
+
+    // shrink when the set is less than 1/8 full, failure is harmless
+    unsigned num_chunks = child->num_parents_chunks;
+    if (child->num_parents <= 2) {
+        // few parents left, move them to embedded pointers without allocating
+        use_embedded_parents(child);
+
+    } else if (child->num_parents * 8 < num_chunks * PW_PARENTS_CHUNK_SIZE) {
+        num_chunks /= 2;
+        if (num_chunks <= PW_PARENTS_LIST_MAX_CHUNKS) {
+            // back to plain list
+            num_chunks = (child->num_parents + PW_PARENTS_CHUNK_SIZE - 1) / PW_PARENTS_CHUNK_SIZE;
+        }
+        if (!rebuild_parents_list(child, num_chunks)) {
+            // keep the set as is
+        }
+    }
+    return true;
+}
+
+/****************************************************************
+ * Acyclic mode
+ */
+
+void pw_set_acyclic(PwValuePtr value)
+{
+    pw_assert(pw_is_compound(value));
+    pw_assert(!_pw_is_embraced(value));
+    _pw_compound_data_ptr(value)->acyclic = true;
+}
+
+#ifdef DEBUG
+static bool refers_to(PwValuePtr container, _PwCompoundData* target, bool acyclic_path, _PwCompoundChain* tail)
+/*
+ * Return true if `target` is reachable from `container` by a path
+ * that passes through an acyclic value. Cycles made of tracked values
+ * only are fine, they are broken on destruction.
+ *
+ * Arrays, maps, sets, and array slices are traversed.
+ */
+{
+    if (pw_is_array_slice(container)) {
+        return refers_to(_pw_array_slice_array(container), target, acyclic_path, tail);
+    }
+    _PwCompoundData* cdata = _pw_compound_data_ptr(container);
+    acyclic_path |= cdata->acyclic;
+    if (cdata == target) {
+        return acyclic_path;
+    }
+    if (_pw_on_chain(container, tail)) {
+        return false;
+    }
+    _PwCompoundChain this_link = {
+        .prev = tail,
+        .value = container
+    };
+    _PwArray* items;
+    if (pw_is_map(container) || pw_is_set(container)) {
+        items = &((_PwMap*) container->struct_data)->kv_pairs;
+    } else if (pw_is_array(container)) {
+        items = get_array_struct_ptr(container);
+    } else {
+        return false;
+    }
+    PwValuePtr item_ptr = items->items;
+    for (unsigned n = items->length; n; n--, item_ptr++) {
+        if ((pw_is_compound(item_ptr) || pw_is_array_slice(item_ptr))
+            && refers_to(item_ptr, target, acyclic_path, &this_link)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void mark_contains_acyclic(_PwCompoundData* cdata)
+/*
+ * Set contains_acyclic for `cdata` and all its ancestors.
+ *
+ * Parents of acyclic values are not tracked, but they were marked
+ * when they adopted the acyclic value, so going up stops there.
+ */
+{
+    if (cdata->contains_acyclic) {
+        return;
+    }
+    cdata->contains_acyclic = true;
+    if (cdata->acyclic) {
+        return;
+    }
+    if (cdata->using_parents_list) {
+        // list and hash set of parents have the same layout
+        _PwParentsChunk* chunk_ptr = get_parents_list(cdata);
+        for (unsigned n = cdata->num_parents_chunks; n; n--, chunk_ptr++) {
+            for (unsigned i = 0; i < PW_PARENTS_CHUNK_SIZE; i++) {
+                if (chunk_ptr->parents[i]) {
+                    mark_contains_acyclic(chunk_ptr->parents[i]);
+                }
+            }
+        }
+    } else {
+        if (cdata->parents[0]) {
+            mark_contains_acyclic(cdata->parents[0]);
+        }
+        if (cdata->parents[1]) {
+            mark_contains_acyclic(cdata->parents[1]);
+        }
+    }
+}
+
+void _pw_embrace_noncompound(PwValuePtr parent, PwValuePtr child)
+{
+    if (pw_is_array_slice(child)) {
+        // array behind the slice is not tracked, always check paths through it
+        mark_contains_acyclic(_pw_compound_data_ptr(parent));
+    }
+}
+#endif
+
+/****************************************************************
+ * Adopt and abandon
+ */
+
 [[nodiscard]] bool _pw_adopt(PwValuePtr parent, PwValuePtr child)
 {
     _PwCompoundData* parent_cdata = _pw_compound_data_ptr(parent);
     _PwCompoundData* child_cdata = _pw_compound_data_ptr(child);
 
+#ifdef DEBUG
+    // an acyclic value anywhere on the way back to parent makes a cycle that is never broken;
+    // without acyclic values reachable from child there's no such way, including acyclic parent
+    if (child_cdata->acyclic || child_cdata->contains_acyclic) {
+        pw_assert(!refers_to(child, parent_cdata, parent_cdata->acyclic, nullptr));
+        mark_contains_acyclic(parent_cdata);
+    }
+#endif
+    if (child_cdata->acyclic) {
+        // plain reference counting
+        return true;
+    }
     if (parent_cdata == child_cdata) {
 success:
         child_cdata->struct_data.refcount--;
         return true;
     }
-    if (child_cdata->using_parents_list) {
+    if (using_parents_set(child_cdata)) {
+        if (!set_adopt(child_cdata, parent_cdata)) {
+            return false;
+        }
+        goto success;
+
+    } else if (child_cdata->using_parents_list) {
 
         // find parent_cdata on the list
         // also, find available position for insertion
@@ -81,6 +381,16 @@ success:
             avail_chunk->parents_refcount[avail_pos]++;
             goto success;
         }
+        if (child_cdata->num_parents_chunks == PW_PARENTS_LIST_MAX_CHUNKS) {
+            // the list is full, convert it to hash set
+            if (!rebuild_parents_list(child_cdata, 2 * PW_PARENTS_LIST_MAX_CHUNKS)) {
+                return false;
+            }
+            if (!set_adopt(child_cdata, parent_cdata)) {
+                return false;
+            }
+            goto success;
+        }
         // extend list
         unsigned old_size = child_cdata->num_parents_chunks * sizeof(_PwParentsChunk);
         unsigned new_size = old_size + sizeof(_PwParentsChunk);
@@ -118,16 +428,20 @@ success:
             child_cdata->parents_refcount[1] = 1;
             goto success;
         }
-        // allocate list
+        // allocate list and move embedded parents to it
         _PwParentsChunk* chunk_ptr = default_allocator.allocate(sizeof(_PwParentsChunk), true);
         if (!chunk_ptr) {
             return false;
         }
+        for (unsigned i = 0; i < 2; i++) {
+            chunk_ptr->parents[i] = child_cdata->parents[i];
+            chunk_ptr->parents_refcount[i] = child_cdata->parents_refcount[i];
+        }
+        chunk_ptr->parents[2] = parent_cdata;
+        chunk_ptr->parents_refcount[2] = 1;
         child_cdata->parents_list = chunk_ptr;
         child_cdata->using_parents_list = true;
         child_cdata->num_parents_chunks = 1;
-        chunk_ptr->parents[0] = parent_cdata;
-        chunk_ptr->parents_refcount[0] = 1;
         goto success;
     }
 }
@@ -146,22 +460,17 @@ static void shrink_parents_list(_PwCompoundData* child, _PwParentsChunk* chunk_p
             num_items_in_chunk++;
         }
     }
-    if (num_items_in_chunk == 2 && child->num_parents_chunks == 1) {
-        // last chunk with exactly 2 iems --> deallocate list
-        _PwParentsChunk* parents_list = get_parents_list(child);
-        child->num_parents_chunks = 0;
-        parent_ptr = parents_list->parents;
-        for (unsigned i = 0, j = 0; i < PW_PARENTS_CHUNK_SIZE; i++, parent_ptr++) {
-            if (*parent_ptr) {
-                child->parents[j] = *parent_ptr;
-                child->parents_refcount[j] = parents_list->parents_refcount[i];
-                j++;
-            }
+    if (child->num_parents_chunks == 1) {
+        if (num_items_in_chunk <= 2) {
+            // last chunk with no more than 2 items --> deallocate list
+            use_embedded_parents(child);
         }
-        default_allocator.release((void**) &parents_list, sizeof(_PwParentsChunk));  // see above, num_parents_chunks was 1
         return;
     }
-    // delete chunk
+    if (num_items_in_chunk) {
+        return;
+    }
+    // delete empty chunk
     if (chunks_left) {
         memmove(chunk_ptr, chunk_ptr + 1, chunks_left * sizeof(_PwParentsChunk));
     }
@@ -170,6 +479,8 @@ static void shrink_parents_list(_PwCompoundData* child, _PwParentsChunk* chunk_p
     unsigned new_size = old_size - sizeof(_PwParentsChunk);
     _PwParentsChunk* parents_list = get_parents_list(child);
     default_allocator.reallocate((void**) &parents_list, old_size, new_size, false, nullptr);
+    child->parents_list = parents_list;
+    child->using_parents_list = true;
     child->num_parents_chunks--;
 }
 
@@ -178,10 +489,13 @@ static void shrink_parents_list(_PwCompoundData* child, _PwParentsChunk* chunk_p
     _PwCompoundData* parent_cdata = _pw_compound_data_ptr(parent);
     _PwCompoundData* child_cdata = _pw_compound_data_ptr(child);
 
-    if (parent_cdata == child_cdata) {
+    if (parent_cdata == child_cdata || child_cdata->acyclic) {
         return true;
     }
-    if (child_cdata->using_parents_list) {
+    if (using_parents_set(child_cdata)) {
+        return set_abandon(child_cdata, parent_cdata);
+
+    } else if (child_cdata->using_parents_list) {
 
         // find parent_cdata on the list
         _PwParentsChunk* chunk_ptr = get_parents_list(child_cdata);
@@ -249,6 +563,9 @@ static unsigned check_parent_link(_PwCompoundData* first, _PwCompoundData* paren
 static unsigned check_cyclic_refs(_PwCompoundData* first, _PwCompoundData* cdata)
 /*
  * Check if any parent of `cdata` is equal to `first` and whether its refcount is zero.
+ *
+ * Stop at the first nonzero refcount: it prevents destruction anyway,
+ * so values with many live parents are checked in constant time.
  */
 {
     unsigned result = 0;  // bit flags: HAVE_CYCLIC_REFS and NONZERO_REFCOUNT
@@ -263,6 +580,9 @@ static unsigned check_cyclic_refs(_PwCompoundData* first, _PwCompoundData* cdata
                 _PwCompoundData* parent = *parent_ptr;
                 if (parent) {
                     result |= check_parent_link(first, parent);
+                    if (result & NONZERO_REFCOUNT) {
+                        return result;
+                    }
                 }
             }
         }
@@ -271,6 +591,9 @@ static unsigned check_cyclic_refs(_PwCompoundData* first, _PwCompoundData* cdata
         // check embedded list
         if (cdata->parents[0]) {
             result |= check_parent_link(first, cdata->parents[0]);
+            if (result & NONZERO_REFCOUNT) {
+                return result;
+            }
         }
         if (cdata->parents[1]) {
             result |= check_parent_link(first, cdata->parents[1]);
@@ -289,6 +612,10 @@ void _pw_dump_compound_data(FILE* fp, PwValuePtr value, int indent)
 {
     _PwCompoundData* cdata = _pw_compound_data_ptr(value);
 
+    if (cdata->acyclic) {
+        fprintf(fp, " compound, acyclic\n");
+        return;
+    }
     if (cdata->using_parents_list) {
         fprintf(fp, " compound, %u chunks:\n", cdata->num_parents_chunks);
 
@@ -354,6 +681,9 @@ void _pw_compound_destroy(PwValuePtr self)
     }
     cdata->destroying = true;
 
+    if (_pw_defer_release(self)) {
+        return;
+    }
     _pw_struct_release(self);
 }
 
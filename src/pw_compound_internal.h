@@ -16,6 +16,13 @@ extern PwType _pw_compound_type;
 
 #define PW_PARENTS_CHUNK_SIZE  8
 
+#define PW_PARENTS_LIST_MAX_CHUNKS  4
+/*
+ * Parents are searched linearly while the list has no more chunks than this.
+ * Longer lists are open-addressed hash sets with power of two number of chunks,
+ * so values shared by thousands of containers are adopted and abandoned in O(1).
+ */
+
 typedef struct {
     /*
      * Pointers and refcounts on the list of parents are allocated in chunks
@@ -35,6 +42,12 @@ struct __PwCompoundData {
 
     bool destroying;  // set when destruction is in progress to bypass values during traversal
 
+    bool acyclic;  // never part of a cycle: parents are not tracked and refcount counts
+                   // references from parents as well, see pw_set_acyclic
+
+    bool contains_acyclic;  // debug builds only: an acyclic value or an array slice
+                            // was adopted by this value or its descendants
+
     /*
      * The minimal structure for tracking circular references
      * is capable to hold two pointers to parent values.
@@ -50,7 +63,10 @@ struct __PwCompoundData {
                 unsigned num_parents_chunks;
             };
         };
-        unsigned parents_refcount[2];
+        union {
+            unsigned parents_refcount[2];  // using_parents_list == 0
+            unsigned num_parents;          // using_parents_list == 1, the number of parents in the hash set
+        };
     };
 };
 
@@ -63,6 +79,16 @@ struct __PwCompoundData {
 
 void _pw_compound_destroy(PwValuePtr self);
 
+/*
+ * deferred release, see pw_reclaim.h
+ */
+
+[[nodiscard]] bool _pw_defer_release(PwValuePtr value);
+/*
+ * Put value on the reclamation queue if deferred release is enabled
+ * and value is large enough. Return false if value should be released immediately.
+ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,9 +12,12 @@
  *     But it can be uncommented for testing against the original implementation.
  */
 
+#include "include/pw.h"
 #include "include/pw_hash.h"
+#include "include/pw_utf.h"
 
 #include "src/rapidhash.h"
+#include "src/string/pw_string_internal.h"
 
 //#define TRACE(...)  printf(__VA_ARGS__)
 #define TRACE(...)
@@ -135,6 +138,52 @@ PwType_Hash _pw_hash_finish(PwHashContext* ctx)
     return rapid_mix(a ^ RAPID_SECRET_0 /* ^ ctx->len */, b ^ RAPID_SECRET_1);
 }
 
+bool _pw_hash_utf8(char8_t* str, unsigned size, PwType_Hash* result)
+{
+    // must produce the same data for hashing as string_hash in src/string/hash.c does
+    // for the string created from this buffer, so invalid sequences are skipped
+
+    PwHashContext ctx;
+    _pw_hash_init(&ctx);
+    _pw_hash_uint64(&ctx, PwTypeId_String);
+
+    union {
+        struct {
+            char32_t a;
+            char32_t b;
+        };
+        uint64_t i64;
+    } data;
+    bool have_a = false;
+
+    char8_t* end_ptr = str + size;
+    while (str < end_ptr) {
+        char32_t c = *str;
+        if (c < 0x80) {
+            str++;
+        } else {
+            str += _pw_decode_utf8_strict(str, end_ptr, &c);
+            if (c == 0xFFFFFFFF) {
+                continue;
+            }
+        }
+        if (have_a) {
+            data.b = c;
+            _pw_hash_uint64(&ctx, data.i64);
+            have_a = false;
+        } else {
+            data.a = c;
+            have_a = true;
+        }
+    }
+    if (have_a) {
+        data.b = 0;
+        _pw_hash_uint64(&ctx, data.i64);
+    }
+    *result = _pw_hash_finish(&ctx);
+    return true;
+}
+
 PwType_Hash pw_hash(PwValuePtr value)
 {
     PwHashContext ctx;
@@ -52,6 +52,7 @@ void _pw_init_interfaces()
     pw_assert(PwInterfaceId_Writer       == pw_register_interface("Writer",       PwInterface_Writer));
     pw_assert(PwInterfaceId_LineReader   == pw_register_interface("LineReader",   PwInterface_LineReader));
     pw_assert(PwInterfaceId_Append       == pw_register_interface("Append",       PwInterface_Append));
+    pw_assert(PwInterfaceId_Comparison   == pw_register_interface("Comparison",   PwInterface_Comparison));
 }
 
 unsigned _pw_register_interface(char* name, unsigned num_methods)
@@ -234,3 +235,20 @@ void _pw_update_interfaces(PwType* type, PwType* ancestor, va_list ap)
         }
     }
 }
+
+bool pw_compare(PwValuePtr a, PwValuePtr b, int* result)
+{
+    _PwInterface* iface = _pw_lookup_interface(a->type_id, PwInterfaceId_Comparison);
+    if (!iface) {
+        return _pw_incomparable(a, b);
+    }
+    return ((PwInterface_Comparison*) iface->interface_methods)->compare(a, b, result);
+}
+
+bool _pw_incomparable(PwValuePtr self, PwValuePtr other)
+{
+    pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE),
+                  "Cannot compare %s with %s",
+                  pw_get_type_name(self), pw_get_type_name(other));
+    return false;
+}
@@ -25,6 +25,12 @@ unsigned _pw_get_num_interface_methods(unsigned interface_id);
  * for internal use
  */
 
+[[nodiscard]] bool _pw_incomparable(PwValuePtr self, PwValuePtr other);
+/*
+ * Set PW_ERROR_INCOMPATIBLE_TYPE status and return false.
+ * Helper for implementations of Comparison interface.
+ */
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,17 +22,15 @@
     return ret;
 }
 
-static inline unsigned get_map_length(_PwMap* map)
-{
-    return _pw_array_length(&map->kv_pairs) >> 1;
-}
-
 static uint8_t get_item_size(unsigned capacity)
 /*
  * Return hash table item size for desired capacity.
  *
  * Index 0 in hash table means no item, so one byte is capable
  * to index 255 items, not 256.
+ *
+ * Item size is rounded up to the size of integral type
+ * for which hash table methods are specialized.
  */
 {
     uint8_t item_size = 1;
@@ -40,51 +38,208 @@ static uint8_t get_item_size(unsigned capacity)
     for (unsigned n = capacity; n > 255; n >>= 8) {
         item_size++;
     }
+    if (item_size > 2) {
+        item_size = (item_size > 4)? 8 : 4;
+    }
     return item_size;
 }
 
 /****************************************************************
  * methods for acessing hash table
+ *
+ * Probing loops are specialized for each item size, so the item
+ * type is known at compile time. Dispatching is done once per call
+ * by lookup, set_hash_table_item, and rebuild_hash_table.
+ *
+ * Lookup methods are also specialized for key type:
+ * PW value or UTF-8 buffer.
  */
 
-#define HT_ITEM_METHODS(typename) \
-    static unsigned get_ht_item_##typename(struct _PwHashTable* ht, unsigned index) \
+#define HT_LOOKUP_METHOD(name, typename, key_type, key_equal) \
+    static unsigned name(_PwMap* map, key_type key, PwType_Hash key_hash, unsigned* ht_offset) \
     { \
-        return ((typename*) (ht->items))[index]; \
-    } \
-    static void set_ht_item_##typename(struct _PwHashTable* ht, unsigned index, unsigned value) \
+        struct _PwHashTable* ht = &map->hash_table; \
+        typename* items = (typename*) ht->items; \
+        PwType_Hash index = key_hash & ht->hash_bitmask; \
+        unsigned offset = 0; \
+        do { \
+            unsigned kv_index = items[index]; \
+            \
+            if (kv_index == 0) { \
+                /* no entry matching key */ \
+                if (ht_offset) { \
+                    *ht_offset = offset; \
+                } \
+                return UINT_MAX; \
+            } \
+            \
+            /* make index 0-based */ \
+            kv_index--; \
+            \
+            /* compare hashes first, keys are compared only if hashes match; */ \
+            /* deleted pairs remain in hash table and never match */ \
+            if (map->hashes[kv_index] == key_hash) { \
+                PwValuePtr k = &map->kv_pairs.items[kv_index << map->entry_shift]; \
+                if (!_pw_map_is_deleted(k) && key_equal(k, key)) { \
+                    /* found key */ \
+                    if (ht_offset) { \
+                        *ht_offset = offset; \
+                    } \
+                    return kv_index << map->entry_shift; \
+                } \
+            } \
+            \
+            /* probe next item */ \
+            index = (index + 1) & ht->hash_bitmask; \
+            offset++; \
+            \
+        } while (true); \
+    }
+
+#define HT_SET_METHOD(typename) \
+    static inline void set_ht_item_##typename(struct _PwHashTable* ht, PwType_Hash key_hash, unsigned kv_index) \
+    { \
+        typename* items = (typename*) ht->items; \
+        PwType_Hash index = key_hash & ht->hash_bitmask; \
+        while (items[index]) { \
+            index = (index + 1) & ht->hash_bitmask; \
+        } \
+        items[index] = (typename) kv_index; \
+    }
+
+#define HT_REBUILD_METHOD(name, set_item) \
+    static void name(_PwMap* map) \
     { \
-        ((typename*) (ht->items))[index] = (typename) value; \
+        struct _PwHashTable* ht = &map->hash_table; \
+        PwValuePtr key_ptr = &map->kv_pairs.items[0]; \
+        PwType_Hash* hash_ptr = map->hashes; \
+        unsigned entry_size = 1 << map->entry_shift; \
+        unsigned kv_index = 1;  /* index is 1-based, zero means unused item in hash table */ \
+        unsigned n = _pw_array_length(&map->kv_pairs); \
+        pw_assert((n & (entry_size - 1)) == 0); \
+        while (n) { \
+            if (!_pw_map_is_deleted(key_ptr)) { \
+                set_item(ht, *hash_ptr, kv_index); \
+            } \
+            key_ptr += entry_size; \
+            hash_ptr++; \
+            n -= entry_size; \
+            kv_index++; \
+        } \
     }
 
-HT_ITEM_METHODS(uint8_t)
-HT_ITEM_METHODS(uint16_t)
-HT_ITEM_METHODS(uint32_t)
+HT_SET_METHOD(uint8_t)
+HT_SET_METHOD(uint16_t)
+HT_SET_METHOD(uint32_t)
+
+HT_REBUILD_METHOD(rebuild_hash_table_uint8_t,  set_ht_item_uint8_t)
+HT_REBUILD_METHOD(rebuild_hash_table_uint16_t, set_ht_item_uint16_t)
+HT_REBUILD_METHOD(rebuild_hash_table_uint32_t, set_ht_item_uint32_t)
 
 #if UINT_WIDTH > 32
-    HT_ITEM_METHODS(uint64_t)
+    HT_SET_METHOD(uint64_t)
+    HT_REBUILD_METHOD(rebuild_hash_table_uint64_t, set_ht_item_uint64_t)
 #endif
 
+/****************************************************************
+ * Swiss table
+ *
+ * Items block contains `capacity` control bytes followed by
+ * `capacity` 32-bit slots with 0-based kv_index.
+ *
+ * Control byte is zero for empty slot. For occupied slot it is
+ * 0x80 | the highest 7 bits of hash, so most of mismatching keys
+ * are rejected without touching slots and hashes.
+ *
+ * Slots are probed in groups of PWMAP_SWISS_GROUP_SIZE, eight control
+ * bytes at a time using plain 64-bit arithmetic, no intrinsics required.
+ * Hash table items are never deleted, so a group with at least one empty
+ * slot terminates the probing.
+ */
+
+#define SWISS_ITEM_SIZE  (1 + sizeof(uint32_t))
+
+#define SWISS_LSB  0x0101'0101'0101'0101ULL
+#define SWISS_MSB  0x8080'8080'8080'8080ULL
+
+static inline uint8_t swiss_ctrl(PwType_Hash hash)
+{
+    return 0x80 | (uint8_t) (hash >> 57);
+}
+
+static inline uint32_t* swiss_slots(struct _PwHashTable* ht)
+{
+    return (uint32_t*) (ht->items + ht->capacity);
+}
+
+static inline uint64_t swiss_load(uint8_t* ctrl)
 /*
- * methods for acessing hash table with any item size
+ * Load eight control bytes, first byte goes to the lowest bits.
  */
-static unsigned get_ht_item(struct _PwHashTable* ht, unsigned index)
 {
-    uint8_t *item_ptr = &ht->items[index * ht->item_size];
-    unsigned result = 0;
-    for (uint8_t i = ht->item_size; i > 0; i--) {
-        result <<= 8;
-        result += *item_ptr++;
+    uint64_t word;
+    memcpy(&word, ctrl, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+static inline uint64_t swiss_match(uint64_t word, uint8_t ctrl)
+/*
+ * Return mask with high bits set in bytes equal to `ctrl`.
+ * False positives are possible, hashes should be compared anyway.
+ */
+{
+    uint64_t x = word ^ (SWISS_LSB * ctrl);
+    return (x - SWISS_LSB) & ~x & SWISS_MSB;
+}
+
+static inline uint64_t swiss_match_empty(uint64_t word)
+/*
+ * Return mask with high bits set in bytes of empty slots.
+ */
+{
+    return ~word & SWISS_MSB;
+}
+
+static inline unsigned swiss_first_group(struct _PwHashTable* ht, PwType_Hash hash)
+{
+    return hash & ht->hash_bitmask & ~(PWMAP_SWISS_GROUP_SIZE - 1);
+}
+
+static inline unsigned swiss_next_group(struct _PwHashTable* ht, unsigned group)
+{
+    return (group + PWMAP_SWISS_GROUP_SIZE) & ht->hash_bitmask;
+}
+
+static unsigned get_swiss_item(struct _PwHashTable* ht, unsigned index)
+/*
+ * Return 1-based kv_index of slot, zero if the slot is empty.
+ */
+{
+    if (ht->items[index]) {
+        return swiss_slots(ht)[index] + 1;
+    } else {
+        return 0;
     }
-    return result;
 }
 
-static void set_ht_item(struct _PwHashTable* ht, unsigned index, unsigned value)
+static void set_swiss_item(struct _PwHashTable* ht, PwType_Hash hash, unsigned kv_index)
+/*
+ * Put 1-based `kv_index` to the first empty slot in the probe sequence.
+ */
 {
-    uint8_t *item_ptr = &ht->items[(index + 1) * ht->item_size];
-    for (uint8_t i = ht->item_size; i > 0; i--) {
-        *(--item_ptr) = (uint8_t) value;
-        value >>= 8;
+    for (unsigned group = swiss_first_group(ht, hash);; group = swiss_next_group(ht, group)) {
+        for (unsigned i = 0; i < PWMAP_SWISS_GROUP_SIZE; i += 8) {
+            uint64_t mask = swiss_match_empty(swiss_load(&ht->items[group + i]));
+            if (mask) {
+                unsigned index = group + i + (__builtin_ctzll(mask) >> 3);
+                ht->items[index] = swiss_ctrl(hash);
+                swiss_slots(ht)[index] = kv_index - 1;
+                return;
+            }
+        }
     }
 }
 
@@ -102,15 +257,26 @@ static void set_ht_item(struct _PwHashTable* ht, unsigned index, unsigned value)
  *
  * value_index = key_index + 1
  * kv_index = key_index / 2
+ *
+ * Sets store keys only, so entry_shift is 0 for them and kv_index = key_index.
+ * Code shared with sets uses entry_shift instead of hardcoded 2.
  */
 
-[[nodiscard]] static bool init_hash_table(PwTypeId type_id, struct _PwHashTable* ht,
+[[nodiscard]] static bool init_hash_table(PwTypeId type_id, _PwMap* map,
                                           unsigned old_capacity, unsigned new_capacity)
+/*
+ * map->engine must be set before the first call.
+ */
 {
-    unsigned old_item_size = get_item_size(old_capacity);
-    unsigned old_memsize = old_item_size * old_capacity;
+    struct _PwHashTable* ht = &map->hash_table;
+    unsigned old_memsize = ht->item_size * old_capacity;
 
-    unsigned new_item_size = get_item_size(new_capacity);
+    unsigned new_item_size;
+    if (map->engine == PW_MAP_ENGINE_SWISS) {
+        new_item_size = SWISS_ITEM_SIZE;
+    } else {
+        new_item_size = get_item_size(new_capacity);
+    }
     unsigned new_memsize = new_item_size * new_capacity;
 
     // reallocate items
@@ -124,256 +290,770 @@ static void set_ht_item(struct _PwHashTable* ht, unsigned index, unsigned value)
     ht->item_size    = new_item_size;
     ht->capacity     = new_capacity;
     ht->hash_bitmask = new_capacity - 1;
-
-    switch (new_item_size) {
-        case 1:
-            ht->get_item = get_ht_item_uint8_t;
-            ht->set_item = set_ht_item_uint8_t;
-            break;
-        case 2:
-            ht->get_item = get_ht_item_uint16_t;
-            ht->set_item = set_ht_item_uint16_t;
-            break;
-        case 4:
-            ht->get_item = get_ht_item_uint32_t;
-            ht->set_item = set_ht_item_uint32_t;
-            break;
-#if UINT_WIDTH > 32
-        case 8:
-            ht->get_item = get_ht_item_uint64_t;
-            ht->set_item = set_ht_item_uint64_t;
-            break;
-#endif
-        default:
-            ht->get_item = get_ht_item;
-            ht->set_item = set_ht_item;
-            break;
-    }
     return true;
 }
 
 static void free_hash_table(PwTypeId type_id, struct _PwHashTable* ht)
 {
-    unsigned ht_memsize = get_item_size(ht->capacity) * ht->capacity;
-    _pw_free(type_id, (void**) &ht->items, ht_memsize);
+    if (ht->items) {
+        unsigned ht_memsize = ht->item_size * ht->capacity;
+        _pw_free(type_id, (void**) &ht->items, ht_memsize);
+    }
 }
 
-static unsigned lookup(_PwMap* map, PwValuePtr key, unsigned* ht_index, unsigned* ht_offset)
+static inline unsigned get_hashes_memsize(_PwMap* map)
+/*
+ * Return size of memory block for hashes of keys.
+ */
+{
+    return map->hashes_capacity * sizeof(PwType_Hash);
+}
+
+#define SWISS_LOOKUP_METHOD(name, key_type, key_equal) \
+    static unsigned name(_PwMap* map, key_type key, PwType_Hash key_hash, unsigned* ht_offset) \
+    /* \
+     * Swiss table version of lookup, ht_offset is the number of probed groups. \
+     */ \
+    { \
+        struct _PwHashTable* ht = &map->hash_table; \
+        uint32_t* slots = swiss_slots(ht); \
+        uint8_t ctrl = swiss_ctrl(key_hash); \
+        unsigned group = swiss_first_group(ht, key_hash); \
+        unsigned offset = 0; \
+        do { \
+            bool has_empty = false; \
+            for (unsigned i = 0; i < PWMAP_SWISS_GROUP_SIZE; i += 8) { \
+                uint64_t word = swiss_load(&ht->items[group + i]); \
+                for (uint64_t mask = swiss_match(word, ctrl); mask; mask &= mask - 1) { \
+                    unsigned kv_index = slots[group + i + (__builtin_ctzll(mask) >> 3)]; \
+                    if (map->hashes[kv_index] == key_hash) { \
+                        PwValuePtr k = &map->kv_pairs.items[kv_index << map->entry_shift]; \
+                        if (!_pw_map_is_deleted(k) && key_equal(k, key)) { \
+                            /* found key */ \
+                            if (ht_offset) { \
+                                *ht_offset = offset; \
+                            } \
+                            return kv_index << map->entry_shift; \
+                        } \
+                    } \
+                } \
+                if (swiss_match_empty(word)) { \
+                    has_empty = true; \
+                } \
+            } \
+            if (has_empty) { \
+                /* no entry matching key */ \
+                if (ht_offset) { \
+                    *ht_offset = offset; \
+                } \
+                return UINT_MAX; \
+            } \
+            /* probe next group */ \
+            group = swiss_next_group(ht, group); \
+            offset++; \
+            \
+        } while (true); \
+    }
+
 /*
- * Lookup key starting from index = hash(key).
+ * Lookup key starting from index = key_hash.
  *
  * Return index of key in kv_pairs or UINT_MAX if hash table has no item matching `key`.
  *
- * If `ht_index` is not `nullptr`: write index of hash table item at which lookup has stopped.
- * If `ht_offset` is not `nullptr`: write the difference from final `ht_index` and initial `ht_index` to `ht_offset`;
+ * If `ht_offset` is not `nullptr`: write the difference from final and initial hash table index to `ht_offset`;
  */
+#define LOOKUP_FUNCTION(name, key_type) \
+    static unsigned name(_PwMap* map, key_type key, PwType_Hash key_hash, unsigned* ht_offset) \
+    { \
+        switch (map->hash_table.item_size) { \
+            case 1: return name##_uint8_t(map, key, key_hash, ht_offset); \
+            case 2: return name##_uint16_t(map, key, key_hash, ht_offset); \
+            case 4: return name##_uint32_t(map, key, key_hash, ht_offset); \
+            LOOKUP_UINT64_CASE(name) \
+            case SWISS_ITEM_SIZE: return swiss_##name(map, key, key_hash, ht_offset); \
+            default: pw_panic("Bad hash table item size %u\n", map->hash_table.item_size); \
+        } \
+    }
+
+#if UINT_WIDTH > 32
+#   define LOOKUP_UINT64_CASE(name)  case 8: return name##_uint64_t(map, key, key_hash, ht_offset);
+#else
+#   define LOOKUP_UINT64_CASE(name)
+#endif
+
+typedef struct {
+    /*
+     * Key for lookup by UTF-8 buffer.
+     */
+    char8_t* ptr;
+    unsigned size;
+} _PwUtf8Key;
+
+static inline bool equal_utf8_key(PwValuePtr k, _PwUtf8Key* key)
 {
-    struct _PwHashTable* ht = &map->hash_table;
-    PwType_Hash index = pw_hash(key) & ht->hash_bitmask;
-    unsigned offset = 0;
-    do {
-        unsigned kv_index = ht->get_item(ht, index);
-
-        if (kv_index == 0) {
-            // no entry matching key
-            if (ht_index) {
-                *ht_index = index;
-            }
-            if (ht_offset) {
-                *ht_offset = offset;
-            }
-            return UINT_MAX;
-        }
+    return _pw_equal_utf8_buf(k, key->ptr, key->size);
+}
 
-        // make index 0-based
-        kv_index--;
+HT_LOOKUP_METHOD(lookup_uint8_t,  uint8_t,  PwValuePtr, _pw_equal)
+HT_LOOKUP_METHOD(lookup_uint16_t, uint16_t, PwValuePtr, _pw_equal)
+HT_LOOKUP_METHOD(lookup_uint32_t, uint32_t, PwValuePtr, _pw_equal)
+SWISS_LOOKUP_METHOD(swiss_lookup, PwValuePtr, _pw_equal)
 
-        PwValuePtr k = &map->kv_pairs.items[kv_index * 2];
+HT_LOOKUP_METHOD(lookup_utf8_uint8_t,  uint8_t,  _PwUtf8Key*, equal_utf8_key)
+HT_LOOKUP_METHOD(lookup_utf8_uint16_t, uint16_t, _PwUtf8Key*, equal_utf8_key)
+HT_LOOKUP_METHOD(lookup_utf8_uint32_t, uint32_t, _PwUtf8Key*, equal_utf8_key)
+SWISS_LOOKUP_METHOD(swiss_lookup_utf8, _PwUtf8Key*, equal_utf8_key)
 
-        // compare keys
-        if (_pw_equal(k, key)) {
-            // found key
-            if (ht_index) {
-                *ht_index = index;
-            }
-            if (ht_offset) {
-                *ht_offset = offset;
-            }
-            return kv_index * 2;
+#if UINT_WIDTH > 32
+    HT_LOOKUP_METHOD(lookup_uint64_t,      uint64_t, PwValuePtr,  _pw_equal)
+    HT_LOOKUP_METHOD(lookup_utf8_uint64_t, uint64_t, _PwUtf8Key*, equal_utf8_key)
+#endif
+
+LOOKUP_FUNCTION(lookup, PwValuePtr)
+LOOKUP_FUNCTION(lookup_utf8, _PwUtf8Key*)
+
+/****************************************************************
+ * Small map
+ *
+ * Up to PWMAP_SMALL_CAPACITY pairs are stored inline in _PwMap
+ * and looked up by linear scan. Hashes and hash table
+ * are allocated when the map grows beyond that.
+ */
+
+static inline bool small_map_has_room(_PwMap* map)
+/*
+ * Check if one more pair can be added to small map
+ * without converting it to hashed layout.
+ */
+{
+    return _pw_map_is_small(map) && _pw_array_length(&map->kv_pairs) < (PWMAP_SMALL_CAPACITY << map->entry_shift);
+}
+
+static inline bool small_key_equal(PwValuePtr k, PwValuePtr key)
+/*
+ * Cheap precheck for string keys before full comparison:
+ * lengths and first characters must match.
+ * Strings of the same char size are compared in place.
+ */
+{
+    if (k->type_id == PwTypeId_String && key->type_id == PwTypeId_String) {
+        unsigned k_length;
+        unsigned key_length;
+        uint8_t* k_start = _pw_string_start_length(k, &k_length);
+        uint8_t* key_start = _pw_string_start_length(key, &key_length);
+        if (k_length != key_length) {
+            return false;
+        }
+        if (k_length == 0) {
+            return true;
+        }
+        uint8_t char_size = k->char_size;
+        if (_pw_get_char(k_start, char_size) != _pw_get_char(key_start, key->char_size)) {
+            return false;
+        }
+        if (char_size == key->char_size && char_size) {
+            return memcmp(k_start, key_start, k_length * char_size) == 0;
         }
+    }
+    return _pw_equal(k, key);
+}
+
+#define SMALL_LOOKUP_METHOD(name, key_type, key_equal) \
+    static unsigned name(_PwMap* map, key_type key) \
+    /* \
+     * Return index of key in kv_pairs or UINT_MAX if not found. \
+     */ \
+    { \
+        PwValuePtr k = map->kv_pairs.items; \
+        unsigned n = map->kv_pairs.length; \
+        unsigned entry_size = 1 << map->entry_shift; \
+        for (unsigned i = 0; i < n; i += entry_size, k += entry_size) { \
+            if (key_equal(k, key)) { \
+                return i; \
+            } \
+        } \
+        return UINT_MAX; \
+    }
 
-        // probe next item
-        index = (index + 1) & ht->hash_bitmask;
-        offset++;
+SMALL_LOOKUP_METHOD(small_lookup, PwValuePtr, small_key_equal)
+SMALL_LOOKUP_METHOD(small_lookup_utf8, _PwUtf8Key*, equal_utf8_key)
 
-    } while (true);
+static inline unsigned find_key(_PwMap* map, PwValuePtr key)
+/*
+ * Return index of key in kv_pairs or UINT_MAX if not found.
+ */
+{
+    if (_pw_map_is_small(map)) {
+        return small_lookup(map, key);
+    }
+    return lookup(map, key, pw_hash(key), nullptr);
+}
+
+unsigned _pw_map_find(_PwMap* map, PwValuePtr key, PwType_Hash key_hash)
+{
+    if (_pw_map_is_small(map)) {
+        return small_lookup(map, key);
+    }
+    return lookup(map, key, key_hash, nullptr);
 }
 
-static unsigned set_hash_table_item(struct _PwHashTable* hash_table, unsigned ht_index, unsigned kv_index)
+unsigned _pw_map_lookup(_PwMap* map, PwValuePtr key, PwType_Hash* key_hash, unsigned* ht_offset)
+{
+    *ht_offset = 0;
+    if (small_map_has_room(map)) {
+        // hash is not needed yet
+        *key_hash = 0;
+        return small_lookup(map, key);
+    }
+    *key_hash = pw_hash(key);
+    if (_pw_map_is_small(map)) {
+        return small_lookup(map, key);
+    }
+    return lookup(map, key, *key_hash, ht_offset);
+}
+
+static void set_hash_table_item(struct _PwHashTable* hash_table, PwType_Hash key_hash, unsigned kv_index)
 /*
- * Assign `kv_index` to `hash_table` at position `ht_index` & hash_bitmask.
+ * Assign `kv_index` to `hash_table` at position `key_hash` & hash_bitmask.
  * If the position is already occupied, try next one.
+ */
+{
+    switch (hash_table->item_size) {
+        case 1: set_ht_item_uint8_t(hash_table, key_hash, kv_index); break;
+        case 2: set_ht_item_uint16_t(hash_table, key_hash, kv_index); break;
+        case 4: set_ht_item_uint32_t(hash_table, key_hash, kv_index); break;
+#if UINT_WIDTH > 32
+        case 8: set_ht_item_uint64_t(hash_table, key_hash, kv_index); break;
+#endif
+        case SWISS_ITEM_SIZE: set_swiss_item(hash_table, key_hash, kv_index); break;
+        default: pw_panic("Bad hash table item size %u\n", hash_table->item_size);
+    }
+}
+
+HT_REBUILD_METHOD(rebuild_swiss_table, set_swiss_item)
+
+static void rebuild_hash_table(_PwMap* map)
+/*
+ * Fill clean hash table with indexes of key-value pairs, skipping deleted ones.
+ */
+{
+    switch (map->hash_table.item_size) {
+        case 1: rebuild_hash_table_uint8_t(map); break;
+        case 2: rebuild_hash_table_uint16_t(map); break;
+        case 4: rebuild_hash_table_uint32_t(map); break;
+#if UINT_WIDTH > 32
+        case 8: rebuild_hash_table_uint64_t(map); break;
+#endif
+        case SWISS_ITEM_SIZE: rebuild_swiss_table(map); break;
+        default: pw_panic("Bad hash table item size %u\n", map->hash_table.item_size);
+    }
+}
+
+static unsigned get_hash_table_item(struct _PwHashTable* ht, unsigned index)
+/*
+ * Return 1-based kv_index at `index`, zero if hash table item is unused.
+ * For diagnostic purposes only.
+ */
+{
+    switch (ht->item_size) {
+        case 1: return ((uint8_t*) ht->items)[index];
+        case 2: return ((uint16_t*) ht->items)[index];
+        case 4: return ((uint32_t*) ht->items)[index];
+#if UINT_WIDTH > 32
+        case 8: return ((uint64_t*) ht->items)[index];
+#endif
+        case SWISS_ITEM_SIZE: return get_swiss_item(ht, index);
+        default: pw_panic("Bad hash table item size %u\n", ht->item_size);
+    }
+}
+
+
+static void compact_map(_PwMap* map)
+/*
+ * Drop deleted pairs from kv_pairs preserving the order of the rest
+ * and rebuild hash table.
+ */
+{
+    PwValuePtr src = map->kv_pairs.items;
+    PwValuePtr dest = src;
+    PwType_Hash* src_hash = map->hashes;
+    PwType_Hash* dest_hash = src_hash;
+    unsigned entry_size = 1 << map->entry_shift;
+    for (unsigned n = _pw_array_length(&map->kv_pairs); n; n -= entry_size, src += entry_size, src_hash++) {
+        if (_pw_map_is_deleted(src)) {
+            continue;
+        }
+        if (dest != src) {
+            for (unsigned i = 0; i < entry_size; i++) {
+                dest[i] = src[i];
+            }
+            *dest_hash = *src_hash;
+        }
+        dest += entry_size;
+        dest_hash++;
+    }
+    map->kv_pairs.length = (unsigned) (dest - map->kv_pairs.items);
+    map->num_deleted = 0;
+    map->cursor_index = 0;
+    map->cursor_key_index = 0;
+
+    struct _PwHashTable* ht = &map->hash_table;
+    memset(ht->items, 0, ht->item_size * ht->capacity);
+    rebuild_hash_table(map);
+}
+
+static inline bool hash_table_fits(uint8_t engine, unsigned capacity,
+                                   unsigned desired_capacity, unsigned ht_offset)
+/*
+ * Check if hash table of given capacity is good for desired number of items.
  *
- * Return ht_index, possibly updated.
+ * Linear probing table is filled up to 3/4, Swiss table up to 7/8.
+ * Probing distance is a hint to expand clustered table earlier.
  */
 {
-    do {
-        ht_index &= hash_table->hash_bitmask;
-        if (hash_table->get_item(hash_table, ht_index)) {
-            ht_index++;
-        } else {
-            hash_table->set_item(hash_table, ht_index, kv_index);
-            return ht_index;
+    if (engine == PW_MAP_ENGINE_SWISS) {
+        unsigned num_groups = capacity / PWMAP_SWISS_GROUP_SIZE;
+        return (capacity - (capacity >> 3) >= desired_capacity) && (ht_offset < (num_groups >> 2) + 1);
+    }
+    unsigned quarter_cap = capacity >> 2;
+    return (capacity >= desired_capacity + quarter_cap) && (ht_offset < quarter_cap);
+}
+
+static unsigned fit_hash_table(uint8_t engine, unsigned capacity, unsigned desired_capacity)
+/*
+ * Double hash table capacity until it fits desired number of items.
+ * Return 0 if no capacity fits, that never happens for desired_capacity
+ * within max_map_capacity.
+ */
+{
+    for (; capacity; capacity <<= 1) {
+        if (hash_table_fits(engine, capacity, desired_capacity, 0)) {
+            return capacity;
         }
-    } while (true);
+    }
+    return 0;
+}
+
+static inline unsigned max_map_capacity(_PwMap* map)
+/*
+ * Return maximal number of items, including deleted ones,
+ * so that kv_pairs does not exceed PWARRAY_MAX_CAPACITY.
+ */
+{
+    return PWARRAY_MAX_CAPACITY >> map->entry_shift;
 }
 
-[[ nodiscard]] static bool _pw_map_expand(PwTypeId type_id, _PwMap* map, unsigned desired_capacity, unsigned ht_offset)
+[[nodiscard]] static bool grow_small_map(PwTypeId type_id, _PwMap* map, unsigned desired_capacity)
 /*
- * Expand map if necessary.
+ * Move pairs from inline storage to allocated array
+ * and build hash table.
  *
- * ht_offset is a hint, can be 0. If greater or equal 1/4 of capacity, hash table size will be doubled.
+ * Inline storage shares memory with hashes and hash table,
+ * so pairs are moved out before initializing them and moved back on failure.
  */
 {
-    // expand array if necessary
-    unsigned array_cap = desired_capacity << 1;
-    if (array_cap > _pw_array_capacity(&map->kv_pairs)) {
-        if (!_pw_array_resize(type_id, &map->kv_pairs, array_cap)) {
-            return false;
+    _PwArray small_array = map->kv_pairs;
+    unsigned length = small_array.length;
+
+    if (!_pw_alloc_array(type_id, &map->kv_pairs, desired_capacity << map->entry_shift)) {
+        map->kv_pairs = small_array;
+        return false;
+    }
+    // items are moved, parents of compound items remain the same
+    memcpy(map->kv_pairs.items, map->small_pairs, length * sizeof(_PwValue));
+    map->kv_pairs.length = length;
+
+    struct _PwHashTable* ht = &map->hash_table;
+    memset(ht, 0, sizeof(struct _PwHashTable));
+    map->hashes_capacity = _pw_array_capacity(&map->kv_pairs) >> map->entry_shift;
+    map->hashes = _pw_alloc(type_id, get_hashes_memsize(map), false);
+    if (!map->hashes) {
+        goto error;
+    }
+    unsigned ht_capacity = fit_hash_table(map->engine,
+                                          (map->engine == PW_MAP_ENGINE_SWISS)? PWMAP_SWISS_GROUP_SIZE : PWMAP_INITIAL_CAPACITY,
+                                          desired_capacity);
+    if (!init_hash_table(type_id, map, 0, ht_capacity)) {
+        goto error;
+    }
+    for (unsigned i = 0; i < length; i += 1 << map->entry_shift) {
+        map->hashes[i >> map->entry_shift] = pw_hash(&map->kv_pairs.items[i]);
+    }
+    rebuild_hash_table(map);
+    return true;
+
+error:
+    if (map->hashes) {
+        _pw_free(type_id, (void**) &map->hashes, get_hashes_memsize(map));
+    }
+    memcpy(map->small_pairs, map->kv_pairs.items, length * sizeof(_PwValue));
+    map->kv_pairs.length = 0;
+    _pw_destroy_array(type_id, &map->kv_pairs, nullptr);
+    map->kv_pairs = small_array;
+    return false;
+}
+
+[[nodiscard]] static bool expand_map(PwTypeId type_id, _PwMap* map, unsigned desired_capacity,
+                                     unsigned ht_offset, bool exact)
+/*
+ * Grow kv_pairs and hashes by array growth policy, or exactly to desired_capacity
+ * if `exact` is set, and grow hash table if necessary.
+ */
+{
+    if (desired_capacity > max_map_capacity(map)) {
+        pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+        return false;
+    }
+    if (_pw_map_is_small(map)) {
+        if (desired_capacity <= PWMAP_SMALL_CAPACITY) {
+            return true;
         }
+        return grow_small_map(type_id, map, desired_capacity);
     }
 
     struct _PwHashTable* ht = &map->hash_table;
 
+    if (map->num_deleted && !hash_table_fits(map->engine, ht->capacity, desired_capacity, ht_offset)) {
+        // rebuilding hash table costs the same as growing it,
+        // drop deleted pairs first, this may make growing unnecessary
+        desired_capacity -= map->num_deleted;
+        compact_map(map);
+        ht_offset = 0;
+    }
+
+    // expand array and hashes if necessary
+    unsigned array_cap = desired_capacity << map->entry_shift;
+    unsigned old_array_cap = _pw_array_capacity(&map->kv_pairs);
+    if (array_cap > old_array_cap) {
+        if (!exact) {
+            // inserts come one by one, grow geometrically to keep them amortized O(1)
+            unsigned grown_cap = _pw_array_grown_capacity(&map->kv_pairs);
+            if (array_cap < grown_cap) {
+                array_cap = grown_cap;
+            }
+        }
+        // grow hashes first, spare hashes do no harm if kv_pairs cannot grow
+        unsigned hashes_capacity = _pw_array_round_capacity(array_cap) >> map->entry_shift;
+        if (hashes_capacity > map->hashes_capacity) {
+            if (!_pw_realloc(type_id, (void**) &map->hashes, get_hashes_memsize(map),
+                             hashes_capacity * sizeof(PwType_Hash), false)) {
+                return false;
+            }
+            map->hashes_capacity = hashes_capacity;
+        }
+        if (!_pw_array_resize(type_id, &map->kv_pairs, array_cap)) {
+            return false;
+        }
+    }
+
     // check if hash table needs expansion
-    unsigned quarter_cap = ht->capacity >> 2;
-    if ((ht->capacity >= desired_capacity + quarter_cap) && (ht_offset < quarter_cap)) {
+    if (hash_table_fits(map->engine, ht->capacity, desired_capacity, ht_offset)) {
         return true;
     }
 
-    unsigned new_capacity = ht->capacity << 1;
-    quarter_cap = desired_capacity >> 2;
-    while (new_capacity < desired_capacity + quarter_cap) {
-        new_capacity <<= 1;
+    unsigned new_capacity = fit_hash_table(map->engine, ht->capacity << 1, desired_capacity);
+    if (!init_hash_table(type_id, map, ht->capacity, new_capacity)) {
+        return false;
     }
+    rebuild_hash_table(map);
+    return true;
+}
+
+[[nodiscard]] bool _pw_map_expand(PwTypeId type_id, _PwMap* map, unsigned desired_capacity, unsigned ht_offset)
+{
+    return expand_map(type_id, map, desired_capacity, ht_offset, false);
+}
 
-    if (!init_hash_table(type_id, ht, ht->capacity, new_capacity)) {
+[[nodiscard]] bool _pw_map_reserve(PwTypeId type_id, _PwMap* map, unsigned capacity)
+{
+    if (capacity > max_map_capacity(map) - map->num_deleted) {
+        pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
         return false;
     }
+    return expand_map(type_id, map, capacity + map->num_deleted, 0, true);
+}
 
-    // rebuild hash table
-    PwValuePtr key_ptr = &map->kv_pairs.items[0];
-    unsigned kv_index = 1;  // index is 1-based, zero means unused item in hash table
-    unsigned n = _pw_array_length(&map->kv_pairs);
-    pw_assert((n & 1) == 0);
-    while (n) {
-        set_hash_table_item(ht, pw_hash(key_ptr), kv_index);
-        key_ptr += 2;
-        n -= 2;
-        kv_index++;
+static unsigned get_key_index(_PwMap* map, unsigned index)
+/*
+ * Convert item index to the index of key in kv_pairs.
+ * Return UINT_MAX if `index` is out of range.
+ *
+ * If kv_pairs contains deleted pairs, scan it starting
+ * from the cursor when possible, so sequential access is O(1).
+ */
+{
+    if (index >= _pw_map_length(map)) {
+        return UINT_MAX;
     }
-    return true;
+    if (map->num_deleted == 0) {
+        return index << map->entry_shift;
+    }
+    unsigned i = 0;
+    unsigned key_index = 0;
+    if (index >= map->cursor_index) {
+        i = map->cursor_index;
+        key_index = map->cursor_key_index;
+    }
+    PwValuePtr key_ptr = &map->kv_pairs.items[key_index];
+    for (;;) {
+        if (!_pw_map_is_deleted(key_ptr)) {
+            if (i == index) {
+                break;
+            }
+            i++;
+        }
+        key_ptr += 1 << map->entry_shift;
+        key_index += 1 << map->entry_shift;
+    }
+    map->cursor_index = index;
+    map->cursor_key_index = key_index;
+    return key_index;
 }
 
-[[nodiscard]] static bool update_map(PwValuePtr map, PwValuePtr key, PwValuePtr value)
+void _pw_map_delete(PwValuePtr self, _PwMap* map, unsigned key_index)
 /*
- * key and value are moved to the internal array
+ * Destroy key and value, mark the pair as deleted,
+ * and compact the map if too many pairs are deleted.
+ */
+{
+    if (_pw_map_is_small(map)) {
+        // no hash table, simply remove the pair
+        _pw_array_del(&map->kv_pairs, key_index, key_index + (1 << map->entry_shift), self);
+        return;
+    }
+
+    PwValuePtr key_ptr = &map->kv_pairs.items[key_index];
+
+    if (pw_is_compound(key_ptr)) {
+        _pw_abandon(self, key_ptr);
+    }
+    pw_destroy(key_ptr);
+    if (map->entry_shift) {
+        PwValuePtr value_ptr = key_ptr + 1;
+        if (pw_is_compound(value_ptr)) {
+            _pw_abandon(self, value_ptr);
+        }
+        pw_destroy(value_ptr);
+    }
+
+    _pw_map_make_tombstone(key_ptr);
+    map->num_deleted++;
+
+    if (key_index < map->cursor_key_index) {
+        map->cursor_index--;
+    }
+    if (map->num_deleted >= map->hash_table.capacity / PWMAP_COMPACT_RATIO) {
+        compact_map(map);
+    }
+}
+
+[[nodiscard]] bool _pw_map_insert(PwValuePtr map, PwValuePtr key, PwType_Hash key_hash,
+                                  PwValuePtr value, unsigned ht_offset)
+/*
+ * Requirements for key_hash are the same as for update_map_hashed.
+ * ht_offset is a hint for _pw_map_expand returned by lookup.
  */
 {
     PwTypeId type_id = map->type_id;
     _PwMap* __map = get_data_ptr(map);
 
+    if (key->type_id == PwTypeId_Null) {
+        // make sure Null key never looks like a tombstone
+        *key = PwNull();
+    }
+
+    if (!small_map_has_room(__map)) {
+        unsigned kv_index = _pw_array_length(&__map->kv_pairs) >> __map->entry_shift;
+        if (!_pw_map_expand(type_id, __map, kv_index + 1, ht_offset)) {
+            return false;
+        }
+        // expansion may compact the map
+        kv_index = _pw_array_length(&__map->kv_pairs) >> __map->entry_shift;
+        set_hash_table_item(&__map->hash_table, key_hash, kv_index + 1);
+        __map->hashes[kv_index] = key_hash;
+    }
+
+    // append key and value
+    if (!_pw_array_append_item(type_id, &__map->kv_pairs, key, map)) {
+        return false;
+    }
+    if (__map->entry_shift == 0) {
+        return true;
+    }
+    return _pw_array_append_item(type_id, &__map->kv_pairs, value, map);
+}
+
+[[nodiscard]] static bool update_map_hashed(PwValuePtr map, PwValuePtr key, PwType_Hash key_hash, PwValuePtr value)
+/*
+ * key and value are moved to the internal array,
+ * key_hash must be equal to pw_hash(key) unless the map
+ * is small and has room for one more pair
+ */
+{
+    _PwMap* __map = get_data_ptr(map);
+
     // lookup key in the map
 
-    unsigned ht_offset;
-    unsigned key_index = lookup(__map, key, nullptr, &ht_offset);
+    unsigned ht_offset = 0;
+    unsigned key_index;
+    if (_pw_map_is_small(__map)) {
+        key_index = small_lookup(__map, key);
+    } else {
+        key_index = lookup(__map, key, key_hash, &ht_offset);
+    }
 
     if (key_index != UINT_MAX) {
         // found key, update value
         unsigned value_index = key_index + 1;
         PwValuePtr v_ptr = &__map->kv_pairs.items[value_index];
+        if (!_pw_embrace(map, value)) {
+            return false;
+        }
+        if (pw_is_compound(v_ptr)) {
+            _pw_abandon(map, v_ptr);
+        }
         pw_move(value, v_ptr);
         return true;
     }
 
     // key not found, insert
+    return _pw_map_insert(map, key, key_hash, value, ht_offset);
+}
 
-    if (!_pw_map_expand(type_id, __map, get_map_length(__map) + 1, ht_offset)) {
-        return false;
-    }
-
-    // append key and value
-    unsigned kv_index = _pw_array_length(&__map->kv_pairs) >> 1;
-    set_hash_table_item(&__map->hash_table, pw_hash(key), kv_index + 1);
-
-    if (!_pw_array_append_item(type_id, &__map->kv_pairs, key, map)) {
-        return false;
+[[nodiscard]] static inline bool update_map(PwValuePtr map, PwValuePtr key, PwValuePtr value)
+/*
+ * key and value are moved to the internal array
+ */
+{
+    _PwMap* __map = get_data_ptr(map);
+    if (small_map_has_room(__map)) {
+        // hash is not needed yet
+        return update_map_hashed(map, key, 0, value);
     }
-    return _pw_array_append_item(type_id, &__map->kv_pairs, value, map);
+    return update_map_hashed(map, key, pw_hash(key), value);
 }
 
 /****************************************************************
  * Basic interface methods
  */
 
-static void map_fini(PwValuePtr self)
+void _pw_map_fini_data(PwValuePtr self)
 {
     _PwMap* map = get_data_ptr(self);
 
+    if (_pw_map_is_small(map)) {
+        // destroy items but do not free inline storage
+        _pw_array_del(&map->kv_pairs, 0, map->kv_pairs.length, self);
+        map->kv_pairs.items = nullptr;
+        return;
+    }
+    if (map->hashes) {
+        _pw_free(self->type_id, (void**) &map->hashes, get_hashes_memsize(map));
+    }
     _pw_destroy_array(self->type_id, &map->kv_pairs, self);
 
     struct _PwHashTable* ht = &map->hash_table;
     free_hash_table(self->type_id, ht);
 }
 
-[[nodiscard]] static bool map_init(PwValuePtr self, void* ctor_args)
+[[nodiscard]] bool _pw_map_init_data(PwValuePtr self, PwMapCtorArgs* args, uint8_t entry_shift)
 {
-    // XXX not using ctor_args for now
-    // XXX add capacity parameter
-
     _PwMap* map = get_data_ptr(self);
-    struct _PwHashTable* ht = &map->hash_table;
-    ht->items_used = 0;
-    if (!init_hash_table(self->type_id, ht, 0, PWMAP_INITIAL_CAPACITY)) {
+    map->entry_shift = entry_shift;
+
+    unsigned capacity = PWMAP_INITIAL_CAPACITY;
+    unsigned ht_capacity = PWMAP_INITIAL_CAPACITY;
+    if (args) {
+        map->compound_data.acyclic = args->acyclic;
+        if (args->engine == PW_MAP_ENGINE_SWISS) {
+            map->engine = PW_MAP_ENGINE_SWISS;
+            if (ht_capacity < PWMAP_SWISS_GROUP_SIZE) {
+                ht_capacity = PWMAP_SWISS_GROUP_SIZE;
+            }
+        }
+        if (args->capacity > capacity) {
+            if (args->capacity > max_map_capacity(map)) {
+                pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+                return false;
+            }
+            capacity = args->capacity;
+            ht_capacity = fit_hash_table(map->engine, ht_capacity, capacity);
+        }
+    }
+    if (capacity <= PWMAP_SMALL_CAPACITY) {
+        // start with inline storage, nothing to allocate
+        map->kv_pairs.items = map->small_pairs;
+        map->kv_pairs.capacity = PWMAP_SMALL_CAPACITY << entry_shift;
+        map->kv_pairs.length = 0;
+        return true;
+    }
+    if (!init_hash_table(self->type_id, map, 0, ht_capacity)) {
+        return false;
+    }
+    if (!_pw_alloc_array(self->type_id, &map->kv_pairs, capacity << entry_shift)) {
+        _pw_map_fini_data(self);
         return false;
     }
-    if (!_pw_alloc_array(self->type_id, &map->kv_pairs, PWMAP_INITIAL_CAPACITY * 2)) {
-        map_fini(self);
+    map->hashes_capacity = _pw_array_capacity(&map->kv_pairs) >> entry_shift;
+    map->hashes = _pw_alloc(self->type_id, get_hashes_memsize(map), false);
+    if (!map->hashes) {
+        _pw_map_fini_data(self);
         return false;
     }
     return true;
 }
 
+[[nodiscard]] static bool map_init(PwValuePtr self, void* ctor_args)
+{
+    return _pw_map_init_data(self, ctor_args, 1);
+}
+
 static void map_hash(PwValuePtr self, PwHashContext* ctx)
 {
     _pw_hash_uint64(ctx, self->type_id);
     _PwMap* map = get_data_ptr(self);
-    for (unsigned i = 0, n = _pw_array_length(&map->kv_pairs); i < n; i++) {
-        PwValuePtr item = &map->kv_pairs.items[i];
-        _pw_call_hash(item, ctx);
+    PwValuePtr item_ptr = &map->kv_pairs.items[0];
+    for (unsigned n = _pw_array_length(&map->kv_pairs); n; n -= 2, item_ptr += 2) {
+        if (!_pw_map_is_deleted(item_ptr)) {
+            _pw_call_hash(item_ptr, ctx);
+            _pw_call_hash(item_ptr + 1, ctx);
+        }
     }
 }
 
 [[nodiscard]] static bool map_deepcopy(PwValuePtr self, PwValuePtr result)
 {
-    if (!pw_create(self->type_id, result)) {
-        return false;
-    }
     _PwMap* src_map = get_data_ptr(self);
-    unsigned map_length = get_map_length(src_map);
-
-    // XXX use capacity parameter in constructor
-    if (!_pw_map_expand(self->type_id, get_data_ptr(result), map_length, 0)) {
+    unsigned map_length = _pw_map_length(src_map);
+    PwMapCtorArgs args = {
+        .engine   = src_map->engine,
+        .capacity = map_length,
+        .acyclic  = src_map->compound_data.acyclic
+    };
+    if (!pw_create2(self->type_id, &args, result)) {
         return false;
     }
     PwValuePtr kv = &src_map->kv_pairs.items[0];
+    PwType_Hash* hash_ptr = _pw_map_is_small(src_map)? nullptr : src_map->hashes;
     PwValue key = PW_NULL;
     PwValue value = PW_NULL;
     for (unsigned i = 0; i < map_length; i++) {{
+        while (_pw_map_is_deleted(kv)) {
+            kv += 2;
+            hash_ptr++;
+        }
         pw_clone2(kv++, &key);  // okay to clone because keys are already deeply copied
         pw_clone2(kv++, &value);
-        if (!update_map(result, &key, &value)) {  // error should not happen because the map already resized
-            return false;
+        // error should not happen because the map already resized
+        if (hash_ptr) {
+            if (!update_map_hashed(result, &key, *hash_ptr++, &value)) {
+                return false;
+            }
+        } else {
+            // small map has no hashes
+            if (!update_map(result, &key, &value)) {
+                return false;
+            }
         }
     }}
     return true;
@@ -398,8 +1078,9 @@ static void map_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inden
     };
 
     _PwMap* map = get_data_ptr(self);
-    fprintf(fp, "%u items, array items/capacity=%u/%u\n",
-            get_map_length(map), _pw_array_length(&map->kv_pairs), _pw_array_capacity(&map->kv_pairs));
+    fprintf(fp, "%u items, %u deleted, array items/capacity=%u/%u\n",
+            _pw_map_length(map), map->num_deleted,
+            _pw_array_length(&map->kv_pairs), _pw_array_capacity(&map->kv_pairs));
 
     next_indent += 4;
     PwValuePtr item_ptr = &map->kv_pairs.items[0];
@@ -408,6 +1089,10 @@ static void map_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inden
         PwValuePtr key   = item_ptr++;
         PwValuePtr value = item_ptr++;
 
+        if (_pw_map_is_deleted(key)) {
+            continue;
+        }
+
         _pw_print_indent(fp, next_indent);
         fputs("Key:   ", fp);
         _pw_call_dump(fp, key, 0, next_indent + 7, &this_link);
@@ -420,7 +1105,12 @@ static void map_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inden
     _pw_print_indent(fp, next_indent);
 
     struct _PwHashTable* ht = &map->hash_table;
-    fprintf(fp, "hash table item size %u, capacity=%u (bitmask %llx)\n",
+    if (_pw_map_is_small(map)) {
+        fputs("small map, no hash table\n", fp);
+        return;
+    }
+    fprintf(fp, "%s hash table item size %u, capacity=%u (bitmask %llx)\n",
+            (map->engine == PW_MAP_ENGINE_SWISS)? "Swiss" : "linear probing",
             ht->item_size, ht->capacity, (unsigned long long) ht->hash_bitmask);
 
     unsigned hex_width = ht->item_size;
@@ -440,7 +1130,7 @@ static void map_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inden
     unsigned line_len = 0;
     _pw_print_indent(fp, next_indent);
     for (unsigned i = 0; i < ht->capacity; i++ ) {
-        unsigned kv_index = ht->get_item(ht, i);
+        unsigned kv_index = get_hash_table_item(ht, i);
         fprintf(fp, fmt, i, kv_index);
         line_len += dec_width + hex_width + 4;
         if (line_len < 80) {
@@ -464,12 +1154,38 @@ static void map_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inden
 
 [[nodiscard]] static bool map_is_true(PwValuePtr self)
 {
-    return get_map_length(get_data_ptr(self));
+    return _pw_map_length(get_data_ptr(self));
 }
 
-[[nodiscard]] static inline bool map_eq(_PwMap* a, _PwMap* b)
+[[nodiscard]] static bool map_eq(_PwMap* a, _PwMap* b)
 {
-    return _pw_array_eq(&a->kv_pairs, &b->kv_pairs);
+    if (a->num_deleted == 0 && b->num_deleted == 0) {
+        return _pw_array_eq(&a->kv_pairs, &b->kv_pairs);
+    }
+    unsigned n = _pw_map_length(a);
+    if (_pw_map_length(b) != n) {
+        return false;
+    }
+    PwValuePtr a_ptr = a->kv_pairs.items;
+    PwValuePtr b_ptr = b->kv_pairs.items;
+    while (n) {
+        while (_pw_map_is_deleted(a_ptr)) {
+            a_ptr += 2;
+        }
+        while (_pw_map_is_deleted(b_ptr)) {
+            b_ptr += 2;
+        }
+        if (!_pw_equal(a_ptr, b_ptr)) {
+            return false;
+        }
+        if (!_pw_equal(a_ptr + 1, b_ptr + 1)) {
+            return false;
+        }
+        a_ptr += 2;
+        b_ptr += 2;
+        n--;
+    }
+    return true;
 }
 
 [[nodiscard]] static bool map_equal_sametype(PwValuePtr self, PwValuePtr other)
@@ -521,7 +1237,7 @@ PwType _pw_map_type = {
     .data_size      = sizeof(_PwMap),
 
     .init           = map_init,
-    .fini           = map_fini,
+    .fini           = _pw_map_fini_data,
 
     .num_interfaces = PW_LENGTH(map_interfaces),
     .interfaces     = map_interfaces
@@ -532,9 +1248,47 @@ PwType _pw_map_type = {
  * map functions
  */
 
+[[nodiscard]] bool pw_create_map_from_pairs(PwValuePtr kv_pairs, unsigned num_pairs, PwValuePtr result)
+{
+    PwMapCtorArgs args = {
+        .capacity = num_pairs
+    };
+    bool ret = pw_create2(PwTypeId_Map, &args, result);
+    for (unsigned i = 0; i < num_pairs; i++) {
+        PwValuePtr key = kv_pairs++;
+        PwValuePtr value = kv_pairs++;
+        if (ret) {
+            PwValue map_key = PW_NULL;
+            ret = pw_deepcopy(key, &map_key);  // deep copy key for immutability, same as pw_map_update
+            if (ret) {
+                ret = update_map(result, &map_key, value);
+            }
+        }
+        // destroy what's left after moving, or after failure
+        pw_destroy(key);
+        pw_destroy(value);
+    }
+    return ret;
+}
+
+[[nodiscard]] bool pw_map_reserve(PwValuePtr self, unsigned capacity)
+{
+    pw_assert_map(self);
+    _PwMap* map = get_data_ptr(self);
+    if (map->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    return _pw_map_reserve(self->type_id, map, capacity);
+}
+
 [[nodiscard]] bool pw_map_update(PwValuePtr map, PwValuePtr key, PwValuePtr value)
 {
     pw_assert_map(map);
+    if (get_data_ptr(map)->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
 
     PwValue map_key = PW_NULL;
     if (!pw_deepcopy(key, &map_key)) {  // deep copy key for immutability
@@ -557,6 +1311,10 @@ PwType _pw_map_type = {
 {
     pw_assert_map(map);
     bool done = false;  // for special case when value is missing
+    if (get_data_ptr(map)->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        goto failure;
+    }
     while (!done) {{
         PwValue key = va_arg(ap, _PwValue);
         if (pw_is_status(&key)) {
@@ -593,8 +1351,7 @@ failure:
 [[nodiscard]] bool _pw_map_has_key(PwValuePtr self, PwValuePtr key)
 {
     pw_assert_map(self);
-    _PwMap* map = get_data_ptr(self);
-    return lookup(map, key, nullptr, nullptr) != UINT_MAX;
+    return find_key(get_data_ptr(self), key) != UINT_MAX;
 }
 
 [[nodiscard]] bool _pw_map_get(PwValuePtr self, PwValuePtr key, PwValuePtr result)
@@ -603,7 +1360,7 @@ failure:
     _PwMap* map = get_data_ptr(self);
 
     // lookup key in the map
-    unsigned key_index = lookup(map, key, nullptr, nullptr);
+    unsigned key_index = find_key(map, key);
 
     if (key_index == UINT_MAX) {
         // key not found
@@ -616,50 +1373,157 @@ failure:
     return true;
 }
 
+[[nodiscard]] bool _pw_map_slot(PwValuePtr self, PwValuePtr key, PwValuePtr default_value, _PwMapSlot* slot)
+{
+    pw_assert_map(self);
+    _PwMap* map = get_data_ptr(self);
+
+    pw_map_slot_release(slot);
+
+    // lookup key in the map, hash is computed only once
+
+    PwType_Hash key_hash;
+    unsigned ht_offset;
+    unsigned key_index = _pw_map_lookup(map, key, &key_hash, &ht_offset);
+
+    if (key_index == UINT_MAX) {
+        // key not found, insert default value
+        if (map->kv_pairs.itercount) {
+            pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+            return false;
+        }
+        PwValue map_key = PW_NULL;
+        if (!pw_deepcopy(key, &map_key)) {  // deep copy key for immutability
+            return false;
+        }
+        PwValue map_value = PW_NULL;
+        if (!pw_deepcopy(default_value, &map_value)) {  // each key gets its own compound default
+            return false;
+        }
+        if (!_pw_map_insert(self, &map_key, key_hash, &map_value, ht_offset)) {
+            return false;
+        }
+        key_index = _pw_array_length(&map->kv_pairs) - 2;
+    }
+
+    // kv_pairs cannot be modified until slot is released
+    map->kv_pairs.itercount++;
+
+    slot->map = pw_clone(self);
+    slot->value = &map->kv_pairs.items[key_index + 1];
+    return true;
+}
+
+[[nodiscard]] bool pw_map_slot_put(_PwMapSlot* slot, PwValuePtr value)
+{
+    pw_assert(slot->value != nullptr);
+    PwValuePtr self = &slot->map;
+    if (!_pw_embrace(self, value)) {
+        return false;
+    }
+    if (pw_is_compound(slot->value)) {
+        _pw_abandon(self, slot->value);
+    }
+    pw_move(value, slot->value);
+    return true;
+}
+
+void pw_map_slot_release(_PwMapSlot* slot)
+{
+    if (slot->map.type_id != PwTypeId_Null) {
+        get_data_ptr(&slot->map)->kv_pairs.itercount--;
+        pw_destroy(&slot->map);
+        slot->value = nullptr;
+    }
+}
+
 [[nodiscard]] bool _pw_map_del(PwValuePtr self, PwValuePtr key)
 {
     pw_assert_map(self);
 
     _PwMap* map = get_data_ptr(self);
+    if (map->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
 
     // lookup key in the map
 
-    unsigned ht_index;
-    unsigned key_index = lookup(map, key, &ht_index, nullptr);
+    unsigned key_index = find_key(map, key);
     if (key_index == UINT_MAX) {
         // key not found
         pw_set_status(PwStatus(PW_ERROR_KEY_NOT_FOUND));
         return false;
     }
 
-    struct _PwHashTable* ht = &map->hash_table;
+    // unless the map is small, the pair remains
+    // in the hash table and in kv_pairs as a tombstone
+    _pw_map_delete(self, map, key_index);
+    return true;
+}
 
-    // delete item from hash table
-    ht->set_item(ht, ht_index, 0);
-    ht->items_used--;
-
-    // delete key-value pair
-    _pw_array_del(&map->kv_pairs, key_index, key_index + 2, self);
-
-    if (key_index + 2 < _pw_array_length(&map->kv_pairs)) {
-        // key-value was not the last pair in the array,
-        // decrement indexes in the hash table that are greater than index of the deleted pair
-        unsigned threshold = (key_index + 2) >> 1;
-        threshold++; // kv_indexes in hash table are 1-based
-        for (unsigned i = 0; i < ht->capacity; i++) {
-            unsigned kv_index = ht->get_item(ht, i);
-            if (kv_index >= threshold) {
-                ht->set_item(ht, i, kv_index - 1);
-            }
-        }
+static unsigned lookup_utf8_buf(_PwMap* map, char8_t* key, unsigned key_size)
+/*
+ * Lookup key by UTF-8 buffer without creating a temporary string.
+ * Return index of key in kv_pairs or UINT_MAX if not found.
+ */
+{
+    _PwUtf8Key utf8_key = {
+        .ptr  = key,
+        .size = key_size
+    };
+    if (_pw_map_is_small(map)) {
+        return small_lookup_utf8(map, &utf8_key);
+    }
+    PwType_Hash key_hash;
+    if (!_pw_hash_utf8(key, key_size, &key_hash)) {
+        return UINT_MAX;
+    }
+    return lookup_utf8(map, &utf8_key, key_hash, nullptr);
+}
+
+[[nodiscard]] bool pw_map_has_key_utf8_buf(PwValuePtr self, char8_t* key, unsigned key_size)
+{
+    pw_assert_map(self);
+    return lookup_utf8_buf(get_data_ptr(self), key, key_size) != UINT_MAX;
+}
+
+[[nodiscard]] bool pw_map_get_utf8_buf(PwValuePtr self, char8_t* key, unsigned key_size, PwValuePtr result)
+{
+    pw_assert_map(self);
+    _PwMap* map = get_data_ptr(self);
+
+    unsigned key_index = lookup_utf8_buf(map, key, key_size);
+    if (key_index == UINT_MAX) {
+        pw_set_status(PwStatus(PW_ERROR_KEY_NOT_FOUND));
+        return false;
+    }
+    pw_clone2(&map->kv_pairs.items[key_index + 1], result);
+    return true;
+}
+
+[[nodiscard]] bool pw_map_del_utf8_buf(PwValuePtr self, char8_t* key, unsigned key_size)
+{
+    pw_assert_map(self);
+    _PwMap* map = get_data_ptr(self);
+    if (map->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+
+    unsigned key_index = lookup_utf8_buf(map, key, key_size);
+    if (key_index == UINT_MAX) {
+        pw_set_status(PwStatus(PW_ERROR_KEY_NOT_FOUND));
+        return false;
     }
+    _pw_map_delete(self, map, key_index);
     return true;
 }
 
 unsigned pw_map_length(PwValuePtr self)
 {
     pw_assert_map(self);
-    return get_map_length(get_data_ptr(self));
+    return _pw_map_length(get_data_ptr(self));
 }
 
 [[nodiscard]] bool pw_map_item(PwValuePtr self, unsigned index, PwValuePtr key, PwValuePtr value)
@@ -668,17 +1532,65 @@ unsigned pw_map_length(PwValuePtr self)
 
     _PwMap* map = get_data_ptr(self);
 
-    index <<= 1;
+    unsigned key_index = get_key_index(map, index);
 
-    if (index < _pw_array_length(&map->kv_pairs)) {
-        pw_clone2(&map->kv_pairs.items[index], key);
-        pw_clone2(&map->kv_pairs.items[index + 1], value);
+    if (key_index != UINT_MAX) {
+        pw_clone2(&map->kv_pairs.items[key_index], key);
+        pw_clone2(&map->kv_pairs.items[key_index + 1], value);
         return true;
     } else {
         return false;
     }
 }
 
+[[nodiscard]] _PwMapCursor pw_map_cursor(PwValuePtr self)
+{
+    pw_assert_map(self);
+    _PwMap* map = get_data_ptr(self);
+
+    // kv_pairs cannot be modified until cursor is stopped
+    map->kv_pairs.itercount++;
+
+    return (_PwMapCursor) {
+        .map = pw_clone(self)
+    };
+}
+
+[[nodiscard]] bool pw_map_cursor_next(_PwMapCursor* cursor)
+{
+    if (cursor->map.type_id == PwTypeId_Null) {
+        return false;
+    }
+    _PwMap* map = get_data_ptr(&cursor->map);
+    unsigned key_index = cursor->_key_index;
+    unsigned length = _pw_array_length(&map->kv_pairs);
+    PwValuePtr key_ptr = &map->kv_pairs.items[key_index];
+    while (key_index < length && _pw_map_is_deleted(key_ptr)) {
+        key_index += 2;
+        key_ptr += 2;
+    }
+    if (key_index >= length) {
+        return false;
+    }
+    if (cursor->key) {
+        cursor->index++;
+    }
+    cursor->key = key_ptr;
+    cursor->value = key_ptr + 1;
+    cursor->_key_index = key_index + 2;
+    return true;
+}
+
+void pw_map_cursor_stop(_PwMapCursor* cursor)
+{
+    if (cursor->map.type_id != PwTypeId_Null) {
+        get_data_ptr(&cursor->map)->kv_pairs.itercount--;
+        pw_destroy(&cursor->map);
+        cursor->key = nullptr;
+        cursor->value = nullptr;
+    }
+}
+
 /****************************************************************
  * RandomAccess interface
  */
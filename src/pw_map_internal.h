@@ -1,7 +1,7 @@
 #pragma once
 
 /*
- * Map internals.
+ * Map internals, shared with sets.
  */
 
 #include "src/pw_array_internal.h"
@@ -13,19 +13,24 @@ extern "C" {
 // capacity must be power of two, it doubles when map needs to grow
 #define PWMAP_INITIAL_CAPACITY  8
 
-struct _PwHashTable;
+// maps of up to PWMAP_SMALL_CAPACITY items keep key-value pairs inline
+// and have no hash table, lookup is a linear scan
+#define PWMAP_SMALL_CAPACITY  8U
 
-typedef unsigned (*_PwHtGet)(struct _PwHashTable* ht, unsigned index);
-typedef void     (*_PwHtSet)(struct _PwHashTable* ht, unsigned index, unsigned value);
+// deleted key-value pairs are compacted when their number
+// reaches 1/PWMAP_COMPACT_RATIO of hash table capacity
+#define PWMAP_COMPACT_RATIO  4
+
+// Swiss table probes slots in groups, capacity is never less than group size
+#define PWMAP_SWISS_GROUP_SIZE  16
 
 struct _PwHashTable {
-    uint8_t item_size;   // in bytes
+    uint8_t item_size;   // in bytes, 1, 2, 4, or 8 for linear probing
     PwType_Hash hash_bitmask;  // calculated from item_size
     unsigned items_used;
     unsigned capacity;
-    _PwHtGet get_item;  // getter function for specific item size
-    _PwHtSet set_item;  // setter function for specific item size
-    uint8_t* items;     // items have variable size
+    uint8_t* items;     // items have variable size;
+                        // for Swiss table: control bytes followed by 32-bit slots
 };
 
 typedef struct {
@@ -35,9 +40,140 @@ typedef struct {
     _PwCompoundData compound_data;
 
     _PwArray kv_pairs;        // key-value pairs in the insertion order
-    struct _PwHashTable hash_table;
+
+    uint8_t engine;           // PW_MAP_ENGINE_*, small map keeps it for the hash table it grows into
+
+    /*
+     * log2 of the number of kv_pairs items per entry:
+     * 1 for maps (key and value), 0 for sets (key only)
+     */
+    uint8_t entry_shift;
+
+    /*
+     * Deleted pairs are left in kv_pairs as tombstones
+     * until compaction, so deletion does not shift the array
+     * and does not touch the hash table.
+     */
+    unsigned num_deleted;
+
+    /*
+     * Cursor for converting item index to key index when
+     * kv_pairs contains tombstones: `cursor_key_index` is
+     * preceded by exactly `cursor_index` live pairs.
+     */
+    unsigned cursor_index;
+    unsigned cursor_key_index;
+
+    union {
+        /*
+         * Inline storage for small map. While kv_pairs.items points here,
+         * hashes and hash table are not allocated and deleted pairs
+         * are removed immediately.
+         */
+        _PwValue small_pairs[PWMAP_SMALL_CAPACITY * 2];
+
+        /*
+         * Hashed layout, valid once pairs are moved to allocated array.
+         */
+        struct {
+            PwType_Hash* hashes;      // hashes of keys in the same order
+            unsigned hashes_capacity; // never less than the number of entries kv_pairs can hold
+            struct _PwHashTable hash_table;
+        };
+    };
 } _PwMap;
 
+/****************************************************************
+ * Tombstones
+ *
+ * Deleted key is replaced with Null that has nonzero second half.
+ * Null keys are normalized on insertion, so they are never
+ * confused with tombstones.
+ */
+
+#define PWMAP_TOMBSTONE_MARK  0xDEAD'DEAD'DEAD'DEADULL
+
+static inline void _pw_map_make_tombstone(PwValuePtr key)
+{
+    key->type_id = PwTypeId_Null;
+    key->u64[1] = PWMAP_TOMBSTONE_MARK;
+}
+
+static inline bool _pw_map_is_deleted(PwValuePtr key)
+{
+    return key->type_id == PwTypeId_Null && key->u64[1] == PWMAP_TOMBSTONE_MARK;
+}
+
+static inline bool _pw_map_is_small(_PwMap* map)
+/*
+ * Small maps keep pairs inline and have no hashes and hash table.
+ */
+{
+    return map->kv_pairs.items == map->small_pairs;
+}
+
+static inline unsigned _pw_map_length(_PwMap* map)
+/*
+ * Return the number of live entries.
+ */
+{
+    return (_pw_array_length(&map->kv_pairs) >> map->entry_shift) - map->num_deleted;
+}
+
+/****************************************************************
+ * Functions shared with sets.
+ *
+ * key_index is the index of key in kv_pairs.
+ */
+
+[[nodiscard]] bool _pw_map_init_data(PwValuePtr self, PwMapCtorArgs* args, uint8_t entry_shift);
+/*
+ * Initialize map data, args can be null.
+ */
+
+void _pw_map_fini_data(PwValuePtr self);
+
+[[nodiscard]] bool _pw_map_expand(PwTypeId type_id, _PwMap* map, unsigned desired_capacity, unsigned ht_offset);
+/*
+ * Expand map if necessary, used on insertion.
+ * kv_pairs and hashes grow by array growth policy.
+ *
+ * desired_capacity includes deleted pairs.
+ *
+ * ht_offset is a hint, can be 0. If greater or equal 1/4 of capacity
+ * (1/4 of groups for Swiss table), hash table size will be doubled.
+ */
+
+[[nodiscard]] bool _pw_map_reserve(PwTypeId type_id, _PwMap* map, unsigned capacity);
+/*
+ * Expand map to hold `capacity` items without reallocation.
+ * Unlike _pw_map_expand, kv_pairs and hashes are sized exactly.
+ */
+
+unsigned _pw_map_find(_PwMap* map, PwValuePtr key, PwType_Hash key_hash);
+/*
+ * Return key_index or UINT_MAX if not found.
+ * key_hash must be equal to pw_hash(key), it is not used for small maps.
+ */
+
+unsigned _pw_map_lookup(_PwMap* map, PwValuePtr key, PwType_Hash* key_hash, unsigned* ht_offset);
+/*
+ * Return key_index or UINT_MAX if not found.
+ * Write to key_hash and ht_offset the values suitable for _pw_map_insert.
+ */
+
+[[nodiscard]] bool _pw_map_insert(PwValuePtr self, PwValuePtr key, PwType_Hash key_hash,
+                                  PwValuePtr value, unsigned ht_offset);
+/*
+ * Append entry, key must not be in the map yet.
+ * key and value are moved, value is ignored for sets.
+ */
+
+void _pw_map_delete(PwValuePtr self, _PwMap* map, unsigned key_index);
+/*
+ * Destroy entry, leaving a tombstone unless the map is small.
+ */
+
 #ifdef __cplusplus
 }
 #endif
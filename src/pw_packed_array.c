@@ -0,0 +1,950 @@
+#include <string.h>
+
+#include "include/pw.h"
+#include "src/pw_alloc.h"
+#include "src/pw_array_internal.h"
+#include "src/pw_struct_internal.h"
+
+/*
+ * Items are read and written with memcpy, that compiles to plain
+ * loads and stores and keeps the code free of strict aliasing issues
+ * because all item types share the same storage.
+ */
+
+PwTypeId PwTypeId_PackedArray = 0;
+
+static PwType packed_array_type;
+
+// bitmap words are allocated in full, so capacity is a multiple of 64
+#define PACKED_CAPACITY_ALIGNMENT  64
+
+#define PACKED_MAX_CAPACITY  ((UINT_MAX / sizeof(uint64_t)) & ~(PACKED_CAPACITY_ALIGNMENT - 1))
+
+static inline unsigned items_memsize(PwTypeId item_type, unsigned capacity)
+{
+    if (item_type == PwTypeId_Bool) {
+        return capacity / 8;
+    } else {
+        return capacity * sizeof(uint64_t);
+    }
+}
+
+static inline unsigned used_memsize(_PwPackedArray* pa)
+/*
+ * Return the size of memory occupied by items.
+ */
+{
+    if (pa->item_type == PwTypeId_Bool) {
+        return (pa->length + 63) / 64 * sizeof(uint64_t);
+    } else {
+        return pa->length * sizeof(uint64_t);
+    }
+}
+
+static inline bool get_bit(uint64_t* bits, unsigned index)
+{
+    return (bits[index / 64] >> (index % 64)) & 1;
+}
+
+static inline void set_bit(uint64_t* bits, unsigned index, bool value)
+{
+    uint64_t mask = 1ULL << (index % 64);
+    if (value) {
+        bits[index / 64] |= mask;
+    } else {
+        bits[index / 64] &= ~mask;
+    }
+}
+
+static inline uint64_t get_raw(_PwPackedArray* pa, unsigned index)
+{
+    if (pa->item_type == PwTypeId_Bool) {
+        return get_bit(pa->bits, index);
+    }
+    uint64_t raw;
+    memcpy(&raw, &pa->unsigned_items[index], sizeof(raw));
+    return raw;
+}
+
+static inline void set_raw(_PwPackedArray* pa, unsigned index, uint64_t raw)
+{
+    if (pa->item_type == PwTypeId_Bool) {
+        set_bit(pa->bits, index, raw);
+    } else {
+        memcpy(&pa->unsigned_items[index], &raw, sizeof(raw));
+    }
+}
+
+[[nodiscard]] static bool reserve(PwTypeId type_id, _PwPackedArray* pa, unsigned capacity)
+/*
+ * Make sure array can hold `capacity` items.
+ */
+{
+    if (capacity <= pa->capacity) {
+        return true;
+    }
+    if (capacity > PACKED_MAX_CAPACITY) {
+        pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+        return false;
+    }
+    capacity = align_unsigned(capacity, PACKED_CAPACITY_ALIGNMENT);
+    unsigned old_memsize = items_memsize(pa->item_type, pa->capacity);
+    unsigned new_memsize = items_memsize(pa->item_type, capacity);
+    if (!_pw_realloc(type_id, (void**) &pa->bits, old_memsize, new_memsize, true)) {
+        return false;
+    }
+    pa->capacity = capacity;
+    return true;
+}
+
+[[nodiscard]] static bool grow(PwTypeId type_id, _PwPackedArray* pa)
+/*
+ * Make room for one more item, doubling the capacity.
+ */
+{
+    if (pa->length < pa->capacity) {
+        return true;
+    }
+    unsigned capacity = pa->capacity;
+    if (capacity >= PACKED_MAX_CAPACITY / 2) {
+        capacity = PACKED_MAX_CAPACITY;
+        if (pa->capacity == capacity) {
+            pw_set_status(PwStatus(PW_ERROR_DATA_SIZE_TOO_BIG));
+            return false;
+        }
+    } else {
+        capacity *= 2;
+    }
+    return reserve(type_id, pa, capacity);
+}
+
+/****************************************************************
+ * Conversion between values and raw items
+ */
+
+[[nodiscard]] static bool to_raw(PwTypeId item_type, PwValuePtr value, uint64_t* raw)
+{
+    switch (item_type) {
+        case PwTypeId_Bool:
+            if (pw_is_bool(value)) {
+                *raw = value->bool_value;
+                return true;
+            }
+            break;
+
+        case PwTypeId_Signed:
+            if (pw_is_signed(value)) {
+                *raw = (uint64_t) value->signed_value;
+                return true;
+            }
+            if (pw_is_unsigned(value)) {
+                if (value->unsigned_value > PW_SIGNED_MAX) {
+                    pw_set_status(PwStatus(PW_ERROR_NUMERIC_OVERFLOW));
+                    return false;
+                }
+                *raw = value->unsigned_value;
+                return true;
+            }
+            break;
+
+        case PwTypeId_Unsigned:
+            if (pw_is_unsigned(value)) {
+                *raw = value->unsigned_value;
+                return true;
+            }
+            if (pw_is_signed(value)) {
+                if (value->signed_value < 0) {
+                    pw_set_status(PwStatus(PW_ERROR_NUMERIC_OVERFLOW));
+                    return false;
+                }
+                *raw = value->signed_value;
+                return true;
+            }
+            break;
+
+        case PwTypeId_Float: {
+            double f;
+            if (pw_is_float(value)) {
+                f = value->float_value;
+            } else if (pw_is_signed(value)) {
+                f = (double) value->signed_value;
+            } else if (pw_is_unsigned(value)) {
+                f = (double) value->unsigned_value;
+            } else {
+                break;
+            }
+            memcpy(raw, &f, sizeof(f));
+            return true;
+        }
+
+        case PwTypeId_Timestamp:
+            if (pw_is_timestamp(value)) {
+                if (value->ts_seconds > (UINT64_MAX - value->ts_nanoseconds) / 1'000'000'000ULL) {
+                    pw_set_status(PwStatus(PW_ERROR_NUMERIC_OVERFLOW));
+                    return false;
+                }
+                *raw = value->ts_seconds * 1'000'000'000ULL + value->ts_nanoseconds;
+                return true;
+            }
+            break;
+
+        default:
+            break;
+    }
+    pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+    return false;
+}
+
+static void from_raw(PwTypeId item_type, uint64_t raw, PwValuePtr result)
+{
+    pw_destroy(result);
+    switch (item_type) {
+        case PwTypeId_Bool:
+            *result = PwBool(raw);
+            break;
+        case PwTypeId_Signed:
+            *result = PwSigned((int64_t) raw);
+            break;
+        case PwTypeId_Unsigned:
+            *result = PwUnsigned(raw);
+            break;
+        case PwTypeId_Float: {
+            double f;
+            memcpy(&f, &raw, sizeof(f));
+            *result = PwFloat(f);
+            break;
+        }
+        case PwTypeId_Timestamp:
+            *result = PwTimestamp(raw / 1'000'000'000ULL, raw % 1'000'000'000ULL);
+            break;
+        default:
+            break;
+    }
+}
+
+/****************************************************************
+ * Vectorized kernels
+ *
+ * Kernels use GCC vector extensions that are compiled to SIMD
+ * instructions of the target, or to pairs of them when
+ * vector registers are narrower.
+ */
+
+#define LANES  4
+
+typedef int64_t  vec_signed   __attribute__ ((vector_size (LANES * sizeof(int64_t))));
+typedef uint64_t vec_unsigned __attribute__ ((vector_size (LANES * sizeof(uint64_t))));
+typedef double   vec_float    __attribute__ ((vector_size (LANES * sizeof(double))));
+
+#define SUM_KERNEL(name, item_t, vec_t)  \
+    static item_t name(item_t* items, unsigned length)  \
+    {  \
+        /* two accumulators hide latency of addition */  \
+        vec_t acc0 = { 0 };  \
+        vec_t acc1 = { 0 };  \
+        unsigned i = 0;  \
+        for (; i + 2 * LANES <= length; i += 2 * LANES) {  \
+            vec_t a, b;  \
+            memcpy(&a, &items[i], sizeof(a));  \
+            memcpy(&b, &items[i + LANES], sizeof(b));  \
+            acc0 += a;  \
+            acc1 += b;  \
+        }  \
+        acc0 += acc1;  \
+        item_t sum = 0;  \
+        for (unsigned j = 0; j < LANES; j++) {  \
+            sum += acc0[j];  \
+        }  \
+        for (; i < length; i++) {  \
+            item_t item;  \
+            memcpy(&item, &items[i], sizeof(item));  \
+            sum += item;  \
+        }  \
+        return sum;  \
+    }
+
+// signed sum is calculated as unsigned to wrap around on overflow
+SUM_KERNEL(sum_unsigned, uint64_t, vec_unsigned)
+SUM_KERNEL(sum_float,    double,   vec_float)
+
+#define MINMAX_KERNEL(name, item_t, vec_t, op)  \
+    static item_t name(item_t* items, unsigned length)  \
+    /*  \
+     * length must be nonzero  \
+     */  \
+    {  \
+        item_t result;  \
+        memcpy(&result, &items[0], sizeof(result));  \
+        unsigned i = 0;  \
+        if (length >= LANES) {  \
+            vec_t acc;  \
+            memcpy(&acc, &items[0], sizeof(acc));  \
+            for (i = LANES; i + LANES <= length; i += LANES) {  \
+                vec_t v;  \
+                memcpy(&v, &items[i], sizeof(v));  \
+                vec_signed m = v op acc;  \
+                acc = (vec_t) (((vec_signed) v & m) | ((vec_signed) acc & ~m));  \
+            }  \
+            result = acc[0];  \
+            for (unsigned j = 1; j < LANES; j++) {  \
+                if (acc[j] op result) {  \
+                    result = acc[j];  \
+                }  \
+            }  \
+        }  \
+        for (; i < length; i++) {  \
+            item_t item;  \
+            memcpy(&item, &items[i], sizeof(item));  \
+            if (item op result) {  \
+                result = item;  \
+            }  \
+        }  \
+        return result;  \
+    }
+
+MINMAX_KERNEL(min_signed,   int64_t,  vec_signed,   <)
+MINMAX_KERNEL(max_signed,   int64_t,  vec_signed,   >)
+MINMAX_KERNEL(min_unsigned, uint64_t, vec_unsigned, <)
+MINMAX_KERNEL(max_unsigned, uint64_t, vec_unsigned, >)
+MINMAX_KERNEL(min_float,    double,   vec_float,    <)
+MINMAX_KERNEL(max_float,    double,   vec_float,    >)
+
+static_assert(LANES == 4, "COMPARE_KERNEL packs exactly 4 lanes");
+
+#define COMPARE_KERNEL(name, item_t, vec_t, op)  \
+    static void name(item_t* items, unsigned length, item_t operand, uint64_t* bits)  \
+    {  \
+        vec_t x = { operand, operand, operand, operand };  \
+        unsigned num_words = length / 64;  \
+        for (unsigned w = 0; w < num_words; w++) {  \
+            item_t* p = &items[w * 64];  \
+            uint64_t word = 0;  \
+            for (unsigned j = 0; j < 64; j += LANES) {  \
+                vec_t v;  \
+                memcpy(&v, &p[j], sizeof(v));  \
+                vec_signed m = v op x;  \
+                word |= (uint64_t) ((m[0] & 1) | (m[1] & 2) | (m[2] & 4) | (m[3] & 8)) << j;  \
+            }  \
+            bits[w] = word;  \
+        }  \
+        unsigned tail = length % 64;  \
+        if (tail) {  \
+            item_t* p = &items[num_words * 64];  \
+            uint64_t word = 0;  \
+            for (unsigned j = 0; j < tail; j++) {  \
+                item_t item;  \
+                memcpy(&item, &p[j], sizeof(item));  \
+                word |= (uint64_t) (item op operand) << j;  \
+            }  \
+            bits[num_words] = word;  \
+        }  \
+    }
+
+#define COMPARE_KERNELS(type_name, item_t, vec_t)  \
+    COMPARE_KERNEL(compare_##type_name##_lt, item_t, vec_t, <)   \
+    COMPARE_KERNEL(compare_##type_name##_le, item_t, vec_t, <=)  \
+    COMPARE_KERNEL(compare_##type_name##_eq, item_t, vec_t, ==)  \
+    COMPARE_KERNEL(compare_##type_name##_ne, item_t, vec_t, !=)  \
+    COMPARE_KERNEL(compare_##type_name##_ge, item_t, vec_t, >=)  \
+    COMPARE_KERNEL(compare_##type_name##_gt, item_t, vec_t, >)   \
+    \
+    static void (*compare_##type_name[])(item_t*, unsigned, item_t, uint64_t*) = {  \
+        [PW_CMP_LT] = compare_##type_name##_lt,  \
+        [PW_CMP_LE] = compare_##type_name##_le,  \
+        [PW_CMP_EQ] = compare_##type_name##_eq,  \
+        [PW_CMP_NE] = compare_##type_name##_ne,  \
+        [PW_CMP_GE] = compare_##type_name##_ge,  \
+        [PW_CMP_GT] = compare_##type_name##_gt   \
+    };
+
+COMPARE_KERNELS(signed,   int64_t,  vec_signed)
+COMPARE_KERNELS(unsigned, uint64_t, vec_unsigned)
+COMPARE_KERNELS(float,    double,   vec_float)
+
+static void compare_bool(uint64_t* items, unsigned length, bool operand, uint8_t op, uint64_t* bits)
+/*
+ * Compare bitmap with operand, false is less than true.
+ */
+{
+    unsigned num_words = (length + 63) / 64;
+    for (unsigned w = 0; w < num_words; w++) {
+        uint64_t word = items[w];
+        switch (op) {
+            case PW_CMP_LT: word = operand? ~word : 0; break;
+            case PW_CMP_LE: word = operand? ~0ULL : ~word; break;
+            case PW_CMP_EQ: word = operand? word : ~word; break;
+            case PW_CMP_NE: word = operand? ~word : word; break;
+            case PW_CMP_GE: word = operand? word : ~0ULL; break;
+            case PW_CMP_GT: word = operand? 0 : word; break;
+        }
+        bits[w] = word;
+    }
+    // keep bits beyond length zero
+    if (length % 64) {
+        bits[num_words - 1] &= (1ULL << (length % 64)) - 1;
+    }
+}
+
+static unsigned count_bits(uint64_t* bits, unsigned length)
+{
+    unsigned count = 0;
+    unsigned num_words = (length + 63) / 64;
+    for (unsigned w = 0; w < num_words; w++) {
+        count += __builtin_popcountll(bits[w]);
+    }
+    return count;
+}
+
+/****************************************************************
+ * Basic interface methods
+ */
+
+[[nodiscard]] static bool packed_array_init(PwValuePtr self, void* ctor_args)
+{
+    PwPackedArrayCtorArgs* args = ctor_args;
+    if (!args) {
+        pw_set_status(PwStatus(PW_ERROR), "Item type is not specified");
+        return false;
+    }
+    switch (args->item_type) {
+        case PwTypeId_Bool:
+        case PwTypeId_Signed:
+        case PwTypeId_Unsigned:
+        case PwTypeId_Float:
+        case PwTypeId_Timestamp:
+            break;
+        default:
+            pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+            return false;
+    }
+    _PwPackedArray* pa = get_packed_array_data_ptr(self);
+    pa->item_type = args->item_type;
+    unsigned capacity = args->capacity;
+    if (capacity < PACKED_CAPACITY_ALIGNMENT) {
+        capacity = PACKED_CAPACITY_ALIGNMENT;
+    }
+    return reserve(self->type_id, pa, capacity);
+}
+
+static void packed_array_fini(PwValuePtr self)
+{
+    _PwPackedArray* pa = get_packed_array_data_ptr(self);
+    if (pa->bits) {
+        _pw_free(self->type_id, (void**) &pa->bits, items_memsize(pa->item_type, pa->capacity));
+    }
+}
+
+static void packed_array_hash(PwValuePtr self, PwHashContext* ctx)
+{
+    _PwPackedArray* pa = get_packed_array_data_ptr(self);
+    _pw_hash_uint64(ctx, self->type_id);
+    _pw_hash_uint64(ctx, pa->item_type);
+    _pw_hash_uint64(ctx, pa->length);
+    if (pa->item_type == PwTypeId_Float) {
+        // items are compared numerically, so -0.0 must hash as 0.0;
+        // NaN is never equal, its hash does not matter
+        for (unsigned i = 0; i < pa->length; i++) {
+            double x;
+            memcpy(&x, &pa->float_items[i], sizeof(x));
+            if (x == 0.0) {
+                x = 0.0;
+            }
+            _pw_hash_buffer(ctx, &x, sizeof(x));
+        }
+        return;
+    }
+    _pw_hash_buffer(ctx, pa->bits, used_memsize(pa));
+}
+
+[[nodiscard]] static bool packed_array_deepcopy(PwValuePtr self, PwValuePtr result)
+{
+    _PwPackedArray* src = get_packed_array_data_ptr(self);
+    PwPackedArrayCtorArgs args = {
+        .item_type = src->item_type,
+        .capacity  = src->length
+    };
+    if (!pw_create2(self->type_id, &args, result)) {
+        return false;
+    }
+    _PwPackedArray* dest = get_packed_array_data_ptr(result);
+    memcpy(dest->bits, src->bits, used_memsize(src));
+    dest->length = src->length;
+    return true;
+}
+
+static void packed_array_dump(PwValuePtr self, FILE* fp, int first_indent, int next_indent, _PwCompoundChain* tail)
+{
+    _pw_dump_start(fp, self, first_indent);
+    _pw_dump_struct_data(fp, self);
+    _PwPackedArray* pa = get_packed_array_data_ptr(self);
+    fprintf(fp, " %u items of %s, capacity=%u\n", pa->length, _pw_types[pa->item_type]->name, pa->capacity);
+}
+
+[[nodiscard]] static bool packed_array_is_true(PwValuePtr self)
+{
+    return get_packed_array_data_ptr(self)->length;
+}
+
+[[nodiscard]] static bool packed_array_eq(_PwPackedArray* a, _PwPackedArray* b)
+{
+    if (a->item_type != b->item_type || a->length != b->length) {
+        return false;
+    }
+    if (a->item_type == PwTypeId_Float) {
+        // compare numerically, not bitwise
+        for (unsigned i = 0; i < a->length; i++) {
+            double x, y;
+            memcpy(&x, &a->float_items[i], sizeof(x));
+            memcpy(&y, &b->float_items[i], sizeof(y));
+            if (x != y) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return memcmp(a->bits, b->bits, used_memsize(a)) == 0;
+}
+
+[[nodiscard]] static bool packed_array_equal_sametype(PwValuePtr self, PwValuePtr other)
+{
+    return packed_array_eq(get_packed_array_data_ptr(self), get_packed_array_data_ptr(other));
+}
+
+[[nodiscard]] static bool packed_array_equal(PwValuePtr self, PwValuePtr other)
+{
+    PwTypeId t = other->type_id;
+    for (;;) {
+        if (t == PwTypeId_PackedArray) {
+            return packed_array_eq(get_packed_array_data_ptr(self), get_packed_array_data_ptr(other));
+        }
+        // check base type
+        t = _pw_types[t]->ancestor_id;
+        if (t == PwTypeId_Null) {
+            return false;
+        }
+    }
+}
+
+/****************************************************************
+ * Packed array functions
+ */
+
+[[nodiscard]] bool pw_packed_array_from_array(PwValuePtr array, PwTypeId item_type, PwValuePtr result)
+{
+    pw_assert_array(array);
+    PwPackedArrayCtorArgs args = {
+        .item_type = item_type,
+        .capacity  = pw_array_length(array)
+    };
+    if (!pw_create2(PwTypeId_PackedArray, &args, result)) {
+        return false;
+    }
+    _PwPackedArray* pa = get_packed_array_data_ptr(result);
+    PwArrayCursor cursor = pw_array_cursor(array);
+    while (pw_array_cursor_next(&cursor)) {
+        uint64_t raw;
+        if (!to_raw(item_type, cursor.item, &raw)) {
+            pw_destroy(result);
+            return false;
+        }
+        set_raw(pa, pa->length++, raw);
+    }
+    return true;
+}
+
+[[nodiscard]] bool pw_packed_array_to_array(PwValuePtr packed_array, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    PwArrayCtorArgs args = {
+        .capacity = pa->length
+    };
+    if (!pw_create2(PwTypeId_Array, &args, result)) {
+        return false;
+    }
+    for (unsigned i = 0; i < pa->length; i++) {{
+        PwValue item = PW_NULL;
+        from_raw(pa->item_type, get_raw(pa, i), &item);
+        if (!pw_array_append(result, &item)) {
+            pw_destroy(result);
+            return false;
+        }
+    }}
+    return true;
+}
+
+[[nodiscard]] bool _pw_packed_array_append(PwValuePtr packed_array, PwValuePtr item)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    uint64_t raw;
+    if (!to_raw(pa->item_type, item, &raw)) {
+        return false;
+    }
+    if (!grow(packed_array->type_id, pa)) {
+        return false;
+    }
+    set_raw(pa, pa->length++, raw);
+    return true;
+}
+
+[[nodiscard]] bool pw_packed_array_item(PwValuePtr packed_array, unsigned index, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    if (index >= pa->length) {
+        pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+        return false;
+    }
+    from_raw(pa->item_type, get_raw(pa, index), result);
+    return true;
+}
+
+[[nodiscard]] bool pw_packed_array_set_item(PwValuePtr packed_array, unsigned index, PwValuePtr item)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    if (index >= pa->length) {
+        pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+        return false;
+    }
+    uint64_t raw;
+    if (!to_raw(pa->item_type, item, &raw)) {
+        return false;
+    }
+    set_raw(pa, index, raw);
+    return true;
+}
+
+void pw_packed_array_del(PwValuePtr packed_array, unsigned start_index, unsigned end_index)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    if (end_index > pa->length) {
+        end_index = pa->length;
+    }
+    if (start_index >= end_index) {
+        return;
+    }
+    unsigned new_length = pa->length - (end_index - start_index);
+    if (pa->item_type == PwTypeId_Bool) {
+        for (unsigned i = start_index; i < new_length; i++) {
+            set_bit(pa->bits, i, get_bit(pa->bits, i + end_index - start_index));
+        }
+        for (unsigned i = new_length; i < pa->length; i++) {
+            set_bit(pa->bits, i, false);
+        }
+    } else {
+        memmove(&pa->unsigned_items[start_index], &pa->unsigned_items[end_index],
+                (pa->length - end_index) * sizeof(uint64_t));
+    }
+    pa->length = new_length;
+}
+
+unsigned pw_packed_array_length(PwValuePtr packed_array)
+{
+    pw_assert_packed_array(packed_array);
+    return get_packed_array_data_ptr(packed_array)->length;
+}
+
+[[nodiscard]] bool pw_packed_array_sum(PwValuePtr packed_array, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    pw_destroy(result);
+    switch (pa->item_type) {
+        case PwTypeId_Bool:
+            *result = PwUnsigned(count_bits(pa->bits, pa->length));
+            return true;
+        case PwTypeId_Signed:
+            *result = PwSigned((int64_t) sum_unsigned(pa->unsigned_items, pa->length));
+            return true;
+        case PwTypeId_Unsigned:
+            *result = PwUnsigned(sum_unsigned(pa->unsigned_items, pa->length));
+            return true;
+        case PwTypeId_Float:
+            *result = PwFloat(sum_float(pa->float_items, pa->length));
+            return true;
+        default:
+            pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+            return false;
+    }
+}
+
+[[nodiscard]] bool pw_packed_array_mean(PwValuePtr packed_array, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    if (pa->length == 0) {
+        pw_set_status(PwStatus(PW_ERROR_EXTRACT_FROM_EMPTY_ARRAY));
+        return false;
+    }
+    double sum;
+    switch (pa->item_type) {
+        case PwTypeId_Bool:     sum = count_bits(pa->bits, pa->length); break;
+        case PwTypeId_Signed:   sum = (double) (int64_t) sum_unsigned(pa->unsigned_items, pa->length); break;
+        case PwTypeId_Unsigned: sum = (double) sum_unsigned(pa->unsigned_items, pa->length); break;
+        case PwTypeId_Float:    sum = sum_float(pa->float_items, pa->length); break;
+        default:
+            pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+            return false;
+    }
+    pw_destroy(result);
+    *result = PwFloat(sum / pa->length);
+    return true;
+}
+
+[[nodiscard]] static bool minmax(PwValuePtr packed_array, bool is_max, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    if (pa->length == 0) {
+        pw_set_status(PwStatus(PW_ERROR_EXTRACT_FROM_EMPTY_ARRAY));
+        return false;
+    }
+    uint64_t raw;
+    switch (pa->item_type) {
+        case PwTypeId_Bool: {
+            unsigned count = count_bits(pa->bits, pa->length);
+            raw = is_max? count != 0 : count == pa->length;
+            break;
+        }
+        case PwTypeId_Signed: {
+            int64_t v = is_max? max_signed(pa->signed_items, pa->length)
+                              : min_signed(pa->signed_items, pa->length);
+            raw = (uint64_t) v;
+            break;
+        }
+        case PwTypeId_Unsigned:
+        case PwTypeId_Timestamp:
+            raw = is_max? max_unsigned(pa->unsigned_items, pa->length)
+                        : min_unsigned(pa->unsigned_items, pa->length);
+            break;
+        case PwTypeId_Float: {
+            double v = is_max? max_float(pa->float_items, pa->length)
+                             : min_float(pa->float_items, pa->length);
+            memcpy(&raw, &v, sizeof(raw));
+            break;
+        }
+        default:
+            pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+            return false;
+    }
+    from_raw(pa->item_type, raw, result);
+    return true;
+}
+
+[[nodiscard]] bool pw_packed_array_min(PwValuePtr packed_array, PwValuePtr result)
+{
+    return minmax(packed_array, false, result);
+}
+
+[[nodiscard]] bool pw_packed_array_max(PwValuePtr packed_array, PwValuePtr result)
+{
+    return minmax(packed_array, true, result);
+}
+
+[[nodiscard]] static bool create_like(PwTypeId item_type, unsigned length, PwValuePtr result)
+/*
+ * Create packed array of `item_type` for `length` items.
+ */
+{
+    PwPackedArrayCtorArgs args = {
+        .item_type = item_type,
+        .capacity  = length
+    };
+    return pw_create2(PwTypeId_PackedArray, &args, result);
+}
+
+[[nodiscard]] bool pw_packed_array_compare(PwValuePtr packed_array, uint8_t op, PwValuePtr operand, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    if (op > PW_CMP_GT) {
+        pw_set_status(PwStatus(PW_ERROR), "Bad comparison operator %u", op);
+        return false;
+    }
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    uint64_t raw;
+    if (!to_raw(pa->item_type, operand, &raw)) {
+        return false;
+    }
+    if (!create_like(PwTypeId_Bool, pa->length, result)) {
+        return false;
+    }
+    _PwPackedArray* mask = get_packed_array_data_ptr(result);
+    switch (pa->item_type) {
+        case PwTypeId_Bool:
+            compare_bool(pa->bits, pa->length, raw, op, mask->bits);
+            break;
+        case PwTypeId_Signed:
+            compare_signed[op](pa->signed_items, pa->length, (int64_t) raw, mask->bits);
+            break;
+        case PwTypeId_Unsigned:
+        case PwTypeId_Timestamp:
+            compare_unsigned[op](pa->unsigned_items, pa->length, raw, mask->bits);
+            break;
+        case PwTypeId_Float: {
+            double f;
+            memcpy(&f, &raw, sizeof(f));
+            compare_float[op](pa->float_items, pa->length, f, mask->bits);
+            break;
+        }
+        default:
+            break;
+    }
+    mask->length = pa->length;
+    return true;
+}
+
+[[nodiscard]] bool pw_packed_array_filter(PwValuePtr packed_array, PwValuePtr mask, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    pw_assert_packed_array(mask);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    _PwPackedArray* m = get_packed_array_data_ptr(mask);
+    if (m->item_type != PwTypeId_Bool) {
+        pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+        return false;
+    }
+    if (m->length != pa->length) {
+        pw_set_status(PwStatus(PW_ERROR), "Mask length %u does not match array length %u", m->length, pa->length);
+        return false;
+    }
+    if (!create_like(pa->item_type, count_bits(m->bits, m->length), result)) {
+        return false;
+    }
+    _PwPackedArray* dest = get_packed_array_data_ptr(result);
+    unsigned num_words = (m->length + 63) / 64;
+    unsigned n = 0;
+    for (unsigned w = 0; w < num_words; w++) {
+        // skip empty words and iterate set bits only
+        for (uint64_t word = m->bits[w]; word; word &= word - 1) {
+            unsigned i = w * 64 + __builtin_ctzll(word);
+            set_raw(dest, n++, get_raw(pa, i));
+        }
+    }
+    dest->length = n;
+    return true;
+}
+
+[[nodiscard]] bool pw_packed_array_gather(PwValuePtr packed_array, PwValuePtr indices, PwValuePtr result)
+{
+    pw_assert_packed_array(packed_array);
+    pw_assert_packed_array(indices);
+    _PwPackedArray* pa = get_packed_array_data_ptr(packed_array);
+    _PwPackedArray* ix = get_packed_array_data_ptr(indices);
+    if (ix->item_type != PwTypeId_Unsigned && ix->item_type != PwTypeId_Signed) {
+        pw_set_status(PwStatus(PW_ERROR_INCOMPATIBLE_TYPE));
+        return false;
+    }
+    if (!create_like(pa->item_type, ix->length, result)) {
+        return false;
+    }
+    _PwPackedArray* dest = get_packed_array_data_ptr(result);
+    for (unsigned i = 0; i < ix->length; i++) {
+        // negative signed indices become huge unsigned ones and fail the check
+        uint64_t index = get_raw(ix, i);
+        if (index >= pa->length) {
+            pw_destroy(result);
+            pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+            return false;
+        }
+        set_raw(dest, i, get_raw(pa, index));
+    }
+    dest->length = ix->length;
+    return true;
+}
+
+/****************************************************************
+ * RandomAccess interface
+ */
+
+[[nodiscard]] static bool key_to_index(PwValuePtr self, PwValuePtr key, unsigned* result)
+/*
+ * Convert key to unsigned index, negative keys are counted from the end.
+ * The index is range-checked in 64 bits before narrowing.
+ */
+{
+    PwValue index = PW_NULL;
+    if (!_pw_array_key_to_index(key, &index)) {
+        return false;
+    }
+    unsigned length = get_packed_array_data_ptr(self)->length;
+    if (pw_is_signed(&index)) {
+        PwType_Signed i = index.signed_value;
+        if (i < 0) {
+            i += length;
+        }
+        if (i < 0 || i >= (PwType_Signed) length) {
+            pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+            return false;
+        }
+        *result = (unsigned) i;
+        return true;
+    }
+    if (index.unsigned_value >= length) {
+        pw_set_status(PwStatus(PW_ERROR_INDEX_OUT_OF_RANGE));
+        return false;
+    }
+    *result = (unsigned) index.unsigned_value;
+    return true;
+}
+
+[[nodiscard]] static bool ra_get_item(PwValuePtr self, PwValuePtr key, PwValuePtr result)
+{
+    unsigned index;
+    if (!key_to_index(self, key, &index)) {
+        return false;
+    }
+    return pw_packed_array_item(self, index, result);
+}
+
+[[nodiscard]] static bool ra_set_item(PwValuePtr self, PwValuePtr key, PwValuePtr value)
+{
+    unsigned index;
+    if (!key_to_index(self, key, &index)) {
+        return false;
+    }
+    return pw_packed_array_set_item(self, index, value);
+}
+
+[[nodiscard]] static bool ra_delete_item(PwValuePtr self, PwValuePtr key)
+{
+    unsigned index;
+    if (!key_to_index(self, key, &index)) {
+        return false;
+    }
+    pw_packed_array_del(self, index, index + 1);
+    return true;
+}
+
+static PwInterface_RandomAccess random_access_interface = {
+    .length      = pw_packed_array_length,
+    .get_item    = ra_get_item,
+    .set_item    = ra_set_item,
+    .delete_item = ra_delete_item
+};
+
+/****************************************************************
+ * Initialization
+ */
+
+[[ gnu::constructor ]]
+void _pw_init_packed_array()
+{
+    if (PwTypeId_PackedArray == 0) {
+
+        PwTypeId_PackedArray = pw_struct_subtype(
+            &packed_array_type, "PackedArray", PwTypeId_Struct, _PwPackedArray,
+            PwInterfaceId_RandomAccess, &random_access_interface
+        );
+        packed_array_type.hash           = packed_array_hash;
+        packed_array_type.deepcopy       = packed_array_deepcopy;
+        packed_array_type.dump           = packed_array_dump;
+        packed_array_type.is_true        = packed_array_is_true;
+        packed_array_type.equal_sametype = packed_array_equal_sametype;
+        packed_array_type.equal          = packed_array_equal;
+        packed_array_type.init           = packed_array_init;
+        packed_array_type.fini           = packed_array_fini;
+    }
+}
@@ -0,0 +1,122 @@
+#include <limits.h>
+#include <time.h>
+
+#include "include/pw.h"
+#include "src/pw_compound_internal.h"
+#include "src/pw_map_internal.h"
+#include "src/pw_struct_internal.h"
+
+#define INITIAL_QUEUE_CAPACITY  16
+
+static unsigned min_deferred_items = 0;  // zero: deferred release disabled
+
+static struct {
+    _PwValue* items;  // used as a stack, nested values are released before their parents
+    unsigned length;
+    unsigned capacity;
+} queue = { nullptr, 0, 0 };
+
+static uint64_t num_deferred = 0;
+static uint64_t num_reclaimed = 0;
+static uint64_t items_reclaimed = 0;
+static double reclaim_seconds = 0.0;
+
+static _PwArray* get_items(PwValuePtr value)
+/*
+ * Return array of items if value supports deferred release, nullptr otherwise.
+ */
+{
+    if (pw_is_map(value) || pw_is_set(value)) {
+        // sets are stored as maps but are not subtypes of Map
+        return &((_PwMap*) value->struct_data)->kv_pairs;
+    }
+    if (pw_is_array(value)) {
+        return get_array_struct_ptr(value);
+    }
+    return nullptr;
+}
+
+void pw_set_deferred_release(unsigned min_items)
+{
+    min_deferred_items = min_items;
+}
+
+bool _pw_defer_release(PwValuePtr value)
+{
+    if (min_deferred_items == 0) {
+        return false;
+    }
+    _PwArray* items = get_items(value);
+    if (!items || items->length < min_deferred_items) {
+        return false;
+    }
+    if (queue.length == queue.capacity) {
+        unsigned old_size = queue.capacity * sizeof(_PwValue);
+        unsigned new_capacity = queue.capacity? queue.capacity * 2 : INITIAL_QUEUE_CAPACITY;
+        if (!default_allocator.reallocate((void**) &queue.items, old_size, new_capacity * sizeof(_PwValue), false, nullptr)) {
+            // release synchronously
+            return false;
+        }
+        queue.capacity = new_capacity;
+    }
+    queue.items[queue.length++] = *value;
+    num_deferred++;
+    return true;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+bool pw_reclaim(unsigned budget)
+{
+    double start = now();
+    unsigned done = 0;
+
+    while (queue.length && done < budget) {
+        // work on a copy because destroying items may grow the queue
+        _PwValue value = queue.items[queue.length - 1];
+        _PwArray* items = get_items(&value);
+        if (items->length) {
+            unsigned n = budget - done;
+            unsigned start_index = (items->length > n)? items->length - n : 0;
+            if (pw_is_map(&value) || pw_is_set(&value)) {
+                // keep key-value pairs whole, sets have entry_shift 0
+                start_index &= ~((1U << ((_PwMap*) value.struct_data)->entry_shift) - 1);
+            }
+            done += items->length - start_index;
+            _pw_array_del(items, start_index, items->length, &value);
+        } else {
+            // all items are destroyed
+            queue.length--;
+            _pw_struct_release(&value);
+            num_reclaimed++;
+            done++;
+        }
+    }
+    if (queue.length == 0 && queue.items) {
+        // the queue is rarely needed, don't keep the memory
+        default_allocator.release((void**) &queue.items, queue.capacity * sizeof(_PwValue));
+        queue.capacity = 0;
+    }
+    items_reclaimed += done;
+    reclaim_seconds += now() - start;
+    return queue.length == 0;
+}
+
+void pw_reclaim_all()
+{
+    while (!pw_reclaim(UINT_MAX)) {}
+}
+
+void pw_reclaim_stats(PwReclaimStats* stats)
+{
+    stats->queue_length    = queue.length;
+    stats->num_deferred    = num_deferred;
+    stats->num_reclaimed   = num_reclaimed;
+    stats->items_reclaimed = items_reclaimed;
+    stats->reclaim_rate    = (reclaim_seconds > 0.0)? items_reclaimed / reclaim_seconds : 0.0;
+}
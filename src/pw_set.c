@@ -0,0 +1,526 @@
+#include <string.h>
+
+#include "include/pw.h"
+#include "src/pw_alloc.h"
+#include "src/pw_compound_internal.h"
+#include "src/pw_map_internal.h"
+#include "src/pw_struct_internal.h"
+
+/*
+ * Set is stored as _PwMap with entry_shift 0: kv_pairs contains keys only,
+ * so key_index, entry index, and index in hashes are the same.
+ */
+
+#define get_data_ptr(value)  ((_PwMap*) ((value)->struct_data))
+
+[[nodiscard]] bool _pw_set_va(PwValuePtr result, ...)
+{
+    va_list ap;
+    va_start(ap);
+    if (!pw_create_set(result)) {
+        _pw_destroy_args(ap);
+        va_end(ap);
+        return false;
+    }
+    bool ret = pw_set_add_ap(result, ap);
+    va_end(ap);
+    return ret;
+}
+
+static inline PwType_Hash get_item_hash(_PwMap* set, unsigned key_index)
+/*
+ * Return hash of item, small sets do not store hashes.
+ */
+{
+    if (_pw_map_is_small(set)) {
+        return pw_hash(&set->kv_pairs.items[key_index]);
+    }
+    return set->hashes[key_index];
+}
+
+[[nodiscard]] static bool add_hashed(PwValuePtr self, PwValuePtr item, PwType_Hash item_hash)
+/*
+ * Add clone of item if it is not in the set yet.
+ * item must be already deeply copied, i.e. taken from another set.
+ */
+{
+    _PwMap* set = get_data_ptr(self);
+    if (_pw_map_find(set, item, item_hash) != UINT_MAX) {
+        return true;
+    }
+    PwValue key = pw_clone(item);
+    return _pw_map_insert(self, &key, item_hash, nullptr, 0);
+}
+
+[[nodiscard]] static bool copy_set(PwValuePtr src, unsigned capacity, PwValuePtr result)
+/*
+ * Create set of given capacity and copy all items from `src`.
+ */
+{
+    _PwMap* src_set = get_data_ptr(src);
+    PwMapCtorArgs args = {
+        .engine   = src_set->engine,
+        .capacity = capacity,
+        .acyclic  = src_set->compound_data.acyclic
+    };
+    if (!pw_create2(PwTypeId_Set, &args, result)) {
+        return false;
+    }
+    unsigned length = _pw_array_length(&src_set->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {{
+        PwValuePtr item = &src_set->kv_pairs.items[i];
+        if (_pw_map_is_deleted(item)) {
+            continue;
+        }
+        // okay to clone because items are already deeply copied
+        PwValue key = pw_clone(item);
+        if (!_pw_map_insert(result, &key, get_item_hash(src_set, i), nullptr, 0)) {
+            return false;
+        }
+    }}
+    return true;
+}
+
+/****************************************************************
+ * Basic interface methods
+ */
+
+[[nodiscard]] static bool set_init(PwValuePtr self, void* ctor_args)
+{
+    return _pw_map_init_data(self, ctor_args, 0);
+}
+
+static void set_hash(PwValuePtr self, PwHashContext* ctx)
+{
+    _pw_hash_uint64(ctx, self->type_id);
+
+    // equal sets may have different order of items,
+    // so combine hashes of items with commutative operation
+    _PwMap* set = get_data_ptr(self);
+    PwType_Hash sum = 0;
+    unsigned length = _pw_array_length(&set->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {
+        if (!_pw_map_is_deleted(&set->kv_pairs.items[i])) {
+            sum += get_item_hash(set, i);
+        }
+    }
+    _pw_hash_uint64(ctx, sum);
+}
+
+[[nodiscard]] static bool set_deepcopy(PwValuePtr self, PwValuePtr result)
+{
+    return copy_set(self, _pw_map_length(get_data_ptr(self)), result);
+}
+
+static void set_dump(PwValuePtr self, FILE* fp, int first_indent, int next_indent, _PwCompoundChain* tail)
+{
+    _pw_dump_start(fp, self, first_indent);
+    _pw_dump_struct_data(fp, self);
+    _pw_dump_compound_data(fp, self, next_indent);
+    _pw_print_indent(fp, next_indent);
+
+    PwValuePtr value_seen = _pw_on_chain(self, tail);
+    if (value_seen) {
+        fprintf(fp, "already dumped: %p, data=%p\n", (void*) value_seen, (void*) value_seen->struct_data);
+        return;
+    }
+
+    _PwCompoundChain this_link = {
+        .prev = tail,
+        .value = self
+    };
+
+    _PwMap* set = get_data_ptr(self);
+    fprintf(fp, "%u items, %u deleted, array items/capacity=%u/%u\n",
+            _pw_map_length(set), set->num_deleted,
+            _pw_array_length(&set->kv_pairs), _pw_array_capacity(&set->kv_pairs));
+
+    next_indent += 4;
+    unsigned length = _pw_array_length(&set->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {
+        PwValuePtr item = &set->kv_pairs.items[i];
+        if (!_pw_map_is_deleted(item)) {
+            _pw_call_dump(fp, item, next_indent, next_indent, &this_link);
+        }
+    }
+
+    _pw_print_indent(fp, next_indent);
+    struct _PwHashTable* ht = &set->hash_table;
+    if (_pw_map_is_small(set)) {
+        fputs("small set, no hash table\n", fp);
+    } else {
+        fprintf(fp, "%s hash table item size %u, capacity=%u\n",
+                (set->engine == PW_MAP_ENGINE_SWISS)? "Swiss" : "linear probing",
+                ht->item_size, ht->capacity);
+    }
+}
+
+[[nodiscard]] static bool set_to_string(PwValuePtr self, PwValuePtr result)
+{
+    pw_set_status(PwStatus(PW_ERROR_NOT_IMPLEMENTED));
+    return false;
+}
+
+[[nodiscard]] static bool set_is_true(PwValuePtr self)
+{
+    return _pw_map_length(get_data_ptr(self));
+}
+
+[[nodiscard]] static bool set_eq(_PwMap* a, _PwMap* b)
+/*
+ * Sets are equal if they have the same items regardless of the order.
+ */
+{
+    if (_pw_map_length(a) != _pw_map_length(b)) {
+        return false;
+    }
+    unsigned length = _pw_array_length(&a->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {
+        PwValuePtr item = &a->kv_pairs.items[i];
+        if (_pw_map_is_deleted(item)) {
+            continue;
+        }
+        if (_pw_map_find(b, item, get_item_hash(a, i)) == UINT_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] static bool set_equal_sametype(PwValuePtr self, PwValuePtr other)
+{
+    return set_eq(get_data_ptr(self), get_data_ptr(other));
+}
+
+[[nodiscard]] static bool set_equal(PwValuePtr self, PwValuePtr other)
+{
+    PwTypeId t = other->type_id;
+    for (;;) {
+        if (t == PwTypeId_Set) {
+            return set_eq(get_data_ptr(self), get_data_ptr(other));
+        }
+        // check base type
+        t = _pw_types[t]->ancestor_id;
+        if (t == PwTypeId_Null) {
+            return false;
+        }
+    }
+}
+
+PwType _pw_set_type = {
+    .id             = PwTypeId_Set,
+    .ancestor_id    = PwTypeId_Compound,
+    .name           = "Set",
+    .allocator      = &default_allocator,
+
+    .create         = _pw_struct_create,
+    .destroy        = _pw_compound_destroy,
+    .clone          = _pw_struct_clone,
+    .hash           = set_hash,
+    .deepcopy       = set_deepcopy,
+    .dump           = set_dump,
+    .to_string      = set_to_string,
+    .is_true        = set_is_true,
+    .equal_sametype = set_equal_sametype,
+    .equal          = set_equal,
+
+    .data_size      = sizeof(_PwMap),
+
+    .init           = set_init,
+    .fini           = _pw_map_fini_data
+};
+
+
+/****************************************************************
+ * set functions
+ */
+
+[[nodiscard]] bool _pw_set_add(PwValuePtr self, PwValuePtr item)
+{
+    pw_assert_set(self);
+    _PwMap* set = get_data_ptr(self);
+    if (set->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+
+    // lookup item in the set, hash is computed only once
+
+    PwType_Hash key_hash;
+    unsigned ht_offset;
+    if (_pw_map_lookup(set, item, &key_hash, &ht_offset) != UINT_MAX) {
+        return true;
+    }
+    PwValue key = PW_NULL;
+    if (!pw_deepcopy(item, &key)) {  // deep copy item for immutability
+        return false;
+    }
+    return _pw_map_insert(self, &key, key_hash, nullptr, ht_offset);
+}
+
+[[nodiscard]] bool pw_set_add_ap(PwValuePtr self, va_list ap)
+{
+    pw_assert_set(self);
+    for (;;) {{
+        PwValue item = va_arg(ap, _PwValue);
+        if (pw_is_status(&item)) {
+            if (pw_is_va_end(&item)) {
+                return true;
+            }
+            pw_set_status(pw_clone(&item));
+            break;
+        }
+        if (!_pw_set_add(self, &item)) {
+            break;
+        }
+    }}
+    // consume args
+    _pw_destroy_args(ap);
+    return false;
+}
+
+bool _pw_set_contains(PwValuePtr self, PwValuePtr item)
+{
+    pw_assert_set(self);
+    PwType_Hash key_hash;
+    unsigned ht_offset;
+    return _pw_map_lookup(get_data_ptr(self), item, &key_hash, &ht_offset) != UINT_MAX;
+}
+
+[[nodiscard]] bool _pw_set_remove(PwValuePtr self, PwValuePtr item)
+{
+    pw_assert_set(self);
+    _PwMap* set = get_data_ptr(self);
+    if (set->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    PwType_Hash key_hash;
+    unsigned ht_offset;
+    unsigned key_index = _pw_map_lookup(set, item, &key_hash, &ht_offset);
+    if (key_index == UINT_MAX) {
+        pw_set_status(PwStatus(PW_ERROR_KEY_NOT_FOUND));
+        return false;
+    }
+    _pw_map_delete(self, set, key_index);
+    return true;
+}
+
+[[nodiscard]] bool pw_set_update(PwValuePtr self, PwValuePtr items)
+{
+    pw_assert_set(self);
+    _PwMap* set = get_data_ptr(self);
+    if (set->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    if (pw_is_set(items)) {
+        if (items->struct_data == self->struct_data) {
+            return true;
+        }
+        _PwMap* src_set = get_data_ptr(items);
+        if (!pw_set_reserve(self, _pw_map_length(set) + _pw_map_length(src_set))) {
+            return false;
+        }
+        unsigned length = _pw_array_length(&src_set->kv_pairs);
+        for (unsigned i = 0; i < length; i++) {
+            PwValuePtr item = &src_set->kv_pairs.items[i];
+            if (!_pw_map_is_deleted(item)) {
+                if (!add_hashed(self, item, get_item_hash(src_set, i))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    pw_assert_array(items);
+    if (!pw_set_reserve(self, _pw_map_length(set) + pw_array_length(items))) {
+        return false;
+    }
+    PwArrayCursor cursor = pw_array_cursor(items);
+    while (pw_array_cursor_next(&cursor)) {
+        if (!_pw_set_add(self, cursor.item)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool pw_set_union(PwValuePtr a, PwValuePtr b, PwValuePtr result)
+{
+    pw_assert_set(a);
+    pw_assert_set(b);
+    if (_pw_map_length(get_data_ptr(a)) < _pw_map_length(get_data_ptr(b))) {
+        PwValuePtr tmp = a;
+        a = b;
+        b = tmp;
+    }
+    // copy larger set without probing, then add missing items of smaller one
+    _PwMap* small = get_data_ptr(b);
+    if (!copy_set(a, _pw_map_length(get_data_ptr(a)) + _pw_map_length(small), result)) {
+        return false;
+    }
+    unsigned length = _pw_array_length(&small->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {
+        PwValuePtr item = &small->kv_pairs.items[i];
+        if (!_pw_map_is_deleted(item)) {
+            if (!add_hashed(result, item, get_item_hash(small, i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] bool pw_set_intersection(PwValuePtr a, PwValuePtr b, PwValuePtr result)
+{
+    pw_assert_set(a);
+    pw_assert_set(b);
+    _PwMap* small = get_data_ptr(a);
+    _PwMap* large = get_data_ptr(b);
+    if (_pw_map_length(small) > _pw_map_length(large)) {
+        _PwMap* tmp = small;
+        small = large;
+        large = tmp;
+    }
+    PwMapCtorArgs args = {
+        .engine   = small->engine,
+        .capacity = _pw_map_length(small),
+        .acyclic  = small->compound_data.acyclic
+    };
+    if (!pw_create2(PwTypeId_Set, &args, result)) {
+        return false;
+    }
+    unsigned length = _pw_array_length(&small->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {{
+        PwValuePtr item = &small->kv_pairs.items[i];
+        if (_pw_map_is_deleted(item)) {
+            continue;
+        }
+        PwType_Hash item_hash = get_item_hash(small, i);
+        if (_pw_map_find(large, item, item_hash) != UINT_MAX) {
+            PwValue key = pw_clone(item);
+            if (!_pw_map_insert(result, &key, item_hash, nullptr, 0)) {
+                return false;
+            }
+        }
+    }}
+    return true;
+}
+
+[[nodiscard]] bool pw_set_difference(PwValuePtr a, PwValuePtr b, PwValuePtr result)
+{
+    pw_assert_set(a);
+    pw_assert_set(b);
+    _PwMap* set_a = get_data_ptr(a);
+    _PwMap* set_b = get_data_ptr(b);
+    unsigned length;
+
+    if (_pw_map_length(set_b) < _pw_map_length(set_a)) {
+        // copy `a` and remove items of smaller `b`
+        if (!copy_set(a, _pw_map_length(set_a), result)) {
+            return false;
+        }
+        _PwMap* set_r = get_data_ptr(result);
+        length = _pw_array_length(&set_b->kv_pairs);
+        for (unsigned i = 0; i < length; i++) {
+            PwValuePtr item = &set_b->kv_pairs.items[i];
+            if (_pw_map_is_deleted(item)) {
+                continue;
+            }
+            unsigned key_index = _pw_map_find(set_r, item, get_item_hash(set_b, i));
+            if (key_index != UINT_MAX) {
+                _pw_map_delete(result, set_r, key_index);
+            }
+        }
+        return true;
+    }
+
+    // iterate `a` and probe larger `b`
+    PwMapCtorArgs args = {
+        .engine   = set_a->engine,
+        .capacity = _pw_map_length(set_a),
+        .acyclic  = set_a->compound_data.acyclic
+    };
+    if (!pw_create2(PwTypeId_Set, &args, result)) {
+        return false;
+    }
+    length = _pw_array_length(&set_a->kv_pairs);
+    for (unsigned i = 0; i < length; i++) {{
+        PwValuePtr item = &set_a->kv_pairs.items[i];
+        if (_pw_map_is_deleted(item)) {
+            continue;
+        }
+        PwType_Hash item_hash = get_item_hash(set_a, i);
+        if (_pw_map_find(set_b, item, item_hash) == UINT_MAX) {
+            PwValue key = pw_clone(item);
+            if (!_pw_map_insert(result, &key, item_hash, nullptr, 0)) {
+                return false;
+            }
+        }
+    }}
+    return true;
+}
+
+[[nodiscard]] bool pw_set_reserve(PwValuePtr self, unsigned capacity)
+{
+    pw_assert_set(self);
+    _PwMap* set = get_data_ptr(self);
+    if (set->kv_pairs.itercount) {
+        pw_set_status(PwStatus(PW_ERROR_ITERATION_IN_PROGRESS));
+        return false;
+    }
+    return _pw_map_reserve(self->type_id, set, capacity);
+}
+
+unsigned pw_set_length(PwValuePtr self)
+{
+    pw_assert_set(self);
+    return _pw_map_length(get_data_ptr(self));
+}
+
+[[nodiscard]] _PwSetCursor pw_set_cursor(PwValuePtr self)
+{
+    pw_assert_set(self);
+    _PwMap* set = get_data_ptr(self);
+
+    // kv_pairs cannot be modified until cursor is stopped
+    set->kv_pairs.itercount++;
+
+    return (_PwSetCursor) {
+        .set = pw_clone(self)
+    };
+}
+
+[[nodiscard]] bool pw_set_cursor_next(_PwSetCursor* cursor)
+{
+    if (cursor->set.type_id == PwTypeId_Null) {
+        return false;
+    }
+    _PwMap* set = get_data_ptr(&cursor->set);
+    unsigned key_index = cursor->_key_index;
+    unsigned length = _pw_array_length(&set->kv_pairs);
+    PwValuePtr item = &set->kv_pairs.items[key_index];
+    while (key_index < length && _pw_map_is_deleted(item)) {
+        key_index++;
+        item++;
+    }
+    if (key_index >= length) {
+        return false;
+    }
+    if (cursor->item) {
+        cursor->index++;
+    }
+    cursor->item = item;
+    cursor->_key_index = key_index + 1;
+    return true;
+}
+
+void pw_set_cursor_stop(_PwSetCursor* cursor)
+{
+    if (cursor->set.type_id != PwTypeId_Null) {
+        get_data_ptr(&cursor->set)->kv_pairs.itercount--;
+        pw_destroy(&cursor->set);
+        cursor->item = nullptr;
+    }
+}
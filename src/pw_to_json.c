@@ -108,21 +108,18 @@ static uint8_t _S_CLOSE_CURLY[1]  = "}";
     memset(&indent_str[1], ' ', indent_width);
 
     bool multiline = indent && num_items > 1;
-    for (unsigned i = 0; i < num_items; i++) {{
-        if (i) {
+    PwArrayCursor cursor = pw_array_cursor(value);
+    while (pw_array_cursor_next(&cursor)) {
+        if (cursor.index) {
             APPEND(_S_COMMA);
         }
         if (multiline) {
             APPEND(indent_str);
         }
-        PwValue item = PW_NULL;
-        if (!pw_array_item(value, i, &item)) {
+        if (!value_to_json(cursor.item, indent, depth + multiline, result, meth_append)) {
             return false;
         }
-        if (!value_to_json(&item, indent, depth + multiline, result, meth_append)) {
-            return false;
-        }
-    }}
+    }
     if (multiline) {
         // dedent closing brace
         if (!meth_append(result, indent_str, indent_str + indent * (depth - 1) + 1, 1)) {
@@ -149,29 +146,25 @@ static uint8_t _S_CLOSE_CURLY[1]  = "}";
     memset(&indent_str[1], ' ', indent_width);
 
     bool multiline = indent && num_items > 1;
-    for (unsigned i = 0; i < num_items; i++) {{
-        PwValue k = PW_NULL;
-        PwValue v = PW_NULL;
-        if (!pw_map_item(value, i, &k, &v)) {
-            return false;
-        }
-        if (i) {
+    PwMapCursor cursor = pw_map_cursor(value);
+    while (pw_map_cursor_next(&cursor)) {
+        if (cursor.index) {
             APPEND(_S_COMMA);
         }
         if (multiline) {
             APPEND(indent_str);
         }
-        if (!escape_string(&k, result, meth_append)) {
+        if (!escape_string(cursor.key, result, meth_append)) {
             return false;
         }
         APPEND(_S_COLON);
         if (indent) {
             APPEND(_S_SPACE);
         }
-        if (!value_to_json(&v, indent, depth + multiline, result, meth_append)) {
+        if (!value_to_json(cursor.value, indent, depth + multiline, result, meth_append)) {
             return false;
         }
-    }}
+    }
     if (multiline) {
         // dedent closing brace
         if (!meth_append(result, indent_str, indent_str + indent * (depth - 1) + 1, 1)) {
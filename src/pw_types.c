@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdarg.h>
 
 #include <libpussy/mmarray.h>
@@ -72,6 +73,26 @@ static void null_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inde
     }
 }
 
+[[nodiscard]] static bool null_compare(PwValuePtr self, PwValuePtr other, int* result)
+{
+    if (pw_is_null(other)) {
+        *result = 0;
+        return true;
+    }
+    return _pw_incomparable(self, other);
+}
+
+static PwInterface_Comparison null_comparison_interface = {
+    .compare = null_compare
+};
+
+static _PwInterface null_interfaces[] = {
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &null_comparison_interface
+    }
+};
+
 static PwType null_type = {
     .id             = PwTypeId_Null,
     .ancestor_id    = PwTypeId_Null,  // no ancestor; Null can't be an ancestor for any type
@@ -85,7 +106,10 @@ static PwType null_type = {
     .to_string      = null_to_string,
     .is_true        = null_is_true,
     .equal_sametype = null_equal_sametype,
-    .equal          = null_equal
+    .equal          = null_equal,
+
+    .num_interfaces = PW_LENGTH(null_interfaces),
+    .interfaces     = null_interfaces
 };
 
 /****************************************************************
@@ -149,6 +173,26 @@ static void bool_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inde
     }
 }
 
+[[nodiscard]] static bool bool_compare(PwValuePtr self, PwValuePtr other, int* result)
+{
+    if (pw_is_bool(other)) {
+        *result = PW_CMP(self->bool_value, other->bool_value);
+        return true;
+    }
+    return _pw_incomparable(self, other);
+}
+
+static PwInterface_Comparison bool_comparison_interface = {
+    .compare = bool_compare
+};
+
+static _PwInterface bool_interfaces[] = {
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &bool_comparison_interface
+    }
+};
+
 static PwType bool_type = {
     .id             = PwTypeId_Bool,
     .ancestor_id    = PwTypeId_Null,  // no ancestor
@@ -162,7 +206,10 @@ static PwType bool_type = {
     .to_string      = bool_to_string,
     .is_true        = bool_is_true,
     .equal_sametype = bool_equal_sametype,
-    .equal          = bool_equal
+    .equal          = bool_equal,
+
+    .num_interfaces = PW_LENGTH(bool_interfaces),
+    .interfaces     = bool_interfaces
 
     // [PwInterfaceId_Logic] = &bool_type_logic_interface
 };
@@ -209,6 +256,126 @@ static void int_dump(PwValuePtr self, FILE* fp, int first_indent, int next_inden
     return false;
 }
 
+/****************************************************************
+ * Comparison of numbers
+ *
+ * Signed, Unsigned and Float values are compared by value
+ * without loss of precision.
+ */
+
+static inline int cmp_signed_unsigned(PwType_Signed a, PwType_Unsigned b)
+{
+    if (a < 0) {
+        return -1;
+    }
+    return PW_CMP((PwType_Unsigned) a, b);
+}
+
+static inline int cmp_float(PwType_Float a, PwType_Float b)
+{
+    if (isnan(a)) {
+        return isnan(b)? 0 : 1;
+    }
+    if (isnan(b)) {
+        return -1;
+    }
+    return PW_CMP(a, b);
+}
+
+static inline int cmp_float_signed(PwType_Float a, PwType_Signed b)
+{
+    if (isnan(a) || a >= 0x1p63) {
+        return 1;
+    }
+    if (a < -0x1p63) {
+        return -1;
+    }
+    // compare integral parts first, then fractional part
+    PwType_Signed i = (PwType_Signed) a;
+    if (i != b) {
+        return PW_CMP(i, b);
+    }
+    return PW_CMP(a, (PwType_Float) i);
+}
+
+static inline int cmp_float_unsigned(PwType_Float a, PwType_Unsigned b)
+{
+    if (isnan(a) || a >= 0x1p64) {
+        return 1;
+    }
+    if (a < 0) {
+        return -1;
+    }
+    PwType_Unsigned i = (PwType_Unsigned) a;
+    if (i != b) {
+        return PW_CMP(i, b);
+    }
+    return PW_CMP(a, (PwType_Float) i);
+}
+
+static PwTypeId number_type(PwTypeId t)
+/*
+ * Return the basic numeric type of `t` or Null if `t` is not a number.
+ */
+{
+    for (;;) {
+        switch (t) {
+            case PwTypeId_Null:
+            case PwTypeId_Signed:
+            case PwTypeId_Unsigned:
+            case PwTypeId_Float:
+                return t;
+            default:
+                t = _pw_types[t]->ancestor_id;
+        }
+    }
+}
+
+[[nodiscard]] static bool number_compare(PwValuePtr self, PwValuePtr other, int* result)
+{
+    PwTypeId other_type = number_type(other->type_id);
+    switch (number_type(self->type_id)) {
+        case PwTypeId_Signed:
+            switch (other_type) {
+                case PwTypeId_Signed:   *result = PW_CMP(self->signed_value, other->signed_value); return true;
+                case PwTypeId_Unsigned: *result = cmp_signed_unsigned(self->signed_value, other->unsigned_value); return true;
+                case PwTypeId_Float:    *result = -cmp_float_signed(other->float_value, self->signed_value); return true;
+                default: break;
+            }
+            break;
+        case PwTypeId_Unsigned:
+            switch (other_type) {
+                case PwTypeId_Signed:   *result = -cmp_signed_unsigned(other->signed_value, self->unsigned_value); return true;
+                case PwTypeId_Unsigned: *result = PW_CMP(self->unsigned_value, other->unsigned_value); return true;
+                case PwTypeId_Float:    *result = -cmp_float_unsigned(other->float_value, self->unsigned_value); return true;
+                default: break;
+            }
+            break;
+        case PwTypeId_Float:
+            switch (other_type) {
+                case PwTypeId_Signed:   *result = cmp_float_signed(self->float_value, other->signed_value); return true;
+                case PwTypeId_Unsigned: *result = cmp_float_unsigned(self->float_value, other->unsigned_value); return true;
+                case PwTypeId_Float:    *result = cmp_float(self->float_value, other->float_value); return true;
+                default: break;
+            }
+            break;
+        default:
+            break;
+    }
+    return _pw_incomparable(self, other);
+}
+
+static PwInterface_Comparison number_comparison_interface = {
+    .compare = number_compare
+};
+
+static _PwInterface number_interfaces[] = {
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &number_comparison_interface
+    }
+};
+
 static PwType int_type = {
     .id             = PwTypeId_Int,
     .ancestor_id    = PwTypeId_Null,  // no ancestor
@@ -226,8 +393,7 @@ static PwType int_type = {
 
     // [PwInterfaceId_Logic]      = &int_type_logic_interface,
     // [PwInterfaceId_Arithmetic] = &int_type_arithmetic_interface,
-    // [PwInterfaceId_Bitwise]    = &int_type_bitwise_interface,
-    // [PwInterfaceId_Comparison] = &int_type_comparison_interface
+    // [PwInterfaceId_Bitwise]    = &int_type_bitwise_interface
 };
 
 /****************************************************************
@@ -318,12 +484,14 @@ static PwType signed_type = {
     .to_string      = signed_to_string,
     .is_true        = signed_is_true,
     .equal_sametype = signed_equal_sametype,
-    .equal          = signed_equal
+    .equal          = signed_equal,
+
+    .num_interfaces = PW_LENGTH(number_interfaces),
+    .interfaces     = number_interfaces
 
     // [PwInterfaceId_Logic]      = &int_type_logic_interface,
     // [PwInterfaceId_Arithmetic] = &int_type_arithmetic_interface,
-    // [PwInterfaceId_Bitwise]    = &int_type_bitwise_interface,
-    // [PwInterfaceId_Comparison] = &int_type_comparison_interface
+    // [PwInterfaceId_Bitwise]    = &int_type_bitwise_interface
 };
 
 /****************************************************************
@@ -411,12 +579,14 @@ static PwType unsigned_type = {
     .to_string      = unsigned_to_string,
     .is_true        = unsigned_is_true,
     .equal_sametype = unsigned_equal_sametype,
-    .equal          = unsigned_equal
+    .equal          = unsigned_equal,
+
+    .num_interfaces = PW_LENGTH(number_interfaces),
+    .interfaces     = number_interfaces
 
     // [PwInterfaceId_Logic]      = &int_type_logic_interface,
     // [PwInterfaceId_Arithmetic] = &int_type_arithmetic_interface,
-    // [PwInterfaceId_Bitwise]    = &int_type_bitwise_interface,
-    // [PwInterfaceId_Comparison] = &int_type_comparison_interface
+    // [PwInterfaceId_Bitwise]    = &int_type_bitwise_interface
 };
 
 /****************************************************************
@@ -493,7 +663,10 @@ static PwType float_type = {
     .to_string      = float_to_string,
     .is_true        = float_is_true,
     .equal_sametype = float_equal_sametype,
-    .equal          = float_equal
+    .equal          = float_equal,
+
+    .num_interfaces = PW_LENGTH(number_interfaces),
+    .interfaces     = number_interfaces
 
     // [PwInterfaceId_Logic]      = &float_type_logic_interface,
     // [PwInterfaceId_Arithmetic] = &float_type_arithmetic_interface,
@@ -593,6 +766,50 @@ static void datetime_dump(PwValuePtr self, FILE* fp, int first_indent, int next_
     }
 }
 
+static int64_t days_from_civil(int y, unsigned m, unsigned d)
+/*
+ * Return the number of days since 1970-01-01 in proleptic Gregorian calendar.
+ */
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned) (y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t) era * 146097 + (int64_t) doe - 719468;
+}
+
+static int64_t datetime_seconds(PwValuePtr dt)
+/*
+ * Return seconds since epoch in UTC.
+ */
+{
+    int64_t days = days_from_civil(dt->year, dt->month, dt->day);
+    return days * 86400 + dt->hour * 3600 + dt->minute * 60 + dt->second - dt->gmt_offset * 60;
+}
+
+[[nodiscard]] static bool datetime_compare(PwValuePtr self, PwValuePtr other, int* result)
+{
+    if (pw_is_datetime(other)) {
+        int64_t a = datetime_seconds(self);
+        int64_t b = datetime_seconds(other);
+        *result = (a == b)? PW_CMP(self->nanosecond, other->nanosecond) : PW_CMP(a, b);
+        return true;
+    }
+    return _pw_incomparable(self, other);
+}
+
+static PwInterface_Comparison datetime_comparison_interface = {
+    .compare = datetime_compare
+};
+
+static _PwInterface datetime_interfaces[] = {
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &datetime_comparison_interface
+    }
+};
+
 static PwType datetime_type = {
     .id             = PwTypeId_DateTime,
     .ancestor_id    = PwTypeId_Null,  // no ancestor
@@ -606,7 +823,10 @@ static PwType datetime_type = {
     .to_string      = datetime_to_string,
     .is_true        = datetime_is_true,
     .equal_sametype = datetime_equal_sametype,
-    .equal          = datetime_equal
+    .equal          = datetime_equal,
+
+    .num_interfaces = PW_LENGTH(datetime_interfaces),
+    .interfaces     = datetime_interfaces
 };
 
 /****************************************************************
@@ -676,6 +896,30 @@ static void timestamp_dump(PwValuePtr self, FILE* fp, int first_indent, int next
     }
 }
 
+[[nodiscard]] static bool timestamp_compare(PwValuePtr self, PwValuePtr other, int* result)
+{
+    if (pw_is_timestamp(other)) {
+        if (self->ts_seconds == other->ts_seconds) {
+            *result = PW_CMP(self->ts_nanoseconds, other->ts_nanoseconds);
+        } else {
+            *result = PW_CMP(self->ts_seconds, other->ts_seconds);
+        }
+        return true;
+    }
+    return _pw_incomparable(self, other);
+}
+
+static PwInterface_Comparison timestamp_comparison_interface = {
+    .compare = timestamp_compare
+};
+
+static _PwInterface timestamp_interfaces[] = {
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &timestamp_comparison_interface
+    }
+};
+
 static PwType timestamp_type = {
     .id             = PwTypeId_Timestamp,
     .ancestor_id    = PwTypeId_Null,  // no ancestor
@@ -689,7 +933,10 @@ static PwType timestamp_type = {
     .to_string      = timestamp_to_string,
     .is_true        = timestamp_is_true,
     .equal_sametype = timestamp_equal_sametype,
-    .equal          = timestamp_equal
+    .equal          = timestamp_equal,
+
+    .num_interfaces = PW_LENGTH(timestamp_interfaces),
+    .interfaces     = timestamp_interfaces
 };
 
 /****************************************************************
@@ -779,6 +1026,7 @@ static PwType ptr_type = {
 extern PwType _pw_status_type;    // defined in pw_status.c
 extern PwType _pw_iterator_type;  // defined in pw_iterator.c
 extern PwType _pw_map_type;       // defined in pw_map.c
+extern PwType _pw_set_type;       // defined in pw_set.c
 
 static PwType* basic_types[] = {
     [PwTypeId_Null]      = &null_type,
@@ -796,7 +1044,8 @@ static PwType* basic_types[] = {
     [PwTypeId_Status]    = &_pw_status_type,
     [PwTypeId_Iterator]  = &_pw_iterator_type,
     [PwTypeId_Array]     = &_pw_array_type,
-    [PwTypeId_Map]       = &_pw_map_type
+    [PwTypeId_Map]       = &_pw_map_type,
+    [PwTypeId_Set]       = &_pw_set_type
 };
 
 [[ gnu::constructor ]]
@@ -114,57 +114,6 @@ APPEND_EXPAND_N_3(uint16_t, 2)
     return true;
 }
 
-/*
- * Append variants with dest expansion for UTF-8 source and dest char_size 1, 2, and 4
- */
-#define APPEND_UTF8(DEST_CHAR_TYPE, DEST_CHAR_SIZE)  \
-    [[nodiscard]] static bool append_##DEST_CHAR_SIZE##_0(  \
-        PwValuePtr dest, unsigned dest_pos, uint8_t* src_start_ptr, uint8_t* src_end_ptr)  \
-    {  \
-        uint8_t* dest_ptr = _pw_string_char_ptr(dest, dest_pos);  \
-        while (src_start_ptr < src_end_ptr) {  \
-            uint8_t* current_ptr = src_start_ptr;  \
-            char32_t c = _pw_decode_utf8_char(&src_start_ptr);  \
-            uint8_t char_size = calc_char_size(c);  \
-            if (_pw_unlikely(char_size > DEST_CHAR_SIZE)) {  \
-                if (!_pw_expand_string(dest, 0, char_size)) {  \
-                    return false;  \
-                }  \
-                StrAppend fn_append = _pw_str_append_variants[char_size][0];  \
-                return fn_append(dest, dest_pos, current_ptr, src_end_ptr);  \
-            }  \
-            *((DEST_CHAR_TYPE*) dest_ptr) = (DEST_CHAR_TYPE) c;  \
-            dest_ptr += DEST_CHAR_SIZE;  \
-            dest_pos++;  \
-        }  \
-        return true;  \
-    }
-APPEND_UTF8(uint8_t,  1)
-APPEND_UTF8(uint16_t, 2)
-APPEND_UTF8(char32_t, 4)
-
-[[nodiscard]] static bool append_3_0(PwValuePtr dest, unsigned dest_pos, uint8_t* src_start_ptr, uint8_t* src_end_ptr)
-{
-    uint8_t* dest_ptr = _pw_string_char_ptr(dest, dest_pos);
-    while (src_start_ptr < src_end_ptr) {
-        uint8_t* current_ptr = src_start_ptr;
-        char32_t c = _pw_decode_utf8_char(&src_start_ptr);
-        uint8_t char_size = calc_char_size(c);
-        if (_pw_unlikely(char_size > 3)) {
-            if (!_pw_expand_string(dest, 0, char_size)) {
-                return false;
-            }
-            StrAppend fn_append = _pw_str_append_variants[char_size][0];
-            return fn_append(dest, dest_pos, current_ptr, src_end_ptr);
-        }
-        *dest_ptr++ = (uint8_t) c; c >>= 8;
-        *dest_ptr++ = (uint8_t) c; c >>= 8;
-        *dest_ptr++ = (uint8_t) c;
-        dest_pos++;
-    }
-    return true;
-}
-
 StrAppend _pw_str_append_variants[5][5] = {
     {
         nullptr,
@@ -174,28 +123,28 @@ StrAppend _pw_str_append_variants[5][5] = {
         nullptr
     },
     {
-        append_1_0,
+        nullptr,
         append_1_1,
         append_1_2,
         append_1_3,
         append_1_4
     },
     {
-        append_2_0,
+        nullptr,
         append_2_1,
         append_2_2,
         append_2_3,
         append_2_4
     },
     {
-        append_3_0,
+        nullptr,
         append_3_1,
         append_3_2,
         append_3_3,
         append_3_4
     },
     {
-        append_4_0,
+        nullptr,
         append_4_1,
         append_4_2,
         append_4_3,
@@ -246,27 +195,35 @@ StrAppend _pw_str_append_variants[5][5] = {
 {
     pw_assert_string(dest);
 
-    uint8_t src_char_size = 1;
-    size_t src_len;
-    if (end_ptr) {
-        src_len = end_ptr - start_ptr;
-    } else {
-        src_len = utf8_strlen3(start_ptr, &src_char_size, &end_ptr);
+    if (!end_ptr) {
+        end_ptr = start_ptr + strlen((char*) start_ptr);
     }
-    if (src_len == 0) {
+    size_t src_size = end_ptr - start_ptr;
+    if (src_size == 0) {
         return true;
     }
-    if (src_len >= UINT_MAX) {
+    if (src_size >= UINT_MAX) {
         pw_set_status(PwStatus(PW_ERROR_STRING_TOO_LONG));
         return false;
     }
+    uint8_t src_char_size;
+    bool valid;
+    unsigned src_len = _pw_utf8_scan((uint8_t*) start_ptr, (uint8_t*) end_ptr, &src_char_size, &valid);
+    if (src_len == 0) {
+        return true;
+    }
     if (!_pw_expand_string(dest, src_len, src_char_size)) {
         return false;
     }
     unsigned dest_pos = _pw_string_inc_length(dest, src_len);
 
-    StrAppend fn_append = _pw_str_append_variants[dest->char_size][0];
-    return fn_append(dest, dest_pos, (uint8_t*) start_ptr, (uint8_t*) end_ptr);
+    if (src_len == src_size) {
+        // ASCII
+        StrAppend fn_append = _pw_str_append_variants[dest->char_size][1];
+        return fn_append(dest, dest_pos, (uint8_t*) start_ptr, (uint8_t*) end_ptr);
+    }
+    _pw_utf8_decode(_pw_string_char_ptr(dest, dest_pos), dest->char_size, (uint8_t*) start_ptr, (uint8_t*) end_ptr, valid);
+    return true;
 }
 
 [[nodiscard]] bool _pw_string_append_utf32(PwValuePtr dest, char32_t* start_ptr, char32_t* end_ptr)
@@ -0,0 +1,33 @@
+#include <string.h>
+
+#include "include/pw.h"
+#include "src/string/pw_string_internal.h"
+
+int pw_strcmp(PwValuePtr a, PwValuePtr b)
+{
+    unsigned a_length, b_length;
+    uint8_t* a_ptr = _pw_string_start_length(a, &a_length);
+    uint8_t* b_ptr = _pw_string_start_length(b, &b_length);
+    unsigned n = (a_length < b_length)? a_length : b_length;
+
+    if (_pw_likely(a->char_size == 1 && b->char_size == 1)) {
+        // byte order is code point order
+        int result = memcmp(a_ptr, b_ptr, n);
+        if (result) {
+            return result;
+        }
+    } else {
+        uint8_t a_char_size = a->char_size;
+        uint8_t b_char_size = b->char_size;
+        while (n--) {
+            char32_t a_chr = _pw_get_char(a_ptr, a_char_size);
+            char32_t b_chr = _pw_get_char(b_ptr, b_char_size);
+            if (a_chr != b_chr) {
+                return PW_CMP(a_chr, b_chr);
+            }
+            a_ptr += a_char_size;
+            b_ptr += b_char_size;
+        }
+    }
+    return PW_CMP(a_length, b_length);
+}
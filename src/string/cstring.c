@@ -1,50 +1,125 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
-static void _cp_to_utf8_uint8_t(uint8_t* self_ptr, char* dest, unsigned length)
-{
-    memcpy(dest, self_ptr, length);
-    *(dest + length) = 0;
-}
+typedef uint8_t  _PwStrVec32_8   __attribute__ ((vector_size (4)));
+typedef uint8_t  _PwStrVec64_8   __attribute__ ((vector_size (8)));
+typedef uint16_t _PwStrVec64_16  __attribute__ ((vector_size (8)));
 
-// integral types:
+/*
+ * Vector loops narrow blocks of ASCII characters to bytes.
+ * Blocks that contain other characters are encoded by scalar loops.
+ *
+ * 32-bit lanes are narrowed in two steps, GCC scalarizes direct conversion.
+ */
 
-#define STR_COPY_TO_UTF8_IMPL(type_name_self)  \
-    static void _cp_to_utf8_##type_name_self(uint8_t* self_ptr, char* dest, unsigned length)  \
+#define TO_UTF8_SCALAR(CHAR_TYPE, CHAR_SIZE)  \
+    static char* to_utf8_##CHAR_SIZE##_scalar(uint8_t* self_ptr, char* dest, unsigned length)  \
     {  \
-        type_name_self* src_ptr = (type_name_self*) self_ptr;  \
         while (length--) {  \
-            dest += pw_char32_to_utf8(*src_ptr++, dest); \
+            dest += _pw_encode_utf8_char(*((CHAR_TYPE*) self_ptr), dest);  \
+            self_ptr += CHAR_SIZE;  \
         }  \
-        *dest = 0;  \
+        return dest;  \
     }
 
-STR_COPY_TO_UTF8_IMPL(uint16_t)
-STR_COPY_TO_UTF8_IMPL(uint32_t)
+#define TO_UTF8_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC_TYPE, WORDS_VEC_TYPE, BYTES_VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static void to_utf8_##CHAR_SIZE##_##VEC_BITS(uint8_t* self_ptr, char* dest, unsigned length)  \
+    {  \
+        unsigned block_length = sizeof(VEC_TYPE) / CHAR_SIZE;  \
+        while (length >= block_length) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, self_ptr, sizeof(v));  \
+            if (_pw_vec##VEC_BITS##_or_lanes(v > 0x7F)) {  \
+                dest = to_utf8_##CHAR_SIZE##_scalar(self_ptr, dest, block_length);  \
+            } else {  \
+                WORDS_VEC_TYPE words = __builtin_convertvector(v, WORDS_VEC_TYPE);  \
+                BYTES_VEC_TYPE bytes = __builtin_convertvector(words, BYTES_VEC_TYPE);  \
+                memcpy(dest, &bytes, sizeof(bytes));  \
+                dest += block_length;  \
+            }  \
+            self_ptr += sizeof(VEC_TYPE);  \
+            length -= block_length;  \
+        }  \
+        dest = to_utf8_##CHAR_SIZE##_scalar(self_ptr, dest, length);  \
+        *dest = 0;  \
+    }
 
-// uint24_t
+#define TO_UTF8(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, WORDS_VEC128_TYPE, BYTES_VEC128_TYPE,  \
+                                  VEC256_TYPE, WORDS_VEC256_TYPE, BYTES_VEC256_TYPE)  \
+    TO_UTF8_SCALAR(CHAR_TYPE, CHAR_SIZE)  \
+    TO_UTF8_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, WORDS_VEC128_TYPE, BYTES_VEC128_TYPE, 128, )  \
+    TO_UTF8_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, WORDS_VEC256_TYPE, BYTES_VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static void to_utf8_##CHAR_SIZE(uint8_t* self_ptr, char* dest, unsigned length)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            to_utf8_##CHAR_SIZE##_256(self_ptr, dest, length);  \
+        } else {  \
+            to_utf8_##CHAR_SIZE##_128(self_ptr, dest, length);  \
+        }  \
+    }
+TO_UTF8(uint8_t,  1, _PwStrVec128_8,  _PwStrVec128_8,  _PwStrVec128_8,
+                     _PwStrVec256_8,  _PwStrVec256_8,  _PwStrVec256_8)
+TO_UTF8(uint16_t, 2, _PwStrVec128_16, _PwStrVec128_16, _PwStrVec64_8,
+                     _PwStrVec256_16, _PwStrVec256_16, _PwStrVec128_8)
+TO_UTF8(char32_t, 4, _PwStrVec128_32, _PwStrVec64_16,  _PwStrVec32_8,
+                     _PwStrVec256_32, _PwStrVec128_16, _PwStrVec64_8)
 
-static void _cp_to_utf8_uint24_t(uint8_t* self_ptr, char* dest, unsigned length)
+static char* to_utf8_3_scalar(uint8_t* self_ptr, char* dest, unsigned length)
 {
     while (length--) {
         char32_t c = *self_ptr++;
         c |= (*self_ptr++) << 8;
         c |= (*self_ptr++) << 16;
-        dest += pw_char32_to_utf8(c, dest);
+        dest += _pw_encode_utf8_char(c, dest);
+    }
+    return dest;
+}
+
+_PW_TARGET_AVX2
+static void to_utf8_3_256(uint8_t* self_ptr, char* dest, unsigned length)
+{
+    // load 32 bytes, encode 8 characters
+    while (length >= 11) {
+        _PwStrVec256_8 v;
+        memcpy(&v, self_ptr, sizeof(v));
+        _PwStrVec256_32 chars = _pw_vec256_unpack24(v, 0);
+        if (_pw_vec256_or_lanes(chars > 0x7F)) {
+            dest = to_utf8_3_scalar(self_ptr, dest, 8);
+        } else {
+            _PwStrVec128_16 words = __builtin_convertvector(chars, _PwStrVec128_16);
+            _PwStrVec64_8 bytes = __builtin_convertvector(words, _PwStrVec64_8);
+            memcpy(dest, &bytes, sizeof(bytes));
+            dest += 8;
+        }
+        self_ptr += 24;
+        length -= 8;
     }
+    dest = to_utf8_3_scalar(self_ptr, dest, length);
     *dest = 0;
 }
 
+static void to_utf8_3(uint8_t* self_ptr, char* dest, unsigned length)
+{
+    if (_pw_cpu_has_avx2()) {
+        to_utf8_3_256(self_ptr, dest, length);
+    } else {
+        *to_utf8_3_scalar(self_ptr, dest, length) = 0;
+    }
+}
+
 typedef void (*CopyToUtf8)(uint8_t* self_ptr, char* dest_ptr, unsigned length);
 
 static CopyToUtf8 _pw_copy_to_utf8_variants[5] = {
     nullptr,
-    _cp_to_utf8_uint8_t,
-    _cp_to_utf8_uint16_t,
-    _cp_to_utf8_uint24_t,
-    _cp_to_utf8_uint32_t
+    to_utf8_1,
+    to_utf8_2,
+    to_utf8_3,
+    to_utf8_4
 };
 
 CStringPtr pw_string_to_utf8(PwValuePtr str)
@@ -65,6 +65,7 @@ EQUZ_N_3(char32_t, 4)
             if (a_chr != b_chr) {  \
                 return PW_NEQ;  \
             }  \
+            b_start_ptr += B_CHAR_SIZE;  \
         }  \
         return (0 == *(B_CHAR_TYPE*) b_start_ptr)? PW_EQ : PW_NEQ;  \
     }
@@ -175,6 +176,58 @@ StrEqualZ _pw_str_equalz_variants[5][5] = {
  * High-level functions
  */
 
+[[nodiscard]] bool _pw_equal_utf8_buf(PwValuePtr a, char8_t* b, unsigned b_size)
+{
+    if (_pw_unlikely(!pw_is_string(a))) {
+        return false;
+    }
+    unsigned a_length;
+    uint8_t* a_ptr = _pw_string_start_length(a, &a_length);
+    uint8_t a_char_size = a->char_size;
+
+    if (a_char_size == 1) {
+        // fast path for ASCII prefix
+        while (a_length && b_size && *b < 0x80) {
+            if (*a_ptr++ != *b++) {
+                return false;
+            }
+            a_length--;
+            b_size--;
+        }
+    }
+    uint8_t* b_end_ptr = b + b_size;
+    while (a_length) {
+        if (b == b_end_ptr) {
+            // b is shorter
+            return false;
+        }
+        char32_t c = *b;
+        if (_pw_likely(c < 0x80)) {
+            b++;
+        } else {
+            b += _pw_decode_utf8_strict(b, b_end_ptr, &c);
+            if (c == 0xFFFFFFFF) {
+                // skip invalid sequence, as when string is created from b
+                continue;
+            }
+        }
+        if (c != _pw_get_char(a_ptr, a_char_size)) {
+            return false;
+        }
+        a_ptr += a_char_size;
+        a_length--;
+    }
+    // what's left in b must be invalid sequences only
+    while (b < b_end_ptr) {
+        char32_t c;
+        b += _pw_decode_utf8_strict(b, b_end_ptr, &c);
+        if (c != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
 [[nodiscard]] bool _pw_equal_z(PwValuePtr a, void* b, uint8_t b_char_size)
 {
     if (_pw_unlikely(!pw_is_string(a))) {
@@ -9,7 +9,7 @@
             if (!b_chr) {  \
                 return PW_EQ_PARTIAL;  \
             }  \
-            if (pw_char_lower(*(A_CHAR_TYPE*) a_start_ptr) != pw_char_lower(b_chr)) {  \
+            if (_pw_char_lower_fast(*(A_CHAR_TYPE*) a_start_ptr) != _pw_char_lower_fast(b_chr)) {  \
                 return PW_NEQ;  \
             }  \
             a_start_ptr += A_CHAR_SIZE;  \
@@ -37,14 +37,14 @@ EQUZI(char32_t, 4, char32_t, 4)
             if (!b_chr) {  \
                 return PW_EQ_PARTIAL;  \
             }  \
-            if (pw_char_lower(*(A_CHAR_TYPE*) a_start_ptr) != pw_char_lower(b_chr)) {  \
+            if (_pw_char_lower_fast(*(A_CHAR_TYPE*) a_start_ptr) != _pw_char_lower_fast(b_chr)) {  \
                 return PW_NEQ;  \
             }  \
             a_start_ptr += A_CHAR_SIZE;  \
         }  \
-        if (_pw_unlikely(*b_start_ptr++)) { return false; }  \
-        if (_pw_unlikely(*b_start_ptr++)) { return false; }  \
-        if (_pw_unlikely(*b_start_ptr)) { return false; }  \
+        if (_pw_unlikely(*b_start_ptr++)) { return PW_NEQ; }  \
+        if (_pw_unlikely(*b_start_ptr++)) { return PW_NEQ; }  \
+        if (_pw_unlikely(*b_start_ptr)) { return PW_NEQ; }  \
         return PW_EQ;  \
     }
 EQUZI_N_3(uint8_t,  1)
@@ -62,9 +62,10 @@ EQUZI_N_3(char32_t, 4)
             char32_t a_chr = *a_start_ptr++;  \
             a_chr |= (*a_start_ptr++) << 8;  \
             a_chr |= (*a_start_ptr++) << 16;  \
-            if (pw_char_lower(a_chr) != pw_char_lower(b_chr)) {  \
+            if (_pw_char_lower_fast(a_chr) != _pw_char_lower_fast(b_chr)) {  \
                 return PW_NEQ;  \
             }  \
+            b_start_ptr += B_CHAR_SIZE;  \
         }  \
         return (0 == *(B_CHAR_TYPE*) b_start_ptr)? PW_EQ : PW_NEQ;  \
     }
@@ -84,14 +85,14 @@ static int streqzi_3_3(uint8_t* a_start_ptr, unsigned a_length, uint8_t* b_start
         char32_t a_chr = *a_start_ptr++;
         a_chr |= (*a_start_ptr++) << 8;
         a_chr |= (*a_start_ptr++) << 16;
-        if (pw_char_lower(a_chr) != pw_char_lower(b_chr)) {
+        if (_pw_char_lower_fast(a_chr) != _pw_char_lower_fast(b_chr)) {
             return PW_NEQ;
         }
     }
     if (_pw_unlikely(*b_start_ptr++)) { return PW_NEQ; }
     if (_pw_unlikely(*b_start_ptr++)) { return PW_NEQ; }
     if (_pw_unlikely(*b_start_ptr)) { return PW_NEQ; }
-    return true;
+    return PW_EQ;
 }
 
 // Comparison with 0-terminated UTF-8 string.
@@ -104,7 +105,7 @@ static int streqzi_3_3(uint8_t* a_start_ptr, unsigned a_length, uint8_t* b_start
             if (!c1) {  \
                 return PW_EQ_PARTIAL;  \
             }  \
-            if (pw_char_lower(c1) != pw_char_lower(*((CHAR_TYPE*) a_start_ptr))) {  \
+            if (_pw_char_lower_fast(c1) != _pw_char_lower_fast(*((CHAR_TYPE*) a_start_ptr))) {  \
                 return PW_NEQ;  \
             }  \
             a_start_ptr += CHAR_SIZE;  \
@@ -125,7 +126,7 @@ static int streqzi_3_0(uint8_t* a_start_ptr, unsigned a_length, uint8_t* b_start
         char32_t c2 = *a_start_ptr++;
         c2 |= (*a_start_ptr++) << 8;
         c2 |= (*a_start_ptr++) << 16;
-        if (pw_char_lower(c1) != pw_char_lower(c2)) {
+        if (_pw_char_lower_fast(c1) != _pw_char_lower_fast(c2)) {
             return PW_NEQ;
         }
     }
@@ -133,7 +134,7 @@ static int streqzi_3_0(uint8_t* a_start_ptr, unsigned a_length, uint8_t* b_start
 }
 
 
-StrEqualZ _pw_str_equalz_variants[5][5] = {
+StrEqualZ _pw_str_equalzi_variants[5][5] = {
     {
         nullptr,
         nullptr,
@@ -170,28 +171,3 @@ StrEqualZ _pw_str_equalz_variants[5][5] = {
         streqzi_4_4
     }
 };
-
-/****************************************************************
- * High-level functions
- */
-
-[[nodiscard]] bool _pw_equal_z(PwValuePtr a, void* b, uint8_t b_char_size)
-{
-    if (_pw_unlikely(!pw_is_string(a))) {
-        return false;
-    }
-    unsigned a_length;
-    uint8_t* a_ptr = _pw_string_start_length(a, &a_length);
-
-    if (_pw_unlikely(a_length == 0)) {
-        if (b_char_size == 4) {
-            return 0 == *(char32_t*) b;
-        } else {
-            return 0 == *(char*) b;
-        }
-    }
-
-    StrEqualZ fn_equalz = _pw_str_equalz_variants[a->char_size][b_char_size];
-    int match = fn_equalz(a_ptr, a_length, b);
-    return (match == PW_EQ)? true : false;  // partial match means not equal
-}
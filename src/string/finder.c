@@ -0,0 +1,365 @@
+#include <string.h>
+
+#include "include/pw.h"
+#include "src/pw_alloc.h"
+#include "src/string/pw_string_internal.h"
+
+/*
+ * Substrings up to this length are searched with the vector filter.
+ * Each false candidate of the filter costs up to SHORT_SUBSTR_MAX
+ * character comparisons.
+ */
+#define SHORT_SUBSTR_MAX  32
+
+/*
+ * The filter gives up and leaves the rest to two-way algorithm
+ * when it finds more than one false candidate per FILTER_CREDIT_RATIO
+ * scanned positions, plus FILTER_INITIAL_CREDIT.
+ * This keeps search time linear on repetitive strings.
+ */
+#define FILTER_CREDIT_RATIO    8
+#define FILTER_INITIAL_CREDIT  64
+
+static inline char32_t* get_codepoints(PwStringFinder* finder)
+{
+    if (finder->length > PW_FINDER_INLINE_LENGTH) {
+        return finder->codepoints_ptr;
+    } else {
+        return finder->codepoints;
+    }
+}
+
+static long maximal_suffix(char32_t* x, long length, bool reversed, unsigned* period)
+/*
+ * Find maximal suffix of `x` for lexicographic order,
+ * or for reversed order if `reversed` is true.
+ * Return position of suffix minus one and write its period to `period`.
+ */
+{
+    long ms = -1;
+    long j = 0;
+    long k = 1;
+    long p = 1;
+    while (j + k < length) {
+        char32_t a = x[j + k];
+        char32_t b = x[ms + k];
+        if (reversed? a > b : a < b) {
+            j += k;
+            k = 1;
+            p = j - ms;
+        } else if (a == b) {
+            if (k != p) {
+                k++;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            ms = j;
+            j = ms + 1;
+            k = p = 1;
+        }
+    }
+    *period = p;
+    return ms;
+}
+
+[[nodiscard]] bool pw_create_string_finder(PwValuePtr substr, bool case_insensitive, PwStringFinder* finder)
+{
+    pw_assert_string(substr);
+
+    unsigned length;
+    uint8_t* ptr = _pw_string_start_length(substr, &length);
+    uint8_t char_size = substr->char_size;
+
+    char32_t* codepoints = finder->codepoints;
+    if (length > PW_FINDER_INLINE_LENGTH) {
+        codepoints = _pw_alloc(substr->type_id, length * sizeof(char32_t), false);
+        if (!codepoints) {
+            return false;
+        }
+        finder->codepoints_ptr = codepoints;
+    }
+    finder->substr = pw_clone(substr);
+    finder->length = length;
+    finder->case_insensitive = case_insensitive;
+
+    char32_t width = 0;
+    for (unsigned i = 0; i < length; i++) {
+        char32_t c = _pw_get_char(ptr, char_size);
+        width |= c;
+        if (case_insensitive) {
+            c = _pw_char_lower_fast(c);
+        }
+        codepoints[i] = c;
+        ptr += char_size;
+    }
+    finder->max_char_size = calc_char_size(width);
+
+    // shift of the window by the last character it contains;
+    // characters with the same low byte share the minimal shift
+    unsigned default_shift = (length < 255)? length : 255;
+    memset(finder->shift, default_shift, sizeof(finder->shift));
+    for (unsigned i = (length > 255)? length - 255 : 0; i < length; i++) {
+        finder->shift[codepoints[i] & 255] = length - 1 - i;
+    }
+
+    // critical factorization for two-way algorithm
+
+    unsigned p, q;
+    long i = maximal_suffix(codepoints, length, false, &p);
+    long j = maximal_suffix(codepoints, length, true, &q);
+    long ell = i;
+    unsigned period = p;
+    if (j > i) {
+        ell = j;
+        period = q;
+    }
+    finder->critical_pos = ell + 1;
+    finder->periodic = ell + 1 + period <= length
+                       && 0 == memcmp(codepoints, codepoints + period, (ell + 1) * sizeof(char32_t));
+    if (finder->periodic) {
+        finder->period = period;
+    } else {
+        unsigned left = ell + 1;
+        unsigned right = length - ell - 1;
+        finder->period = ((left > right)? left : right) + 1;
+    }
+    return true;
+}
+
+void pw_destroy_string_finder(PwStringFinder* finder)
+{
+    if (finder->length > PW_FINDER_INLINE_LENGTH) {
+        _pw_free(finder->substr.type_id, (void**) &finder->codepoints_ptr, finder->length * sizeof(char32_t));
+    }
+    pw_destroy(&finder->substr);
+    finder->length = 0;
+}
+
+/****************************************************************
+ * Two-way algorithm by Crochemore and Perrin.
+ *
+ * The substring is split at the critical position. The right part
+ * is matched left to right, and on mismatch the window is shifted
+ * by the number of matched characters. Then the left part is matched
+ * right to left, and on mismatch the window is shifted by the period.
+ * For periodic substrings the length of the prefix that matched
+ * in the previous window is remembered and not compared again.
+ *
+ * Before comparisons, the window is shifted by the last character
+ * it contains, as in Horspool algorithm. This makes search sublinear
+ * on typical strings.
+ */
+
+#define SAME_CASE(c)   (c)
+#define LOWER_CASE(c)  _pw_char_lower_fast(c)
+
+#define TWO_WAY(NAME, CHAR_SIZE, FOLD_CASE)  \
+    static uint8_t* NAME(PwStringFinder* finder, uint8_t* start_ptr, uint8_t* end_ptr)  \
+    {  \
+        char32_t* substr = get_codepoints(finder);  \
+        long length = finder->length;  \
+        long ell = (long) finder->critical_pos - 1;  \
+        long period = finder->period;  \
+        long memory = -1;  \
+        long last_pos = (end_ptr - start_ptr) / CHAR_SIZE - length;  \
+        for (long pos = 0; pos <= last_pos; ) {  \
+            uint8_t* window = start_ptr + pos * CHAR_SIZE;  \
+            long shift = finder->shift[FOLD_CASE(_pw_get_char(window + (length - 1) * CHAR_SIZE, CHAR_SIZE)) & 255];  \
+            if (shift) {  \
+                if (memory >= 0 && shift < period) {  \
+                    shift = length - period;  \
+                }  \
+                memory = -1;  \
+                pos += shift;  \
+                continue;  \
+            }  \
+            long i = ((ell > memory)? ell : memory) + 1;  \
+            while (i < length && substr[i] == FOLD_CASE(_pw_get_char(window + i * CHAR_SIZE, CHAR_SIZE))) {  \
+                i++;  \
+            }  \
+            if (i < length) {  \
+                pos += i - ell;  \
+                memory = -1;  \
+                continue;  \
+            }  \
+            i = ell;  \
+            while (i > memory && substr[i] == FOLD_CASE(_pw_get_char(window + i * CHAR_SIZE, CHAR_SIZE))) {  \
+                i--;  \
+            }  \
+            if (i <= memory) {  \
+                return window;  \
+            }  \
+            pos += period;  \
+            if (finder->periodic) {  \
+                memory = length - period - 1;  \
+            }  \
+        }  \
+        return nullptr;  \
+    }
+TWO_WAY(two_way_1, 1, SAME_CASE)
+TWO_WAY(two_way_2, 2, SAME_CASE)
+TWO_WAY(two_way_3, 3, SAME_CASE)
+TWO_WAY(two_way_4, 4, SAME_CASE)
+TWO_WAY(two_way_i_1, 1, LOWER_CASE)
+TWO_WAY(two_way_i_2, 2, LOWER_CASE)
+TWO_WAY(two_way_i_3, 3, LOWER_CASE)
+TWO_WAY(two_way_i_4, 4, LOWER_CASE)
+
+typedef uint8_t* (*TwoWay)(PwStringFinder* finder, uint8_t* start_ptr, uint8_t* end_ptr);
+
+static TwoWay two_way_variants[2][5] = {
+    { nullptr, two_way_1,   two_way_2,   two_way_3,   two_way_4 },
+    { nullptr, two_way_i_1, two_way_i_2, two_way_i_3, two_way_i_4 }
+};
+
+/****************************************************************
+ * Vector filter for short substrings.
+ *
+ * Compare a block of characters with the first character of the substring
+ * and the block shifted by the length of substring minus one with the last
+ * character, and verify positions where both match.
+ *
+ * For case-insensitive search ASCII characters are converted to lower case
+ * and all non-ASCII characters are candidates.
+ *
+ * If the filter gives up, it writes the position where
+ * the search should continue to `stop_ptr`, otherwise it writes nullptr.
+ */
+
+#define EXACT_FILTER_CHAR(c)       (c)
+#define EXACT_FILTER_EQ(v, c)      ((v) == (c))
+#define EXACT_CHAR_EQ(c, cp)       ((c) == (cp))
+#define EXACT_SUBSTREQ             _pw_substreq_variants
+
+#define ICASE_FILTER_CHAR(c)       (((c) < 128)? (c) : 128)
+#define ICASE_FILTER_EQ(v, c)      _pw_vec_eqi_ascii(v, c)
+#define ICASE_CHAR_EQ(c, cp)       (_pw_char_lower_fast(c) == (cp))
+#define ICASE_SUBSTREQ             _pw_substreqi_variants
+
+#define FIRST_LAST_KERNEL(MODE, CHAR_TYPE, CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static uint8_t* first_last_##MODE##_##CHAR_SIZE##_##VEC_BITS(PwStringFinder* finder, uint8_t* start_ptr, uint8_t* end_ptr, uint8_t** stop_ptr)  \
+    {  \
+        char32_t* codepoints = get_codepoints(finder);  \
+        char32_t first_codepoint = codepoints[0];  \
+        char32_t last_codepoint = codepoints[finder->length - 1];  \
+        CHAR_TYPE first = MODE##_FILTER_CHAR(first_codepoint);  \
+        CHAR_TYPE last = MODE##_FILTER_CHAR(last_codepoint);  \
+        ptrdiff_t last_offset = (finder->length - 1) * CHAR_SIZE;  \
+        uint8_t* substr_end_ptr;  \
+        uint8_t* substr_ptr = _pw_string_start_end(&finder->substr, &substr_end_ptr);  \
+        SubstrEq fn_substreq = MODE##_SUBSTREQ[CHAR_SIZE][finder->substr.char_size];  \
+        long credit = FILTER_INITIAL_CREDIT;  \
+        *stop_ptr = nullptr;  \
+        while (end_ptr - start_ptr >= (ptrdiff_t) sizeof(VEC_TYPE) + last_offset) {  \
+            VEC_TYPE a, b;  \
+            memcpy(&a, start_ptr, sizeof(a));  \
+            memcpy(&b, start_ptr + last_offset, sizeof(b));  \
+            VEC_TYPE match = (VEC_TYPE) (MODE##_FILTER_EQ(a, first) & MODE##_FILTER_EQ(b, last));  \
+            for (unsigned w = 0; w < sizeof(VEC_TYPE) / 8; w++) {  \
+                if (((_PwStrVec##VEC_BITS##_64) match)[w] == 0) {  \
+                    continue;  \
+                }  \
+                for (unsigned i = w * 8 / CHAR_SIZE; i < (w + 1) * 8 / CHAR_SIZE; i++) {  \
+                    if (match[i]) {  \
+                        uint8_t* candidate = start_ptr + i * CHAR_SIZE;  \
+                        if (fn_substreq(candidate, substr_ptr, substr_end_ptr)) {  \
+                            return candidate;  \
+                        }  \
+                        credit -= FILTER_CREDIT_RATIO;  \
+                    }  \
+                }  \
+            }  \
+            start_ptr += sizeof(VEC_TYPE);  \
+            if (credit < 0) {  \
+                *stop_ptr = start_ptr;  \
+                return nullptr;  \
+            }  \
+            credit += sizeof(VEC_TYPE) / CHAR_SIZE;  \
+        }  \
+        while (end_ptr - start_ptr > last_offset) {  \
+            if (MODE##_CHAR_EQ(*(CHAR_TYPE*) start_ptr, first_codepoint)  \
+                    && MODE##_CHAR_EQ(*(CHAR_TYPE*) (start_ptr + last_offset), last_codepoint)  \
+                    && fn_substreq(start_ptr, substr_ptr, substr_end_ptr)) {  \
+                return start_ptr;  \
+            }  \
+            start_ptr += CHAR_SIZE;  \
+        }  \
+        return nullptr;  \
+    }
+
+#define FIRST_LAST(MODE, CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, VEC256_TYPE)  \
+    FIRST_LAST_KERNEL(MODE, CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, 128, )  \
+    FIRST_LAST_KERNEL(MODE, CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static uint8_t* first_last_##MODE##_##CHAR_SIZE(PwStringFinder* finder, uint8_t* start_ptr, uint8_t* end_ptr, uint8_t** stop_ptr)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            return first_last_##MODE##_##CHAR_SIZE##_256(finder, start_ptr, end_ptr, stop_ptr);  \
+        } else {  \
+            return first_last_##MODE##_##CHAR_SIZE##_128(finder, start_ptr, end_ptr, stop_ptr);  \
+        }  \
+    }
+FIRST_LAST(EXACT, uint8_t,  1, _PwStrVec128_8,  _PwStrVec256_8)
+FIRST_LAST(EXACT, uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+FIRST_LAST(EXACT, char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
+FIRST_LAST(ICASE, uint8_t,  1, _PwStrVec128_8,  _PwStrVec256_8)
+FIRST_LAST(ICASE, uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+FIRST_LAST(ICASE, char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
+
+typedef uint8_t* (*FirstLast)(PwStringFinder* finder, uint8_t* start_ptr, uint8_t* end_ptr, uint8_t** stop_ptr);
+
+// 3-byte characters need byte shuffle, two-way is used instead
+static FirstLast first_last_variants[2][5] = {
+    { nullptr, first_last_EXACT_1, first_last_EXACT_2, nullptr, first_last_EXACT_4 },
+    { nullptr, first_last_ICASE_1, first_last_ICASE_2, nullptr, first_last_ICASE_4 }
+};
+
+/****************************************************************
+ * Search
+ */
+
+[[nodiscard]] bool pw_string_find(PwStringFinder* finder, PwValuePtr str, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+
+    unsigned length = finder->length;
+    unsigned str_len;
+    uint8_t* str_ptr = _pw_string_start_length(str, &str_len);
+    if (_pw_unlikely(length == 0 || start_pos >= str_len || str_len - start_pos < length)) {
+        return false;
+    }
+    uint8_t char_size = str->char_size;
+    bool case_insensitive = finder->case_insensitive;
+    if (!case_insensitive && finder->max_char_size > char_size) {
+        return false;
+    }
+    uint8_t* start_ptr = str_ptr + start_pos * char_size;
+    uint8_t* end_ptr = str_ptr + str_len * char_size;
+
+    uint8_t* found;
+    if (length == 1) {
+        if (case_insensitive) {
+            found = _pw_strchri_variants[char_size](start_ptr, end_ptr, finder->codepoints[0]);
+        } else {
+            found = _pw_strchr_variants[char_size](start_ptr, end_ptr, finder->codepoints[0]);
+        }
+    } else if (length <= SHORT_SUBSTR_MAX && first_last_variants[case_insensitive][char_size]) {
+        uint8_t* stop_ptr;
+        found = first_last_variants[case_insensitive][char_size](finder, start_ptr, end_ptr, &stop_ptr);
+        if (!found && stop_ptr) {
+            found = two_way_variants[case_insensitive][char_size](finder, stop_ptr, end_ptr);
+        }
+    } else {
+        found = two_way_variants[case_insensitive][char_size](finder, start_ptr, end_ptr);
+    }
+    if (!found) {
+        return false;
+    }
+    if (pos) {
+        *pos = (found - str_ptr) / char_size;
+    }
+    return true;
+}
@@ -0,0 +1,242 @@
+#include <string.h>
+
+#include "include/pw.h"
+#include "src/string/pw_string_internal.h"
+
+static inline char32_t decode_valid_char(uint8_t** ptr)
+/*
+ * Decode multibyte sequence that is known to be valid.
+ */
+{
+    uint8_t* p = *ptr;
+    char32_t c = *p;
+    if (c < 0xE0) {
+        c = ((c & 0x1F) << 6) | (p[1] & 0x3F);
+        *ptr = p + 2;
+    } else if (c < 0xF0) {
+        c = ((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        *ptr = p + 3;
+    } else {
+        c = ((c & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        *ptr = p + 4;
+    }
+    return c;
+}
+
+/****************************************************************
+ * Validation
+ */
+
+static unsigned scan_scalar(uint8_t* start_ptr, uint8_t* end_ptr, uint8_t* char_size)
+{
+    unsigned length = 0;
+    char32_t width = 0;
+    while (start_ptr < end_ptr) {
+        char32_t c;
+        start_ptr += _pw_decode_utf8_strict(start_ptr, end_ptr, &c);
+        if (c != 0xFFFFFFFF) {
+            width |= c;
+            length++;
+        }
+    }
+    *char_size = calc_char_size(width);
+    return length;
+}
+
+/*
+ * Vector loops check each byte against up to three preceding bytes,
+ * which are loaded from unaligned addresses:
+ *
+ *   - continuation byte is required after a lead byte and nowhere else;
+ *   - C0, C1, and F5..FF never occur;
+ *   - second byte after E0 and F0 rules out overlong sequences,
+ *     after ED -- surrogates, and after F4 -- code points beyond U+10FFFF.
+ *
+ * Characters are counted as bytes minus continuation bytes.
+ * Continuation bytes are counted in byte lanes which are added up every 255 blocks.
+ * Char size is determined by lead bytes: C2 and C3 encode U+0080..U+00FF,
+ * C4..EF encode 2-byte characters, and F0..F4 encode 3-byte ones.
+ *
+ * The first and the last blocks are copied to a zero-padded buffer.
+ * If the data is invalid, scalar loop counts valid characters.
+ */
+
+#define SCAN_KERNEL(VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static unsigned scan_##VEC_BITS(uint8_t* start_ptr, uint8_t* end_ptr, uint8_t* char_size, bool* valid)  \
+    {  \
+        unsigned length = 0;  \
+        unsigned num_blocks = 0;  \
+        VEC_TYPE continuations = { 0 };  \
+        VEC_TYPE errors = { 0 };  \
+        VEC_TYPE wide = { 0 };  \
+        VEC_TYPE wider = { 0 };  \
+        uint8_t* ptr = start_ptr;  \
+        while (ptr < end_ptr) {  \
+            VEC_TYPE v, prev1, prev2, prev3;  \
+            unsigned n = sizeof(VEC_TYPE);  \
+            if (_pw_likely(end_ptr - ptr >= (ptrdiff_t) sizeof(VEC_TYPE) && ptr - start_ptr >= 3)) {  \
+                memcpy(&v,     ptr,     sizeof(v));  \
+                memcpy(&prev1, ptr - 1, sizeof(v));  \
+                memcpy(&prev2, ptr - 2, sizeof(v));  \
+                memcpy(&prev3, ptr - 3, sizeof(v));  \
+            } else {  \
+                uint8_t block[sizeof(VEC_TYPE) + 3] = { 0 };  \
+                unsigned num_prev = (ptr - start_ptr < 3)? ptr - start_ptr : 3;  \
+                if (end_ptr - ptr < (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+                    n = end_ptr - ptr;  \
+                }  \
+                memcpy(block + 3 - num_prev, ptr - num_prev, num_prev + n);  \
+                memcpy(&v,     block + 3, sizeof(v));  \
+                memcpy(&prev1, block + 2, sizeof(v));  \
+                memcpy(&prev2, block + 1, sizeof(v));  \
+                memcpy(&prev3, block,     sizeof(v));  \
+            }  \
+            ptr += n;  \
+            length += n;  \
+            if (!_pw_vec##VEC_BITS##_or_lanes((v | prev3) & 0x80)) {  \
+                continue;  \
+            }  \
+            VEC_TYPE is_continuation = (VEC_TYPE) ((v & 0xC0) == 0x80);  \
+            continuations -= is_continuation;  \
+            errors |= is_continuation ^ (VEC_TYPE) ((prev1 >= 0xC0) | (prev2 >= 0xE0) | (prev3 >= 0xF0));  \
+            errors |= (VEC_TYPE) (((VEC_TYPE) (v - 0xC0) < 2) | (v >= 0xF5));  \
+            errors |= (VEC_TYPE) (((prev1 == 0xE0) & (v < 0xA0)) | ((prev1 == 0xED) & (v >= 0xA0))  \
+                                | ((prev1 == 0xF0) & (v < 0x90)) | ((prev1 == 0xF4) & (v >= 0x90)));  \
+            wide |= (VEC_TYPE) (v >= 0xC4);  \
+            wider |= (VEC_TYPE) (v >= 0xF0);  \
+            if (++num_blocks == 255) {  \
+                for (unsigned i = 0; i < sizeof(VEC_TYPE); i++) {  \
+                    length -= continuations[i];  \
+                }  \
+                continuations = (VEC_TYPE) { 0 };  \
+                num_blocks = 0;  \
+            }  \
+        }  \
+        for (unsigned i = 0; i < sizeof(VEC_TYPE); i++) {  \
+            length -= continuations[i];  \
+        }  \
+        /* the last block has the zero padding that catches incomplete sequences, unless it is full */  \
+        static uint8_t min_lead_byte[4] = { 0, 0xC0, 0xE0, 0xF0 };  \
+        bool incomplete = false;  \
+        for (unsigned i = 1; i <= 3 && i <= (unsigned) (end_ptr - start_ptr); i++) {  \
+            incomplete |= *(end_ptr - i) >= min_lead_byte[i];  \
+        }  \
+        if (_pw_unlikely(incomplete || _pw_vec##VEC_BITS##_or_lanes(errors))) {  \
+            *valid = false;  \
+            return scan_scalar(start_ptr, end_ptr, char_size);  \
+        }  \
+        *valid = true;  \
+        if (_pw_vec##VEC_BITS##_or_lanes(wider)) {  \
+            *char_size = 3;  \
+        } else if (_pw_vec##VEC_BITS##_or_lanes(wide)) {  \
+            *char_size = 2;  \
+        } else {  \
+            *char_size = 1;  \
+        }  \
+        return length;  \
+    }
+SCAN_KERNEL(_PwStrVec128_8, 128, )
+SCAN_KERNEL(_PwStrVec256_8, 256, _PW_TARGET_AVX2)
+
+unsigned _pw_utf8_scan(uint8_t* start_ptr, uint8_t* end_ptr, uint8_t* char_size, bool* valid)
+{
+    if (_pw_cpu_has_avx2()) {
+        return scan_256(start_ptr, end_ptr, char_size, valid);
+    } else {
+        return scan_128(start_ptr, end_ptr, char_size, valid);
+    }
+}
+
+/****************************************************************
+ * Decoding
+ */
+
+static void decode_invalid(uint8_t* dest_ptr, uint8_t dest_char_size, uint8_t* src_start_ptr, uint8_t* src_end_ptr)
+{
+    while (src_start_ptr < src_end_ptr) {
+        char32_t c;
+        src_start_ptr += _pw_decode_utf8_strict(src_start_ptr, src_end_ptr, &c);
+        if (c != 0xFFFFFFFF) {
+            dest_ptr += _pw_put_char(dest_ptr, c, dest_char_size);
+        }
+    }
+}
+
+/*
+ * Vector loops widen blocks of ASCII characters.
+ * Blocks that contain multibyte sequences are decoded by scalar loops
+ * which may go past the end of block to complete the last sequence.
+ */
+
+#define DECODE_SCALAR(DEST_CHAR_SIZE)  \
+    static inline uint8_t* decode_##DEST_CHAR_SIZE##_scalar(uint8_t* dest_ptr, uint8_t** src_ptr, uint8_t* src_end_ptr)  \
+    {  \
+        uint8_t* ptr = *src_ptr;  \
+        while (ptr < src_end_ptr) {  \
+            char32_t c = *ptr;  \
+            if (c < 0x80) {  \
+                ptr++;  \
+            } else {  \
+                c = decode_valid_char(&ptr);  \
+            }  \
+            dest_ptr += _pw_put_char(dest_ptr, c, DEST_CHAR_SIZE);  \
+        }  \
+        *src_ptr = ptr;  \
+        return dest_ptr;  \
+    }
+
+#define DECODE_KERNEL(DEST_CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static void decode_##DEST_CHAR_SIZE##_##VEC_BITS(uint8_t* dest_ptr, uint8_t* src_start_ptr, uint8_t* src_end_ptr)  \
+    {  \
+        while (src_end_ptr - src_start_ptr >= (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, src_start_ptr, sizeof(v));  \
+            if (_pw_vec##VEC_BITS##_or_lanes(v & 0x80)) {  \
+                dest_ptr = decode_##DEST_CHAR_SIZE##_scalar(dest_ptr, &src_start_ptr, src_start_ptr + sizeof(VEC_TYPE));  \
+            } else {  \
+                for (unsigned i = 0; i < sizeof(VEC_TYPE); i++) {  \
+                    _pw_put_char(dest_ptr + i * DEST_CHAR_SIZE, v[i], DEST_CHAR_SIZE);  \
+                }  \
+                dest_ptr += sizeof(VEC_TYPE) * DEST_CHAR_SIZE;  \
+                src_start_ptr += sizeof(VEC_TYPE);  \
+            }  \
+        }  \
+        decode_##DEST_CHAR_SIZE##_scalar(dest_ptr, &src_start_ptr, src_end_ptr);  \
+    }
+
+#define DECODE(DEST_CHAR_SIZE)  \
+    DECODE_SCALAR(DEST_CHAR_SIZE)  \
+    DECODE_KERNEL(DEST_CHAR_SIZE, _PwStrVec128_8, 128, )  \
+    DECODE_KERNEL(DEST_CHAR_SIZE, _PwStrVec256_8, 256, _PW_TARGET_AVX2)  \
+    \
+    static void decode_##DEST_CHAR_SIZE(uint8_t* dest_ptr, uint8_t* src_start_ptr, uint8_t* src_end_ptr)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            decode_##DEST_CHAR_SIZE##_256(dest_ptr, src_start_ptr, src_end_ptr);  \
+        } else {  \
+            decode_##DEST_CHAR_SIZE##_128(dest_ptr, src_start_ptr, src_end_ptr);  \
+        }  \
+    }
+DECODE(1)
+DECODE(2)
+DECODE(3)
+DECODE(4)
+
+static StrCopy decode_variants[5] = {
+    nullptr,
+    decode_1,
+    decode_2,
+    decode_3,
+    decode_4
+};
+
+void _pw_utf8_decode(uint8_t* dest_ptr, uint8_t dest_char_size, uint8_t* src_start_ptr, uint8_t* src_end_ptr, bool valid)
+{
+    if (_pw_likely(valid)) {
+        decode_variants[dest_char_size](dest_ptr, src_start_ptr, src_end_ptr);
+    } else {
+        decode_invalid(dest_ptr, dest_char_size, src_start_ptr, src_end_ptr);
+    }
+}
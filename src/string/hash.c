@@ -5,6 +5,8 @@
  * Implementation of hash methods.
  *
  * Calculate hash of codepoints regardless of char size.
+ *
+ * _pw_hash_utf8 in src/pw_hash.c must follow the same algorithm.
  */
 
 #define HASH_IMPL(type_name)  \
@@ -5,7 +5,7 @@ static bool is_space_1(uint8_t* start_ptr, uint8_t* end_ptr)
 {
     while (start_ptr < end_ptr) {
         uint8_t c = *start_ptr++;
-        if (!isspace(c)) {
+        if (!pw_isspace(c)) {
             return false;
         }
     }
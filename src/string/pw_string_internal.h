@@ -217,6 +217,223 @@ typedef bool (*StrAppend)(PwValuePtr dest, unsigned dest_pos, uint8_t* src_start
 
 extern StrAppend _pw_str_append_variants[5][5];  // [dest_char_size][src_char_size]
 
+/****************************************************************
+ * UTF-8 conversion
+ */
+
+static inline unsigned _pw_encode_utf8_char(char32_t codepoint, char* buffer)
+/*
+ * Inline variant of pw_char32_to_utf8 for encoding loops.
+ */
+{
+    /*
+     * U+0000 - U+007F      0xxxxxxx
+     * U+0080 - U+07FF      110xxxxx  10xxxxxx
+     * U+0800 - U+FFFF      1110xxxx  10xxxxxx  10xxxxxx
+     * U+010000 - U+10FFFF  11110xxx  10xxxxxx  10xxxxxx  10xxxxxx
+     */
+    if (codepoint < 0x80) {
+        *buffer++ = (char) codepoint;
+        return 1;
+    }
+    if (codepoint < 0b1'00000'000000) {
+        *buffer++ = (char) (0xC0 | (codepoint >> 6));
+        *buffer++ = (char) (0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0b1'0000'000000'000000) {
+        *buffer++ = (char) (0xE0 | (codepoint >> 12));
+        *buffer++ = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+        *buffer++ = (char) (0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    *buffer++ = (char) (0xF0 | ((codepoint >> 18) & 0x07));
+    *buffer++ = (char) (0x80 | ((codepoint >> 12) & 0x3F));
+    *buffer++ = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+    *buffer++ = (char) (0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+static inline unsigned _pw_decode_utf8_strict(uint8_t* ptr, uint8_t* end_ptr, char32_t* result)
+/*
+ * Decode strict UTF-8 sequence, return the number of bytes consumed.
+ *
+ * Overlong sequences, surrogates, code points beyond U+10FFFF,
+ * and sequences truncated by `end_ptr` are invalid.
+ * For invalid sequence write 0xFFFFFFFF to `result` and consume one byte.
+ *
+ * String creation and decoders of UTF-8 buffers use these rules,
+ * so a string created from a buffer and a lookup by the same buffer
+ * see the same characters.
+ */
+{
+    static char32_t min_codepoint[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+
+    char32_t c = *ptr;
+    if (c < 0x80) {
+        *result = c;
+        return 1;
+    }
+    unsigned n;
+    if (c < 0xC2) {
+        goto bad_utf8;  // continuation byte or overlong 2-byte sequence
+    } else if (c < 0xE0) {
+        n = 2;
+        c &= 0x1F;
+    } else if (c < 0xF0) {
+        n = 3;
+        c &= 0x0F;
+    } else if (c < 0xF5) {
+        n = 4;
+        c &= 0x07;
+    } else {
+        goto bad_utf8;
+    }
+    if (_pw_unlikely((unsigned) (end_ptr - ptr) < n)) {
+        goto bad_utf8;
+    }
+    for (unsigned i = 1; i < n; i++) {
+        uint8_t next = ptr[i];
+        if (_pw_unlikely((next & 0xC0) != 0x80)) {
+            goto bad_utf8;
+        }
+        c = (c << 6) | (next & 0x3F);
+    }
+    if (_pw_unlikely(c < min_codepoint[n] || c > 0x10FFFF || (c & 0xFFFFF800) == 0xD800)) {
+        goto bad_utf8;
+    }
+    *result = c;
+    return n;
+
+bad_utf8:
+    *result = 0xFFFFFFFF;
+    return 1;
+}
+
+unsigned _pw_utf8_scan(uint8_t* start_ptr, uint8_t* end_ptr, uint8_t* char_size, bool* valid);
+/*
+ * Validate UTF-8 data, count characters, and find the char size they require.
+ *
+ * Overlong sequences, surrogates, code points beyond U+10FFFF,
+ * and incomplete sequences are invalid. They are not counted
+ * and `valid` is set to false.
+ *
+ * If all bytes are characters, the data is ASCII.
+ */
+
+void _pw_utf8_decode(uint8_t* dest_ptr, uint8_t dest_char_size, uint8_t* src_start_ptr, uint8_t* src_end_ptr, bool valid);
+/*
+ * Decode UTF-8 data scanned by _pw_utf8_scan.
+ * If the data is not valid, skip invalid sequences.
+ *
+ * The caller must ensure destination has sufficient capacity and char size.
+ */
+
+/****************************************************************
+ * Vectors for string kernels.
+ *
+ * Kernels use GCC vector extensions, same as packed array kernels.
+ * They are compiled for 128-bit vectors, which are native to the baseline
+ * of 64-bit targets, and on x86-64 also for 256-bit AVX2 vectors.
+ * The variant is selected at run time.
+ *
+ * Vector types are named by vector and lane bits.
+ */
+
+typedef uint8_t  _PwStrVec128_8   __attribute__ ((vector_size (16)));
+typedef uint16_t _PwStrVec128_16  __attribute__ ((vector_size (16)));
+typedef uint32_t _PwStrVec128_32  __attribute__ ((vector_size (16)));
+typedef uint64_t _PwStrVec128_64  __attribute__ ((vector_size (16)));
+
+typedef uint8_t  _PwStrVec256_8   __attribute__ ((vector_size (32)));
+typedef uint16_t _PwStrVec256_16  __attribute__ ((vector_size (32)));
+typedef uint32_t _PwStrVec256_32  __attribute__ ((vector_size (32)));
+typedef uint64_t _PwStrVec256_64  __attribute__ ((vector_size (32)));
+
+#ifdef __x86_64__
+#   define _PW_TARGET_AVX2  __attribute__ ((target ("avx2")))
+#   define _pw_cpu_has_avx2()  __builtin_cpu_supports("avx2")
+#else
+#   define _PW_TARGET_AVX2
+#   define _pw_cpu_has_avx2()  false
+#endif
+
+#define _pw_vec128_or_lanes(v)  (((_PwStrVec128_64) (v))[0] | ((_PwStrVec128_64) (v))[1])
+#define _pw_vec256_or_lanes(v)  \
+    (((_PwStrVec256_64) (v))[0] | ((_PwStrVec256_64) (v))[1] | ((_PwStrVec256_64) (v))[2] | ((_PwStrVec256_64) (v))[3])
+/*
+ * Bitwise OR of all lanes as uint64_t.
+ */
+
+static inline char32_t _pw_fold_width_2(uint64_t bits)
+/*
+ * Fold result of _pw_vec*_or_lanes for 16-bit lanes
+ * to a value that has the same char size as the widest lane.
+ */
+{
+    bits |= bits >> 32;
+    bits |= bits >> 16;
+    return (uint16_t) bits;
+}
+
+static inline char32_t _pw_fold_width_4(uint64_t bits)
+/*
+ * Same as above, for 32-bit lanes.
+ */
+{
+    return (uint32_t) (bits | (bits >> 32));
+}
+
+#ifdef __clang__
+#   define _pw_vec256_unpack24(v, offset)  \
+        ((_PwStrVec256_32) __builtin_shufflevector((v), (_PwStrVec256_8) { 0 },  \
+            (offset) +  0, (offset) +  1, (offset) +  2, 32,  (offset) +  3, (offset) +  4, (offset) +  5, 32,  \
+            (offset) +  6, (offset) +  7, (offset) +  8, 32,  (offset) +  9, (offset) + 10, (offset) + 11, 32,  \
+            (offset) + 12, (offset) + 13, (offset) + 14, 32,  (offset) + 15, (offset) + 16, (offset) + 17, 32,  \
+            (offset) + 18, (offset) + 19, (offset) + 20, 32,  (offset) + 21, (offset) + 22, (offset) + 23, 32))
+#else
+#   define _pw_vec256_unpack24(v, offset)  \
+        ((_PwStrVec256_32) __builtin_shuffle((v), (_PwStrVec256_8) { 0 }, (_PwStrVec256_8) {  \
+            (offset) +  0, (offset) +  1, (offset) +  2, 32,  (offset) +  3, (offset) +  4, (offset) +  5, 32,  \
+            (offset) +  6, (offset) +  7, (offset) +  8, 32,  (offset) +  9, (offset) + 10, (offset) + 11, 32,  \
+            (offset) + 12, (offset) + 13, (offset) + 14, 32,  (offset) + 15, (offset) + 16, (offset) + 17, 32,  \
+            (offset) + 18, (offset) + 19, (offset) + 20, 32,  (offset) + 21, (offset) + 22, (offset) + 23, 32 }))
+#endif
+/*
+ * Unpack 8 characters of 3 bytes starting at byte `offset` of vector `v`
+ * to 32-bit lanes. `offset` is a constant, 0 or 8.
+ *
+ * There is no 128-bit variant: byte shuffles appeared in SSSE3
+ * and the baseline would scalarize them.
+ */
+
+/****************************************************************
+ * Case-insensitive comparison.
+ *
+ * ASCII characters are converted to lower case inline,
+ * pw_char_lower is called only for the rest.
+ */
+
+static inline char32_t _pw_char_lower_fast(char32_t c)
+{
+    if (c < 128) {
+        return c | ((c - 'A' < 26) << 5);
+    }
+    return pw_char_lower(c);
+}
+
+#define _pw_vec_lower_ascii(v)  ((v) | ((typeof(v)) ((v) - 'A' < 26) & 0x20))
+/*
+ * Convert ASCII letters in all lanes of `v` to lower case.
+ */
+
+#define _pw_vec_eqi_ascii(v, c)  ((typeof(v)) (_pw_vec_lower_ascii(v) == (c)) | (typeof(v)) ((v) > 127))
+/*
+ * Compare lanes of `v` with lower case character `c`.
+ * Lanes that are not ASCII are reported as matching, because their lower case
+ * can be ASCII, e.g. KELVIN SIGN. They should be checked with _pw_char_lower_fast.
+ */
+
 /****************************************************************
  * strchr variants
  *
@@ -274,6 +491,24 @@ typedef bool (*SubstrEq)(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uint
 extern SubstrEq _pw_substreq_variants[5][5];  // [str_char_size][substr_char_size]
 extern SubstrEq _pw_substreqi_variants[5][5];
 
+/****************************************************************
+ * Substring search
+ */
+
+#define PW_NAIVE_STRSTR_MAX  256
+/*
+ * pw_strstr and pw_strstri search single characters, and haystacks
+ * with fewer characters left than this, without building PwStringFinder.
+ * The finder setup costs more than it saves on short strings,
+ * and the naive scan of them is bounded.
+ */
+
+static inline bool _pw_strstr_short_haystack(PwValuePtr str, unsigned start_pos)
+{
+    unsigned str_length = pw_strlen(str);
+    return start_pos >= str_length || str_length - start_pos < PW_NAIVE_STRSTR_MAX;
+}
+
 
 /****************************************************************
  * skip_chars variants
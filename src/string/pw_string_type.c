@@ -2,6 +2,7 @@
 
 #include "include/pw.h"
 #include "src/pw_alloc.h"
+#include "src/pw_interfaces_internal.h"
 #include "src/string/pw_string_internal.h"
 
 /****************************************************************
@@ -184,6 +185,23 @@ static PwInterface_Append append_interface = {
     .append_string_data = append_string_data
 };
 
+/****************************************************************
+ * Comparison interface
+ */
+
+[[nodiscard]] static bool string_compare(PwValuePtr self, PwValuePtr other, int* result)
+{
+    if (pw_is_string(other)) {
+        *result = pw_strcmp(self, other);
+        return true;
+    }
+    return _pw_incomparable(self, other);
+}
+
+static PwInterface_Comparison comparison_interface = {
+    .compare = string_compare
+};
+
 /****************************************************************
  * String type
  */
@@ -195,6 +213,10 @@ static _PwInterface string_interfaces[] = {
     {
         .interface_id      = PwInterfaceId_Append,
         .interface_methods = (void**) &append_interface
+    },
+    {
+        .interface_id      = PwInterfaceId_Comparison,
+        .interface_methods = (void**) &comparison_interface
     }
     /*
     {
@@ -5,7 +5,7 @@
 static uint8_t* skip_spaces_1(uint8_t* start_ptr, uint8_t* end_ptr)
 {
     while (start_ptr < end_ptr) {
-        if (!isspace(*start_ptr)) {
+        if (!pw_isspace(*start_ptr)) {
             break;
         }
         start_ptr++;
@@ -9,18 +9,48 @@ static uint8_t* strchr_1(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoin
     return memchr(start_ptr, (uint8_t) codepoint, end_ptr - start_ptr);
 }
 
-static uint8_t* strchr_2(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
-{
-    while (start_ptr < end_ptr) {
-        if (codepoint == *((uint16_t*) start_ptr)) {
-            return start_ptr;
-        }
-        start_ptr += 2;
+/*
+ * Vector loops stop at the block that contains the codepoint
+ * and leave the rest to scalar loops.
+ */
+
+#define STRCHR_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static uint8_t* strchr_##CHAR_SIZE##_##VEC_BITS(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)  \
+    {  \
+        while (end_ptr - start_ptr >= (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, start_ptr, sizeof(v));  \
+            if (_pw_vec##VEC_BITS##_or_lanes(v == (CHAR_TYPE) codepoint)) {  \
+                break;  \
+            }  \
+            start_ptr += sizeof(VEC_TYPE);  \
+        }  \
+        while (start_ptr < end_ptr) {  \
+            if (codepoint == *((CHAR_TYPE*) start_ptr)) {  \
+                return start_ptr;  \
+            }  \
+            start_ptr += CHAR_SIZE;  \
+        }  \
+        return nullptr;  \
     }
-    return nullptr;
-}
 
-static uint8_t* strchr_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
+#define STRCHR(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, VEC256_TYPE)  \
+    STRCHR_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, 128, )  \
+    STRCHR_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static uint8_t* strchr_##CHAR_SIZE(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            return strchr_##CHAR_SIZE##_256(start_ptr, end_ptr, codepoint);  \
+        } else {  \
+            return strchr_##CHAR_SIZE##_128(start_ptr, end_ptr, codepoint);  \
+        }  \
+    }
+STRCHR(uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+STRCHR(char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
+
+static uint8_t* strchr_3_scalar(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
 {
     while (start_ptr < end_ptr) {
         char32_t c = *start_ptr++;
@@ -34,15 +64,28 @@ static uint8_t* strchr_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoin
     return nullptr;
 }
 
-static uint8_t* strchr_4(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
+_PW_TARGET_AVX2
+static uint8_t* strchr_3_256(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
 {
-    while (start_ptr < end_ptr) {
-        if (codepoint == *((char32_t*) start_ptr)) {
-            return start_ptr;
+    // load 32 bytes, check 8 characters
+    while (end_ptr - start_ptr >= 32) {
+        _PwStrVec256_8 v;
+        memcpy(&v, start_ptr, sizeof(v));
+        if (_pw_vec256_or_lanes(_pw_vec256_unpack24(v, 0) == codepoint)) {
+            break;
         }
-        start_ptr += 4;
+        start_ptr += 24;
+    }
+    return strchr_3_scalar(start_ptr, end_ptr, codepoint);
+}
+
+static uint8_t* strchr_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
+{
+    if (_pw_cpu_has_avx2()) {
+        return strchr_3_256(start_ptr, end_ptr, codepoint);
+    } else {
+        return strchr_3_scalar(start_ptr, end_ptr, codepoint);
     }
-    return nullptr;
 }
 
 StrChr _pw_strchr_variants[5] = {
@@ -10,25 +10,57 @@ static uint8_t* strchr2_1(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoi
     return memchr(start_ptr, (uint8_t) codepoint, end_ptr - start_ptr);
 }
 
-static uint8_t* strchr2_2(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
-{
-    char32_t width = 0;
-    while (start_ptr < end_ptr) {
-        char32_t c = *(uint16_t*) start_ptr;
-        width |= c;
-        if (c == codepoint) {
-            *char_size = calc_char_size(width);
-            return start_ptr;
-        }
-        start_ptr += 2;
+/*
+ * Vector loops accumulate width of skipped blocks in a vector,
+ * stop at the block that contains the codepoint and leave
+ * the rest to scalar loops.
+ */
+
+#define STRCHR2_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static uint8_t* strchr2_##CHAR_SIZE##_##VEC_BITS(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)  \
+    {  \
+        VEC_TYPE width_vec = { 0 };  \
+        while (end_ptr - start_ptr >= (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, start_ptr, sizeof(v));  \
+            if (_pw_vec##VEC_BITS##_or_lanes(v == (CHAR_TYPE) codepoint)) {  \
+                break;  \
+            }  \
+            width_vec |= v;  \
+            start_ptr += sizeof(VEC_TYPE);  \
+        }  \
+        char32_t width = _pw_fold_width_##CHAR_SIZE(_pw_vec##VEC_BITS##_or_lanes(width_vec));  \
+        while (start_ptr < end_ptr) {  \
+            char32_t c = *(CHAR_TYPE*) start_ptr;  \
+            width |= c;  \
+            if (c == codepoint) {  \
+                *char_size = calc_char_size(width);  \
+                return start_ptr;  \
+            }  \
+            start_ptr += CHAR_SIZE;  \
+        }  \
+        *char_size = calc_char_size(width);  \
+        return nullptr;  \
     }
-    *char_size = calc_char_size(width);
-    return nullptr;
-}
 
-static uint8_t* strchr2_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
+#define STRCHR2(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, VEC256_TYPE)  \
+    STRCHR2_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, 128, )  \
+    STRCHR2_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static uint8_t* strchr2_##CHAR_SIZE(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            return strchr2_##CHAR_SIZE##_256(start_ptr, end_ptr, codepoint, char_size);  \
+        } else {  \
+            return strchr2_##CHAR_SIZE##_128(start_ptr, end_ptr, codepoint, char_size);  \
+        }  \
+    }
+STRCHR2(uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+STRCHR2(char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
+
+static uint8_t* strchr2_3_scalar(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, char32_t width, uint8_t* char_size)
 {
-    char32_t width = 0;
     while (start_ptr < end_ptr) {
         char32_t c = *start_ptr++;
         c |= (*start_ptr++) << 8;
@@ -43,20 +75,32 @@ static uint8_t* strchr2_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoi
     return nullptr;
 }
 
-static uint8_t* strchr2_4(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
+_PW_TARGET_AVX2
+static uint8_t* strchr2_3_256(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
 {
-    char32_t width = 0;
-    while (start_ptr < end_ptr) {
-        char32_t c = *(char32_t*) start_ptr;
-        width |= c;
-        if (c == codepoint) {
-            *char_size = calc_char_size(width);
-            return start_ptr;
+    // load 32 bytes, check 8 characters
+    _PwStrVec256_32 width_vec = { 0 };
+    while (end_ptr - start_ptr >= 32) {
+        _PwStrVec256_8 v;
+        memcpy(&v, start_ptr, sizeof(v));
+        _PwStrVec256_32 chars = _pw_vec256_unpack24(v, 0);
+        if (_pw_vec256_or_lanes(chars == codepoint)) {
+            break;
         }
-        start_ptr += 4;
+        width_vec |= chars;
+        start_ptr += 24;
+    }
+    char32_t width = _pw_fold_width_4(_pw_vec256_or_lanes(width_vec));
+    return strchr2_3_scalar(start_ptr, end_ptr, codepoint, width, char_size);
+}
+
+static uint8_t* strchr2_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
+{
+    if (_pw_cpu_has_avx2()) {
+        return strchr2_3_256(start_ptr, end_ptr, codepoint, char_size);
+    } else {
+        return strchr2_3_scalar(start_ptr, end_ptr, codepoint, 0, char_size);
     }
-    *char_size = calc_char_size(width);
-    return nullptr;
 }
 
 StrChr2 _pw_strchr2_variants[5] = {
@@ -78,5 +122,12 @@ StrChr2 _pw_strchr2_variants[5] = {
         return false;
     }
     StrChr2 fn_strchr2 = _pw_strchr2_variants[char_size];
-    return fn_strchr2(start_ptr, end_ptr, chr, max_char_size);
+    uint8_t* char_ptr = fn_strchr2(start_ptr, end_ptr, chr, max_char_size);
+    if (!char_ptr) {
+        return false;
+    }
+    if (result) {
+        *result = start_pos + (char_ptr - start_ptr) / char_size;
+    }
+    return true;
 }
@@ -1,20 +1,59 @@
+#include <string.h>
+
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
-#define SUBSTREQI(CHAR_TYPE, CHAR_SIZE)  \
-    static uint8_t* strchri_##CHAR_SIZE(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)  \
+#define STRCHRI_SCALAR(CHAR_TYPE, CHAR_SIZE)  \
+    static uint8_t* strchri_##CHAR_SIZE##_scalar(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)  \
     {  \
         while (start_ptr < end_ptr) {  \
-            if (codepoint == (char32_t) pw_char_lower(*((CHAR_TYPE*) start_ptr))) {  \
+            if (codepoint == _pw_char_lower_fast(*((CHAR_TYPE*) start_ptr))) {  \
                 return start_ptr;  \
             }  \
             start_ptr += CHAR_SIZE;  \
         }  \
         return nullptr;  \
     }
-SUBSTREQI(uint8_t,  1)
-SUBSTREQI(uint16_t, 2)
-SUBSTREQI(char32_t, 4)
+
+/*
+ * Vector loops check ASCII characters and leave blocks
+ * that contain candidates or non-ASCII characters to scalar loops.
+ */
+
+#define STRCHRI_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static uint8_t* strchri_##CHAR_SIZE##_##VEC_BITS(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)  \
+    {  \
+        while (end_ptr - start_ptr >= (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, start_ptr, sizeof(v));  \
+            if (_pw_vec##VEC_BITS##_or_lanes(_pw_vec_eqi_ascii(v, (CHAR_TYPE) codepoint))) {  \
+                uint8_t* char_ptr = strchri_##CHAR_SIZE##_scalar(start_ptr, start_ptr + sizeof(VEC_TYPE), codepoint);  \
+                if (char_ptr) {  \
+                    return char_ptr;  \
+                }  \
+            }  \
+            start_ptr += sizeof(VEC_TYPE);  \
+        }  \
+        return strchri_##CHAR_SIZE##_scalar(start_ptr, end_ptr, codepoint);  \
+    }
+
+#define STRCHRI(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, VEC256_TYPE)  \
+    STRCHRI_SCALAR(CHAR_TYPE, CHAR_SIZE)  \
+    STRCHRI_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, 128, )  \
+    STRCHRI_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static uint8_t* strchri_##CHAR_SIZE(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            return strchri_##CHAR_SIZE##_256(start_ptr, end_ptr, codepoint);  \
+        } else {  \
+            return strchri_##CHAR_SIZE##_128(start_ptr, end_ptr, codepoint);  \
+        }  \
+    }
+STRCHRI(uint8_t,  1, _PwStrVec128_8,  _PwStrVec256_8)
+STRCHRI(uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+STRCHRI(char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
 
 static uint8_t* strchri_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint)
 {
@@ -23,7 +62,7 @@ static uint8_t* strchri_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoi
         c |= (*start_ptr++) << 8;
         c |= (*start_ptr++) << 16;
 
-        if (codepoint == (char32_t) pw_char_lower(c)) {
+        if (codepoint == _pw_char_lower_fast(c)) {
             return start_ptr - 3;
         }
     }
@@ -51,7 +90,7 @@ StrChr _pw_strchri_variants[5] = {
         return false;
     }
     StrChr fn_strchri = _pw_strchri_variants[char_size];
-    uint8_t* char_ptr = fn_strchri(start_ptr, end_ptr, pw_char_lower(chr));
+    uint8_t* char_ptr = fn_strchri(start_ptr, end_ptr, _pw_char_lower_fast(chr));
     if (_pw_unlikely(!char_ptr)) {
         return false;
     }
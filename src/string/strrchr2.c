@@ -11,25 +11,55 @@ static uint8_t* strrchr2_1(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepo
     return memrchr(start_ptr, (uint8_t) codepoint, end_ptr - start_ptr);
 }
 
-static uint8_t* strrchr2_2(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
-{
-    char32_t width = 0;
-    while (start_ptr < end_ptr) {
-        end_ptr -= 2;
-        char32_t c = *(uint16_t*) end_ptr;
-        width |= c;
-        if (c == codepoint) {
-            *char_size = calc_char_size(width);
-            return end_ptr;
-        }
+/*
+ * Same as strchr2, but loops go from the end.
+ */
+
+#define STRRCHR2_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static uint8_t* strrchr2_##CHAR_SIZE##_##VEC_BITS(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)  \
+    {  \
+        VEC_TYPE width_vec = { 0 };  \
+        while (end_ptr - start_ptr >= (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, end_ptr - sizeof(VEC_TYPE), sizeof(v));  \
+            if (_pw_vec##VEC_BITS##_or_lanes(v == (CHAR_TYPE) codepoint)) {  \
+                break;  \
+            }  \
+            width_vec |= v;  \
+            end_ptr -= sizeof(VEC_TYPE);  \
+        }  \
+        char32_t width = _pw_fold_width_##CHAR_SIZE(_pw_vec##VEC_BITS##_or_lanes(width_vec));  \
+        while (start_ptr < end_ptr) {  \
+            end_ptr -= CHAR_SIZE;  \
+            char32_t c = *(CHAR_TYPE*) end_ptr;  \
+            width |= c;  \
+            if (c == codepoint) {  \
+                *char_size = calc_char_size(width);  \
+                return end_ptr;  \
+            }  \
+        }  \
+        *char_size = calc_char_size(width);  \
+        return nullptr;  \
     }
-    *char_size = calc_char_size(width);
-    return nullptr;
-}
 
-static uint8_t* strrchr2_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
+#define STRRCHR2(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, VEC256_TYPE)  \
+    STRRCHR2_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, 128, )  \
+    STRRCHR2_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static uint8_t* strrchr2_##CHAR_SIZE(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            return strrchr2_##CHAR_SIZE##_256(start_ptr, end_ptr, codepoint, char_size);  \
+        } else {  \
+            return strrchr2_##CHAR_SIZE##_128(start_ptr, end_ptr, codepoint, char_size);  \
+        }  \
+    }
+STRRCHR2(uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+STRRCHR2(char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
+
+static uint8_t* strrchr2_3_scalar(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, char32_t width, uint8_t* char_size)
 {
-    char32_t width = 0;
     while (start_ptr < end_ptr) {
         end_ptr -= 3;
         char32_t c = *end_ptr++;
@@ -46,20 +76,32 @@ static uint8_t* strrchr2_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepo
     return nullptr;
 }
 
-static uint8_t* strrchr2_4(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
+_PW_TARGET_AVX2
+static uint8_t* strrchr2_3_256(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
 {
-    char32_t width = 0;
-    while (start_ptr < end_ptr) {
-        end_ptr -= 4;
-        char32_t c = *(char32_t*) end_ptr;
-        width |= c;
-        if (c == codepoint) {
-            *char_size = calc_char_size(width);
-            return end_ptr;
+    // load 32 bytes, check last 8 characters
+    _PwStrVec256_32 width_vec = { 0 };
+    while (end_ptr - start_ptr >= 32) {
+        _PwStrVec256_8 v;
+        memcpy(&v, end_ptr - 32, sizeof(v));
+        _PwStrVec256_32 chars = _pw_vec256_unpack24(v, 8);
+        if (_pw_vec256_or_lanes(chars == codepoint)) {
+            break;
         }
+        width_vec |= chars;
+        end_ptr -= 24;
+    }
+    char32_t width = _pw_fold_width_4(_pw_vec256_or_lanes(width_vec));
+    return strrchr2_3_scalar(start_ptr, end_ptr, codepoint, width, char_size);
+}
+
+static uint8_t* strrchr2_3(uint8_t* start_ptr, uint8_t* end_ptr, char32_t codepoint, uint8_t* char_size)
+{
+    if (_pw_cpu_has_avx2()) {
+        return strrchr2_3_256(start_ptr, end_ptr, codepoint, char_size);
+    } else {
+        return strrchr2_3_scalar(start_ptr, end_ptr, codepoint, 0, char_size);
     }
-    *char_size = calc_char_size(width);
-    return nullptr;
 }
 
 StrRChr2 _pw_strrchr2_variants[5] = {
@@ -1,11 +1,11 @@
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
-bool _pw_strstr(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned* pos)
+static bool naive_strstr(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned* pos)
+/*
+ * Search without precompiled finder, nothing is allocated.
+ */
 {
-    pw_assert_string(str);
-    pw_assert_string(substr);
-
     uint8_t  substr_char_size = substr->char_size;
     uint8_t* substr_end_ptr;
     uint8_t* substr_start_ptr = _pw_string_start_end(substr, &substr_end_ptr);
@@ -27,8 +27,9 @@ bool _pw_strstr(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned*
     StrChr   fn_strchr   = _pw_strchr_variants[str_char_size];
     SubstrEq fn_substreq = _pw_substreq_variants[str_char_size][substr_char_size];
 
-    str_end_ptr -= substr_end_ptr - substr_start_ptr - 1;  // reduce by strlen(substr) - 1
-    for (uint8_t* str_ptr = str_start_ptr; str_start_ptr < str_end_ptr; ) {
+    // reduce by strlen(substr) - 1
+    str_end_ptr -= (substr_end_ptr - substr_start_ptr) / substr_char_size * str_char_size - str_char_size;
+    for (uint8_t* str_ptr = str_start_ptr; str_ptr < str_end_ptr; ) {
 
         uint8_t* maybe_substr = fn_strchr(str_ptr, str_end_ptr, start_codepoint);
         if (!maybe_substr) {
@@ -44,3 +45,21 @@ bool _pw_strstr(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned*
     }
     return false;
 }
+
+bool _pw_strstr(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+    pw_assert_string(substr);
+
+    if (pw_strlen(substr) == 1 || _pw_strstr_short_haystack(str, start_pos)) {
+        return naive_strstr(str, substr, start_pos, pos);
+    }
+    PwStringFinder finder;
+    if (!pw_create_string_finder(substr, false, &finder)) {
+        // out of memory for a long substring, search the slow way
+        return naive_strstr(str, substr, start_pos, pos);
+    }
+    bool found = pw_string_find(&finder, str, start_pos, pos);
+    pw_destroy_string_finder(&finder);
+    return found;
+}
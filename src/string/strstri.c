@@ -1,11 +1,11 @@
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
-bool _pw_strstri(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned* pos)
+static bool naive_strstri(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned* pos)
+/*
+ * Search without precompiled finder, nothing is allocated.
+ */
 {
-    pw_assert_string(str);
-    pw_assert_string(substr);
-
     uint8_t  substr_char_size = substr->char_size;
     uint8_t* substr_end_ptr;
     uint8_t* substr_start_ptr = _pw_string_start_end(substr, &substr_end_ptr);
@@ -19,7 +19,7 @@ bool _pw_strstri(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned
     uint8_t* str_start_ptr = _pw_string_start_end(str, &str_end_ptr);
     str_start_ptr += start_pos * str_char_size;
 
-    char32_t start_codepoint = _pw_get_char(substr_start_ptr, substr_char_size);
+    char32_t start_codepoint = _pw_char_lower_fast(_pw_get_char(substr_start_ptr, substr_char_size));
     if (_pw_unlikely(start_codepoint >= (1ULL << (8 * str_char_size)))) {
         return false;
     }
@@ -27,8 +27,9 @@ bool _pw_strstri(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned
     StrChr   fn_strchri   = _pw_strchri_variants[str_char_size];
     SubstrEq fn_substreqi = _pw_substreqi_variants[str_char_size][substr_char_size];
 
-    str_end_ptr -= substr_end_ptr - substr_start_ptr - 1;  // reduce by strlen(substr) - 1
-    for (uint8_t* str_ptr = str_start_ptr; str_start_ptr < str_end_ptr; ) {
+    // reduce by strlen(substr) - 1
+    str_end_ptr -= (substr_end_ptr - substr_start_ptr) / substr_char_size * str_char_size - str_char_size;
+    for (uint8_t* str_ptr = str_start_ptr; str_ptr < str_end_ptr; ) {
 
         uint8_t* maybe_substr = fn_strchri(str_ptr, str_end_ptr, start_codepoint);
         if (!maybe_substr) {
@@ -44,3 +45,101 @@ bool _pw_strstri(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned
     }
     return false;
 }
+
+static bool naive_strstri_z(PwValuePtr str, void* substr, uint8_t substr_char_size, unsigned start_pos, unsigned* pos)
+/*
+ * Search for C string without creating a string value, nothing is allocated.
+ */
+{
+    unsigned str_len = pw_strlen(str);
+    if (_pw_unlikely(start_pos >= str_len)) {
+        return false;
+    }
+    uint8_t  str_char_size = str->char_size;
+    uint8_t* str_end_ptr;
+    uint8_t* str_start_ptr = _pw_string_start_end(str, &str_end_ptr);
+    str_start_ptr += start_pos * str_char_size;
+    str_len -= start_pos;
+
+    char32_t start_codepoint = _pw_char_lower_fast(_pw_get_char((uint8_t*) substr, substr_char_size));
+    if (_pw_unlikely(start_codepoint == 0 || start_codepoint >= (1ULL << (8 * str_char_size)))) {
+        return false;
+    }
+
+    StrChr    fn_strchri = _pw_strchri_variants[str_char_size];
+    StrEqualZ fn_equalzi = _pw_str_equalzi_variants[str_char_size][substr_char_size];
+
+    for (uint8_t* str_ptr = str_start_ptr; str_ptr < str_end_ptr; ) {
+
+        uint8_t* maybe_substr = fn_strchri(str_ptr, str_end_ptr, start_codepoint);
+        if (!maybe_substr) {
+            break;
+        }
+        unsigned offset = (maybe_substr - str_start_ptr) / str_char_size;
+        if (fn_equalzi(maybe_substr, str_len - offset, (uint8_t*) substr) != PW_NEQ) {  // partial and full matches are ok
+            if (pos) {
+                *pos = start_pos + offset;
+            }
+            return true;
+        }
+        str_ptr = maybe_substr + str_char_size;
+    }
+    return false;
+}
+
+bool _pw_strstri(PwValuePtr str, PwValuePtr substr, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+    pw_assert_string(substr);
+
+    if (pw_strlen(substr) == 1 || _pw_strstr_short_haystack(str, start_pos)) {
+        return naive_strstri(str, substr, start_pos, pos);
+    }
+    PwStringFinder finder;
+    if (!pw_create_string_finder(substr, true, &finder)) {
+        // out of memory for a long substring, search the slow way
+        return naive_strstri(str, substr, start_pos, pos);
+    }
+    bool found = pw_string_find(&finder, str, start_pos, pos);
+    pw_destroy_string_finder(&finder);
+    return found;
+}
+
+bool _pw_strstri_ascii(PwValuePtr str, char* substr, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+    if (_pw_strstr_short_haystack(str, start_pos)) {
+        return naive_strstri_z(str, substr, 1, start_pos, pos);
+    }
+    PwValue s = PW_NULL;
+    if (!pw_create_string(substr, &s)) {
+        return naive_strstri_z(str, substr, 1, start_pos, pos);
+    }
+    return _pw_strstri(str, &s, start_pos, pos);
+}
+
+bool _pw_strstri_utf8(PwValuePtr str, char8_t* substr, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+    if (_pw_strstr_short_haystack(str, start_pos)) {
+        return naive_strstri_z(str, substr, 0, start_pos, pos);
+    }
+    PwValue s = PW_NULL;
+    if (!pw_create_string(substr, &s)) {
+        return naive_strstri_z(str, substr, 0, start_pos, pos);
+    }
+    return _pw_strstri(str, &s, start_pos, pos);
+}
+
+bool _pw_strstri_utf32(PwValuePtr str, char32_t* substr, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+    if (_pw_strstr_short_haystack(str, start_pos)) {
+        return naive_strstri_z(str, substr, 4, start_pos, pos);
+    }
+    PwValue s = PW_NULL;
+    if (!pw_create_string(substr, &s)) {
+        return naive_strstri_z(str, substr, 4, start_pos, pos);
+    }
+    return _pw_strstri(str, &s, start_pos, pos);
+}
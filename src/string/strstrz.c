@@ -1,7 +1,10 @@
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
-bool _pw_strstr_z(PwValuePtr str, void* substr, uint8_t substr_char_size, unsigned start_pos, unsigned* pos)
+static bool naive_strstr_z(PwValuePtr str, void* substr, uint8_t substr_char_size, unsigned start_pos, unsigned* pos)
+/*
+ * Search for C string without creating a string value, nothing is allocated.
+ */
 {
     unsigned str_len = pw_strlen(str);
     if (_pw_unlikely(start_pos >= str_len)) {
@@ -21,7 +24,7 @@ bool _pw_strstr_z(PwValuePtr str, void* substr, uint8_t substr_char_size, unsign
     StrChr    fn_strchr = _pw_strchr_variants[str_char_size];
     StrEqualZ fn_equalz = _pw_str_equalz_variants[str_char_size][substr_char_size];
 
-    for (uint8_t* str_ptr = str_start_ptr; str_start_ptr < str_end_ptr; ) {
+    for (uint8_t* str_ptr = str_start_ptr; str_ptr < str_end_ptr; ) {
 
         uint8_t* maybe_substr = fn_strchr(str_ptr, str_end_ptr, start_codepoint);
         if (!maybe_substr) {
@@ -35,7 +38,28 @@ bool _pw_strstr_z(PwValuePtr str, void* substr, uint8_t substr_char_size, unsign
             return true;
         }
         str_ptr = maybe_substr + str_char_size;
-        str_len--;
     }
     return false;
 }
+
+bool _pw_strstr_z(PwValuePtr str, void* substr, uint8_t substr_char_size, unsigned start_pos, unsigned* pos)
+{
+    pw_assert_string(str);
+    if (_pw_strstr_short_haystack(str, start_pos)) {
+        return naive_strstr_z(str, substr, substr_char_size, start_pos, pos);
+    }
+    PwValue s = PW_NULL;
+    bool created;
+    switch (substr_char_size) {
+        case 0: created = pw_create_string((char8_t*) substr, &s); break;
+        case 1: created = pw_create_string((char*) substr, &s); break;
+        case 4: created = pw_create_string((char32_t*) substr, &s); break;
+        default:
+            _pw_panic_bad_char_size(substr_char_size);
+    }
+    if (!created) {
+        // out of memory, search the slow way
+        return naive_strstr_z(str, substr, substr_char_size, start_pos, pos);
+    }
+    return _pw_strstr(str, &s, start_pos, pos);
+}
@@ -1,11 +1,13 @@
+#include <string.h>
+
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
-#define SUBSTREQI(STR_CHAR_TYPE, STR_CHAR_SIZE, SUBSTR_CHAR_TYPE, SUBSTR_CHAR_SIZE)  \
-    static bool substreqi_##STR_CHAR_SIZE##_##SUBSTR_CHAR_SIZE(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uint8_t* substr_end_ptr)  \
+#define SUBSTREQI(NAME, STR_CHAR_TYPE, STR_CHAR_SIZE, SUBSTR_CHAR_TYPE, SUBSTR_CHAR_SIZE)  \
+    static bool NAME(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uint8_t* substr_end_ptr)  \
     {  \
         while (substr_start_ptr < substr_end_ptr) {  \
-            if (pw_char_lower(*((STR_CHAR_TYPE*) str_start_ptr)) != pw_char_lower(*((SUBSTR_CHAR_TYPE*) substr_start_ptr))) {  \
+            if (_pw_char_lower_fast(*((STR_CHAR_TYPE*) str_start_ptr)) != _pw_char_lower_fast(*((SUBSTR_CHAR_TYPE*) substr_start_ptr))) {  \
                 return false;  \
             }  \
             str_start_ptr += STR_CHAR_SIZE;  \
@@ -13,15 +15,54 @@
         }  \
         return true;  \
     }
-SUBSTREQI(uint8_t,  1,  uint8_t,  1)
-SUBSTREQI(uint8_t,  1,  uint16_t, 2)
-SUBSTREQI(uint8_t,  1,  char32_t, 4)
-SUBSTREQI(uint16_t, 2,  uint8_t,  1)
-SUBSTREQI(uint16_t, 2,  uint16_t, 2)
-SUBSTREQI(uint16_t, 2,  char32_t, 4)
-SUBSTREQI(char32_t, 4,  uint8_t,  1)
-SUBSTREQI(char32_t, 4,  uint16_t, 2)
-SUBSTREQI(char32_t, 4,  char32_t, 4)
+SUBSTREQI(substreqi_1_1_scalar, uint8_t,  1,  uint8_t,  1)
+SUBSTREQI(substreqi_1_2,        uint8_t,  1,  uint16_t, 2)
+SUBSTREQI(substreqi_1_4,        uint8_t,  1,  char32_t, 4)
+SUBSTREQI(substreqi_2_1,        uint16_t, 2,  uint8_t,  1)
+SUBSTREQI(substreqi_2_2_scalar, uint16_t, 2,  uint16_t, 2)
+SUBSTREQI(substreqi_2_4,        uint16_t, 2,  char32_t, 4)
+SUBSTREQI(substreqi_4_1,        char32_t, 4,  uint8_t,  1)
+SUBSTREQI(substreqi_4_2,        char32_t, 4,  uint16_t, 2)
+SUBSTREQI(substreqi_4_4_scalar, char32_t, 4,  char32_t, 4)
+
+/*
+ * Strings of the same char size are compared by vectors.
+ * Blocks that contain non-ASCII characters are compared by scalar loops.
+ *
+ * Substrings are usually short, so 128-bit vectors are used without dispatch,
+ * and the last incomplete block overlaps the previous one.
+ */
+
+#define SUBSTREQI_VEC(CHAR_SIZE, VEC_TYPE)  \
+    static bool substreqi_##CHAR_SIZE##_##CHAR_SIZE(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uint8_t* substr_end_ptr)  \
+    {  \
+        if (substr_end_ptr - substr_start_ptr < (ptrdiff_t) sizeof(VEC_TYPE)) {  \
+            return substreqi_##CHAR_SIZE##_##CHAR_SIZE##_scalar(str_start_ptr, substr_start_ptr, substr_end_ptr);  \
+        }  \
+        uint8_t* last_block_ptr = substr_end_ptr - sizeof(VEC_TYPE);  \
+        while (substr_start_ptr < substr_end_ptr) {  \
+            if (substr_start_ptr > last_block_ptr) {  \
+                str_start_ptr -= substr_start_ptr - last_block_ptr;  \
+                substr_start_ptr = last_block_ptr;  \
+            }  \
+            VEC_TYPE a, b;  \
+            memcpy(&a, str_start_ptr, sizeof(a));  \
+            memcpy(&b, substr_start_ptr, sizeof(b));  \
+            if (_pw_vec128_or_lanes((a | b) > 127)) {  \
+                if (!substreqi_##CHAR_SIZE##_##CHAR_SIZE##_scalar(str_start_ptr, substr_start_ptr, substr_start_ptr + sizeof(VEC_TYPE))) {  \
+                    return false;  \
+                }  \
+            } else if (_pw_vec128_or_lanes(_pw_vec_lower_ascii(a) != _pw_vec_lower_ascii(b))) {  \
+                return false;  \
+            }  \
+            str_start_ptr += sizeof(VEC_TYPE);  \
+            substr_start_ptr += sizeof(VEC_TYPE);  \
+        }  \
+        return true;  \
+    }
+SUBSTREQI_VEC(1, _PwStrVec128_8)
+SUBSTREQI_VEC(2, _PwStrVec128_16)
+SUBSTREQI_VEC(4, _PwStrVec128_32)
 
 #define SUBSTREQI_N_3(STR_CHAR_TYPE, STR_CHAR_SIZE)  \
     static bool substreqi_##STR_CHAR_SIZE##_3(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uint8_t* substr_end_ptr)  \
@@ -30,7 +71,7 @@ SUBSTREQI(char32_t, 4,  char32_t, 4)
             char32_t c = *substr_start_ptr++;  \
             c |= (*substr_start_ptr++) << 8;  \
             c |= (*substr_start_ptr++) << 16;  \
-            if (pw_char_lower(*((STR_CHAR_TYPE*) str_start_ptr)) != pw_char_lower(c)) {  \
+            if (_pw_char_lower_fast(*((STR_CHAR_TYPE*) str_start_ptr)) != _pw_char_lower_fast(c)) {  \
                 return false;  \
             }  \
             str_start_ptr += STR_CHAR_SIZE;  \
@@ -48,7 +89,7 @@ SUBSTREQI_N_3(char32_t, 4)
             char32_t c = *str_start_ptr++;  \
             c |= (*str_start_ptr++) << 8;  \
             c |= (*str_start_ptr++) << 16;  \
-            if (pw_char_lower(c) != pw_char_lower(*((SUBSTR_CHAR_TYPE*) substr_start_ptr))) {  \
+            if (_pw_char_lower_fast(c) != _pw_char_lower_fast(*((SUBSTR_CHAR_TYPE*) substr_start_ptr))) {  \
                 return false;  \
             }  \
             substr_start_ptr += SUBSTR_CHAR_SIZE;  \
@@ -65,10 +106,10 @@ static bool substreqi_3_3(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uin
         char32_t c1 = *str_start_ptr++;
         c1 |= (*str_start_ptr++) << 8;
         c1 |= (*str_start_ptr++) << 16;
-        char32_t c2 = *substr_start_ptr++;  \
-        c2 |= (*substr_start_ptr++) << 8;  \
-        c2 |= (*substr_start_ptr++) << 16;  \
-        if (pw_char_lower(c1) != pw_char_lower(c2)) {
+        char32_t c2 = *substr_start_ptr++;
+        c2 |= (*substr_start_ptr++) << 8;
+        c2 |= (*substr_start_ptr++) << 16;
+        if (_pw_char_lower_fast(c1) != _pw_char_lower_fast(c2)) {
             return false;
         }
     }
@@ -82,7 +123,7 @@ static bool substreqi_3_3(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uin
     {  \
         while(substr_start_ptr < substr_end_ptr) {  \
             char32_t c = _pw_decode_utf8_char(&substr_start_ptr);  \
-            if (pw_char_lower(c) != pw_char_lower(*((CHAR_TYPE*) str_start_ptr))) {  \
+            if (_pw_char_lower_fast(c) != _pw_char_lower_fast(*((CHAR_TYPE*) str_start_ptr))) {  \
                 return false;  \
             }  \
             str_start_ptr += CHAR_SIZE;  \
@@ -100,7 +141,7 @@ static bool substreqi_3_0(uint8_t* str_start_ptr, uint8_t* substr_start_ptr, uin
         char32_t c2 = *str_start_ptr++;
         c2 |= (*str_start_ptr++) << 8;
         c2 |= (*str_start_ptr++) << 16;
-        if (pw_char_lower(c1) != pw_char_lower(c2)) {
+        if (_pw_char_lower_fast(c1) != _pw_char_lower_fast(c2)) {
             return false;
         }
     }
@@ -184,7 +225,7 @@ SubstrEq _pw_substreqi_variants[5][5] = {
     if (_pw_unlikely(length == 0)) {
         return false;
     }
-    return pw_char_lower(_pw_get_char(_pw_string_start(str), str->char_size)) == pw_char_lower(prefix);
+    return _pw_char_lower_fast(_pw_get_char(_pw_string_start(str), str->char_size)) == _pw_char_lower_fast(prefix);
 }
 
 [[nodiscard]] bool _pw_startswithi(PwValuePtr str, PwValuePtr prefix)
@@ -201,7 +242,7 @@ SubstrEq _pw_substreqi_variants[5][5] = {
         return false;
     }
     uint8_t char_size = str->char_size;
-    return pw_char_lower(prefix) == pw_char_lower(_pw_get_char(ptr + (length - 1) * char_size, char_size));
+    return _pw_char_lower_fast(prefix) == _pw_char_lower_fast(_pw_get_char(ptr + (length - 1) * char_size, char_size));
 }
 
 [[nodiscard]] bool _pw_endswithi(PwValuePtr str, PwValuePtr suffix)
@@ -82,14 +82,13 @@ TRANSFORM(lower, char32_t, 4)
                     if (start_ptr >= end_ptr) {  \
                         return true;  \
                     }  \
-                    start_ptr -= 3;  \
                     c = *start_ptr++;  \
                     c |= (*start_ptr++) << 8;  \
                     c |= (*start_ptr++) << 16;  \
                     new_c = pw_char_##TFUNC(c);  \
+                    start_ptr -= 3;  \
                 }  \
             }  \
-            start_ptr += 3;  \
             offset += 3;  \
         }  \
         return true;  \
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "include/pw.h"
 #include "src/string/pw_string_internal.h"
 
@@ -33,7 +35,9 @@ char32_t _pw_decode_utf8_char(char8_t** str)
         APPEND_NEXT
         APPEND_NEXT
     } else {
-        goto bad_utf8;
+        // skip bad lead byte
+        *str = p;
+        return 0xFFFFFFFF;
     }
     if (codepoint == 0) {
         // zero codepoint encoded with 2 or more bytes,
@@ -49,7 +53,7 @@ char32_t _pw_decode_utf8_char(char8_t** str)
     return codepoint;
 
 end_of_string:
-    *str = p;
+    *str = --p;  // stay at terminating null character
     return 0;
 
 bad_utf8:
@@ -141,94 +145,23 @@ bool _pw_decode_utf8_buffer(char8_t** ptr, unsigned* bytes_remaining, char32_t*
     if (!remaining) {
         return false;
     }
-
-    char32_t codepoint;
-    char8_t next;
-
-#   define APPEND_NEXT      \
-        next = *p++;        \
-        remaining--;        \
-        if (_pw_unlikely((next & 0b1100'0000) != 0b1000'0000)) goto bad_utf8; \
-        codepoint <<= 6;       \
-        codepoint |= next & 0x3F;
-
-    char8_t c = *p++;
-    remaining--;
-    if (c < 0x80) {
-        codepoint = c;
-        goto done;
-    }
-    if ((c & 0b1110'0000) == 0b1100'0000) {
-        if (_pw_unlikely(!remaining)) return false;
-        codepoint = c & 0b0011'1111;
-        APPEND_NEXT
-    } else if ((c & 0b1111'0000) == 0b1110'0000) {
-        if (_pw_unlikely(remaining < 2)) return false;
-        codepoint = c & 0b0001'1111;
-        APPEND_NEXT
-        APPEND_NEXT
-    } else if ((c & 0b1111'1000) == 0b1111'0000) {
-        if (_pw_unlikely(remaining < 3)) return false;
-        codepoint = c & 0b0000'1111;
-        APPEND_NEXT
-        APPEND_NEXT
-        APPEND_NEXT
-    } else {
-        goto bad_utf8;
-    }
-    if (codepoint == 0) {
-        // zero codepoint encoded with 2 or more bytes,
-        // make it invalid to avoid mixing up with 1-byte null character
-        codepoint = 0xFFFFFFFF;
-/*
-    } else if (0xD800 <= codepoint && codepoint <= 0xDFFF) {
-        // surrogate pairs are prohibited, return inalid codepoint for them
-        codepoint = 0xFFFFFFFF;
-*/
+    char8_t c = *p;
+    if (_pw_unlikely(remaining < 4 && c >= 0xC2 && c < 0xF5)) {
+        // check if buffer ends with incomplete sequence, more data may follow
+        unsigned n = (c < 0xE0)? 2 : (c < 0xF0)? 3 : 4;
+        if (remaining < n) {
+            return false;
+        }
     }
-
-done:
-    *ptr = p;
-    *bytes_remaining = remaining;
-    *result = codepoint;
+    unsigned n = _pw_decode_utf8_strict(p, p + remaining, result);
+    *ptr = p + n;
+    *bytes_remaining = remaining - n;
     return true;
-
-bad_utf8:
-    p--;  // rollback to bad octet, will process it on the next call
-    codepoint = 0xFFFFFFFF;
-    goto done;
-
-#   undef APPEND_NEXT
 }
 
 unsigned pw_char32_to_utf8(char32_t codepoint, char* buffer)
 {
-    /*
-     * U+0000 - U+007F      0xxxxxxx
-     * U+0080 - U+07FF      110xxxxx  10xxxxxx
-     * U+0800 - U+FFFF      1110xxxx  10xxxxxx  10xxxxxx
-     * U+010000 - U+10FFFF  11110xxx  10xxxxxx  10xxxxxx  10xxxxxx
-     */
-    if (codepoint < 0x80) {
-        *buffer++ = (char) codepoint;
-        return 1;
-    }
-    if (codepoint < 0b1'00000'000000) {
-        *buffer++ = (char) (0xC0 | (codepoint >> 6));
-        *buffer++ = (char) (0x80 | (codepoint & 0x3F));
-        return 2;
-    }
-    if (codepoint < 0b1'0000'000000'000000) {
-        *buffer++ = (char) (0xE0 | (codepoint >> 12));
-        *buffer++ = (char) (0x80 | ((codepoint >> 6) & 0x3F));
-        *buffer++ = (char) (0x80 | (codepoint & 0x3F));
-        return 3;
-    }
-    *buffer++ = (char) (0xF0 | ((codepoint >> 18) & 0x07));
-    *buffer++ = (char) (0x80 | ((codepoint >> 12) & 0x3F));
-    *buffer++ = (char) (0x80 | ((codepoint >> 6) & 0x3F));
-    *buffer++ = (char) (0x80 | (codepoint & 0x3F));
-    return 4;
+    return _pw_encode_utf8_char(codepoint, buffer);
 }
 
 unsigned utf8_strlen(char8_t* str)
@@ -413,26 +346,131 @@ uint8_t utf32_char_size(char32_t* str, unsigned max_len)
     return calc_char_size(width);
 }
 
+/*
+ * Vector loops count extra UTF-8 bytes for each character in lanes
+ * that are added up before they can overflow.
+ */
+
+#define UTF8_EXTRA_BYTES_1(v)  ((v) > 0x7F)
+#define UTF8_EXTRA_BYTES_2(v)  (((v) > 0x7F) + ((v) > 0x7FF))
+#define UTF8_EXTRA_BYTES_4(v)  (((v) > 0x7F) + ((v) > 0x7FF) + ((v) > 0xFFFF))
+
+static unsigned utf8_length(char32_t c)
+{
+    if (c < 0x80) {
+        return 1;
+    } else if (c < 0b1'00000'000000) {
+        return 2;
+    } else if (c < 0b1'0000'000000'000000) {
+        return 3;
+    } else {
+        return 4;
+    }
+}
+
+#define STRLEN_IN_UTF8_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC_TYPE, VEC_BITS, TARGET)  \
+    TARGET  \
+    static unsigned strlen_in_utf8_##CHAR_SIZE##_##VEC_BITS(uint8_t* ptr, unsigned n)  \
+    {  \
+        unsigned length = 0;  \
+        unsigned num_blocks = 0;  \
+        VEC_TYPE extra_bytes = { 0 };  \
+        while (n >= sizeof(VEC_TYPE) / CHAR_SIZE) {  \
+            VEC_TYPE v;  \
+            memcpy(&v, ptr, sizeof(v));  \
+            extra_bytes -= (VEC_TYPE) UTF8_EXTRA_BYTES_##CHAR_SIZE(v);  \
+            if (++num_blocks == (CHAR_TYPE) -1 / 3) {  \
+                for (unsigned i = 0; i < sizeof(VEC_TYPE) / CHAR_SIZE; i++) {  \
+                    length += extra_bytes[i];  \
+                }  \
+                extra_bytes = (VEC_TYPE) { 0 };  \
+                num_blocks = 0;  \
+            }  \
+            length += sizeof(VEC_TYPE) / CHAR_SIZE;  \
+            ptr += sizeof(VEC_TYPE);  \
+            n -= sizeof(VEC_TYPE) / CHAR_SIZE;  \
+        }  \
+        for (unsigned i = 0; i < sizeof(VEC_TYPE) / CHAR_SIZE; i++) {  \
+            length += extra_bytes[i];  \
+        }  \
+        while (n--) {  \
+            length += utf8_length(*((CHAR_TYPE*) ptr));  \
+            ptr += CHAR_SIZE;  \
+        }  \
+        return length;  \
+    }
+
+#define STRLEN_IN_UTF8(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, VEC256_TYPE)  \
+    STRLEN_IN_UTF8_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC128_TYPE, 128, )  \
+    STRLEN_IN_UTF8_KERNEL(CHAR_TYPE, CHAR_SIZE, VEC256_TYPE, 256, _PW_TARGET_AVX2)  \
+    \
+    static unsigned strlen_in_utf8_##CHAR_SIZE(uint8_t* ptr, unsigned n)  \
+    {  \
+        if (_pw_cpu_has_avx2()) {  \
+            return strlen_in_utf8_##CHAR_SIZE##_256(ptr, n);  \
+        } else {  \
+            return strlen_in_utf8_##CHAR_SIZE##_128(ptr, n);  \
+        }  \
+    }
+STRLEN_IN_UTF8(uint8_t,  1, _PwStrVec128_8,  _PwStrVec256_8)
+STRLEN_IN_UTF8(uint16_t, 2, _PwStrVec128_16, _PwStrVec256_16)
+STRLEN_IN_UTF8(char32_t, 4, _PwStrVec128_32, _PwStrVec256_32)
+
+static unsigned strlen_in_utf8_3_scalar(uint8_t* ptr, unsigned n)
+{
+    unsigned length = 0;
+    while (n--) {
+        char32_t c = *ptr++;
+        c |= (*ptr++) << 8;
+        c |= (*ptr++) << 16;
+        length += utf8_length(c);
+    }
+    return length;
+}
+
+_PW_TARGET_AVX2
+static unsigned strlen_in_utf8_3_256(uint8_t* ptr, unsigned n)
+{
+    // load 32 bytes, count 8 characters
+    unsigned length = 0;
+    _PwStrVec256_32 extra_bytes = { 0 };
+    while (n >= 11) {
+        _PwStrVec256_8 v;
+        memcpy(&v, ptr, sizeof(v));
+        extra_bytes -= (_PwStrVec256_32) UTF8_EXTRA_BYTES_4(_pw_vec256_unpack24(v, 0));
+        length += 8;
+        ptr += 24;
+        n -= 8;
+    }
+    for (unsigned i = 0; i < 8; i++) {
+        length += extra_bytes[i];
+    }
+    return length + strlen_in_utf8_3_scalar(ptr, n);
+}
+
+static unsigned strlen_in_utf8_3(uint8_t* ptr, unsigned n)
+{
+    if (_pw_cpu_has_avx2()) {
+        return strlen_in_utf8_3_256(ptr, n);
+    } else {
+        return strlen_in_utf8_3_scalar(ptr, n);
+    }
+}
+
+typedef unsigned (*StrLenInUtf8)(uint8_t* ptr, unsigned n);
+
+static StrLenInUtf8 strlen_in_utf8_variants[5] = {
+    nullptr,
+    strlen_in_utf8_1,
+    strlen_in_utf8_2,
+    strlen_in_utf8_3,
+    strlen_in_utf8_4
+};
+
 unsigned pw_strlen_in_utf8(PwValuePtr str)
 {
     pw_assert_string(str);
-    unsigned length = 0;
-    uint8_t char_size = str->char_size;
     unsigned n;
     uint8_t* ptr = _pw_string_start_length(str, &n);
-    while (n) {
-        char32_t c = _pw_get_char(ptr, char_size);
-        if (c < 0x80) {
-            length++;
-        } else if (c < 0b1'00000'000000) {
-            length += 2;
-        } else if (c < 0b1'0000'000000'000000) {
-            length += 3;
-        } else {
-            length += 4;
-        }
-        ptr += char_size;
-        n--;
-    }
-    return length;
+    return strlen_in_utf8_variants[str->char_size](ptr, n);
 }
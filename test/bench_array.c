@@ -0,0 +1,467 @@
+/*
+ * Array benchmarks.
+ *
+ * Measure append throughput for each growth policy at sizes
+ * from 1e3 to 1e8 items. Linear growth is quadratic, so it is
+ * measured up to MAX_LINEAR_ITEMS only.
+ *
+ * Also measure creation of small arrays, queue and deque operations,
+ * bulk extend compared to appending item by item, paging with slice
+ * copies and views, sum of packed array compared to iterating Array,
+ * sorting of numbers and strings, adoption of a child shared
+ * by many parents with and without parent tracking, and pauses
+ * of deferred release compared to synchronous destruction.
+ *
+ * Pass maximal number of items as the first argument
+ * to limit memory usage, 1e8 items take about 2GB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "include/pw.h"
+#include "src/pw_array_internal.h"
+
+#define panic()  \
+    do {  \
+        fprintf(stderr, "PANIC: %s:%d\n", __FILE__, __LINE__);  \
+        pw_print_status(stderr, &current_task->status);  \
+        abort();  \
+    } while (false)
+
+#define MAX_LINEAR_ITEMS  1'000'000
+
+static char* growth_names[] = {
+    [PW_ARRAY_GROWTH_DOUBLE] = "double",
+    [PW_ARRAY_GROWTH_1_5X]   = "1.5x",
+    [PW_ARRAY_GROWTH_LINEAR] = "linear"
+};
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_append(uint8_t growth, unsigned num_items)
+{
+    PwArrayCtorArgs args = { .growth = growth };
+    PwValue array = PW_NULL;
+    if (!pw_create2(PwTypeId_Array, &args, &array)) {
+        panic();
+    }
+    _PwArray* a = get_array_struct_ptr(&array);
+    unsigned num_resizes = 0;
+    unsigned num_moves = 0;
+    PwValuePtr items = a->items;
+    unsigned capacity = a->capacity;
+
+    double start = now();
+    for (unsigned i = 0; i < num_items; i++) {
+        if (!pw_array_append(&array, i)) {
+            panic();
+        }
+        if (a->capacity != capacity) {
+            capacity = a->capacity;
+            num_resizes++;
+            if (a->items != items) {
+                items = a->items;
+                num_moves++;
+            }
+        }
+    }
+    double append_ns = (now() - start) * 1e9 / num_items;
+
+    start = now();
+    if (!pw_array_shrink(&array)) {
+        panic();
+    }
+    double shrink_us = (now() - start) * 1e6;
+
+    printf("%-6s %10u %8.1f %8u %8u %10.1f %9.1f\n",
+           growth_names[growth], num_items, append_ns, num_resizes, num_moves,
+           (double) capacity / num_items, shrink_us);
+}
+
+static void bench_small(unsigned num_items)
+/*
+ * Create and destroy 1M arrays of num_items.
+ */
+{
+    unsigned num_arrays = 1'000'000;
+    double start = now();
+    for (unsigned i = 0; i < num_arrays; i++) {{
+        PwValue array = PW_NULL;
+        if (!pw_create_array(&array)) {
+            panic();
+        }
+        for (unsigned j = 0; j < num_items; j++) {
+            if (!pw_array_append(&array, j)) {
+                panic();
+            }
+        }
+    }}
+    printf("arrays of %u items: %.1f ns/array\n", num_items, (now() - start) * 1e9 / num_arrays);
+}
+
+static void bench_queue(unsigned num_items)
+/*
+ * Measure append + pull and insert at front + pop
+ * on arrays holding num_items.
+ */
+{
+    PwValue array = PW_NULL;
+    if (!pw_create_array(&array)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_items; i++) {
+        if (!pw_array_append(&array, i)) {
+            panic();
+        }
+    }
+    unsigned num_ops = 1'000'000;
+    double start = now();
+    for (unsigned i = 0; i < num_ops; i++) {{
+        if (!pw_array_append(&array, i)) {
+            panic();
+        }
+        PwValue v = PW_NULL;
+        if (!pw_array_pull(&array, &v)) {
+            panic();
+        }
+    }}
+    double queue_ns = (now() - start) * 1e9 / num_ops;
+
+    start = now();
+    for (unsigned i = 0; i < num_ops; i++) {{
+        if (!pw_array_insert(&array, 0, i)) {
+            panic();
+        }
+        PwValue v = PW_NULL;
+        if (!pw_array_pop(&array, &v)) {
+            panic();
+        }
+    }}
+    double deque_ns = (now() - start) * 1e9 / num_ops;
+
+    printf("%u items: append + pull %.1f ns, insert at front + pop %.1f ns\n",
+           num_items, queue_ns, deque_ns);
+}
+
+static void bench_extend(unsigned num_items)
+{
+    _PwValue* values = malloc(num_items * sizeof(_PwValue));
+    if (!values) {
+        panic();
+    }
+    PwValue appended = PW_NULL;
+    if (!pw_create_array(&appended)) {
+        panic();
+    }
+    double start = now();
+    for (unsigned i = 0; i < num_items; i++) {
+        if (!pw_array_append(&appended, i)) {
+            panic();
+        }
+    }
+    double append_ns = (now() - start) * 1e9 / num_items;
+
+    for (unsigned i = 0; i < num_items; i++) {
+        values[i] = PwUnsigned(i);
+    }
+    PwValue moved = PW_NULL;
+    if (!pw_create_array(&moved)) {
+        panic();
+    }
+    start = now();
+    if (!pw_array_extend_move(&moved, values, num_items)) {
+        panic();
+    }
+    double move_ns = (now() - start) * 1e9 / num_items;
+
+    PwValue extended = PW_NULL;
+    if (!pw_create_array(&extended)) {
+        panic();
+    }
+    start = now();
+    if (!pw_array_extend(&extended, &appended)) {
+        panic();
+    }
+    double extend_ns = (now() - start) * 1e9 / num_items;
+
+    printf("%u items: append %.2f ns/item, extend_move %.2f ns/item, extend %.2f ns/item\n",
+           num_items, append_ns, move_ns, extend_ns);
+    free(values);
+}
+
+static void bench_paging(unsigned page_size)
+/*
+ * Read 1M items in pages, copying them with pw_array_slice
+ * and viewing them with pw_array_slice_view.
+ */
+{
+    unsigned num_items = 1'000'000;
+    PwValue array = PW_NULL;
+    if (!pw_create_array(&array)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_items; i++) {
+        if (!pw_array_append(&array, "a string that is too long to be embedded")) {
+            panic();
+        }
+    }
+    double start = now();
+    for (unsigned i = 0; i < num_items; i += page_size) {{
+        PwValue page = PW_NULL;
+        if (!pw_array_slice(&array, i, i + page_size, &page)) {
+            panic();
+        }
+    }}
+    double copy_ns = (now() - start) * 1e9 / num_items;
+
+    start = now();
+    for (unsigned i = 0; i < num_items; i += page_size) {{
+        PwValue page = PW_NULL;
+        if (!pw_array_slice_view(&array, i, i + page_size, &page)) {
+            panic();
+        }
+    }}
+    double view_ns = (now() - start) * 1e9 / num_items;
+
+    printf("pages of %u: slice copy %.2f ns/item, slice view %.2f ns/item\n",
+           page_size, copy_ns, view_ns);
+}
+
+static void bench_packed_sum(unsigned num_items)
+{
+    PwValue array = PW_NULL;
+    if (!pw_create_array(&array)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_items; i++) {
+        if (!pw_array_append(&array, i * 0.5)) {
+            panic();
+        }
+    }
+    PwValue packed = PW_NULL;
+    if (!pw_packed_array_from_array(&array, PwTypeId_Float, &packed)) {
+        panic();
+    }
+    unsigned num_rounds = 100'000'000 / num_items;
+
+    double array_sum = 0;
+    double start = now();
+    for (unsigned r = 0; r < num_rounds; r++) {
+        PwArrayCursor cursor = pw_array_cursor(&array);
+        while (pw_array_cursor_next(&cursor)) {
+            array_sum += cursor.item->float_value;
+        }
+    }
+    double array_ns = (now() - start) * 1e9 / num_rounds / num_items;
+
+    double packed_sum = 0;
+    start = now();
+    for (unsigned r = 0; r < num_rounds; r++) {{
+        PwValue sum = PW_NULL;
+        if (!pw_packed_array_sum(&packed, &sum)) {
+            panic();
+        }
+        packed_sum += sum.float_value;
+    }}
+    double packed_ns = (now() - start) * 1e9 / num_rounds / num_items;
+
+    printf("%u floats: Array sum %.2f ns/item, packed sum %.2f ns/item (%g, %g)\n",
+           num_items, array_ns, packed_ns, array_sum, packed_sum);
+}
+
+static void bench_sort(unsigned num_items)
+/*
+ * Sort random integers and floats with radix sort, mixed numbers
+ * with generic comparison, and strings in one and four threads.
+ */
+{
+    static char* names[] = { "signed", "float", "mixed", "strings", "strings/4" };
+    printf("%u items:", num_items);
+    for (unsigned kind = 0; kind < PW_LENGTH(names); kind++) {{
+        PwValue array = PW_NULL;
+        if (!pw_create_array(&array)) {
+            panic();
+        }
+        uint64_t x = 1;
+        for (unsigned i = 0; i < num_items; i++) {{
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            PwValue item = PW_NULL;
+            if (kind == 0) {
+                item = PwSigned((int64_t) x);
+            } else if (kind == 1 || (kind == 2 && (i & 1))) {
+                item = PwFloat(((int64_t) x) / 1e9);
+            } else if (kind == 2) {
+                item = PwSigned(((int64_t) x) >> 30);
+            } else {
+                char buf[24];
+                snprintf(buf, sizeof(buf), "%llu", (unsigned long long) x);
+                if (!pw_create_string((char8_t*) buf, &item)) {
+                    panic();
+                }
+            }
+            if (!pw_array_append(&array, &item)) {
+                panic();
+            }
+        }}
+        PwSortOptions options = { .num_threads = (kind == 4)? 4 : 1 };
+        double start = now();
+        if (!pw_array_sort(&array, &options)) {
+            panic();
+        }
+        printf(" %s %.1f ns/item", names[kind], (now() - start) * 1e9 / num_items);
+    }}
+    putchar('\n');
+}
+
+static void bench_shared_child(unsigned num_parents, bool acyclic)
+/*
+ * Append the same child array to num_parents arrays and delete it.
+ */
+{
+    PwValue parents = PW_NULL;
+    PwValue first = PW_NULL;
+    if (!pw_create_array(&parents) || !pw_create_array(&first)) {
+        panic();
+    }
+    {
+        PwArrayCtorArgs args = { .acyclic = acyclic };
+        PwValue child = PW_NULL;
+        if (!pw_create2(PwTypeId_Array, &args, &child) || !pw_array_append(&first, &child)) {
+            panic();
+        }
+    }
+    PwValuePtr child = get_array_struct_ptr(&first)->items;
+    for (unsigned i = 0; i < num_parents; i++) {{
+        PwValue parent = PW_NULL;
+        if (!pw_create_array(&parent) || !pw_array_append(&parents, &parent)) {
+            panic();
+        }
+    }}
+    _PwArray* a = get_array_struct_ptr(&parents);
+    double start = now();
+    for (unsigned i = 0; i < num_parents; i++) {
+        if (!pw_array_append(&a->items[i], child)) {
+            panic();
+        }
+    }
+    double adopt_ns = (now() - start) * 1e9 / num_parents;
+    start = now();
+    for (unsigned i = 0; i < num_parents; i++) {
+        pw_array_del(&a->items[i], 0, 1);
+    }
+    double abandon_ns = (now() - start) * 1e9 / num_parents;
+    printf("%u parents%s: adopt %.1f ns, abandon %.1f ns\n",
+           num_parents, acyclic? " (acyclic child)" : "", adopt_ns, abandon_ns);
+}
+
+static void make_graph(unsigned num_items, PwValuePtr result)
+/*
+ * Create array of num_items / 10 arrays holding 10 strings each.
+ */
+{
+    if (!pw_create_array(result)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_items / 10; i++) {{
+        PwValue row = PW_NULL;
+        if (!pw_create_array(&row)) {
+            panic();
+        }
+        for (unsigned j = 0; j < 10; j++) {
+            if (!pw_array_append(&row, (char8_t*) "a string that is too long to be embedded")) {
+                panic();
+            }
+        }
+        if (!pw_array_append(result, &row)) {
+            panic();
+        }
+    }}
+}
+
+static void bench_reclaim(unsigned num_items, unsigned budget)
+/*
+ * Compare synchronous destruction of a large graph with the longest
+ * pause of incremental reclamation.
+ */
+{
+    PwValue graph = PW_NULL;
+    make_graph(num_items, &graph);
+    double start = now();
+    pw_destroy(&graph);
+    double sync_ms = (now() - start) * 1e3;
+
+    make_graph(num_items, &graph);
+    pw_set_deferred_release(10);  // defer rows too
+    start = now();
+    pw_destroy(&graph);
+    double defer_us = (now() - start) * 1e6;
+    double max_pause_us = 0.0;
+    unsigned num_slices = 0;
+    bool done;
+    do {
+        start = now();
+        done = pw_reclaim(budget);
+        double pause_us = (now() - start) * 1e6;
+        if (pause_us > max_pause_us) {
+            max_pause_us = pause_us;
+        }
+        num_slices++;
+    } while (!done);
+    pw_set_deferred_release(0);
+
+    printf("%9u items: destroy %.2f ms, deferred destroy %.1f us, %u slices of %u, max pause %.1f us\n",
+           num_items, sync_ms, defer_us, num_slices, budget, max_pause_us);
+}
+
+int main(int argc, char* argv[])
+{
+    init_allocator(&pet_allocator);
+
+    unsigned max_items = 100'000'000;
+    if (argc > 1) {
+        max_items = strtoul(argv[1], nullptr, 10);
+    }
+
+    printf("growth      items   ns/item  resizes    moves  capacity/n  shrink us\n");
+    for (uint8_t growth = PW_ARRAY_GROWTH_DOUBLE; growth <= PW_ARRAY_GROWTH_LINEAR; growth++) {
+        for (unsigned n = 1000; n <= max_items; n *= 10) {
+            if (growth == PW_ARRAY_GROWTH_LINEAR && n > MAX_LINEAR_ITEMS) {
+                break;
+            }
+            bench_append(growth, n);
+        }
+    }
+    for (unsigned n = 0; n <= 8; n += 2) {
+        bench_small(n);
+    }
+    for (unsigned n = 1000; n <= 1'000'000 && n <= max_items; n *= 10) {
+        bench_queue(n);
+    }
+    for (unsigned n = 1000; n <= 10'000'000 && n <= max_items; n *= 10) {
+        bench_extend(n);
+    }
+    for (unsigned n = 10; n <= 10'000; n *= 10) {
+        bench_paging(n);
+    }
+    for (unsigned n = 1000; n <= 10'000'000 && n <= max_items; n *= 10) {
+        bench_packed_sum(n);
+    }
+    for (unsigned n = 1000; n <= 10'000'000 && n <= max_items; n *= 10) {
+        bench_sort(n);
+    }
+    for (unsigned n = 10; n <= 100'000 && n <= max_items; n *= 10) {
+        bench_shared_child(n, false);
+        bench_shared_child(n, true);
+    }
+    for (unsigned n = 10'000; n <= 1'000'000 && n <= max_items; n *= 10) {
+        bench_reclaim(n, 10'000);
+    }
+    return 0;
+}
@@ -0,0 +1,486 @@
+/*
+ * Map benchmarks.
+ *
+ * Measure insert, lookup of existing and missing keys, and delete time
+ * for each hash table engine at different load factors.
+ *
+ * Maps are presized for HT_CAPACITY * 3/4 items, the highest load
+ * both engines allow, so requested load factors are achieved exactly.
+ * The actual load factor is printed to make sure the table did not grow.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "include/pw.h"
+#include "src/pw_map_internal.h"
+
+#define panic()  \
+    do {  \
+        fprintf(stderr, "PANIC: %s:%d\n", __FILE__, __LINE__);  \
+        pw_print_status(stderr, &current_task->status);  \
+        abort();  \
+    } while (false)
+
+// total number of lookups per measurement
+#define NUM_LOOKUPS  (4 * 1024 * 1024)
+
+// hash table capacity to fill
+#define HT_CAPACITY  (64 * 1024)
+
+static double load_factors[] = { 0.25, 0.5, 0.75 };
+
+static char* engine_names[] = {
+    [PW_MAP_ENGINE_LINEAR] = "linear",
+    [PW_MAP_ENGINE_SWISS]  = "swiss"
+};
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_lookup(PwValuePtr map, PwValuePtr keys, unsigned num_keys, unsigned* num_found)
+/*
+ * Return nanoseconds per lookup.
+ */
+{
+    unsigned found = 0;
+    double start = now();
+    for (unsigned n = 0; n < NUM_LOOKUPS; n += num_keys) {
+        for (unsigned i = 0; i < num_keys; i++) {
+            found += pw_map_has_key(map, &keys[i]);
+        }
+    }
+    double elapsed = now() - start;
+    unsigned total = ((NUM_LOOKUPS + num_keys - 1) / num_keys) * num_keys;
+    *num_found = found;
+    return elapsed * 1e9 / total;
+}
+
+static void bench_map(uint8_t engine, double load_factor, bool string_keys)
+{
+    unsigned num_keys = (unsigned) (HT_CAPACITY * load_factor);
+
+    PwValuePtr hit_keys = calloc(num_keys, sizeof(_PwValue));
+    PwValuePtr miss_keys = calloc(num_keys, sizeof(_PwValue));
+    if (!hit_keys || !miss_keys) {
+        fprintf(stderr, "Out of memory\n");
+        abort();
+    }
+    for (unsigned i = 0; i < num_keys; i++) {
+        if (string_keys) {
+            char buf[32];
+            sprintf(buf, "key-%u", i);
+            if (!pw_create_string(buf, &hit_keys[i])) {
+                panic();
+            }
+            sprintf(buf, "key-%u", i + num_keys);
+            if (!pw_create_string(buf, &miss_keys[i])) {
+                panic();
+            }
+        } else {
+            hit_keys[i] = PwUnsigned(i);
+            miss_keys[i] = PwUnsigned(i + num_keys);
+        }
+    }
+
+    PwMapCtorArgs args = {
+        .engine   = engine,
+        .capacity = HT_CAPACITY / 4 * 3
+    };
+    PwValue map = PW_NULL;
+    if (!pw_create2(PwTypeId_Map, &args, &map)) {
+        panic();
+    }
+    double start = now();
+    for (unsigned i = 0; i < num_keys; i++) {
+        PwValue value = PwUnsigned(i);
+        if (!pw_map_update(&map, &hit_keys[i], &value)) {
+            panic();
+        }
+    }
+    double insert_ns = (now() - start) * 1e9 / num_keys;
+
+    unsigned found;
+    double hit_ns = bench_lookup(&map, hit_keys, num_keys, &found);
+    if (found != ((NUM_LOOKUPS + num_keys - 1) / num_keys) * num_keys) {
+        fprintf(stderr, "Not all keys found\n");
+        abort();
+    }
+    double miss_ns = bench_lookup(&map, miss_keys, num_keys, &found);
+    if (found) {
+        fprintf(stderr, "Found missing keys\n");
+        abort();
+    }
+
+    _PwMap* m = (_PwMap*) map.struct_data;
+    unsigned ht_capacity = m->hash_table.capacity;
+
+    start = now();
+    for (unsigned i = 0; i < num_keys; i++) {
+        if (!pw_map_del(&map, &hit_keys[i])) {
+            panic();
+        }
+    }
+    double delete_ns = (now() - start) * 1e9 / num_keys;
+
+    printf("%-8s %-8s %8u  %5.2f  %7u  %6.3f  %9.1f  %9.1f  %9.1f  %9.1f\n",
+           engine_names[engine], string_keys? "string" : "unsigned",
+           num_keys, load_factor, ht_capacity,
+           (double) num_keys / ht_capacity,
+           insert_ns, hit_ns, miss_ns, delete_ns);
+
+    for (unsigned i = 0; i < num_keys; i++) {
+        pw_destroy(&hit_keys[i]);
+        pw_destroy(&miss_keys[i]);
+    }
+    free(hit_keys);
+    free(miss_keys);
+}
+
+static void bench_build(unsigned num_keys)
+/*
+ * Compare building map by incremental insertion and by bulk constructor.
+ */
+{
+    PwValuePtr pairs = calloc(num_keys * 2, sizeof(_PwValue));
+    if (!pairs) {
+        fprintf(stderr, "Out of memory\n");
+        abort();
+    }
+
+    double start = now();
+    PwValue map = PW_NULL;
+    if (!pw_create_map(&map)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_keys; i++) {
+        PwValue key = PwUnsigned(i);
+        PwValue value = PwUnsigned(i);
+        if (!pw_map_update(&map, &key, &value)) {
+            panic();
+        }
+    }
+    double incremental_ms = (now() - start) * 1e3;
+
+    for (unsigned i = 0; i < num_keys; i++) {
+        pairs[i * 2] = PwUnsigned(i);
+        pairs[i * 2 + 1] = PwUnsigned(i);
+    }
+    start = now();
+    PwValue bulk_map = PW_NULL;
+    if (!pw_create_map_from_pairs(pairs, num_keys, &bulk_map)) {
+        panic();
+    }
+    double bulk_ms = (now() - start) * 1e3;
+
+    printf("build %u items: incremental %.1f ms, bulk %.1f ms\n", num_keys, incremental_ms, bulk_ms);
+    free(pairs);
+}
+
+static void bench_utf8_lookup(unsigned num_keys)
+/*
+ * Compare lookup by string value and by UTF-8 buffer.
+ */
+{
+    char8_t (*buffers)[16] = calloc(num_keys, sizeof(*buffers));
+    PwValuePtr keys = calloc(num_keys, sizeof(_PwValue));
+    if (!buffers || !keys) {
+        fprintf(stderr, "Out of memory\n");
+        abort();
+    }
+    PwValue map = PW_NULL;
+    if (!pw_create_map(&map)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_keys; i++) {
+        sprintf((char*) buffers[i], "header-%u", i);
+        if (!pw_create_string(buffers[i], &keys[i])) {
+            panic();
+        }
+        PwValue value = PwUnsigned(i);
+        if (!pw_map_update(&map, &keys[i], &value)) {
+            panic();
+        }
+    }
+    unsigned found = 0;
+    double start = now();
+    for (unsigned n = 0; n < NUM_LOOKUPS; n += num_keys) {
+        for (unsigned i = 0; i < num_keys; i++) {
+            found += pw_map_has_key(&map, &keys[i]);
+        }
+    }
+    double value_ns = (now() - start) * 1e9 / NUM_LOOKUPS;
+
+    start = now();
+    for (unsigned n = 0; n < NUM_LOOKUPS; n += num_keys) {
+        for (unsigned i = 0; i < num_keys; i++) {
+            found += pw_map_has_key_utf8_buf(&map, buffers[i], strlen((char*) buffers[i]));
+        }
+    }
+    double utf8_ns = (now() - start) * 1e9 / NUM_LOOKUPS;
+
+    // what UTF-8 lookup used to cost
+    start = now();
+    for (unsigned n = 0; n < NUM_LOOKUPS; n += num_keys) {
+        for (unsigned i = 0; i < num_keys; i++) {{
+            PwValue key = PW_NULL;
+            if (!pw_create_string(buffers[i], &key)) {
+                panic();
+            }
+            found += pw_map_has_key(&map, &key);
+        }}
+    }
+    double tmp_string_ns = (now() - start) * 1e9 / NUM_LOOKUPS;
+
+    if (found != 3 * ((NUM_LOOKUPS + num_keys - 1) / num_keys) * num_keys) {
+        fprintf(stderr, "Not all keys found\n");
+        abort();
+    }
+    printf("lookup %u string keys: by value %.1f ns, by UTF-8 buffer %.1f ns, by temporary string %.1f ns\n",
+           num_keys, value_ns, utf8_ns, tmp_string_ns);
+
+    for (unsigned i = 0; i < num_keys; i++) {
+        pw_destroy(&keys[i]);
+    }
+    free(keys);
+    free(buffers);
+}
+
+static void bench_small_map(unsigned num_keys)
+/*
+ * Compare small map with linear scan against hashed map of the same size.
+ */
+{
+    PwValuePtr keys = calloc(num_keys, sizeof(_PwValue));
+    if (!keys) {
+        fprintf(stderr, "Out of memory\n");
+        abort();
+    }
+    for (unsigned i = 0; i < num_keys; i++) {
+        char buf[32];
+        sprintf(buf, "content-%u", i);
+        if (!pw_create_string(buf, &keys[i])) {
+            panic();
+        }
+    }
+    double ns[2];
+    for (unsigned hashed = 0; hashed < 2; hashed++) {{
+        // capacity above PWMAP_SMALL_CAPACITY forces hash table
+        PwMapCtorArgs args = {
+            .capacity = hashed? PWMAP_SMALL_CAPACITY + 1 : 0
+        };
+        double start = now();
+        for (unsigned n = 0; n < NUM_LOOKUPS / 64; n++) {{
+            PwValue map = PW_NULL;
+            if (!pw_create2(PwTypeId_Map, &args, &map)) {
+                panic();
+            }
+            for (unsigned i = 0; i < num_keys; i++) {
+                PwValue value = PwUnsigned(i);
+                if (!pw_map_update(&map, &keys[i], &value)) {
+                    panic();
+                }
+            }
+            for (unsigned i = 0; i < 64; i++) {
+                if (!pw_map_has_key(&map, &keys[i % num_keys])) {
+                    panic();
+                }
+            }
+        }}
+        ns[hashed] = (now() - start) * 1e9 / (NUM_LOOKUPS / 64);
+    }}
+    printf("create map of %u string keys and lookup 64 times: small %.1f ns, hashed %.1f ns\n",
+           num_keys, ns[0], ns[1]);
+
+    for (unsigned i = 0; i < num_keys; i++) {
+        pw_destroy(&keys[i]);
+    }
+    free(keys);
+}
+
+static void bench_scan(unsigned num_keys)
+/*
+ * Compare full scan with pw_map_item and with borrowing cursor.
+ */
+{
+    PwValue map = PW_NULL;
+    if (!pw_create_map(&map)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_keys; i++) {{
+        char buf[32];
+        sprintf(buf, "key-%u", i);
+        PwValue key = PW_NULL;
+        if (!pw_create_string(buf, &key)) {
+            panic();
+        }
+        PwValue value = PW_NULL;
+        if (!pw_create_string(buf + 4, &value)) {
+            panic();
+        }
+        if (!pw_map_update(&map, &key, &value)) {
+            panic();
+        }
+    }}
+    unsigned total = 0;
+    double start = now();
+    for (unsigned n = 0; n < NUM_LOOKUPS; n += num_keys) {
+        for (unsigned i = 0; i < num_keys; i++) {{
+            PwValue key = PW_NULL;
+            PwValue value = PW_NULL;
+            if (!pw_map_item(&map, i, &key, &value)) {
+                panic();
+            }
+            total += pw_strlen(&value);
+        }}
+    }
+    double item_ns = (now() - start) * 1e9 / NUM_LOOKUPS;
+
+    start = now();
+    for (unsigned n = 0; n < NUM_LOOKUPS; n += num_keys) {
+        PwMapCursor cursor = pw_map_cursor(&map);
+        while (pw_map_cursor_next(&cursor)) {
+            total += pw_strlen(cursor.value);
+        }
+    }
+    double cursor_ns = (now() - start) * 1e9 / NUM_LOOKUPS;
+
+    printf("scan %u items (%u): pw_map_item %.1f ns, cursor %.1f ns per item\n",
+           num_keys, total, item_ns, cursor_ns);
+}
+
+static void bench_counters(unsigned num_keys)
+/*
+ * Compare incrementing counters with get + update and with slots.
+ */
+{
+    PwValuePtr keys = calloc(num_keys, sizeof(_PwValue));
+    if (!keys) {
+        fprintf(stderr, "Out of memory\n");
+        abort();
+    }
+    for (unsigned i = 0; i < num_keys; i++) {
+        char buf[32];
+        sprintf(buf, "word-%u", i);
+        if (!pw_create_string(buf, &keys[i])) {
+            panic();
+        }
+    }
+    PwValue zero = PwUnsigned(0);
+    double ns[2];
+    for (unsigned use_slot = 0; use_slot < 2; use_slot++) {{
+        PwValue map = PW_NULL;
+        if (!pw_create_map(&map)) {
+            panic();
+        }
+        double start = now();
+        for (unsigned n = 0; n < NUM_LOOKUPS; n++) {
+            PwValuePtr key = &keys[n % num_keys];
+            if (use_slot) {
+                PwMapSlot counter = PW_MAP_SLOT_NULL;
+                if (!pw_map_slot(&map, key, &zero, &counter)) {
+                    panic();
+                }
+                counter.value->unsigned_value++;
+            } else {
+                PwValue counter = PW_NULL;
+                if (!pw_map_get(&map, key, &counter)) {
+                    counter = PwUnsigned(0);
+                }
+                counter.unsigned_value++;
+                if (!pw_map_update(&map, key, &counter)) {
+                    panic();
+                }
+            }
+        }
+        ns[use_slot] = (now() - start) * 1e9 / NUM_LOOKUPS;
+    }}
+    printf("increment %u counters: get + update %.1f ns, slot %.1f ns\n", num_keys, ns[0], ns[1]);
+
+    for (unsigned i = 0; i < num_keys; i++) {
+        pw_destroy(&keys[i]);
+    }
+    free(keys);
+}
+
+static void bench_set(unsigned num_keys)
+/*
+ * Compare set with map of Null values used as a set,
+ * and intersection of large and small sets.
+ */
+{
+    PwValue set = PW_NULL;
+    PwValue map = PW_NULL;
+    if (!pw_create_set(&set)) {
+        panic();
+    }
+    if (!pw_create_map(&map)) {
+        panic();
+    }
+    PwValue null = PwNull();
+    double start = now();
+    for (unsigned i = 0; i < num_keys; i++) {
+        if (!pw_set_add(&set, i)) {
+            panic();
+        }
+    }
+    double set_ns = (now() - start) * 1e9 / num_keys;
+    start = now();
+    for (unsigned i = 0; i < num_keys; i++) {
+        PwValue key = PwUnsigned(i);
+        if (!pw_map_update(&map, &key, &null)) {
+            panic();
+        }
+    }
+    double map_ns = (now() - start) * 1e9 / num_keys;
+    _PwMap* s = (_PwMap*) set.struct_data;
+    _PwMap* m = (_PwMap*) map.struct_data;
+    printf("add %u keys: set %.1f ns (%zu bytes), map of nulls %.1f ns (%zu bytes)\n",
+           num_keys, set_ns, _pw_array_capacity(&s->kv_pairs) * sizeof(_PwValue),
+           map_ns, _pw_array_capacity(&m->kv_pairs) * sizeof(_PwValue));
+
+    PwValue small = PW_NULL;
+    if (!pw_create_set(&small)) {
+        panic();
+    }
+    for (unsigned i = 0; i < 100; i++) {
+        if (!pw_set_add(&small, i * 7)) {
+            panic();
+        }
+    }
+    start = now();
+    for (unsigned n = 0; n < 1000; n++) {{
+        PwValue result = PW_NULL;
+        if (!pw_set_intersection(&set, &small, &result)) {
+            panic();
+        }
+    }}
+    printf("intersection of %u and 100 items: %.1f ns\n", num_keys, (now() - start) * 1e9 / 1000);
+}
+
+int main(int argc, char* argv[])
+{
+    init_allocator(&pet_allocator);
+
+    printf("engine   keys         size   load  ht size  actual  insert ns  lookup ns    miss ns  delete ns\n");
+    for (int string_keys = 0; string_keys < 2; string_keys++) {
+        for (unsigned i = 0; i < PW_LENGTH(load_factors); i++) {
+            for (uint8_t engine = PW_MAP_ENGINE_LINEAR; engine <= PW_MAP_ENGINE_SWISS; engine++) {
+                bench_map(engine, load_factors[i], string_keys);
+            }
+        }
+    }
+    bench_build(1024 * 1024);
+    bench_utf8_lookup(64);
+    bench_small_map(4);
+    bench_small_map(PWMAP_SMALL_CAPACITY);
+    bench_scan(64 * 1024);
+    bench_counters(1000);
+    bench_set(64 * 1024);
+    return 0;
+}
@@ -0,0 +1,420 @@
+/*
+ * String benchmarks.
+ *
+ * Measure search throughput for each char size on long strings
+ * where the character is at the end: strchr, strchr2 that also
+ * calculates char size, and rsplit that scans from the end.
+ *
+ * Measure substring search on text-like strings and on repetitive
+ * strings that make naive search quadratic.
+ *
+ * Measure case-insensitive matching of HTTP header names.
+ *
+ * Measure case conversion and trimming of text.
+ *
+ * Measure conversion from and to UTF-8 of text that is mostly ASCII
+ * and of text where all letters are multibyte characters.
+ *
+ * Pass string length as the first argument, default is 1e6.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "include/pw.h"
+
+#define panic()  \
+    do {  \
+        fprintf(stderr, "PANIC: %s:%d\n", __FILE__, __LINE__);  \
+        pw_print_status(stderr, &current_task->status);  \
+        abort();  \
+    } while (false)
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_string(unsigned length, uint8_t char_size, char32_t last_char, PwValuePtr result)
+/*
+ * Create string of `length` characters of `char_size` that ends with `last_char`.
+ */
+{
+    static char32_t wide_chars[] = { 0, 'b', 0x3b1, 0x10348, 0x1000000 };
+
+    if (!pw_create_empty_string(length, char_size, result)) {
+        panic();
+    }
+    for (unsigned i = 0; i < length - 1; i++) {
+        char32_t c = (i == length / 2)? wide_chars[char_size] : 'a';
+        if (!pw_string_append(result, c)) {
+            panic();
+        }
+    }
+    if (!pw_string_append(result, last_char)) {
+        panic();
+    }
+}
+
+static void bench_strchr(unsigned length, uint8_t char_size)
+{
+    PwValue str = PW_NULL;
+    make_string(length, char_size, 'x', &str);
+    unsigned repeat = 100'000'000 / length + 1;
+
+    double start = now();
+    for (unsigned i = 0; i < repeat; i++) {
+        unsigned pos;
+        if (!pw_strchr(&str, 'x', 0, &pos) || pos != length - 1) {
+            panic();
+        }
+    }
+    double strchr_gbs = (double) length * char_size * repeat / (now() - start) / 1e9;
+
+    start = now();
+    for (unsigned i = 0; i < repeat; i++) {
+        unsigned pos;
+        uint8_t max_char_size;
+        if (!pw_strchr2(&str, 'x', 0, &pos, &max_char_size) || max_char_size != char_size) {
+            panic();
+        }
+    }
+    double strchr2_gbs = (double) length * char_size * repeat / (now() - start) / 1e9;
+
+    // rsplit scans the whole string when the splitter is at the beginning
+    PwValue rstr = PW_NULL;
+    if (!pw_create_string("x", &rstr) || !pw_string_append(&rstr, &str)) {
+        panic();
+    }
+    start = now();
+    for (unsigned i = 0; i < repeat; i++) {{
+        PwValue parts = PW_NULL;
+        if (!pw_string_rsplit_chr(&rstr, 'y', 1, &parts)) {
+            panic();
+        }
+    }}
+    double rsplit_gbs = (double) length * char_size * repeat / (now() - start) / 1e9;
+
+    printf("%9u chars of %u bytes: strchr %6.2f GB/s, strchr2 %6.2f GB/s, rsplit (not found) %6.2f GB/s\n",
+           length, char_size, strchr_gbs, strchr2_gbs, rsplit_gbs);
+}
+
+static void make_text(unsigned length, uint8_t char_size, PwValuePtr result)
+/*
+ * Create string of `length` characters that looks like words.
+ */
+{
+    static char32_t wide_chars[] = { 0, 'b', 0x3b1, 0x10348, 0x1000000 };
+
+    if (!pw_create_empty_string(length, char_size, result)) {
+        panic();
+    }
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < length; i++) {
+        seed = seed * 1103515245 + 12345;
+        unsigned n = (seed >> 16) % 8;
+        char32_t c = (n == 0)? ' ' : 'a' + (seed >> 20) % 16;
+        if (i == length / 2) {
+            c = wide_chars[char_size];
+        }
+        if (!pw_string_append(result, c)) {
+            panic();
+        }
+    }
+}
+
+static double strstr_gbs(PwValuePtr str, PwValuePtr substr, bool case_insensitive)
+{
+    unsigned length = pw_strlen(str);
+    unsigned repeat = 100'000'000 / length + 1;
+    double start = now();
+    for (unsigned i = 0; i < repeat; i++) {
+        unsigned pos;
+        bool found = case_insensitive? pw_strstri(str, substr, 0, &pos) : pw_strstr(str, substr, 0, &pos);
+        if (!found || pos != length - pw_strlen(substr)) {
+            panic();
+        }
+    }
+    return (double) length * str->char_size * repeat / (now() - start) / 1e9;
+}
+
+static void bench_strstr(unsigned length, uint8_t char_size)
+{
+    // text with the substring at the end
+    PwValue text = PW_NULL;
+    make_text(length, char_size, &text);
+    PwValue word = PW_NULL;
+    PwValue long_word = PW_NULL;
+    if (!pw_create_string("needle", &word)
+        || !pw_create_string("a needle that is too long for the vector filter", &long_word)) {
+        panic();
+    }
+    PwValue text_word = PW_NULL;
+    PwValue text_long_word = PW_NULL;
+    if (!pw_strcat(&text_word, pw_clone(&text), pw_clone(&word))
+        || !pw_strcat(&text_long_word, pw_clone(&text), pw_clone(&long_word))) {
+        panic();
+    }
+    double short_gbs = strstr_gbs(&text_word, &word, false);
+    double long_gbs = strstr_gbs(&text_long_word, &long_word, false);
+    double icase_gbs = strstr_gbs(&text_word, &word, true);
+
+    // aaa...a with aaa...ab at the end
+    PwValue repetitive = PW_NULL;
+    PwValue pattern = PW_NULL;
+    if (!pw_create_empty_string(length, char_size, &repetitive) || !pw_create_string("", &pattern)) {
+        panic();
+    }
+    for (unsigned i = 0; i < length; i++) {
+        if (!pw_string_append(&repetitive, 'a')) {
+            panic();
+        }
+    }
+    for (unsigned i = 0; i < 30; i++) {
+        if (!pw_string_append(&pattern, 'a')) {
+            panic();
+        }
+    }
+    if (!pw_string_append(&pattern, 'b') || !pw_string_append(&repetitive, &pattern)) {
+        panic();
+    }
+    double repetitive_gbs = strstr_gbs(&repetitive, &pattern, false);
+
+    printf("%9u chars of %u bytes: strstr short %6.2f GB/s, long %6.2f GB/s, "
+           "case-insensitive %6.2f GB/s, repetitive %6.2f GB/s\n",
+           length, char_size, short_gbs, long_gbs, icase_gbs, repetitive_gbs);
+}
+
+static void utf8_gbs(PwValuePtr str, double* decode_gbs, double* encode_gbs)
+/*
+ * Measure conversion of `str` from and to UTF-8, return UTF-8 bytes per second.
+ */
+{
+    CString utf8 = pw_string_to_utf8(str);
+    unsigned size = strlen(utf8);
+    unsigned repeat = 100'000'000 / size + 1;
+    double start = now();
+    for (unsigned i = 0; i < repeat; i++) {{
+        PwValue decoded = PW_NULL;
+        if (!pw_create_string((char8_t*) utf8, &decoded) || pw_strlen(&decoded) != pw_strlen(str)) {
+            panic();
+        }
+    }}
+    *decode_gbs = (double) size * repeat / (now() - start) / 1e9;
+
+    start = now();
+    for (unsigned i = 0; i < repeat; i++) {{
+        CString encoded = pw_string_to_utf8(str);
+        if (!encoded) {
+            panic();
+        }
+    }}
+    *encode_gbs = (double) size * repeat / (now() - start) / 1e9;
+}
+
+static void bench_utf8(unsigned length, uint8_t char_size)
+{
+    // text with one wide char
+    PwValue text = PW_NULL;
+    make_text(length, char_size, &text);
+
+    // all letters are wide: latin-1, thai, and emoji
+    static char32_t wide_letters[] = { 0, 0xe0, 0xe01, 0x1f600 };
+    PwValue wide_text = PW_NULL;
+    if (!pw_create_empty_string(length, char_size, &wide_text)) {
+        panic();
+    }
+    for (unsigned i = 0; i < length; i++) {
+        char32_t c = pw_char_at(&text, i);
+        if ('a' <= c && c <= 'z') {
+            c += wide_letters[char_size] - 'a';
+        }
+        if (!pw_string_append(&wide_text, c)) {
+            panic();
+        }
+    }
+    double text_decode_gbs, text_encode_gbs, wide_decode_gbs, wide_encode_gbs;
+    utf8_gbs(&text, &text_decode_gbs, &text_encode_gbs);
+    utf8_gbs(&wide_text, &wide_decode_gbs, &wide_encode_gbs);
+
+    printf("%9u chars of %u bytes: from UTF-8 %6.2f GB/s, to UTF-8 %6.2f GB/s, "
+           "wide text from UTF-8 %6.2f GB/s, to UTF-8 %6.2f GB/s\n",
+           length, char_size, text_decode_gbs, text_encode_gbs, wide_decode_gbs, wide_encode_gbs);
+}
+
+static void bench_finder(unsigned num_strings)
+/*
+ * Search one substring in many short strings.
+ */
+{
+    PwValue strings = PW_NULL;
+    if (!pw_create_array(&strings)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_strings; i++) {{
+        PwValue str = PW_NULL;
+        make_text(100, 1, &str);
+        if (!pw_array_append(&strings, &str)) {
+            panic();
+        }
+    }}
+    PwValue substr = PW_NULL;
+    if (!pw_create_string("a substring that is not there", &substr)) {
+        panic();
+    }
+    double start = now();
+    for (unsigned i = 0; i < num_strings; i++) {{
+        PwValue str = PW_NULL;
+        if (!pw_array_item(&strings, i, &str)) {
+            panic();
+        }
+        if (pw_strstr(&str, &substr, 0, nullptr)) {
+            panic();
+        }
+    }}
+    double strstr_ns = (now() - start) * 1e9 / num_strings;
+
+    PwStringFinder finder;
+    if (!pw_create_string_finder(&substr, false, &finder)) {
+        panic();
+    }
+    start = now();
+    for (unsigned i = 0; i < num_strings; i++) {{
+        PwValue str = PW_NULL;
+        if (!pw_array_item(&strings, i, &str)) {
+            panic();
+        }
+        if (pw_string_find(&finder, &str, 0, nullptr)) {
+            panic();
+        }
+    }}
+    double finder_ns = (now() - start) * 1e9 / num_strings;
+    pw_destroy_string_finder(&finder);
+
+    printf("%u strings of 100 chars: strstr %.1f ns, precompiled %.1f ns\n", num_strings, strstr_ns, finder_ns);
+}
+
+static void bench_headers(unsigned repeat)
+/*
+ * Look up header names of a request in a list of known names.
+ */
+{
+    static char* known_names[] = {
+        "accept", "accept-encoding", "accept-language", "authorization", "cache-control",
+        "connection", "content-length", "content-type", "cookie", "host",
+        "if-modified-since", "if-none-match", "referer", "user-agent", "x-forwarded-for"
+    };
+    static char* request_names[] = {
+        "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding",
+        "Referer", "Connection", "Cookie", "If-Modified-Since", "X-Requested-With"
+    };
+    unsigned num_known = sizeof(known_names) / sizeof(known_names[0]);
+    unsigned num_request = sizeof(request_names) / sizeof(request_names[0]);
+
+    PwValue known = PW_NULL;
+    PwValue request = PW_NULL;
+    if (!pw_create_array(&known) || !pw_create_array(&request)) {
+        panic();
+    }
+    for (unsigned i = 0; i < num_known; i++) {{
+        PwValue name = PW_NULL;
+        if (!pw_create_string(known_names[i], &name) || !pw_array_append(&known, &name)) {
+            panic();
+        }
+    }}
+    for (unsigned i = 0; i < num_request; i++) {{
+        PwValue name = PW_NULL;
+        if (!pw_create_string(request_names[i], &name) || !pw_array_append(&request, &name)) {
+            panic();
+        }
+    }}
+    unsigned found = 0;
+    double start = now();
+    for (unsigned r = 0; r < repeat; r++) {
+        for (unsigned i = 0; i < num_request; i++) {{
+            PwValue name = PW_NULL;
+            if (!pw_array_item(&request, i, &name)) {
+                panic();
+            }
+            unsigned length = pw_strlen(&name);
+            for (unsigned j = 0; j < num_known; j++) {{
+                PwValue known_name = PW_NULL;
+                if (!pw_array_item(&known, j, &known_name)) {
+                    panic();
+                }
+                if (pw_strlen(&known_name) == length && pw_startswithi(&name, &known_name)) {
+                    found++;
+                    break;
+                }
+            }}
+        }}
+    }
+    double elapsed = now() - start;
+    if (found != (num_request - 1) * repeat) {
+        panic();
+    }
+    printf("header lookup: %.1f ns per header\n", elapsed * 1e9 / (repeat * num_request));
+}
+
+static void bench_case(unsigned length, uint8_t char_size)
+{
+    PwValue text = PW_NULL;
+    make_text(length, char_size, &text);
+    unsigned repeat = 10'000'000 / length + 1;
+    double start = now();
+    for (unsigned i = 0; i < repeat; i++) {
+        if (!pw_string_upper(&text) || !pw_string_lower(&text)) {
+            panic();
+        }
+    }
+    double case_gbs = 2.0 * length * char_size * repeat / (now() - start) / 1e9;
+
+    // spaces on both ends
+    PwValue spaces = PW_NULL;
+    if (!pw_create_empty_string(2 * length + 1, char_size, &spaces)) {
+        panic();
+    }
+    for (unsigned i = 0; i <= 2 * length; i++) {
+        if (!pw_string_append(&spaces, (i == length)? 'x' : (i % 2)? ' ' : 0xa0)) {
+            panic();
+        }
+    }
+    start = now();
+    for (unsigned i = 0; i < repeat; i++) {{
+        PwValue str = pw_clone(&spaces);
+        if (!pw_string_trim(&str) || pw_strlen(&str) != 1) {
+            panic();
+        }
+    }}
+    double trim_gbs = 2.0 * length * char_size * repeat / (now() - start) / 1e9;
+
+    printf("%9u chars of %u bytes: upper/lower %6.2f GB/s, trim %6.2f GB/s\n", length, char_size, case_gbs, trim_gbs);
+}
+
+int main(int argc, char* argv[])
+{
+    init_allocator(&pet_allocator);
+
+    unsigned length = 1'000'000;
+    if (argc > 1) {
+        length = strtoul(argv[1], nullptr, 10);
+    }
+    for (uint8_t char_size = 1; char_size <= 4; char_size++) {
+        bench_strchr(length, char_size);
+    }
+    for (uint8_t char_size = 1; char_size <= 4; char_size++) {
+        bench_strstr(length, char_size);
+    }
+    bench_finder(100'000);
+    bench_headers(100'000);
+    for (uint8_t char_size = 1; char_size <= 4; char_size++) {
+        bench_case(length, char_size);
+    }
+    for (uint8_t char_size = 1; char_size <= 3; char_size++) {
+        bench_utf8(length, char_size);
+    }
+    return 0;
+}
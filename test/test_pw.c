@@ -1,4 +1,7 @@
+#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -9,8 +12,13 @@
 #include "include/pw_socket.h"
 #include "include/pw_to_json.h"
 #include "include/pw_utf.h"
+#include "src/pw_map_internal.h"
 #include "src/string/pw_string_internal.h"
 
+#ifdef PW_WITH_ICU
+#   include <unicode/uchar.h>
+#endif
+
 int num_tests = 0;
 int num_ok = 0;
 int num_fail = 0;
@@ -36,16 +44,58 @@ bool print_ok = false;
         abort();  \
     } while (false)
 
-void test_icu()
+void test_unicode()
 {
+    TEST(pw_isspace(' '));
+    TEST(pw_isspace(0x2003));  // EM SPACE
+    TEST(!pw_isspace(0));
+    TEST(pw_isalpha(0x3b1));
+    TEST(pw_isdigit(0xe51));   // THAI DIGIT ONE
+    TEST(!pw_isalnum('_'));
+    TEST(pw_ispunct('_'));
+    TEST(pw_char_upper(0x3b1) == 0x391);
+    TEST(pw_char_lower(0x130) == 'i');     // LATIN CAPITAL LETTER I WITH DOT ABOVE
+    TEST(pw_char_lower(0x212a) == 'k');    // KELVIN SIGN
+    TEST(pw_char_upper(0xdf) == 0xdf);     // sharp s has no single-character upper case
+    TEST(pw_char_upper(0x1f80) == 0x1f88);
+    TEST(pw_char_lower(0x1e921) == 0x1e943);  // ADLAM
+    TEST(!pw_isprint(0x1000000));
+    TEST(pw_char_lower(0x1000000) == 0x1000000);
+
+    // 1-byte strings are classified with the same tables
+    PwValue nbsp = PW_NULL;
+    TEST(pw_create_string(U"\u00a0 x \u00a0", &nbsp));
+    TEST(nbsp.char_size == 1);
+    PwValue latin1_spaces = PW_NULL;
+    TEST(pw_create_string(U"\u00a0\x85", &latin1_spaces));
+    TEST(pw_string_isspace(&latin1_spaces));
+    TEST(pw_string_skip_spaces(&nbsp, 0) == 2);
+    TEST(pw_string_trim(&nbsp));
+    TEST(pw_equal(&nbsp, "x"));
+
 #   ifdef PW_WITH_ICU
         puts("With ICU");
-        TEST(pw_isspace(' '));
-        TEST(pw_isspace(0x2003));
+        // compare code points assigned up to the version of tables
+        for (char32_t c = 0; c <= 0x10FFFF; c++) {
+            UVersionInfo age;
+            u_charAge(c, age);
+            if (age[0] > pw_unicode_version[0] || (age[0] == pw_unicode_version[0] && age[1] > pw_unicode_version[1])) {
+                continue;
+            }
+            TEST(pw_isspace(c) == (bool) u_isspace(c));
+            TEST(pw_isblank(c) == (bool) u_isblank(c));
+            TEST(pw_isalpha(c) == (bool) u_isalpha(c));
+            TEST(pw_isdigit(c) == (bool) u_isdigit(c));
+            TEST(pw_isalnum(c) == (bool) u_isalnum(c));
+            TEST(pw_ispunct(c) == (bool) u_ispunct(c));
+            TEST(pw_iscntrl(c) == (bool) u_iscntrl(c));
+            TEST(pw_isgraph(c) == (bool) u_isgraph(c));
+            TEST(pw_isprint(c) == (bool) u_isprint(c));
+            TEST(pw_char_lower(c) == (char32_t) u_tolower(c));
+            TEST(pw_char_upper(c) == (char32_t) u_toupper(c));
+        }
 #   else
         puts("Without ICU");
-        TEST(pw_isspace(' '));
-        TEST(!pw_isspace(0x2003));
 #   endif
 }
 
@@ -375,6 +425,33 @@ void test_integral_types()
     TEST(!pw_equal(&f_1, -1.0f));
 }
 
+static unsigned naive_strstr(char32_t* str, unsigned str_len, char32_t* substr, unsigned substr_len, unsigned start_pos, bool case_insensitive)
+/*
+ * Reference substring search for ASCII-compatible test data,
+ * return UINT_MAX if not found.
+ */
+{
+    for (unsigned i = start_pos; i + substr_len <= str_len; i++) {
+        unsigned j = 0;
+        while (j < substr_len) {
+            char32_t a = str[i + j];
+            char32_t b = substr[j];
+            if (case_insensitive && a < 128 && b < 128) {
+                a = tolower(a);
+                b = tolower(b);
+            }
+            if (a != b) {
+                break;
+            }
+            j++;
+        }
+        if (j == substr_len) {
+            return i;
+        }
+    }
+    return UINT_MAX;
+}
+
 void test_string()
 {
     // zero is not space
@@ -643,6 +720,17 @@ void test_string()
         TEST(v.char_size == 3);
         //pw_dump(stderr, &v);
     }
+    { // comparison of char_size=3 with C strings
+        PwValue v = PW_NULL;
+        TEST(pw_create_string(U"\U00010400abc", &v));
+        TEST(v.char_size == 3);
+        TEST(pw_equal(&v, U"\U00010400abc"));
+        TEST(!pw_equal(&v, U"\U00010400abd"));
+        TEST(!pw_equal(&v, U"\U00010400ab"));
+        TEST(pw_startswith(&v, U"\U00010400a"));
+        TEST(pw_startswithi(&v, U"\U00010400AB"));
+        TEST(!pw_startswithi(&v, U"\U00010400AD"));
+    }
 
     { // testing char_size=4
         PwValue v = PW_NULL;
@@ -738,6 +826,58 @@ void test_string()
         TEST(pw_equal(&v, U"สบาย/สบาย/yo/yo"));
     }
 
+    { // vectorized strchr
+        // long strings of 'a' with one wide char at position 50 and 'x' at position i,
+        // to test both vector and scalar paths of all char sizes
+        char32_t wide_chars[] = { 0x3b1, 0x10348, 0x1000000 };
+        for (unsigned w = 0; w < 3; w++) {
+            uint8_t char_size = w + 2;
+            for (unsigned i = 0; i < 100; i++) {
+                if (i == 50) {
+                    continue;
+                }
+                PwValue str = PW_NULL;
+                TEST(pw_create_empty_string(100, char_size, &str));
+                for (unsigned j = 0; j < 100; j++) {
+                    char32_t c = 'a';
+                    if (j == 50) {
+                        c = wide_chars[w];
+                    } else if (j == i) {
+                        c = 'x';
+                    }
+                    TEST(pw_string_append(&str, c));
+                }
+                TEST(str.char_size == char_size);
+                unsigned pos = 0;
+                TEST(pw_strchr(&str, 'x', 0, &pos));
+                TEST(pos == i);
+                TEST(pw_strchr(&str, 'x', i, &pos));
+                TEST(pos == i);
+                TEST(!pw_strchr(&str, 'x', i + 1, nullptr));
+                TEST(!pw_strchr(&str, 'y', 0, nullptr));
+                TEST(pw_strchr(&str, wide_chars[w], 0, &pos));
+                TEST(pos == 50);
+
+                uint8_t max_char_size = 0;
+                TEST(pw_strchr2(&str, 'x', 0, &pos, &max_char_size));
+                TEST(pos == i);
+                TEST(max_char_size == ((i > 50)? char_size : 1));
+                TEST(!pw_strchr2(&str, 'y', 0, &pos, &max_char_size));
+                TEST(max_char_size == char_size);
+
+                if (i) {
+                    PwValue parts = PW_NULL;
+                    TEST(pw_string_rsplit_chr(&str, 'x', 1, &parts));
+                    TEST(pw_array_length(&parts) == 2);
+                    PwValue tail = PW_NULL;
+                    TEST(pw_array_item(&parts, 1, &tail));
+                    TEST(pw_strlen(&tail) == 99 - i);
+                    TEST(tail.char_size == ((i < 50)? char_size : 1));
+                }
+            }
+        }
+    }
+
     // test append_buffer
     {
         char8_t data[2500];
@@ -918,6 +1058,322 @@ void test_string()
         _pw_string_set_length(&str, 35);
         TEST(!pw_strstr(&str, "z", 0, &pos));
     }
+    { // substring search engine
+        // compare with naive search on small alphabets that make periodic substrings,
+        // with haystacks of all char sizes and substrings shorter and longer
+        // than vector filter can handle
+        char32_t wide_chars[] = { 0, 'z', 0x3b1, 0x10348, 0x1000000 };
+        char32_t str_chars[301];
+        char32_t substr_chars[101];
+        uint32_t seed = 1;
+        for (unsigned trial = 0; trial < 3000; trial++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned alphabet = (seed >> 16) % 3 + 2;
+            seed = seed * 1103515245 + 12345;
+            unsigned str_len = (seed >> 16) % 300;
+            seed = seed * 1103515245 + 12345;
+            unsigned substr_len = (seed >> 16) % ((trial % 4)? 40 : 100) + 1;
+            uint8_t char_size = trial % 4 + 1;
+            bool case_insensitive = trial % 5 == 0;
+            for (unsigned i = 0; i < str_len; i++) {
+                seed = seed * 1103515245 + 12345;
+                str_chars[i] = 'a' + (seed >> 16) % alphabet;
+                if (case_insensitive && ((seed >> 28) & 1)) {
+                    str_chars[i] = toupper(str_chars[i]);
+                }
+            }
+            if (str_len) {
+                str_chars[str_len / 2] = wide_chars[char_size];
+            }
+            str_chars[str_len] = 0;
+            seed = seed * 1103515245 + 12345;
+            if (substr_len <= str_len && (seed >> 16) % 2) {
+                // take substring from str, it may contain the wide char
+                seed = seed * 1103515245 + 12345;
+                unsigned start = (seed >> 16) % (str_len - substr_len + 1);
+                memcpy(substr_chars, &str_chars[start], substr_len * sizeof(char32_t));
+            } else {
+                for (unsigned i = 0; i < substr_len; i++) {
+                    seed = seed * 1103515245 + 12345;
+                    substr_chars[i] = 'a' + (seed >> 16) % alphabet;
+                }
+            }
+            if (case_insensitive) {
+                for (unsigned i = 0; i < substr_len; i += 2) {
+                    if (substr_chars[i] < 128) {
+                        substr_chars[i] = toupper(substr_chars[i]);
+                    }
+                }
+            }
+            substr_chars[substr_len] = 0;
+
+            PwValue str = PW_NULL;
+            TEST(pw_create_string(str_chars, &str));
+            PwValue substr = PW_NULL;
+            TEST(pw_create_string(substr_chars, &substr));
+            for (unsigned start_pos = 0; start_pos < 5; start_pos += 4) {
+                unsigned expected = naive_strstr(str_chars, str_len, substr_chars, substr_len, start_pos, case_insensitive);
+                unsigned pos = UINT_MAX;
+                bool found;
+                if (case_insensitive) {
+                    found = pw_strstri(&str, &substr, start_pos, &pos);
+                } else {
+                    found = pw_strstr(&str, &substr, start_pos, &pos);
+                }
+                TEST(found == (expected != UINT_MAX));
+                TEST(pos == expected);
+            }
+        }
+    }
+    { // precompiled substring
+        PwValue substr = PwStaticString("needle");
+        PwStringFinder finder;
+        TEST(pw_create_string_finder(&substr, false, &finder));
+        PwValue haystacks = PW_NULL;
+        TEST(pw_array_va(&haystacks,
+            PwStaticString("no match here"),
+            PwStaticString("a needle in a haystack"),
+            PwStaticStringUtf32(U"\u03b1\u03b2 needle"),
+            PwStaticString("needl"),
+            PwStaticString("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxneedle")
+        ));
+        unsigned expected[] = { UINT_MAX, 2, 3, UINT_MAX, 64 };
+        for (unsigned i = 0; i < 5; i++) {{
+            PwValue str = PW_NULL;
+            TEST(pw_array_item(&haystacks, i, &str));
+            unsigned pos = UINT_MAX;
+            TEST(pw_string_find(&finder, &str, 0, &pos) == (expected[i] != UINT_MAX));
+            TEST(pos == expected[i]);
+        }}
+        pw_destroy_string_finder(&finder);
+
+        // C strings
+        PwValue str = PwStaticString("Hello, World!");
+        unsigned pos;
+        TEST(pw_strstr(&str, "World", 0, &pos));
+        TEST(pos == 7);
+        TEST(pw_strstri(&str, "WORLD", 0, &pos));
+        TEST(pos == 7);
+        TEST(pw_strstri(&str, U"hello", 0, &pos));
+        TEST(pos == 0);
+        TEST(!pw_strstri(&str, "hello", 1, &pos));
+        TEST(!pw_strstr(&str, "", 0, &pos));
+    }
+    { // case conversion
+        // wide chars have case, except the 4-byte one
+        char32_t wide_chars[] = { 0, 0xc0, 0x391, 0x10400, 0x1000000 };
+        for (uint8_t char_size = 1; char_size <= 4; char_size++) {
+            for (unsigned length = 2; length < 40; length += 37) {{
+                // short strings are embedded, long ones are copied on write
+                char32_t chars[41];
+                char32_t lower_chars[41];
+                char32_t upper_chars[41];
+                for (unsigned i = 0; i < length; i++) {
+                    chars[i] = (i == length / 2)? wide_chars[char_size] : (char32_t) "Hello, World!"[i % 13];
+                    lower_chars[i] = pw_char_lower(chars[i]);
+                    upper_chars[i] = pw_char_upper(chars[i]);
+                }
+                chars[length] = 0;
+                lower_chars[length] = 0;
+                upper_chars[length] = 0;
+                TEST(lower_chars[length / 2] != upper_chars[length / 2] || char_size == 4);
+
+                PwValue str = PW_NULL;
+                TEST(pw_create_string(chars, &str));
+                TEST(str.char_size == char_size);
+                PwValue lower = pw_clone(&str);
+                TEST(pw_string_lower(&lower));
+                TEST(pw_equal(&lower, lower_chars));
+                PwValue upper = pw_clone(&str);
+                TEST(pw_string_upper(&upper));
+                TEST(pw_equal(&upper, upper_chars));
+                TEST(pw_equal(&str, chars));
+            }}
+        }
+    }
+    { // case-insensitive comparison
+        char32_t text[] = U"Content-Type: Application/JSON; Charset=UTF-8";
+        char32_t lower_text[] = U"content-type: application/json; charset=utf-8";
+        unsigned length = utf32_strlen(text);
+        char32_t wide_chars[] = { 0, '=', 0x2192, 0x10348, 0x1000000 };
+        char32_t middle_char = text[length / 2];
+
+        for (uint8_t char_size = 1; char_size <= 4; char_size++) {
+            // put a wide char in the middle to make strings of char_size
+            text[length / 2] = wide_chars[char_size];
+            lower_text[length / 2] = wide_chars[char_size];
+            for (unsigned n = 1; n <= length; n += (n < 20)? 1 : 7) {
+                for (unsigned mismatch = 0; mismatch <= n; mismatch++) {{
+                    // mismatch == n means no mismatch
+                    PwValue a = PW_NULL;
+                    TEST(pw_create_string(text, &a));
+                    char32_t b_chars[64];
+                    memcpy(b_chars, lower_text, n * sizeof(char32_t));
+                    b_chars[n] = 0;
+                    if (mismatch < n) {
+                        b_chars[mismatch] = '#';
+                    }
+                    PwValue b = PW_NULL;
+                    TEST(pw_create_string(b_chars, &b));
+                    TEST(pw_substring_eqi(&a, 0, n, &b) == (mismatch == n));
+                }}
+            }
+        }
+        text[length / 2] = middle_char;
+
+        PwValue str = PW_NULL;
+        TEST(pw_create_string(text, &str));
+        TEST(pw_startswithi(&str, "CONTENT-type"));
+        TEST(pw_startswithi(&str, U"content-TYPE"));
+        TEST(!pw_startswithi(&str, "content-typo"));
+        TEST(pw_endswithi(&str, "charset=utf-8"));
+        TEST(!pw_endswithi(&str, "charset=utf-16"));
+        TEST(pw_substring_eqi(&str, 14, 30, "APPLICATION/json"));
+        TEST(!pw_substring_eqi(&str, 14, 30, "APPLICATION/jsin"));
+
+        unsigned pos;
+        TEST(pw_strchri(&str, 'J', 0, &pos));
+        TEST(pos == 26);
+        TEST(pw_strchri(&str, 'j', 0, &pos));
+        TEST(pos == 26);
+        TEST(!pw_strchri(&str, 'q', 0, &pos));
+        TEST(pw_strstri(&str, "application/JSON", 0, &pos));
+        TEST(pos == 14);
+        TEST(pw_strstri(&str, "CHARSET", 0, &pos));
+        TEST(pos == 32);
+
+        // non-ASCII characters whose lower case is ASCII
+        PwValue kelvin = PwStaticStringUtf32(U"xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\u212axxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+        TEST(pw_strchri(&kelvin, 'k', 0, &pos));
+        TEST(pos == 30);
+        TEST(pw_strstri(&kelvin, "XKX", 0, &pos));
+        TEST(pos == 29);
+        TEST(pw_strstri(&kelvin, "xxxxkxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", 0, &pos));
+        TEST(pos == 26);
+
+        PwValue latin1 = PwStaticStringUtf32(U"\u00c0\u00c9\u00ce\u00d5\u00dc-ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+        TEST(pw_substring_eqi(&latin1, 0, 32, U"\u00e0\u00e9\u00ee\u00f5\u00fc-abcdefghijklmnopqrstuvwxyz"));
+        TEST(!pw_substring_eqi(&latin1, 0, 32, U"\u00e0\u00e9\u00ee\u00f5\u00fd-abcdefghijklmnopqrstuvwxyz"));
+    }
+    { // UTF-8 conversion
+        char32_t wide_chars[] = { 0, 0xe9, 0xe2a, 0x1f64f };
+        for (uint8_t char_size = 1; char_size <= 3; char_size++) {
+            for (unsigned length = 1; length < 100; length += (length < 40)? 1 : 13) {
+                for (unsigned wide_pos = 0; wide_pos <= length; wide_pos += 3) {{
+                    // wide_pos >= length means ASCII string
+                    char32_t chars[100];
+                    for (unsigned i = 0; i < length; i++) {
+                        chars[i] = (i == wide_pos)? wide_chars[char_size] : (char32_t) "Hello, World!"[i % 13];
+                    }
+                    chars[length] = 0;
+                    PwValue str = PW_NULL;
+                    TEST(pw_create_string(chars, &str));
+
+                    CString utf8 = pw_string_to_utf8(&str);
+                    TEST(strlen(utf8) == pw_strlen_in_utf8(&str));
+
+                    PwValue decoded = PW_NULL;
+                    TEST(pw_create_string((char8_t*) utf8, &decoded));
+                    TEST(decoded.char_size == ((wide_pos < length)? char_size : 1));
+                    TEST(pw_equal(&decoded, &str));
+
+                    PwValue wide = PW_NULL;
+                    TEST(pw_create_empty_string(0, 4, &wide));
+                    TEST(pw_string_append(&wide, (char8_t*) utf8, nullptr));
+                    TEST(wide.char_size == 4);
+                    TEST(pw_equal(&wide, &str));
+                }}
+            }
+        }
+
+        // invalid sequences are skipped
+        struct {
+            char* utf8;
+            char32_t* expected;
+        } invalid[] = {
+            { "a\xff" "b",                      U"ab" },
+            { "\xc0\x80z",                      U"z" },       // overlong zero
+            { "\xe0\x9f\xbf!",                  U"!" },       // overlong U+07FF
+            { "\xed\xa0\x80.",                  U"." },       // surrogate
+            { "\xf4\x90\x80\x80.",              U"." },       // beyond U+10FFFF
+            { "x\xc3",                          U"x" },       // incomplete
+            { "x\xe0\xb8",                      U"x" },
+            { "\xc3(\xc3\xa9",                  U"(\u00e9" },
+            { "\xe0\xb8\xaa\x80\xf0\x9f\x99\x8f", U"\u0e2a\U0001f64f" }
+        };
+        for (unsigned i = 0; i < PW_LENGTH(invalid); i++) {{
+            PwValue str = PW_NULL;
+            TEST(pw_create_string((char8_t*) invalid[i].utf8, &str));
+            TEST(pw_equal(&str, invalid[i].expected));
+
+            // same in the middle of long string
+            char buf[100];
+            memset(buf, 'a', 40);
+            strcpy(buf + 40, invalid[i].utf8);
+            PwValue long_str = PW_NULL;
+            TEST(pw_create_string((char8_t*) buf, &long_str));
+            TEST(pw_strlen(&long_str) == 40 + pw_strlen(&str));
+            TEST(pw_substring_eq(&long_str, 40, 100, &str));
+        }}
+
+        // latin-1 characters take two bytes
+        PwValue str = PW_NULL;
+        TEST(pw_create_string(U"caf\u00e9 cr\u00e8me br\u00fbl\u00e9e, na\u00efve fa\u00e7ade", &str));
+        TEST(str.char_size == 1);
+        CString utf8 = pw_string_to_utf8(&str);
+        TEST(strcmp(utf8, "caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e, na\xc3\xafve fa\xc3\xa7" "ade") == 0);
+    }
+}
+
+[[nodiscard]] static bool first_char_key(PwValuePtr item, PwValuePtr result)
+/*
+ * Sort key for stable sort tests.
+ */
+{
+    return pw_substr(item, 0, 1, result);
+}
+
+[[nodiscard]] static bool wrap_key(PwValuePtr item, PwValuePtr result)
+/*
+ * Sort key that makes pw_array_sort use generic comparison.
+ */
+{
+    PwValue first = PW_NULL;
+    if (!pw_substr(item, 0, 1, &first)) {
+        return false;
+    }
+    return pw_array_va(result, pw_clone(&first));
+}
+
+static PwValuePtr array_being_sorted = nullptr;
+
+[[nodiscard]] static bool modifying_key(PwValuePtr item, PwValuePtr result)
+/*
+ * Sort key that tries to modify the array being sorted.
+ */
+{
+    if (pw_array_append(array_being_sorted, item)) {
+        return true;
+    }
+    pw_clone2(item, result);
+    return true;
+}
+
+static bool array_is_sorted(PwValuePtr array)
+{
+    unsigned n = pw_array_length(array);
+    for (unsigned i = 1; i < n; i++) {{
+        PwValue a = PW_NULL;
+        PwValue b = PW_NULL;
+        int result;
+        if (!pw_array_item(array, i - 1, &a) || !pw_array_item(array, i, &b) || !pw_compare(&a, &b, &result)) {
+            panic();
+        }
+        if (result > 0) {
+            return false;
+        }
+    }}
+    return true;
 }
 
 void test_array()
@@ -1082,6 +1538,804 @@ void test_array()
         TEST(pw_equal(&v, " first line,second line,  third line"));
         //pw_dump(stderr, &v);
     }
+    { // deque
+        PwValue queue = PW_NULL;
+        if (!pw_create_array(&queue)) {
+            panic();
+        }
+        _PwArray* a = get_array_struct_ptr(&queue);
+
+        // queue: append and pull, the array does not grow
+        unsigned next_in = 0;
+        unsigned next_out = 0;
+        for (unsigned i = 0; i < 1000; i++) {
+            for (unsigned j = 0; j < 3; j++) {
+                if (!pw_array_append(&queue, next_in++)) {
+                    panic();
+                }
+            }
+            for (unsigned j = 0; j < 2; j++) {
+                PwValue v = PW_NULL;
+                TEST(pw_array_pull(&queue, &v));
+                TEST(v.unsigned_value == next_out++);
+            }
+        }
+        TEST(pw_array_length(&queue) == 1000);
+        TEST(a->head + a->capacity < 2048);
+        for (unsigned i = 0; i < 1000; i++) {
+            PwValue v = PW_NULL;
+            TEST(pw_array_item(&queue, i, &v));
+            TEST(v.unsigned_value == next_out + i);
+        }
+        while (pw_array_length(&queue)) {
+            PwValue v = PW_NULL;
+            TEST(pw_array_pull(&queue, &v));
+        }
+        TEST(a->head == 0);
+
+        // insert at front and in the first half
+        for (unsigned i = 0; i < 1000; i++) {
+            if (!pw_array_insert(&queue, 0, i)) {
+                panic();
+            }
+        }
+        TEST(a->head + a->capacity < 4096);
+        TEST(pw_array_insert(&queue, 1, "second"));
+        TEST(pw_array_insert(&queue, 1001, "last"));
+        PwValue v = PW_NULL;
+        TEST(pw_array_item(&queue, 0, &v));
+        TEST(pw_equal(&v, 999));
+        TEST(pw_array_item(&queue, 1, &v));
+        TEST(pw_equal(&v, "second"));
+        TEST(pw_array_item(&queue, 2, &v));
+        TEST(pw_equal(&v, 998));
+        TEST(pw_array_item(&queue, -1, &v));
+        TEST(pw_equal(&v, "last"));
+        TEST(pw_array_item(&queue, -2, &v));
+        TEST(pw_equal(&v, 0));
+        TEST(pw_array_pop(&queue, &v));
+        TEST(pw_equal(&v, "last"));
+        TEST(pw_array_pull(&queue, &v));
+        TEST(pw_equal(&v, 999));
+        TEST(pw_array_length(&queue) == 1000);
+
+        // head room is released on shrink
+        TEST(pw_array_shrink(&queue));
+        TEST(a->head == 0);
+        TEST(pw_array_item(&queue, 0, &v));
+        TEST(pw_equal(&v, "second"));
+        TEST(pw_array_item(&queue, 999, &v));
+        TEST(pw_equal(&v, 0));
+    }
+    { // packed arrays
+        PwValue source = PW_NULL;
+        if (!pw_create_array(&source)) {
+            panic();
+        }
+        for (int i = 0; i < 1000; i++) {
+            if (!pw_array_append(&source, i - 500)) {
+                panic();
+            }
+        }
+        PwValue packed = PW_NULL;
+        TEST(pw_packed_array_from_array(&source, PwTypeId_Signed, &packed));
+        TEST(pw_packed_array_length(&packed) == 1000);
+        TEST(pw_packed_array_data(&packed) != nullptr);
+
+        PwValue v = PW_NULL;
+        TEST(pw_packed_array_sum(&packed, &v));
+        TEST(pw_equal(&v, -500));
+        TEST(pw_packed_array_mean(&packed, &v));
+        TEST(v.float_value == -0.5);
+        TEST(pw_packed_array_min(&packed, &v));
+        TEST(pw_equal(&v, -500));
+        TEST(pw_packed_array_max(&packed, &v));
+        TEST(pw_equal(&v, 499));
+
+        // compare, filter, and gather
+        PwValue operand = PwSigned(490);
+        PwValue mask = PW_NULL;
+        TEST(pw_packed_array_compare(&packed, PW_CMP_GT, &operand, &mask));
+        TEST(pw_packed_array_length(&mask) == 1000);
+        TEST(pw_packed_array_sum(&mask, &v));
+        TEST(pw_equal(&v, 9u));
+        PwValue filtered = PW_NULL;
+        TEST(pw_packed_array_filter(&packed, &mask, &filtered));
+        TEST(pw_packed_array_length(&filtered) == 9);
+        TEST(pw_packed_array_item(&filtered, 0, &v));
+        TEST(pw_equal(&v, 491));
+        TEST(pw_packed_array_compare(&packed, PW_CMP_LE, &operand, &mask));
+        TEST(pw_packed_array_sum(&mask, &v));
+        TEST(pw_equal(&v, 991u));
+        TEST(pw_packed_array_compare(&packed, PW_CMP_EQ, &operand, &mask));
+        TEST(pw_packed_array_sum(&mask, &v));
+        TEST(pw_equal(&v, 1u));
+
+        PwValue indices = PW_NULL;
+        TEST(pw_create_packed_array(PwTypeId_Unsigned, &indices));
+        TEST(pw_packed_array_append(&indices, 999u));
+        TEST(pw_packed_array_append(&indices, 0u));
+        PwValue gathered = PW_NULL;
+        TEST(pw_packed_array_gather(&packed, &indices, &gathered));
+        TEST(pw_packed_array_item(&gathered, 0, &v));
+        TEST(pw_equal(&v, 499));
+        TEST(pw_packed_array_item(&gathered, 1, &v));
+        TEST(pw_equal(&v, -500));
+        TEST(pw_packed_array_append(&indices, 1000u));
+        TEST(!pw_packed_array_gather(&packed, &indices, &gathered));
+
+        // conversion back, deletion and equality
+        PwValue array = PW_NULL;
+        TEST(pw_packed_array_to_array(&packed, &array));
+        TEST(pw_equal(&array, &source));
+        PwValue copy = PW_NULL;
+        TEST(pw_deepcopy(&packed, &copy));
+        TEST(pw_equal(&copy, &packed));
+        pw_packed_array_del(&copy, 0, 10);
+        TEST(pw_packed_array_length(&copy) == 990);
+        TEST(!pw_equal(&copy, &packed));
+        TEST(pw_packed_array_item(&copy, 0, &v));
+        TEST(pw_equal(&v, -490));
+
+        // items must match item type
+        TEST(!pw_packed_array_append(&packed, 1.5));
+        TEST(!pw_packed_array_append(&packed, PW_UNSIGNED_MAX));
+        TEST(pw_packed_array_append(&packed, 1u));
+
+        // floats
+        PwValue floats = PW_NULL;
+        TEST(pw_create_packed_array(PwTypeId_Float, &floats));
+        for (unsigned i = 0; i < 101; i++) {
+            if (!pw_packed_array_append(&floats, i * 0.5)) {
+                panic();
+            }
+        }
+        TEST(pw_packed_array_append(&floats, -1));
+        TEST(pw_packed_array_sum(&floats, &v));
+        TEST(v.float_value == 2524.0);
+        TEST(pw_packed_array_min(&floats, &v));
+        TEST(v.float_value == -1.0);
+        TEST(pw_packed_array_max(&floats, &v));
+        TEST(v.float_value == 50.0);
+        PwValue limit = PwFloat(10.0);
+        TEST(pw_packed_array_compare(&floats, PW_CMP_LT, &limit, &mask));
+        TEST(pw_packed_array_sum(&mask, &v));
+        TEST(pw_equal(&v, 21u));
+
+        // equal arrays hash the same, -0.0 == 0.0
+        PwValue zeros = PW_NULL;
+        PwValue neg_zeros = PW_NULL;
+        TEST(pw_create_packed_array(PwTypeId_Float, &zeros));
+        TEST(pw_create_packed_array(PwTypeId_Float, &neg_zeros));
+        TEST(pw_packed_array_append(&zeros, 0.0));
+        TEST(pw_packed_array_append(&neg_zeros, -0.0));
+        TEST(pw_equal(&zeros, &neg_zeros));
+        TEST(pw_hash(&zeros) == pw_hash(&neg_zeros));
+
+        // bools
+        PwValue bools = PW_NULL;
+        TEST(pw_create_packed_array(PwTypeId_Bool, &bools));
+        for (unsigned i = 0; i < 130; i++) {
+            if (!pw_packed_array_append(&bools, (bool) (i < 3))) {
+                panic();
+            }
+        }
+        TEST(pw_packed_array_sum(&bools, &v));
+        TEST(pw_equal(&v, 3u));
+        TEST(pw_packed_array_min(&bools, &v));
+        TEST(pw_equal(&v, false));
+        TEST(pw_packed_array_max(&bools, &v));
+        TEST(pw_equal(&v, true));
+        PwValue f = PwBool(false);
+        TEST(pw_packed_array_compare(&bools, PW_CMP_EQ, &f, &mask));
+        TEST(pw_packed_array_sum(&mask, &v));
+        TEST(pw_equal(&v, 127u));
+        pw_packed_array_del(&bools, 1, 2);
+        TEST(pw_packed_array_length(&bools) == 129);
+        TEST(pw_packed_array_sum(&bools, &v));
+        TEST(pw_equal(&v, 2u));
+        TEST(pw_packed_array_item(&bools, 1, &v));
+        TEST(pw_equal(&v, true));
+        TEST(pw_packed_array_item(&bools, 2, &v));
+        TEST(pw_equal(&v, false));
+
+        // timestamps
+        PwValue timestamps = PW_NULL;
+        TEST(pw_create_packed_array(PwTypeId_Timestamp, &timestamps));
+        PwValue ts = PwTimestamp(1700000000, 5);
+        TEST(pw_packed_array_append(&timestamps, &ts));
+        ts = PwTimestamp(1600000000, 7);
+        TEST(pw_packed_array_append(&timestamps, &ts));
+        TEST(pw_packed_array_min(&timestamps, &v));
+        TEST(v.ts_seconds == 1600000000);
+        TEST(v.ts_nanoseconds == 7);
+        TEST(!pw_packed_array_sum(&timestamps, &v));
+
+        // RandomAccess interface
+        TEST(pw_get(&v, &packed, "-1"));
+        TEST(pw_equal(&v, 1));
+        TEST(pw_get(&v, &packed, "2"));
+        TEST(pw_equal(&v, -498));
+        TEST(!pw_get(&v, &packed, "1001"));
+        TEST(!pw_get(&v, &packed, "4294967296"));
+        TEST(current_task->status.status_code == PW_ERROR_INDEX_OUT_OF_RANGE);
+        TEST(!pw_get(&v, &packed, "-4294967296"));
+        TEST(current_task->status.status_code == PW_ERROR_INDEX_OUT_OF_RANGE);
+
+        PwValue strings = PW_NULL;
+        PwPackedArrayCtorArgs args = { .item_type = PwTypeId_String };
+        TEST(!pw_create2(PwTypeId_PackedArray, &args, &strings));
+    }
+    { // extend
+        PwValue dest = PW_NULL;
+        if (!pw_create_array(&dest)) {
+            panic();
+        }
+        PwValue src = PW_NULL;
+        if (!pw_create_array(&src)) {
+            panic();
+        }
+        PwValue nested = PW_NULL;
+        if (!pw_create_array(&nested)) {
+            panic();
+        }
+        for (unsigned i = 0; i < 100; i++) {
+            if (!pw_array_append(&src, i)) {
+                panic();
+            }
+        }
+        TEST(pw_array_append(&src, "a string that is too long to be embedded"));
+        TEST(pw_array_append(&src, &nested));
+
+        TEST(pw_array_extend(&dest, &src));
+        TEST(pw_array_length(&dest) == 102);
+        TEST(pw_equal(&dest, &src));
+
+        // extend with self
+        TEST(pw_array_extend(&dest, &dest));
+        TEST(pw_array_length(&dest) == 204);
+        PwValue v = PW_NULL;
+        TEST(pw_array_item(&dest, 102, &v));
+        TEST(pw_equal(&v, 0));
+        TEST(pw_array_item(&dest, -2, &v));
+        TEST(pw_equal(&v, "a string that is too long to be embedded"));
+        TEST(pw_array_item(&dest, -1, &v));
+        TEST(v.struct_data == nested.struct_data);
+        pw_destroy(&v);
+
+        // move values
+        _PwValue values[3] = { PwUnsigned(1), PW_NULL, PW_NULL };
+        TEST(pw_create_string("another string that is too long to be embedded", &values[1]));
+        TEST(pw_create_array(&values[2]));
+        TEST(pw_array_extend_move(&dest, values, 3));
+        TEST(pw_array_length(&dest) == 207);
+        TEST(pw_is_null(&values[0]));
+        TEST(pw_is_null(&values[1]));
+        TEST(pw_is_null(&values[2]));
+        TEST(pw_array_item(&dest, -2, &v));
+        TEST(pw_equal(&v, "another string that is too long to be embedded"));
+        TEST(pw_array_item(&dest, -1, &v));
+        TEST(pw_is_array(&v));
+
+        pw_array_del(&dest, 0, 103);
+        TEST(pw_array_length(&dest) == 104);
+        TEST(pw_array_extend_move(&dest, values, 0));
+        TEST(pw_array_length(&dest) == 104);
+        for (unsigned i = 0; i < PW_LENGTH(values); i++) {
+            pw_destroy(&values[i]);
+        }
+    }
+    { // slice views
+        PwValue array = PW_NULL;
+        if (!pw_create_array(&array)) {
+            panic();
+        }
+        for (unsigned i = 0; i < 100; i++) {
+            if (!pw_array_append(&array, i)) {
+                panic();
+            }
+        }
+        PwValue view = PW_NULL;
+        TEST(pw_array_slice_view(&array, 10, 20, &view));
+        TEST(pw_is_array_slice(&view));
+        TEST(pw_array_slice_length(&view) == 10);
+        PwValue v = PW_NULL;
+        TEST(pw_array_slice_item(&view, 0, &v));
+        TEST(pw_equal(&v, 10));
+        TEST(!pw_array_slice_item(&view, 10, &v));
+
+        // iteration
+        unsigned sum = 0;
+        unsigned count = 0;
+        {
+            PwArrayCursor cursor = pw_array_slice_cursor(&view);
+            while (pw_array_cursor_next(&cursor)) {
+                TEST(cursor.index == count);
+                sum += cursor.item->unsigned_value;
+                count++;
+            }
+            TEST(!pw_array_append(&array, 0));
+        }
+        TEST(count == 10);
+        TEST(sum == 145);
+
+        // view of view refers to the same array
+        PwValue subview = PW_NULL;
+        TEST(pw_array_slice_view(&view, 5, 100, &subview));
+        TEST(pw_array_slice_length(&subview) == 5);
+        TEST(pw_get(&v, &subview, "0"));
+        TEST(pw_equal(&v, 15));
+        TEST(pw_get(&v, &subview, "-1"));
+        TEST(pw_equal(&v, 19));
+        TEST(!pw_get(&v, &subview, "-6"));
+        TEST(!pw_get(&v, &subview, "5"));
+        TEST(!pw_get(&v, &subview, "4294967296"));
+
+        // views reflect changes of array
+        PwValue fifteen = PwStaticString("fifteen");
+        TEST(pw_array_set_item(&array, 15, &fifteen));
+        TEST(pw_array_slice_item(&subview, 0, &v));
+        TEST(pw_equal(&v, "fifteen"));
+        pw_array_del(&array, 12, 100);
+        TEST(pw_array_slice_length(&view) == 2);
+        TEST(pw_array_slice_length(&subview) == 0);
+
+        // writes materialize the view and do not affect array
+        PwValue eleven = PwStaticString("eleven");
+        TEST(pw_array_slice_set_item(&view, 1, &eleven));
+        TEST(pw_array_slice_item(&view, 1, &v));
+        TEST(pw_equal(&v, "eleven"));
+        TEST(pw_array_item(&array, 11, &v));
+        TEST(pw_equal(&v, 11));
+        pw_array_del(&array, 0, 100);
+        TEST(pw_array_slice_length(&view) == 2);
+
+        // conversion
+        PwValue copy = PW_NULL;
+        TEST(pw_array_slice_to_array(&view, &copy));
+        TEST(pw_is_array(&copy));
+        TEST(pw_array_length(&copy) == 2);
+        PwValue deep = PW_NULL;
+        TEST(pw_deepcopy(&view, &deep));
+        TEST(pw_equal(&deep, &view));
+    }
+    { // inline storage
+        PwValue small = PW_NULL;
+        if (!pw_create_array(&small)) {
+            panic();
+        }
+        _PwArray* a = get_array_struct_ptr(&small);
+        PwValuePtr inline_items = ((_PwArrayData*) a)->inline_items;
+        TEST(a->items == inline_items);
+        TEST(pw_array_append(&small, "inline"));
+        TEST(pw_array_insert(&small, 0, 0));
+        PwValue nested = PW_NULL;
+        TEST(pw_create_array(&nested));
+        TEST(pw_array_append(&small, &nested));
+        TEST(pw_array_append(&small, 3));
+        TEST(a->items == inline_items);
+        TEST(pw_array_length(&small) == 4);
+
+        PwValue copy = PW_NULL;
+        TEST(pw_deepcopy(&small, &copy));
+        TEST(get_array_struct_ptr(&copy)->inline_storage);
+        TEST(pw_equal(&copy, &small));
+
+        // spill to allocated block
+        TEST(pw_array_append(&small, 4));
+        TEST(!a->inline_storage);
+        TEST(a->items != inline_items);
+        PwValue v = PW_NULL;
+        TEST(pw_array_item(&small, 1, &v));
+        TEST(pw_equal(&v, "inline"));
+        TEST(pw_array_item(&small, 4, &v));
+        TEST(pw_equal(&v, 4));
+
+        // shrink back
+        TEST(pw_array_pull(&small, &v));
+        TEST(pw_array_shrink(&small));
+        TEST(a->inline_storage);
+        TEST(a->head == 0);
+        TEST(a->items == inline_items);
+        TEST(pw_array_item(&small, 0, &v));
+        TEST(pw_equal(&v, "inline"));
+        TEST(pw_array_item(&small, 3, &v));
+        TEST(pw_equal(&v, 4));
+    }
+    { // sort
+        int result;
+        PwValue one = PwSigned(1);
+        PwValue minus_one = PwSigned(-1);
+        PwValue big = PwUnsigned(0xFFFFFFFFFFFFFFFFULL);
+        PwValue half = PwFloat(0.5);
+        PwValue huge = PwFloat(1e300);
+        PwValue nan = PwFloat(NAN);
+        TEST(pw_compare(&one, &half, &result) && result > 0);
+        TEST(pw_compare(&half, &one, &result) && result < 0);
+        TEST(pw_compare(&minus_one, &big, &result) && result < 0);
+        TEST(pw_compare(&big, &minus_one, &result) && result > 0);
+        TEST(pw_compare(&big, &huge, &result) && result < 0);
+        TEST(pw_compare(&nan, &huge, &result) && result > 0);
+        TEST(pw_compare(&nan, &nan, &result) && result == 0);
+        PwValue abc = PwStaticString("abc");
+        PwValue abd = PwStaticString("abd");
+        PwValue ab = PwStaticString("ab");
+        PwValue wide = PW_STATIC_STRING_UTF32(U"ab\u20ac");
+        TEST(pw_compare(&abc, &abd, &result) && result < 0);
+        TEST(pw_compare(&ab, &abc, &result) && result < 0);
+        TEST(pw_compare(&wide, &abc, &result) && result > 0);
+        TEST(pw_compare(&abc, &abc, &result) && result == 0);
+        TEST(!pw_compare(&abc, &one, &result));
+        TEST(current_task->status.status_code == PW_ERROR_INCOMPATIBLE_TYPE);
+        PwValue ts1 = PwTimestamp(10, 5);
+        PwValue ts2 = PwTimestamp(10, 7);
+        TEST(pw_compare(&ts1, &ts2, &result) && result < 0);
+        PwValue a1 = PW_NULL;
+        PwValue a2 = PW_NULL;
+        TEST(pw_array_va(&a1, PwSigned(1), PwStaticString("b")));
+        TEST(pw_array_va(&a2, PwSigned(1), PwStaticString("b"), PwSigned(0)));
+        TEST(pw_compare(&a1, &a2, &result) && result < 0);
+
+        // mixed numbers
+        PwValue numbers = PW_NULL;
+        TEST(pw_array_va(&numbers, PwSigned(3), PwFloat(-1.5), PwUnsigned(2), PwFloat(NAN), PwSigned(0), PwSigned(-7)));
+        TEST(pw_array_sort(&numbers, nullptr));
+        PwValue v = PW_NULL;
+        TEST(pw_array_item(&numbers, 0, &v));
+        TEST(pw_equal(&v, -7));
+        TEST(pw_array_item(&numbers, 1, &v));
+        TEST(pw_equal(&v, -1.5));
+        TEST(pw_array_item(&numbers, 4, &v));
+        TEST(pw_equal(&v, 3));
+        TEST(pw_array_item(&numbers, 5, &v));
+        TEST(isnan(v.float_value));
+
+        // radix paths, and generic path for mixed numbers (Null)
+        uint8_t types[] = { PwTypeId_Signed, PwTypeId_Unsigned, PwTypeId_Float, PwTypeId_Timestamp, PwTypeId_Null };
+        for (unsigned t = 0; t < PW_LENGTH(types); t++) {{
+            PwValue values = PW_NULL;
+            TEST(pw_create_array(&values));
+            uint64_t x = 12345;
+            for (unsigned i = 0; i < 1000; i++) {{
+                x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+                PwValue item = PW_NULL;
+                switch (types[t]) {
+                    case PwTypeId_Signed:   item = PwSigned((int64_t) x); break;
+                    case PwTypeId_Unsigned: item = PwUnsigned(x); break;
+                    case PwTypeId_Float:    item = PwFloat((i == 500)? NAN : ((int64_t) x) / 1e6); break;
+                    case PwTypeId_Null:     item = (i & 1)? PwFloat((x >> 40) / 3.0) : PwSigned(x >> 40); break;
+                    default:                item = PwTimestamp(x >> 60, (x >> 8) & 0xFFFFF); break;
+                }
+                TEST(pw_array_append(&values, &item));
+            }}
+            TEST(pw_array_sort(&values, nullptr));
+            TEST(pw_array_length(&values) == 1000);
+            TEST(array_is_sorted(&values));
+        }}
+
+        // strings, stable and unstable, fast and generic paths
+        char* words[] = { "cherry", "apple", "banana", "avocado", "blueberry", "apricot", "cranberry" };
+        for (unsigned k = 0; k < 2; k++) {{
+            PwValue fruits = PW_NULL;
+            TEST(pw_create_array(&fruits));
+            for (unsigned i = 0; i < PW_LENGTH(words); i++) {
+                TEST(pw_array_append(&fruits, words[i]));
+            }
+            PwSortOptions options = { .stable = k };
+            TEST(pw_array_sort(&fruits, &options));
+            TEST(array_is_sorted(&fruits));
+            TEST(pw_array_item(&fruits, 0, &v));
+            TEST(pw_equal(&v, "apple"));
+        }}
+        for (unsigned k = 0; k < 2; k++) {{
+            PwValue fruits = PW_NULL;
+            TEST(pw_create_array(&fruits));
+            for (unsigned i = 0; i < PW_LENGTH(words); i++) {
+                TEST(pw_array_append(&fruits, words[i]));
+            }
+            PwSortOptions options = { .stable = true, .key = k? wrap_key : first_char_key };
+            TEST(pw_array_sort(&fruits, &options));
+            char* expected[] = { "apple", "avocado", "apricot", "banana", "blueberry", "cherry", "cranberry" };
+            for (unsigned i = 0; i < PW_LENGTH(expected); i++) {
+                TEST(pw_array_item(&fruits, i, &v));
+                TEST(pw_equal(&v, expected[i]));
+            }
+        }}
+        { // key function cannot modify the array
+            PwValue fruits = PW_NULL;
+            TEST(pw_create_array(&fruits));
+            for (unsigned i = 0; i < PW_LENGTH(words); i++) {
+                TEST(pw_array_append(&fruits, words[i]));
+            }
+            array_being_sorted = &fruits;
+            PwSortOptions options = { .key = modifying_key };
+            TEST(pw_array_sort(&fruits, &options));
+            TEST(pw_array_length(&fruits) == PW_LENGTH(words));
+            TEST(array_is_sorted(&fruits));
+            TEST(pw_array_append(&fruits, "date"));
+            array_being_sorted = nullptr;
+        }
+
+        // parallel sort of strings
+        PwValue many = PW_NULL;
+        TEST(pw_create_array(&many));
+        uint64_t x = 1;
+        for (unsigned i = 0; i < 100000; i++) {{
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            char buf[24];
+            snprintf(buf, sizeof(buf), "%llu", (unsigned long long) (x >> 20));
+            TEST(pw_array_append(&many, (char8_t*) buf));
+        }}
+        PwSortOptions options = { .num_threads = 4 };
+        TEST(pw_array_sort(&many, &options));
+        TEST(pw_array_length(&many) == 100000);
+        TEST(array_is_sorted(&many));
+
+        // incompatible items
+        PwValue mixed = PW_NULL;
+        TEST(pw_array_va(&mixed, PwSigned(2), PwStaticString("one"), PwSigned(1)));
+        TEST(!pw_array_sort(&mixed, nullptr));
+        TEST(current_task->status.status_code == PW_ERROR_INCOMPATIBLE_TYPE);
+        TEST(pw_array_item(&mixed, 0, &v));
+        TEST(pw_equal(&v, 2));
+    }
+    { // shared child
+        PwValue parents = PW_NULL;
+        TEST(pw_create_array(&parents));
+        PwValue first = PW_NULL;
+        TEST(pw_create_array(&first));
+        {
+            PwValue child = PW_NULL;
+            TEST(pw_create_array(&child));
+            TEST(pw_array_append(&first, &child));
+        }
+        TEST(pw_array_append(&parents, &first));
+        PwValuePtr child = get_array_struct_ptr(&first)->items;
+        _PwCompoundData* cdata = _pw_compound_data_ptr(child);
+        for (unsigned i = 1; i < 1000; i++) {{
+            PwValue parent = PW_NULL;
+            TEST(pw_create_array(&parent));
+            TEST(pw_array_append(&parent, child));
+            TEST(pw_array_append(&parent, child));
+            TEST(pw_array_append(&parents, &parent));
+        }}
+        TEST(cdata->using_parents_list);
+        TEST(cdata->num_parents_chunks > PW_PARENTS_LIST_MAX_CHUNKS);
+        TEST(cdata->num_parents == 1000);
+
+        // parent is removed from the set when its last reference to child is gone
+        for (unsigned i = 1; i < 996; i++) {{
+            PwValue parent = PW_NULL;
+            TEST(pw_array_item(&parents, i, &parent));
+            pw_array_del(&parent, 0, 1);
+            if (i == 1) {
+                TEST(cdata->num_parents == 1000);
+            }
+            pw_array_del(&parent, 0, 1);
+            if (i == 1) {
+                TEST(cdata->num_parents == 999);
+            }
+        }}
+        // back to plain list
+        TEST(cdata->using_parents_list);
+        TEST(cdata->num_parents_chunks == 1);
+        TEST(_pw_is_embraced(child));
+    }
+    { // acyclic mode
+        PwArrayCtorArgs args = { .acyclic = true };
+        PwValue child = PW_NULL;
+        TEST(pw_create2(PwTypeId_Array, &args, &child));
+        TEST(pw_array_append(&child, "leaf"));
+        _PwCompoundData* cdata = _pw_compound_data_ptr(&child);
+        TEST(cdata->acyclic);
+
+        // references from parents are counted, no parents are tracked
+        PwValue parents = PW_NULL;
+        TEST(pw_create_array(&parents));
+        for (unsigned i = 0; i < 3; i++) {
+            TEST(pw_array_append(&parents, &child));
+        }
+        TEST(child.struct_data->refcount == 4);
+        TEST(!_pw_is_embraced(&child));
+        PwValue v = PW_NULL;
+        TEST(pw_array_pull(&parents, &v));
+        TEST(child.struct_data->refcount == 4);
+        pw_destroy(&v);
+        TEST(child.struct_data->refcount == 3);
+
+        // acyclic map holding tracked and acyclic values
+        PwMapCtorArgs map_args = { .acyclic = true };
+        PwValue map = PW_NULL;
+        TEST(pw_create2(PwTypeId_Map, &map_args, &map));
+        PwValue child_key = PwStaticString("child");
+        PwValue parents_key = PwStaticString("parents");
+        TEST(pw_map_update(&map, &child_key, &child));
+        TEST(pw_map_update(&map, &parents_key, &parents));
+        TEST(_pw_is_embraced(&parents));
+        PwValue holder = PW_NULL;
+        TEST(pw_create_array(&holder));
+        TEST(pw_array_append(&holder, &map));
+        TEST(_pw_compound_data_ptr(&map)->struct_data.refcount == 2);
+
+        // deep copy keeps the mode
+        PwValue copy = PW_NULL;
+        TEST(pw_deepcopy(&child, &copy));
+        TEST(_pw_compound_data_ptr(&copy)->acyclic);
+        TEST(pw_equal(&copy, &child));
+
+        PwValue other = PW_NULL;
+        TEST(pw_create_array(&other));
+        pw_set_acyclic(&other);
+        TEST(pw_array_append(&other, &copy));
+        TEST(copy.struct_data->refcount == 2);
+        pw_array_clean(&other);
+        TEST(copy.struct_data->refcount == 1);
+
+        // parents is tracked, its reference from the map is not counted,
+        // so destroy it before the map
+        pw_array_clean(&parents);
+        pw_destroy(&parents);
+    }
+    { // deferred release
+        pw_set_deferred_release(100);
+        PwReclaimStats stats_before;
+        pw_reclaim_stats(&stats_before);
+        {
+            PwValue big = PW_NULL;
+            TEST(pw_create_array(&big));
+            PwValue nested = PW_NULL;
+            TEST(pw_create_array(&nested));
+            for (unsigned i = 0; i < 200; i++) {
+                TEST(pw_array_append(&nested, "a string that is too long to be embedded"));
+            }
+            TEST(pw_array_append(&big, &nested));
+            for (unsigned i = 0; i < 1000; i++) {
+                TEST(pw_array_append(&big, i));
+            }
+            PwValue small = PW_NULL;
+            TEST(pw_create_array(&small));
+            TEST(pw_array_append(&small, 1));
+        }
+        PwReclaimStats stats;
+        pw_reclaim_stats(&stats);
+        TEST(stats.queue_length == 1);
+        TEST(stats.num_deferred == stats_before.num_deferred + 1);
+
+        TEST(!pw_reclaim(10));
+        unsigned num_calls = 1;
+        while (!pw_reclaim(100)) {
+            num_calls++;
+        }
+        TEST(num_calls > 10);
+        pw_reclaim_stats(&stats);
+        TEST(stats.queue_length == 0);
+        TEST(stats.num_deferred == stats_before.num_deferred + 2);  // nested array was deferred too
+        TEST(stats.num_reclaimed == stats_before.num_reclaimed + 2);
+        TEST(stats.items_reclaimed >= stats_before.items_reclaimed + 1200);
+
+        {
+            PwValue map = PW_NULL;
+            TEST(pw_create_map(&map));
+            for (unsigned i = 0; i < 100; i++) {{
+                PwValue key = PwUnsigned(i);
+                PwValue value = PwSigned(-i);
+                TEST(pw_map_update(&map, &key, &value));
+            }}
+        }
+        pw_reclaim_stats(&stats);
+        TEST(stats.queue_length == 1);
+        TEST(!pw_reclaim(51));
+        pw_reclaim_all();
+        pw_reclaim_stats(&stats);
+        TEST(stats.queue_length == 0);
+
+        {
+            PwValue set = PW_NULL;
+            TEST(pw_create_set(&set));
+            for (unsigned i = 0; i < 200; i++) {
+                TEST(pw_set_add(&set, i));
+            }
+        }
+        pw_reclaim_stats(&stats);
+        TEST(stats.queue_length == 1);
+        TEST(!pw_reclaim(51));
+        pw_reclaim_all();
+        pw_reclaim_stats(&stats);
+        TEST(stats.queue_length == 0);
+        TEST(stats.reclaim_rate > 0.0);
+        pw_set_deferred_release(0);
+    }
+    { // growth policies
+        uint8_t policies[] = { PW_ARRAY_GROWTH_DOUBLE, PW_ARRAY_GROWTH_1_5X, PW_ARRAY_GROWTH_LINEAR };
+        unsigned num_resizes[PW_LENGTH(policies)];
+        for (unsigned p = 0; p < PW_LENGTH(policies); p++) {{
+            PwArrayCtorArgs args = { .growth = policies[p] };
+            PwValue array = PW_NULL;
+            if (!pw_create2(PwTypeId_Array, &args, &array)) {
+                panic();
+            }
+            _PwArray* a = get_array_struct_ptr(&array);
+            unsigned capacity = a->capacity;
+            num_resizes[p] = 0;
+            for (unsigned i = 0; i < 100000; i++) {
+                if (!pw_array_append(&array, i)) {
+                    panic();
+                }
+                if (a->capacity != capacity) {
+                    capacity = a->capacity;
+                    num_resizes[p]++;
+                }
+            }
+            TEST(pw_array_length(&array) == 100000);
+            TEST(a->capacity >= 100000);
+
+            // large arrays occupy whole pages
+            unsigned tail_size = a->capacity * sizeof(_PwValue) % sys_page_size;
+            TEST(tail_size == 0);
+
+            PwValue copy = PW_NULL;
+            TEST(pw_deepcopy(&array, &copy));
+            TEST(get_array_struct_ptr(&copy)->growth == policies[p]);
+            TEST(pw_equal(&array, &copy));
+
+            pw_array_del(&array, 10, 100000);
+            TEST(pw_array_shrink(&array));
+            TEST(a->capacity == 12);
+            TEST(pw_array_shrink(&array));
+            TEST(a->capacity == 12);
+            PwValue v = PW_NULL;
+            TEST(pw_array_item(&array, 9, &v));
+            TEST(pw_equal(&v, 9));
+        }}
+        TEST(num_resizes[0] < 20);
+        TEST(num_resizes[1] < 30);
+        TEST(num_resizes[2] > 500);
+
+        // presized array does not grow
+        PwArrayCtorArgs args = { .capacity = 1000 };
+        PwValue array = PW_NULL;
+        if (!pw_create2(PwTypeId_Array, &args, &array)) {
+            panic();
+        }
+        PwValuePtr items = get_array_struct_ptr(&array)->items;
+        for (unsigned i = 0; i < 1000; i++) {
+            if (!pw_array_append(&array, i)) {
+                panic();
+            }
+        }
+        TEST(get_array_struct_ptr(&array)->items == items);
+    }
+    { // borrowing iteration
+        PwValue array = PW_NULL;
+        if (!pw_array_va(&array, PwUnsigned(1), PwUnsigned(2), PwUnsigned(3))) {
+            panic();
+        }
+        unsigned sum = 0;
+        unsigned last_index = 0;
+        {
+            PwArrayCursor cursor = pw_array_cursor(&array);
+            while (pw_array_cursor_next(&cursor)) {
+                sum += cursor.item->unsigned_value;
+                last_index = cursor.index;
+                TEST(!pw_array_append(&array, 4U));
+                TEST(current_task->status.status_code == PW_ERROR_ITERATION_IN_PROGRESS);
+            }
+            TEST(!pw_array_cursor_next(&cursor));
+        }
+        TEST(sum == 6);
+        TEST(last_index == 2);
+
+        // cursor is stopped automatically, the array can be modified again
+        TEST(pw_array_append(&array, 4U));
+        TEST(pw_array_length(&array) == 4);
+
+        PwArrayCursor cursor = pw_array_cursor(&array);
+        TEST(pw_array_cursor_next(&cursor));
+        pw_array_cursor_stop(&cursor);
+        pw_array_cursor_stop(&cursor);
+        TEST(!pw_array_cursor_next(&cursor));
+        TEST(pw_array_append(&array, 5U));
+    }
 }
 
 void test_map()
@@ -1118,6 +2372,324 @@ void test_map()
         TEST(pw_map_length(&map) == 49);
         //pw_dump(stderr, &map);
     }
+    // delete: items keep insertion order and remain reachable
+    for (uint8_t engine = PW_MAP_ENGINE_LINEAR; engine <= PW_MAP_ENGINE_SWISS; engine++) {{
+        PwMapCtorArgs args = { .engine = engine };
+        PwValue map = PW_NULL;
+        if (!pw_create2(PwTypeId_Map, &args, &map)) {
+            panic();
+        }
+        for (unsigned i = 0; i < 1000; i++) {
+            PwValue key = PwUnsigned(i);
+            PwValue value = PwUnsigned(i * 10);
+            if (!pw_map_update(&map, &key, &value)) {
+                panic();
+            }
+        }
+        for (unsigned i = 0; i < 1000; i += 3) {
+            TEST(pw_map_del(&map, i));
+        }
+        TEST(!pw_map_del(&map, 3U));
+        TEST(pw_map_length(&map) == 666);
+
+        bool all_found = true;
+        bool all_ordered = true;
+        unsigned expected = 1;
+        for (unsigned i = 0; i < pw_map_length(&map); i++) {{
+            PwValue k = PW_NULL;
+            PwValue v = PW_NULL;
+            if (!pw_map_item(&map, i, &k, &v)) {
+                panic();
+            }
+            if (!pw_equal(&k, expected) || !pw_equal(&v, expected * 10)) {
+                all_ordered = false;
+            }
+            expected += (expected % 3 == 1)? 1 : 2;
+        }}
+        for (unsigned i = 0; i < 1000; i++) {
+            if (pw_map_has_key(&map, i) != (i % 3 != 0)) {
+                all_found = false;
+            }
+        }
+        TEST(all_ordered);
+        TEST(all_found);
+        {
+            PwValue k = PW_NULL;
+            PwValue v = PW_NULL;
+            TEST(pw_map_item(&map, 665, &k, &v));
+            TEST(pw_equal(&k, 998));
+            TEST(!pw_map_item(&map, 666, &k, &v));
+        }
+
+        // re-insert deleted key, it goes to the end
+        PwValue key = PwUnsigned(0);
+        PwValue value = PwUnsigned(0);
+        if (!pw_map_update(&map, &key, &value)) {
+            panic();
+        }
+        TEST(pw_map_length(&map) == 667);
+        {
+            PwValue k = PW_NULL;
+            PwValue v = PW_NULL;
+            TEST(pw_map_item(&map, 666, &k, &v));
+            TEST(pw_equal(&k, 0));
+        }
+
+        // delete all
+        for (unsigned i = 0; i < 1000; i++) {
+            if (i % 3 != 0 || i == 0) {
+                TEST(pw_map_del(&map, i));
+            }
+        }
+        TEST(pw_map_length(&map) == 0);
+
+        // string keys, lookup by strings of different char width
+        for (unsigned i = 0; i < 200; i++) {
+            char k[16];
+            sprintf(k, "key%u", i);
+            PwValue key = PW_NULL;
+            if (!pw_create_string(k, &key)) {
+                panic();
+            }
+            PwValue value = PwUnsigned(i);
+            if (!pw_map_update(&map, &key, &value)) {
+                panic();
+            }
+        }
+        TEST(pw_map_length(&map) == 200);
+        TEST(pw_map_has_key(&map, "key199"));
+        TEST(pw_map_has_key(&map, U"key7"));
+        TEST(!pw_map_has_key(&map, "key200"));
+        {
+            PwValue v = PW_NULL;
+            TEST(pw_map_get(&map, U"key123", &v));
+            TEST(pw_equal(&v, 123));
+        }
+        {
+            PwValue map_copy = PW_NULL;
+            if (!pw_deepcopy(&map, &map_copy)) {
+                panic();
+            }
+            TEST(pw_equal(&map, &map_copy));
+            TEST(pw_map_has_key(&map_copy, "key42"));
+        }
+        { // lookup by UTF-8 buffer without temporary string
+            char8_t buf[] = { 'k', 'e', 'y', '1', '2', '3', '4' };
+            TEST(pw_map_has_key_utf8_buf(&map, buf, 6));
+            TEST(!pw_map_has_key_utf8_buf(&map, buf, 7));
+            TEST(pw_map_has_key(&map, (char8_t*) "key42"));
+            TEST(!pw_map_has_key(&map, (char8_t*) "key\xff"));
+            PwValue v = PW_NULL;
+            TEST(pw_map_get_utf8_buf(&map, buf, 5, &v));
+            TEST(pw_equal(&v, 12));
+
+            PwValue key = PW_NULL;
+            if (!pw_create_string(U"สวัสดี", &key)) {
+                panic();
+            }
+            PwValue value = PwBool(true);
+            if (!pw_map_update(&map, &key, &value)) {
+                panic();
+            }
+            char8_t* hello = (char8_t*) u8"สวัสดี!";
+            unsigned hello_size = strlen((char*) hello) - 1;
+            TEST(pw_map_get_utf8_buf(&map, hello, hello_size, &v));
+            TEST(pw_equal(&v, true));
+            TEST(!pw_map_has_key_utf8_buf(&map, hello, hello_size - 1));
+            TEST(pw_map_del_utf8_buf(&map, hello, hello_size));
+            TEST(!pw_map_has_key(&map, U"สวัสดี"));
+
+            // overlong sequences are skipped by lookups the same way as by string creation:
+            // "\xC1\xB9" would be 'y' and "\xC1\x81" would be 'A' if decoded leniently
+            char8_t* overlong_y = (char8_t*) "ke\xC1\xB9" "7";
+            char8_t* overlong_a = (char8_t*) "key\xC1\x81" "7";
+            TEST(!pw_map_has_key_utf8_buf(&map, overlong_y, 5));
+            TEST(pw_map_get_utf8_buf(&map, overlong_a, 6, &v));
+            TEST(pw_equal(&v, 7));
+            PwValue created_y = PW_NULL;
+            PwValue created_a = PW_NULL;
+            if (!pw_create_string(overlong_y, &created_y) || !pw_create_string(overlong_a, &created_a)) {
+                panic();
+            }
+            TEST(!pw_map_has_key(&map, &created_y));
+            TEST(pw_map_has_key(&map, &created_a));
+            PwValue key7 = PwStaticString("key7");
+            TEST(pw_equal(&created_a, &key7));
+            TEST(pw_hash(&created_a) == pw_hash(&key7));
+        }
+        for (unsigned i = 0; i < 200; i++) {
+            char k[16];
+            sprintf(k, "key%u", i);
+            TEST(pw_map_del(&map, k));
+        }
+        TEST(pw_map_length(&map) == 0);
+
+        PwValue empty_map = PW_NULL;
+        if (!pw_create_map(&empty_map)) {
+            panic();
+        }
+        TEST(pw_equal(&map, &empty_map));
+    }}
+    { // presized maps do not grow
+        PwValue map = PW_NULL;
+        if (!pw_create_map(&map)) {
+            panic();
+        }
+        if (!pw_map_reserve(&map, 1000)) {
+            panic();
+        }
+        _PwMap* m = (_PwMap*) map.struct_data;
+        unsigned ht_capacity = m->hash_table.capacity;
+        PwValuePtr kv_items = m->kv_pairs.items;
+        for (unsigned i = 0; i < 1000; i++) {
+            PwValue key = PwUnsigned(i);
+            PwValue value = PwUnsigned(i);
+            if (!pw_map_update(&map, &key, &value)) {
+                panic();
+            }
+        }
+        TEST(m->hash_table.capacity == ht_capacity);
+        TEST(m->kv_pairs.items == kv_items);
+
+        _PwValue pairs[8] = {
+            PwUnsigned(1), PwString("one"),
+            PwUnsigned(2), PwNull(),
+            PwUnsigned(1), PwString("uno"),
+            PwString("list"), PW_NULL
+        };
+        if (!pw_create_array(&pairs[7])) {
+            panic();
+        }
+        PwValue bulk_map = PW_NULL;
+        if (!pw_create_map_from_pairs(pairs, 4, &bulk_map)) {
+            panic();
+        }
+        TEST(pw_map_length(&bulk_map) == 3);
+        TEST(pw_is_null(&pairs[0]) && pw_is_null(&pairs[7]));
+        PwValue v = PW_NULL;
+        TEST(pw_map_get(&bulk_map, 1U, &v));
+        TEST(pw_equal(&v, "uno"));
+        TEST(pw_map_get(&bulk_map, "list", &v));
+        TEST(pw_is_array(&v));
+
+        // keys are deep-copied, changing the caller's copy does not affect the map
+        PwValue key_array = PW_NULL;
+        TEST(pw_array_va(&key_array, PwUnsigned(1)));
+        _PwValue compound_pairs[2] = { pw_clone(&key_array), PwUnsigned(1) };
+        PwValue compound_map = PW_NULL;
+        TEST(pw_create_map_from_pairs(compound_pairs, 1, &compound_map));
+        TEST(pw_array_append(&key_array, 2U));
+        PwValue original_key = PW_NULL;
+        TEST(pw_array_va(&original_key, PwUnsigned(1)));
+        TEST(pw_map_has_key(&compound_map, &original_key));
+        TEST(!pw_map_has_key(&compound_map, &key_array));
+    }
+    for (uint8_t engine = PW_MAP_ENGINE_LINEAR; engine <= PW_MAP_ENGINE_SWISS; engine++) {{
+        // absurd capacities fail instead of overflowing
+
+        PwMapCtorArgs args = { .engine = engine, .capacity = UINT_MAX };
+        PwValue map = PW_NULL;
+        TEST(!pw_create2(PwTypeId_Map, &args, &map));
+        TEST(current_task->status.status_code == PW_ERROR_DATA_SIZE_TOO_BIG);
+
+        args.capacity = 0;
+        if (!pw_create2(PwTypeId_Map, &args, &map)) {
+            panic();
+        }
+        TEST(!pw_map_reserve(&map, 0x80000004));
+        TEST(current_task->status.status_code == PW_ERROR_DATA_SIZE_TOO_BIG);
+        TEST(!pw_map_reserve(&map, UINT_MAX));
+        TEST(current_task->status.status_code == PW_ERROR_DATA_SIZE_TOO_BIG);
+        PwValue one = PwUnsigned(1);
+        TEST(pw_map_update(&map, &one, &one));
+        TEST(pw_map_del(&map, 1U));
+        TEST(!pw_map_reserve(&map, UINT_MAX));  // capacity + num_deleted must not wrap
+        TEST(current_task->status.status_code == PW_ERROR_DATA_SIZE_TOO_BIG);
+        TEST(pw_map_length(&map) == 0);
+
+        PwValue set = PW_NULL;
+        if (!pw_create_set(&set)) {
+            panic();
+        }
+        TEST(!pw_set_reserve(&set, 0x80000004));
+        TEST(current_task->status.status_code == PW_ERROR_DATA_SIZE_TOO_BIG);
+    }}
+    for (uint8_t engine = PW_MAP_ENGINE_LINEAR; engine <= PW_MAP_ENGINE_SWISS; engine++) {{
+        // small maps have no hash table until they grow
+
+        PwMapCtorArgs args = { .engine = engine };
+        PwValue map = PW_NULL;
+        if (!pw_create2(PwTypeId_Map, &args, &map)) {
+            panic();
+        }
+        _PwMap* m = (_PwMap*) map.struct_data;
+        for (unsigned i = 0; i < PWMAP_SMALL_CAPACITY; i++) {
+            char buf[8];
+            sprintf(buf, "k%u", i);
+            PwValue key = PW_NULL;
+            if (!pw_create_string(buf, &key)) {
+                panic();
+            }
+            PwValue value = PwUnsigned(i);
+            if (!pw_map_update(&map, &key, &value)) {
+                panic();
+            }
+        }
+        TEST(_pw_map_is_small(m));
+        TEST(pw_map_has_key(&map, "k0"));
+        TEST(pw_map_has_key(&map, "k7"));
+        TEST(!pw_map_has_key(&map, "k8"));
+        TEST(!pw_map_has_key(&map, "K0"));
+        TEST(pw_map_has_key_utf8_buf(&map, (char8_t*) "k3", 2));
+        TEST(pw_map_has_key_utf8_buf(&map, (char8_t*) "k3\xff", 3));  // invalid byte is skipped, as by pw_create_string
+        TEST(!pw_map_has_key_utf8_buf(&map, (char8_t*) "k\xC1\xB3", 3));  // overlong '3'
+
+        // pairs are removed from small map immediately
+        TEST(pw_map_del(&map, "k3"));
+        TEST(m->num_deleted == 0);
+        TEST(pw_map_length(&map) == PWMAP_SMALL_CAPACITY - 1);
+        TEST(!pw_map_has_key(&map, "k3"));
+
+        // compound values keep their parent when the map grows
+        PwValue list = PW_NULL;
+        if (!pw_create_array(&list)) {
+            panic();
+        }
+        PwValue list_key = PwString("list");
+        if (!pw_map_update(&map, &list_key, &list)) {
+            panic();
+        }
+        TEST(_pw_map_is_small(m));
+        PwValue k8 = PwString("k8");
+        PwValue v8 = PwUnsigned(8);
+        if (!pw_map_update(&map, &k8, &v8)) {
+            panic();
+        }
+        TEST(!_pw_map_is_small(m));
+        TEST(m->hash_table.items != nullptr);
+        TEST(m->engine == engine);
+        TEST(pw_map_length(&map) == PWMAP_SMALL_CAPACITY + 1);
+
+        PwValue key = PW_NULL;
+        PwValue value = PW_NULL;
+        TEST(pw_map_item(&map, 0, &key, &value));
+        TEST(pw_equal(&key, "k0"));
+        TEST(pw_map_item(&map, 3, &key, &value));
+        TEST(pw_equal(&key, "k4"));
+        TEST(pw_map_item(&map, PWMAP_SMALL_CAPACITY - 1, &key, &value));
+        TEST(pw_equal(&key, "list"));
+        TEST(pw_map_get(&map, "k8", &value));
+        TEST(pw_equal(&value, 8U));
+        TEST(pw_map_get_utf8_buf(&map, (char8_t*) "k7", 2, &value));
+        TEST(pw_equal(&value, 7U));
+        TEST(!pw_map_has_key(&map, "k3"));
+
+        PwValue copy = PW_NULL;
+        if (!pw_deepcopy(&map, &copy)) {
+            panic();
+        }
+        TEST(pw_equal(&copy, &map));
+    }}
     {
         PwValue map = PW_NULL;
         if (!pw_map_va(&map,
@@ -1135,6 +2707,303 @@ void test_map()
         TEST(pw_map_length(&map) == 8);
         //pw_dump(stderr, &map);
     }
+    for (unsigned n = PWMAP_SMALL_CAPACITY; n <= 100; n += 100 - PWMAP_SMALL_CAPACITY) {{
+        // borrowing iteration, small and hashed maps with deleted pairs
+
+        PwValue map = PW_NULL;
+        if (!pw_create_map(&map)) {
+            panic();
+        }
+        for (unsigned i = 0; i < n; i++) {
+            PwValue key = PwUnsigned(i);
+            PwValue value = PwUnsigned(i * 10);
+            if (!pw_map_update(&map, &key, &value)) {
+                panic();
+            }
+        }
+        TEST(pw_map_del(&map, 0U));
+        TEST(pw_map_del(&map, 5U));
+        {
+            unsigned count = 0;
+            unsigned last_key = 0;
+            PwMapCursor cursor = pw_map_cursor(&map);
+            while (pw_map_cursor_next(&cursor)) {
+                TEST(cursor.index == count);
+                TEST(cursor.value->unsigned_value == cursor.key->unsigned_value * 10);
+                TEST(cursor.key->unsigned_value > last_key);
+                last_key = cursor.key->unsigned_value;
+                count++;
+            }
+            TEST(count == n - 2);
+            TEST(last_key == n - 1);
+
+            PwValue key = PwUnsigned(n);
+            PwValue value = PwNull();
+            TEST(!pw_map_update(&map, &key, &value));
+            TEST(current_task->status.status_code == PW_ERROR_ITERATION_IN_PROGRESS);
+            TEST(!pw_map_del(&map, 1U));
+            TEST(!pw_map_reserve(&map, 1000));
+            TEST(pw_map_has_key(&map, 1U));
+        }
+        TEST(pw_map_del(&map, 1U));
+        TEST(pw_map_length(&map) == n - 3);
+    }}
+    { // get-or-insert slots
+        PwValue map = PW_NULL;
+        if (!pw_create_map(&map)) {
+            panic();
+        }
+        PwValue zero = PwUnsigned(0);
+        for (unsigned i = 0; i < 1000; i++) {
+            PwMapSlot counter = PW_MAP_SLOT_NULL;
+            if (!pw_map_slot(&map, i % 20, &zero, &counter)) {
+                panic();
+            }
+            counter.value->unsigned_value++;
+        }
+        TEST(pw_map_length(&map) == 20);
+        PwValue v = PW_NULL;
+        TEST(pw_map_get(&map, 0, &v));
+        TEST(pw_equal(&v, 50U));
+        TEST(pw_map_get(&map, 19, &v));
+        TEST(pw_equal(&v, 50U));
+
+        // each key gets its own list
+        PwValue empty_list = PW_NULL;
+        if (!pw_create_array(&empty_list)) {
+            panic();
+        }
+        char* words[] = { "apple", "avocado", "banana", "apricot", "blueberry", "cherry" };
+        char* initials[] = { "a", "a", "b", "a", "b", "c" };
+        for (unsigned i = 0; i < PW_LENGTH(words); i++) {
+            PwMapSlot list = PW_MAP_SLOT_NULL;
+            if (!pw_map_slot(&map, initials[i], &empty_list, &list)) {
+                panic();
+            }
+            if (!pw_array_append(list.value, words[i])) {
+                panic();
+            }
+        }
+        TEST(pw_array_length(&empty_list) == 0);
+        TEST(pw_map_get(&map, "a", &v));
+        TEST(pw_array_length(&v) == 3);
+        TEST(pw_map_get(&map, "b", &v));
+        TEST(pw_array_length(&v) == 2);
+        TEST(pw_map_get(&map, u8"c", &v));
+        TEST(pw_array_length(&v) == 1);
+
+        pw_destroy(&v);
+
+        // active slot holds the map
+        PwMapSlot slot = PW_MAP_SLOT_NULL;
+        TEST(pw_map_slot(&map, "c", &empty_list, &slot));
+        TEST(!pw_map_update(&map, &zero, &zero));
+        TEST(current_task->status.status_code == PW_ERROR_ITERATION_IN_PROGRESS);
+        TEST(!pw_map_del(&map, "a"));
+        TEST(current_task->status.status_code == PW_ERROR_ITERATION_IN_PROGRESS);
+
+        // replaced compound value is attached to the map
+        PwValue new_list = PW_NULL;
+        if (!pw_create_array(&new_list)) {
+            panic();
+        }
+        PwValue new_list_ref = pw_clone(&new_list);
+        TEST(pw_map_slot_put(&slot, &new_list));
+        TEST(new_list.type_id == PwTypeId_Null);
+        TEST(slot.value->struct_data == new_list_ref.struct_data);
+        pw_map_slot_release(&slot);
+        pw_map_slot_release(&slot);
+        TEST(pw_map_update(&map, &zero, &zero));
+        TEST(pw_map_get(&map, "c", &v));
+        TEST(pw_array_length(&v) == 0);
+
+        // existing slots are available during iteration, insertion is not
+        PwMapCursor cursor = pw_map_cursor(&map);
+        TEST(pw_map_slot(&map, 5, &zero, &slot));
+        pw_map_slot_release(&slot);
+        TEST(!pw_map_slot(&map, 20, &zero, &slot));
+        TEST(current_task->status.status_code == PW_ERROR_ITERATION_IN_PROGRESS);
+        pw_map_cursor_stop(&cursor);
+        TEST(pw_map_slot(&map, 20, &zero, &slot));
+    }
+}
+
+void test_set()
+{
+    { // small set
+        PwValue set = PW_NULL;
+        if (!pw_create_set(&set)) {
+            panic();
+        }
+        TEST(pw_set_length(&set) == 0);
+        TEST(!pw_is_true(&set));
+        TEST(pw_set_add(&set, "one"));
+        TEST(pw_set_add(&set, 2));
+        TEST(pw_set_add(&set, nullptr));
+        TEST(pw_set_add(&set, "one"));
+        TEST(pw_set_length(&set) == 3);
+        TEST(pw_set_contains(&set, "one"));
+        TEST(pw_set_contains(&set, (char8_t*) u8"one"));
+        TEST(pw_set_contains(&set, 2U));
+        TEST(pw_set_contains(&set, nullptr));
+        TEST(!pw_set_contains(&set, 3));
+        TEST(pw_set_remove(&set, nullptr));
+        TEST(!pw_set_contains(&set, nullptr));
+        TEST(!pw_set_remove(&set, nullptr));
+        TEST(current_task->status.status_code == PW_ERROR_KEY_NOT_FOUND);
+        TEST(pw_set_length(&set) == 2);
+        TEST(_pw_map_is_small((_PwMap*) set.struct_data));
+    }
+    { // hashed set with deletions
+        PwValue set = PW_NULL;
+        if (!pw_create_set(&set)) {
+            panic();
+        }
+        unsigned n = 1000;
+        for (unsigned i = 0; i < n; i++) {
+            if (!pw_set_add(&set, i)) {
+                panic();
+            }
+        }
+        TEST(pw_set_length(&set) == n);
+        for (unsigned i = 0; i < n; i += 2) {
+            if (!pw_set_remove(&set, i)) {
+                panic();
+            }
+        }
+        TEST(pw_set_length(&set) == n / 2);
+        TEST(!pw_set_contains(&set, 0U));
+        TEST(pw_set_contains(&set, 1U));
+        TEST(pw_set_contains(&set, n - 1));
+
+        // cursor goes in the insertion order and skips deleted items
+        unsigned count = 0;
+        unsigned last_item = 0;
+        PwSetCursor cursor = pw_set_cursor(&set);
+        while (pw_set_cursor_next(&cursor)) {
+            TEST(cursor.index == count);
+            TEST(cursor.item->unsigned_value > last_item);
+            TEST(cursor.item->unsigned_value & 1);
+            last_item = cursor.item->unsigned_value;
+            count++;
+        }
+        TEST(count == n / 2);
+        TEST(!pw_set_add(&set, n));
+        TEST(current_task->status.status_code == PW_ERROR_ITERATION_IN_PROGRESS);
+        TEST(!pw_set_remove(&set, 1U));
+        pw_set_cursor_stop(&cursor);
+        TEST(pw_set_add(&set, n));
+        TEST(pw_set_length(&set) == n / 2 + 1);
+    }
+    for (uint8_t engine = PW_MAP_ENGINE_LINEAR; engine <= PW_MAP_ENGINE_SWISS; engine++) {{
+        // algebra, small and hashed operands
+        unsigned sizes[] = { 3, 8, 100 };
+        for (unsigned i = 0; i < PW_LENGTH(sizes); i++) {
+            for (unsigned j = 0; j < PW_LENGTH(sizes); j++) {{
+                // a is multiples of 2, b is multiples of 3
+                // results keep the acyclic mode of operands
+                bool acyclic = (i == j);
+                PwMapCtorArgs args = { .engine = engine, .acyclic = acyclic };
+                PwValue a = PW_NULL;
+                PwValue b = PW_NULL;
+                if (!pw_create2(PwTypeId_Set, &args, &a)) {
+                    panic();
+                }
+                if (!pw_create2(PwTypeId_Set, &args, &b)) {
+                    panic();
+                }
+                for (unsigned k = 0; k < sizes[i]; k++) {
+                    if (!pw_set_add(&a, k * 2)) {
+                        panic();
+                    }
+                }
+                for (unsigned k = 0; k < sizes[j]; k++) {
+                    if (!pw_set_add(&b, k * 3)) {
+                        panic();
+                    }
+                }
+                PwValue u = PW_NULL;
+                PwValue x = PW_NULL;
+                PwValue d = PW_NULL;
+                if (!pw_set_union(&a, &b, &u)) {
+                    panic();
+                }
+                if (!pw_set_intersection(&a, &b, &x)) {
+                    panic();
+                }
+                if (!pw_set_difference(&a, &b, &d)) {
+                    panic();
+                }
+                unsigned num_u = 0, num_x = 0, num_d = 0;
+                for (unsigned k = 0; k < 300; k++) {
+                    bool in_a = (k % 2 == 0) && k / 2 < sizes[i];
+                    bool in_b = (k % 3 == 0) && k / 3 < sizes[j];
+                    TEST(pw_set_contains(&u, k) == (in_a || in_b));
+                    TEST(pw_set_contains(&x, k) == (in_a && in_b));
+                    TEST(pw_set_contains(&d, k) == (in_a && !in_b));
+                    num_u += in_a || in_b;
+                    num_x += in_a && in_b;
+                    num_d += in_a && !in_b;
+                }
+                TEST(pw_set_length(&u) == num_u);
+                TEST(pw_set_length(&x) == num_x);
+                TEST(pw_set_length(&d) == num_d);
+                TEST(pw_set_length(&a) == sizes[i]);
+                TEST(pw_set_length(&b) == sizes[j]);
+                TEST(_pw_compound_data_ptr(&u)->acyclic == acyclic);
+                TEST(_pw_compound_data_ptr(&x)->acyclic == acyclic);
+                TEST(_pw_compound_data_ptr(&d)->acyclic == acyclic);
+            }}
+        }
+    }}
+    { // bulk insert, equality, deepcopy
+        PwValue items = PW_NULL;
+        if (!pw_create_array(&items)) {
+            panic();
+        }
+        for (unsigned i = 0; i < 50; i++) {
+            if (!pw_array_append(&items, i % 25)) {
+                panic();
+            }
+        }
+        PwValue a = PW_NULL;
+        if (!pw_create_set(&a)) {
+            panic();
+        }
+        TEST(pw_set_update(&a, &items));
+        TEST(pw_set_length(&a) == 25);
+
+        // same items in reverse order
+        PwValue b = PW_NULL;
+        if (!pw_create_set(&b)) {
+            panic();
+        }
+        for (unsigned i = 25; i--;) {
+            if (!pw_set_add(&b, i)) {
+                panic();
+            }
+        }
+        TEST(pw_equal(&a, &b));
+        TEST(pw_hash(&a) == pw_hash(&b));
+        TEST(pw_set_remove(&b, 0U));
+        TEST(!pw_equal(&a, &b));
+        TEST(pw_set_update(&b, &a));
+        TEST(pw_equal(&a, &b));
+        TEST(pw_set_update(&b, &b));
+        TEST(pw_set_length(&b) == 25);
+
+        PwValue c = PW_NULL;
+        TEST(pw_deepcopy(&b, &c));
+        TEST(pw_equal(&b, &c));
+        TEST(pw_set_add(&c, "extra"));
+        TEST(!pw_set_contains(&b, "extra"));
+
+        PwValue s = pwva_set(PwString("x"), PwString("y"), PwString("x"), PwUnsigned(1));
+        TEST(pw_is_set(&s));
+        TEST(pw_set_length(&s) == 3);
+        TEST(pw_set_contains(&s, "y"));
+        TEST(pw_set_contains(&s, 1));
+    }
 }
 
 void test_file()
@@ -1778,11 +3647,12 @@ int main(int argc, char* argv[])
         panic();
     }
 
-    test_icu();
+    test_unicode();
     test_integral_types();
     test_string();
     test_array();
     test_map();
+    test_set();
     test_file();
     test_string_io();
     test_netutils();
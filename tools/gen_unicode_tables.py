@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+
+'''
+Generate character property and case mapping tables for include/pw_unicode.h
+
+Usage:
+
+    tools/gen_unicode_tables.py > src/pw_unicode_tables.c
+    tools/gen_unicode_tables.py --ucd UnicodeData.txt --version 15.0.0 > src/pw_unicode_tables.c
+
+Without --ucd the data of Python's unicodedata module is used.
+
+Each code point maps to a record that contains classification flags
+and deltas of simple lower and upper case mappings.
+Records are looked up with two-stage table: the index of a block
+of BLOCK_SIZE code points, and the block that contains record numbers.
+Identical blocks are stored once.
+
+Flags follow definitions of ICU functions u_isspace, u_isalpha, etc.
+'''
+
+import argparse
+import sys
+import unicodedata
+
+MAX_CODEPOINT = 0x10FFFF
+
+# must match include/pw_unicode.h
+BLOCK_SHIFT = 7
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+
+FLAGS = [
+    'SPACE',
+    'BLANK',
+    'ALPHA',
+    'DIGIT',
+    'PUNCT',
+    'CNTRL',
+    'GRAPH',
+    'PRINT'
+]
+
+
+def char_flags(c, category):
+    flags = set()
+    if category[0] == 'Z' or (c <= 0x9f and (0x09 <= c <= 0x0d or 0x1c <= c <= 0x1f or c == 0x85)):
+        flags.add('SPACE')
+    if (c in (0x09, 0x20)) if c <= 0x9f else (category == 'Zs'):
+        flags.add('BLANK')
+    if category[0] == 'L':
+        flags.add('ALPHA')
+    if category == 'Nd':
+        flags.add('DIGIT')
+    if category[0] == 'P':
+        flags.add('PUNCT')
+    if category in ('Cc', 'Cf', 'Zl', 'Zp'):
+        flags.add('CNTRL')
+    if not (category in ('Cc', 'Cf', 'Cs', 'Cn') or category[0] == 'Z'):
+        flags.add('GRAPH')
+    if category[0] != 'C':
+        flags.add('PRINT')
+    return sum(1 << FLAGS.index(name) for name in flags)
+
+
+def read_unicodedata(filename):
+    '''
+    Return list of (category, lower, upper) for all code points.
+    '''
+    data = [('Cn', c, c) for c in range(MAX_CODEPOINT + 1)]
+    range_start = None
+    with open(filename) as f:
+        for line in f:
+            fields = line.strip().split(';')
+            if len(fields) < 15:
+                continue
+            c = int(fields[0], 16)
+            category = fields[2]
+            upper = int(fields[12], 16) if fields[12] else c
+            lower = int(fields[13], 16) if fields[13] else c
+            if fields[1].endswith(', First>'):
+                range_start = c
+                continue
+            if fields[1].endswith(', Last>'):
+                for rc in range(range_start, c + 1):
+                    data[rc] = (category, rc, rc)
+                continue
+            data[c] = (category, lower, upper)
+    return data
+
+
+def read_python_unicodedata():
+    '''
+    Same as above, for unicodedata module.
+
+    Python provides full case mappings only. Simple mappings are derived:
+    a lower case mapping to several characters keeps the first one if the rest
+    are combining marks, and an upper case mapping to several characters is
+    replaced with single-character title case mapping, if any.
+    '''
+    data = []
+    for c in range(MAX_CODEPOINT + 1):
+        char = chr(c)
+        category = unicodedata.category(char)
+
+        lower = char.lower()
+        if len(lower) > 1 and all(unicodedata.category(m) == 'Mn' for m in lower[1:]):
+            lower = lower[0]
+        upper = char.upper()
+        if len(upper) > 1:
+            upper = char.title()
+
+        data.append((
+            category,
+            ord(lower) if len(lower) == 1 else c,
+            ord(upper) if len(upper) == 1 else c
+        ))
+    return data
+
+
+def format_array(values, indent='    ', per_line=16):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append(indent + ', '.join(str(v) for v in values[i:i + per_line]) + ',')
+    lines[-1] = lines[-1][:-1]
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate Unicode tables')
+    parser.add_argument('--ucd', help='path to UnicodeData.txt')
+    parser.add_argument('--version', help='Unicode version of UnicodeData.txt, e.g. 15.0.0')
+    args = parser.parse_args()
+
+    if args.ucd:
+        if not args.version:
+            parser.error('--version is required with --ucd')
+        data = read_unicodedata(args.ucd)
+        version = args.version
+        source = 'UnicodeData.txt'
+    else:
+        data = read_python_unicodedata()
+        version = unicodedata.unidata_version
+        source = 'Python unicodedata module'
+
+    # record 0 is for code points without properties
+    records = {(0, 0, 0): 0}
+    record_numbers = []
+    for c, (category, lower, upper) in enumerate(data):
+        record = (char_flags(c, category), lower - c, upper - c)
+        record_numbers.append(records.setdefault(record, len(records)))
+
+    blocks = {}
+    index = []
+    for start in range(0, MAX_CODEPOINT + 1, BLOCK_SIZE):
+        block = tuple(record_numbers[start : start + BLOCK_SIZE])
+        index.append(blocks.setdefault(block, len(blocks)))
+
+    if len(records) > 256 or len(blocks) > 256:
+        sys.exit(f'{len(records)} records and {len(blocks)} blocks do not fit uint8_t,'
+                 ' change types in include/pw_unicode.h')
+
+    version_numbers = [int(n) for n in version.split('.')] + [0, 0]
+
+    out = []
+    out.append('/*')
+    out.append(f' * Generated by tools/gen_unicode_tables.py from {source}, Unicode {version}')
+    out.append(' *')
+    out.append(' * Do not edit.')
+    out.append(' */')
+    out.append('')
+    out.append('#include "include/pw_unicode.h"')
+    out.append('')
+    out.append(f'static_assert(_PW_UNICODE_BLOCK_SHIFT == {BLOCK_SHIFT});')
+    out.append('')
+    out.append('const uint8_t pw_unicode_version[3] = { %d, %d, %d };' % tuple(version_numbers[:3]))
+    out.append('')
+    out.append(f'const _PwUnicodeRecord _pw_unicode_records[{len(records)}] = {{')
+    for i, (flags, lower_delta, upper_delta) in enumerate(records):
+        comma = ',' if i < len(records) - 1 else ''
+        out.append(f'    {{ 0x{flags:02x}, {lower_delta}, {upper_delta} }}{comma}')
+    out.append('};')
+    out.append('')
+    out.append(f'const uint8_t _pw_unicode_index[{len(index)}] = {{')
+    out.append(format_array(index))
+    out.append('};')
+    out.append('')
+    out.append(f'const uint8_t _pw_unicode_blocks[{len(blocks) * BLOCK_SIZE}] = {{')
+    out.append(format_array([n for block in blocks for n in block]))
+    out.append('};')
+    print('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()